@@ -9,13 +9,22 @@
 #define BOOST_CHRONO_HEADER_ONLY
 #include <boost/chrono/process_cpu_clocks.hpp>
 #include <boost/chrono.hpp>
+#include <boost/optional.hpp>
 
 // stl
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <set>
 #include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
 
 namespace benchmark {
 
@@ -39,11 +48,198 @@ public:
     {
         return iterations_;
     }
+    mapnik::parameters const& params() const
+    {
+        return params_;
+    }
     virtual bool validate() const = 0;
     virtual void operator()() const = 0;
     virtual ~test_case() {}
 };
 
+// Options every benchmark understands, besides --threads and --iterations:
+//
+//  --warmup N      untimed runs before sampling (default 1)
+//  --samples N     timed runs to take statistics over (default 5)
+//  --report F      text (default), json or csv; json and csv go to stdout
+//                  as one line per run, so the outputs of several
+//                  benchmarks can be concatenated into one file
+//  --csv-header 1  write the csv column names before the result line
+//  --baseline F    json lines of an earlier run to compare the median
+//                  wall time against; a benchmark slower than the
+//                  baseline by more than --tolerance (default 0.05)
+//                  exits with 1
+struct run_options
+{
+    run_options(mapnik::parameters const& params)
+        : warmup(*params.get<mapnik::value_integer>("warmup",1)),
+          samples(std::max<mapnik::value_integer>(1, *params.get<mapnik::value_integer>("samples",5))),
+          report(*params.get<std::string>("report","text")),
+          baseline(*params.get<std::string>("baseline","")),
+          tolerance(*params.get<mapnik::value_double>("tolerance",0.05)),
+          csv_header(*params.get<mapnik::value_integer>("csv-header",0) != 0) {}
+
+    std::size_t warmup;
+    std::size_t samples;
+    std::string report;
+    std::string baseline;
+    double tolerance;
+    bool csv_header;
+};
+
+struct summary
+{
+    double min;
+    double median;
+    double p95;
+    double p99;
+    double mean;
+};
+
+// nearest rank percentiles, so each is one of the measured values
+summary summarize(std::vector<double> values)
+{
+    summary result = { 0, 0, 0, 0, 0 };
+    if (values.empty()) return result;
+    std::sort(values.begin(), values.end());
+    auto rank = [&values](double p)
+    {
+        std::size_t n = static_cast<std::size_t>(std::ceil(p * values.size()));
+        return values[std::min(values.size(), std::max<std::size_t>(n, 1)) - 1];
+    };
+    result.min = values.front();
+    result.median = rank(0.5);
+    result.p95 = rank(0.95);
+    result.p99 = rank(0.99);
+    result.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    return result;
+}
+
+struct result
+{
+    std::string name;
+    std::size_t threads;
+    std::size_t iterations;
+    std::size_t samples;
+    summary wall_ms;
+    summary cpu_ms;
+    // test runs (iterations, times threads when threaded) per second
+    // of median wall time
+    double ops_per_sec;
+};
+
+std::string json_escape(std::string const& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void write_json(std::ostream & out, result const& r)
+{
+    out << "{\"name\":\"" << json_escape(r.name) << "\""
+        << ",\"threads\":" << r.threads
+        << ",\"iterations\":" << r.iterations
+        << ",\"samples\":" << r.samples;
+    for (auto const& stat : { std::make_pair("wall", &r.wall_ms), std::make_pair("cpu", &r.cpu_ms) })
+    {
+        out << ",\"" << stat.first << "_min_ms\":" << stat.second->min
+            << ",\"" << stat.first << "_median_ms\":" << stat.second->median
+            << ",\"" << stat.first << "_p95_ms\":" << stat.second->p95
+            << ",\"" << stat.first << "_p99_ms\":" << stat.second->p99
+            << ",\"" << stat.first << "_mean_ms\":" << stat.second->mean;
+    }
+    out << ",\"ops_per_sec\":" << r.ops_per_sec << "}\n";
+}
+
+void write_csv(std::ostream & out, result const& r)
+{
+    std::string name(r.name);
+    std::replace(name.begin(), name.end(), ',', ';');
+    out << name << "," << r.threads << "," << r.iterations << "," << r.samples;
+    for (summary const* stat : { &r.wall_ms, &r.cpu_ms })
+    {
+        out << "," << stat->min << "," << stat->median << "," << stat->p95
+            << "," << stat->p99 << "," << stat->mean;
+    }
+    out << "," << r.ops_per_sec << "\n";
+}
+
+const char* csv_header = "name,threads,iterations,samples,"
+    "wall_min_ms,wall_median_ms,wall_p95_ms,wall_p99_ms,wall_mean_ms,"
+    "cpu_min_ms,cpu_median_ms,cpu_p95_ms,cpu_p99_ms,cpu_mean_ms,ops_per_sec";
+
+void write_text(std::ostream & out, result const& r)
+{
+    std::stringstream s;
+    s << std::fixed << std::setprecision(1);
+    s << r.name << ":"
+        << std::setw(45 - (int)s.tellp()) << std::right
+        << " t:" << r.threads
+        << " i:" << r.iterations;
+    s << std::setw(65 - (int)s.tellp()) << std::right
+        << r.wall_ms.median << " ms"
+        << " (min " << r.wall_ms.min
+        << " p95 " << r.wall_ms.p95
+        << " p99 " << r.wall_ms.p99 << ")"
+        << " cpu " << r.cpu_ms.median << " ms"
+        << " " << std::setprecision(0) << r.ops_per_sec << " ops/s\n";
+    out << s.str();
+}
+
+// value of `"key":` in a line written by write_json
+boost::optional<std::string> json_field(std::string const& line, std::string const& key)
+{
+    boost::optional<std::string> value;
+    std::string pattern = "\"" + key + "\":";
+    std::size_t pos = line.find(pattern);
+    if (pos == std::string::npos) return value;
+    pos += pattern.size();
+    if (pos < line.size() && line[pos] == '"')
+    {
+        std::string str;
+        for (++pos; pos < line.size() && line[pos] != '"'; ++pos)
+        {
+            if (line[pos] == '\\' && pos + 1 < line.size()) ++pos;
+            str += line[pos];
+        }
+        value = str;
+    }
+    else
+    {
+        value = line.substr(pos, line.find_first_of(",}", pos) - pos);
+    }
+    return value;
+}
+
+// median wall time of the same benchmark with as many threads in `file`
+boost::optional<double> baseline_median(std::string const& file, result const& r)
+{
+    boost::optional<double> median;
+    std::ifstream in(file.c_str());
+    if (!in)
+    {
+        throw std::runtime_error("could not open baseline " + file);
+    }
+    std::string line;
+    while (std::getline(in, line))
+    {
+        boost::optional<std::string> name = json_field(line, "name");
+        boost::optional<std::string> threads = json_field(line, "threads");
+        boost::optional<std::string> value = json_field(line, "wall_median_ms");
+        if (name && threads && value && *name == r.name &&
+            std::stoul(*threads) == r.threads)
+        {
+            median = std::stod(*value);
+        }
+    }
+    return median;
+}
+
 void handle_args(int argc, char** argv, mapnik::parameters & params)
 {
     if (argc > 0) {
@@ -78,6 +274,55 @@ void handle_args(int argc, char** argv, mapnik::parameters & params)
         }                                               \
     }                                                   \
 
+template <typename T>
+std::pair<double, double> time_once(T const& test_runner)
+{
+    using wall_clock = boost::chrono::steady_clock;
+    using cpu_clock = boost::chrono::process_cpu_clock;
+    wall_clock::time_point wall_start;
+    cpu_clock::time_point cpu_start;
+    if (test_runner.threads() > 0)
+    {
+        // every thread runs its own copy, and waits for the others to be
+        // created so thread startup isn't timed
+        std::vector<T> runners(test_runner.threads(), test_runner);
+        std::mutex mutex;
+        std::condition_variable start;
+        bool go = false;
+        std::vector<std::thread> tg;
+        for (T const& runner : runners)
+        {
+            tg.emplace_back([&runner, &mutex, &start, &go]
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    start.wait(lock, [&go] { return go; });
+                }
+                runner();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wall_start = wall_clock::now();
+            cpu_start = cpu_clock::now();
+            go = true;
+        }
+        start.notify_all();
+        std::for_each(tg.begin(), tg.end(), [](std::thread & t) {if (t.joinable()) t.join();});
+    }
+    else
+    {
+        wall_start = wall_clock::now();
+        cpu_start = cpu_clock::now();
+        test_runner();
+    }
+    cpu_clock::duration cpu = cpu_clock::now() - cpu_start;
+    wall_clock::duration wall = wall_clock::now() - wall_start;
+    double wall_ms = boost::chrono::duration<double, boost::milli>(wall).count();
+    double cpu_ms = (cpu.count().user + cpu.count().system) / 1e6;
+    return std::make_pair(wall_ms, cpu_ms);
+}
+
 template <typename T>
 int run(T const& test_runner, std::string const& name)
 {
@@ -88,35 +333,61 @@ int run(T const& test_runner, std::string const& name)
             std::clog << "test did not validate: " << name << "\n";
             return -1;
         }
-        boost::chrono::process_cpu_clock::time_point start;
-        boost::chrono::process_cpu_clock::duration elapsed;
-        std::stringstream s;
-        s << name << ":"
-            << std::setw(45 - (int)s.tellp()) << std::right
-            << " t:" << test_runner.threads()
-            << " i:" << test_runner.iterations();
-        if (test_runner.threads() > 0)
+        run_options options(test_runner.params());
+        for (std::size_t i = 0; i < options.warmup; ++i)
         {
-            using thread_group = std::vector<std::unique_ptr<std::thread> >;
-            using value_type = thread_group::value_type;
-            thread_group tg;
-            for (std::size_t i=0;i<test_runner.threads();++i)
-            {
-                tg.emplace_back(new std::thread(test_runner));
-            }
-            start = boost::chrono::process_cpu_clock::now();
-            std::for_each(tg.begin(), tg.end(), [](value_type & t) {if (t->joinable()) t->join();});
-            elapsed = boost::chrono::process_cpu_clock::now() - start;
+            time_once(test_runner);
+        }
+        std::vector<double> wall;
+        std::vector<double> cpu;
+        for (std::size_t i = 0; i < options.samples; ++i)
+        {
+            std::pair<double, double> sample = time_once(test_runner);
+            wall.push_back(sample.first);
+            cpu.push_back(sample.second);
+        }
+
+        result r;
+        r.name = name;
+        r.threads = test_runner.threads();
+        r.iterations = test_runner.iterations();
+        r.samples = options.samples;
+        r.wall_ms = summarize(wall);
+        r.cpu_ms = summarize(cpu);
+        double ops = static_cast<double>(r.iterations) * std::max<std::size_t>(r.threads, 1);
+        r.ops_per_sec = r.wall_ms.median > 0 ? ops * 1000.0 / r.wall_ms.median : 0;
+
+        if (options.report == "json")
+        {
+            write_json(std::cout, r);
+        }
+        else if (options.report == "csv")
+        {
+            if (options.csv_header) std::cout << csv_header << "\n";
+            write_csv(std::cout, r);
         }
         else
         {
-            start = boost::chrono::process_cpu_clock::now();
-            test_runner();
-            elapsed = boost::chrono::process_cpu_clock::now() - start;
+            write_text(std::clog, r);
+        }
+
+        if (!options.baseline.empty())
+        {
+            boost::optional<double> base = baseline_median(options.baseline, r);
+            if (!base)
+            {
+                std::clog << name << ": no baseline with t:" << r.threads << "\n";
+            }
+            else
+            {
+                double ratio = *base > 0 ? r.wall_ms.median / *base : 1.0;
+                bool regressed = ratio > 1.0 + options.tolerance;
+                std::clog << name << ": " << std::fixed << std::setprecision(3) << ratio
+                          << "x baseline median (" << *base << " ms)"
+                          << (regressed ? " REGRESSION" : "") << "\n";
+                if (regressed) return 1;
+            }
         }
-        s << std::setw(65 - (int)s.tellp()) << std::right
-            << boost::chrono::duration_cast<boost::chrono::milliseconds>(elapsed) << "\n";
-        std::clog << s.str();
         return 0;
     }
     catch (std::exception const& ex)
@@ -40,6 +40,12 @@ benchmarks = [
     "test_face_ptr_creation.cpp",
     "test_font_registration.cpp",
     "test_rendering.cpp",
+    "test_compiled_map.cpp",
+    "test_rule_dispatch.cpp",
+    "test_symbolizer_properties.cpp",
+    "test_vertex_converters.cpp",
+    "test_image_filters.cpp",
+    "test_render_suite.cpp",
 ]
 for cpp_test in benchmarks:
     test_program = test_env_local.Program('out/'+cpp_test.replace('.cpp',''), source=[cpp_test])
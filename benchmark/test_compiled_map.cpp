@@ -0,0 +1,77 @@
+#include "bench_framework.hpp"
+#include <mapnik/map.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/save_map.hpp>
+#include <mapnik/compiled_map.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <stdexcept>
+
+class test : public benchmark::test_case
+{
+    std::string xml_;
+    std::string compiled_;
+    bool use_compiled_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       xml_(),
+       compiled_(),
+       use_compiled_(*params.get<std::string>("format","compiled") == "compiled")
+      {
+        boost::optional<std::string> map = params.get<std::string>("map");
+        if (!map)
+        {
+            throw std::runtime_error("please provide a --map=<path to xml> arg");
+        }
+        xml_ = *map;
+        mapnik::Map m(256,256);
+        mapnik::load_map(m,xml_);
+        compiled_ = mapnik::save_compiled_map_to_string(m);
+      }
+    bool validate() const
+    {
+        mapnik::Map xml_map(256,256);
+        mapnik::load_map(xml_map,xml_);
+        mapnik::Map compiled_map(256,256);
+        mapnik::load_compiled_map_string(compiled_map,compiled_);
+        return mapnik::save_map_to_string(xml_map) == mapnik::save_map_to_string(compiled_map);
+    }
+    void operator()() const
+    {
+        for (unsigned i=0;i<iterations_;++i)
+        {
+            mapnik::Map m(256,256);
+            if (use_compiled_) mapnik::load_compiled_map_string(m,compiled_);
+            else mapnik::load_map(m,xml_);
+        }
+    }
+};
+
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        mapnik::parameters params;
+        benchmark::handle_args(argc,argv,params);
+        boost::optional<std::string> name = params.get<std::string>("name");
+        if (!name)
+        {
+            std::clog << "please provide a name for this test\n";
+            return -1;
+        }
+        mapnik::freetype_engine::register_fonts("./fonts", true);
+        mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
+        {
+            test test_runner(params);
+            run(test_runner,*name);
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        return -1;
+    }
+    return 0;
+}
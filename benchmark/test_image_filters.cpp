@@ -0,0 +1,106 @@
+#include "bench_framework.hpp"
+#include <mapnik/graphics.hpp>
+#include <mapnik/image_filter.hpp>
+#include <mapnik/util/process_bands.hpp>
+#include <cstring>
+#include <cstdlib>
+
+// fills a premultiplied canvas with sparse opaque blobs over transparency,
+// roughly what a halo or shadow style buffer looks like
+void fill_canvas(mapnik::image_32 & im)
+{
+    std::srand(1);
+    unsigned char * bytes = im.raw_data();
+    for (unsigned i = 0; i < im.width() * im.height(); ++i)
+    {
+        unsigned char * p = bytes + i * 4;
+        if ((i / 16) % 5 == 0)
+        {
+            p[3] = 128 + std::rand() % 128;
+            for (int c = 0; c < 3; ++c) p[c] = (std::rand() % 256) * p[3] / 255;
+        }
+    }
+}
+
+template <typename Filter>
+class test : public benchmark::test_case
+{
+    Filter filter_;
+    bool reference_;
+public:
+    test(mapnik::parameters const& params, Filter const& filter, bool reference)
+     : test_case(params),
+       filter_(filter),
+       reference_(reference) {}
+
+    bool validate() const
+    {
+        mapnik::image_32 expected(256,256);
+        fill_canvas(expected);
+        mapnik::image_32 actual(expected);
+        apply_reference(expected);
+        mapnik::filter::apply_filter(actual, filter_);
+        return std::memcmp(expected.raw_data(), actual.raw_data(), 256 * 256 * 4) == 0;
+    }
+
+    void apply_reference(mapnik::image_32 & im) const
+    {
+        {
+            im.demultiply();
+            mapnik::filter::double_buffer<mapnik::image_32> tb(im);
+            mapnik::filter::apply_convolution_3x3(tb.src_view, tb.dst_view, filter_);
+        }
+        im.premultiply();
+    }
+
+    void operator()() const
+    {
+        mapnik::image_32 im(1024,1024);
+        fill_canvas(im);
+        for (unsigned i=0;i<iterations_;++i)
+        {
+            if (reference_) apply_reference(im);
+            else mapnik::filter::apply_filter(im, filter_);
+        }
+    }
+};
+
+// the reference for the stack blur is a single pass over the whole image
+template <>
+void test<mapnik::filter::agg_stack_blur>::apply_reference(mapnik::image_32 & im) const
+{
+    agg::rendering_buffer buf(im.raw_data(), im.width(), im.height(), im.width() * 4);
+    agg::pixfmt_rgba32_pre pixf(buf);
+    agg::stack_blur_rgba32(pixf, filter_.rx, filter_.ry);
+}
+
+template <typename Filter>
+int run_filter(mapnik::parameters const& params, Filter const& filter, std::string const& name)
+{
+    int return_value = 0;
+    {
+        test<Filter> test_runner(params, filter, true);
+        return_value = return_value | run(test_runner, name + " (reference)");
+    }
+    {
+        test<Filter> test_runner(params, filter, false);
+        return_value = return_value | run(test_runner, name);
+    }
+    return return_value;
+}
+
+int main(int argc, char** argv)
+{
+    mapnik::parameters params;
+    benchmark::handle_args(argc,argv,params);
+    // --band_threads N lets each filter run split the image into bands
+    mapnik::util::set_max_band_threads(static_cast<unsigned>(*params.get<mapnik::value_integer>("band_threads",1)));
+    int return_value = 0;
+    return_value |= run_filter(params, mapnik::filter::blur(), "image filter: blur");
+    return_value |= run_filter(params, mapnik::filter::sharpen(), "image filter: sharpen");
+    return_value |= run_filter(params, mapnik::filter::emboss(), "image filter: emboss");
+    return_value |= run_filter(params, mapnik::filter::edge_detect(), "image filter: edge-detect");
+    return_value |= run_filter(params, mapnik::filter::sobel(), "image filter: sobel");
+    return_value |= run_filter(params, mapnik::filter::agg_stack_blur(8,8), "image filter: agg-stack-blur(8,8)");
+    return return_value;
+}
@@ -0,0 +1,547 @@
+#include "bench_framework.hpp"
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/attribute_collector.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/scale_denominator.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/unicode.hpp>
+#include <boost/algorithm/string.hpp>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+// Renders a grid of tiles at several zoom levels for each of the styles in
+// benchmark/data/render_suite and times every phase of a render on its own:
+//
+//  query              datasource queries the renderer would issue per layer
+//  style evaluation   rule filters of the active styles over the features
+//  rasterization      rendering of every symbolizer but text and shields
+//  text placement     rendering of only the text and shield symbolizers
+//  encoding           encoding the rendered tiles with --encoding
+//  total              query, render and encode of the whole map
+//
+// The rasterization and text placement phases render features prefetched
+// per tile, so they don't include query time. Layers are filled with
+// synthetic data generated here, by layer name, so runs are repeatable.
+
+namespace {
+
+const std::string merc_srs("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0.0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +over");
+const double world_size = 2 * 20037508.342789244;
+// synthetic data covers a square of this many meters around 0,0
+const double data_size = 8000.0;
+
+// deterministic pseudo random numbers so every run renders the same data
+class random_source
+{
+public:
+    random_source(std::uint32_t seed)
+        : state_(seed) {}
+
+    // in [0,1)
+    double operator()()
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return (state_ >> 8) / 16777216.0;
+    }
+private:
+    std::uint32_t state_;
+};
+
+std::shared_ptr<mapnik::memory_datasource> make_datasource()
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    double half = data_size / 2;
+    ds->set_envelope(mapnik::box2d<double>(-half, -half, half, half));
+    return ds;
+}
+
+// a street grid split into one feature per block, with a few vertices each
+mapnik::datasource_ptr make_roads()
+{
+    auto ds = make_datasource();
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("class");
+    ctx->push("name");
+    mapnik::transcoder tr("utf-8");
+    random_source rand(1);
+    const int streets = 50;
+    double spacing = data_size / streets;
+    double origin = -data_size / 2;
+    mapnik::value_integer id = 1;
+    for (int dir = 0; dir < 2; ++dir)
+    {
+        for (int i = 0; i < streets; ++i)
+        {
+            std::string cls = i % 10 == 0 ? "motorway" : (i % 5 == 0 ? "main" : "minor");
+            std::string name = (dir == 0 ? "Avenue " : "Street ") + std::to_string(i);
+            for (int j = 0; j < streets; ++j)
+            {
+                mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id++));
+                feature->put("class", tr.transcode(cls.c_str()));
+                feature->put("name", tr.transcode(name.c_str()));
+                std::unique_ptr<mapnik::geometry_type> line(new mapnik::geometry_type(mapnik::geometry_type::types::LineString));
+                for (int k = 0; k <= 4; ++k)
+                {
+                    double along = origin + (j + k / 4.0) * spacing;
+                    double across = origin + i * spacing + (k > 0 && k < 4 ? (rand() - 0.5) * spacing * 0.1 : 0);
+                    if (dir == 0) line->push_vertex(along, across, k == 0 ? mapnik::SEG_MOVETO : mapnik::SEG_LINETO);
+                    else line->push_vertex(across, along, k == 0 ? mapnik::SEG_MOVETO : mapnik::SEG_LINETO);
+                }
+                feature->add_geometry(line.release());
+                ds->push(feature);
+            }
+        }
+    }
+    return ds;
+}
+
+// jittered octagons, one per grid cell
+mapnik::datasource_ptr make_polygons()
+{
+    static const char* landuse[] = { "forest", "park", "residential", "industrial", "water" };
+    auto ds = make_datasource();
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("landuse");
+    mapnik::transcoder tr("utf-8");
+    random_source rand(2);
+    const int cells = 40;
+    double size = data_size / cells;
+    double origin = -data_size / 2;
+    mapnik::value_integer id = 1;
+    for (int row = 0; row < cells; ++row)
+    {
+        for (int col = 0; col < cells; ++col)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id++));
+            feature->put("landuse", tr.transcode(landuse[static_cast<int>(rand() * 5)]));
+            std::unique_ptr<mapnik::geometry_type> poly(new mapnik::geometry_type(mapnik::geometry_type::types::Polygon));
+            double cx = origin + (col + 0.5) * size;
+            double cy = origin + (row + 0.5) * size;
+            for (int k = 0; k < 8; ++k)
+            {
+                double angle = k * M_PI / 4;
+                double radius = size * (0.35 + rand() * 0.15);
+                double x = cx + radius * std::cos(angle);
+                double y = cy + radius * std::sin(angle);
+                if (k == 0) poly->move_to(x, y);
+                else poly->line_to(x, y);
+            }
+            poly->close_path();
+            feature->add_geometry(poly.release());
+            ds->push(feature);
+        }
+    }
+    return ds;
+}
+
+mapnik::datasource_ptr make_points()
+{
+    auto ds = make_datasource();
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("category");
+    random_source rand(3);
+    double origin = -data_size / 2;
+    for (mapnik::value_integer id = 1; id <= 4000; ++id)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id));
+        feature->put("category", static_cast<mapnik::value_integer>(rand() * 4));
+        std::unique_ptr<mapnik::geometry_type> point(new mapnik::geometry_type(mapnik::geometry_type::types::Point));
+        point->move_to(origin + rand() * data_size, origin + rand() * data_size);
+        feature->add_geometry(point.release());
+        ds->push(feature);
+    }
+    return ds;
+}
+
+// 4x4 float32 rasters of a smooth surface ranging over 0-100; each also
+// carries its extent as a polygon, which the memory datasource tests
+// against the query box
+mapnik::datasource_ptr make_raster()
+{
+    auto ds = make_datasource();
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    const int grid = 4;
+    const unsigned size = 256;
+    double step = data_size / grid;
+    double origin = -data_size / 2;
+    mapnik::value_integer id = 1;
+    for (int row = 0; row < grid; ++row)
+    {
+        for (int col = 0; col < grid; ++col)
+        {
+            mapnik::box2d<double> ext(origin + col * step, origin + row * step,
+                                      origin + (col + 1) * step, origin + (row + 1) * step);
+            auto source = std::make_shared<mapnik::raster>(ext, size, size, 1.0, mapnik::RASTER_FLOAT32);
+            for (unsigned y = 0; y < size; ++y)
+            {
+                for (unsigned x = 0; x < size; ++x)
+                {
+                    double gx = ext.minx() + ext.width() * x / size;
+                    double gy = ext.maxy() - ext.height() * y / size;
+                    source->band_32f()(x, y) = static_cast<float>(
+                        50 + 25 * std::sin(gx / 900) + 25 * std::cos(gy / 700));
+                }
+            }
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id++));
+            feature->set_raster(source);
+            std::unique_ptr<mapnik::geometry_type> poly(new mapnik::geometry_type(mapnik::geometry_type::types::Polygon));
+            poly->move_to(ext.minx(), ext.miny());
+            poly->line_to(ext.maxx(), ext.miny());
+            poly->line_to(ext.maxx(), ext.maxy());
+            poly->line_to(ext.minx(), ext.maxy());
+            poly->close_path();
+            feature->add_geometry(poly.release());
+            ds->push(feature);
+        }
+    }
+    return ds;
+}
+
+mapnik::datasource_ptr synthetic_data(std::string const& layer_name)
+{
+    if (layer_name == "roads") return make_roads();
+    if (layer_name == "polygons") return make_polygons();
+    if (layer_name == "points") return make_points();
+    if (layer_name == "raster") return make_raster();
+    throw std::runtime_error("no synthetic data for layer '" + layer_name + "'");
+}
+
+// the query feature_style_processor issues for `lay`, without reprojection
+mapnik::query layer_query(mapnik::Map const& m, mapnik::layer const& lay)
+{
+    mapnik::box2d<double> extent = m.get_current_extent();
+    mapnik::box2d<double> buffered(extent);
+    double padding = 2.0 * m.scale() * m.buffer_size();
+    buffered.width(extent.width() + padding);
+    buffered.height(extent.height() + padding);
+    double scale_denom = mapnik::scale_denominator(m.scale(), false);
+    mapnik::query::resolution_type res(m.width() / extent.width(), m.height() / extent.height());
+    mapnik::query q(buffered, res, scale_denom, extent);
+
+    std::set<std::string> names;
+    mapnik::attribute_collector collector(names);
+    for (std::string const& style_name : lay.styles())
+    {
+        boost::optional<mapnik::feature_type_style const&> style = m.find_style(style_name);
+        if (!style) continue;
+        for (mapnik::rule const& r : style->get_rules())
+        {
+            if (r.active(scale_denom)) collector(r);
+        }
+    }
+    for (std::string const& name : names)
+    {
+        q.add_property_name(name);
+    }
+    return q;
+}
+
+bool is_text(mapnik::symbolizer const& sym)
+{
+    return sym.is<mapnik::text_symbolizer>() || sym.is<mapnik::shield_symbolizer>();
+}
+
+// drops the text and shield symbolizers of `m`, or everything else
+void keep_symbolizers(mapnik::Map & m, bool text)
+{
+    for (auto & kv : m.styles())
+    {
+        for (mapnik::rule & r : kv.second.get_rules_nonconst())
+        {
+            for (std::size_t i = r.get_symbolizers().size(); i-- > 0;)
+            {
+                if (is_text(r.get_symbolizers()[i]) != text) r.remove_at(i);
+            }
+        }
+    }
+}
+
+void render(mapnik::Map const& m, mapnik::image_32 & image)
+{
+    mapnik::agg_renderer<mapnik::image_32> ren(m, image);
+    ren.apply();
+}
+
+}
+
+// everything a phase needs, built once and shared read only between
+// threads
+struct suite_fixture
+{
+    struct tile
+    {
+        tile(mapnik::Map const& m)
+            : map(m),
+              shapes(m),
+              text(m),
+              image(m.width(), m.height()) {}
+        // the live map zoomed to the tile
+        mapnik::Map map;
+        // rendering only shapes or only text of features prefetched
+        // for this tile
+        mapnik::Map shapes;
+        mapnik::Map text;
+        // features of each layer of `map`
+        std::vector<std::vector<mapnik::feature_ptr> > features;
+        mapnik::image_32 image;
+    };
+
+    suite_fixture(std::string const& xml,
+                  std::vector<unsigned> const& zooms,
+                  unsigned tiles_per_side,
+                  unsigned tile_size,
+                  int buffer_size,
+                  std::string const& _encoding)
+        : encoding(_encoding)
+    {
+        mapnik::Map m(tile_size, tile_size);
+        mapnik::load_map(m, xml, true);
+        m.set_buffer_size(buffer_size);
+        for (mapnik::layer & lay : m.layers())
+        {
+            if (!lay.datasource()) lay.set_datasource(synthetic_data(lay.name()));
+        }
+
+        for (unsigned zoom : zooms)
+        {
+            double span = world_size / (1u << zoom);
+            // tiles_per_side x tiles_per_side tiles around the data center
+            double origin = -span * std::floor(tiles_per_side / 2.0);
+            for (unsigned row = 0; row < tiles_per_side; ++row)
+            {
+                for (unsigned col = 0; col < tiles_per_side; ++col)
+                {
+                    double minx = origin + col * span;
+                    double miny = origin + row * span;
+                    m.zoom_to_box(mapnik::box2d<double>(minx, miny, minx + span, miny + span));
+                    tiles.emplace_back(new tile(m));
+                    prepare(*tiles.back());
+                }
+            }
+        }
+    }
+
+    void prepare(tile & t)
+    {
+        keep_symbolizers(t.shapes, false);
+        keep_symbolizers(t.text, true);
+        std::vector<mapnik::layer> const& layers = t.map.layers();
+        for (std::size_t i = 0; i < layers.size(); ++i)
+        {
+            auto ds = make_datasource();
+            std::vector<mapnik::feature_ptr> features;
+            mapnik::featureset_ptr fs = layers[i].datasource()->features(layer_query(t.map, layers[i]));
+            mapnik::feature_ptr feature;
+            while (fs && (feature = fs->next()))
+            {
+                features.push_back(feature);
+                ds->push(feature);
+            }
+            t.features.push_back(features);
+            t.shapes.get_layer(i).set_datasource(ds);
+            t.text.get_layer(i).set_datasource(ds);
+        }
+        render(t.map, t.image);
+    }
+
+    std::string encoding;
+    std::vector<std::unique_ptr<tile> > tiles;
+};
+
+enum phase_e
+{
+    QUERY = 0,
+    STYLE_EVALUATION,
+    RASTERIZATION,
+    TEXT_PLACEMENT,
+    ENCODING,
+    TOTAL,
+    phase_e_MAX
+};
+
+const char* phase_names[] = { "query", "style evaluation", "rasterization", "text placement", "encoding", "total" };
+
+class test : public benchmark::test_case
+{
+    std::shared_ptr<suite_fixture const> fixture_;
+    phase_e phase_;
+public:
+    test(mapnik::parameters const& params,
+         std::shared_ptr<suite_fixture const> const& fixture,
+         phase_e phase)
+     : test_case(params),
+       fixture_(fixture),
+       phase_(phase) {}
+
+    bool validate() const
+    {
+        // every phase should have something to work on
+        std::size_t features = 0;
+        for (auto const& t : fixture_->tiles)
+        {
+            for (auto const& layer_features : t->features) features += layer_features.size();
+        }
+        if (features == 0)
+        {
+            std::clog << "no features in any tile\n";
+            return false;
+        }
+        return true;
+    }
+
+    std::size_t query(suite_fixture::tile const& t) const
+    {
+        std::size_t count = 0;
+        for (mapnik::layer const& lay : t.map.layers())
+        {
+            mapnik::featureset_ptr fs = lay.datasource()->features(layer_query(t.map, lay));
+            while (fs && fs->next()) ++count;
+        }
+        return count;
+    }
+
+    std::size_t evaluate_styles(suite_fixture::tile const& t) const
+    {
+        double scale_denom = mapnik::scale_denominator(t.map.scale(), false);
+        mapnik::attributes vars;
+        std::size_t count = 0;
+        std::vector<mapnik::layer> const& layers = t.map.layers();
+        for (std::size_t i = 0; i < layers.size(); ++i)
+        {
+            for (std::string const& style_name : layers[i].styles())
+            {
+                boost::optional<mapnik::feature_type_style const&> style = t.map.find_style(style_name);
+                if (!style) continue;
+                for (mapnik::feature_ptr const& feature : t.features[i])
+                {
+                    for (mapnik::rule const& r : style->get_rules())
+                    {
+                        if (!r.active(scale_denom)) continue;
+                        mapnik::value_type result = mapnik::util::apply_visitor(
+                            mapnik::evaluate<mapnik::feature_impl,mapnik::value_type,mapnik::attributes>(*feature,vars),
+                            *r.get_filter());
+                        if (result.to_bool()) ++count;
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    void operator()() const
+    {
+        for (std::size_t i=0;i<iterations_;++i)
+        {
+            for (auto const& t : fixture_->tiles)
+            {
+                switch (phase_)
+                {
+                case QUERY:
+                    query(*t);
+                    break;
+                case STYLE_EVALUATION:
+                    evaluate_styles(*t);
+                    break;
+                case RASTERIZATION:
+                {
+                    mapnik::image_32 image(t->shapes.width(), t->shapes.height());
+                    render(t->shapes, image);
+                    break;
+                }
+                case TEXT_PLACEMENT:
+                {
+                    mapnik::image_32 image(t->text.width(), t->text.height());
+                    render(t->text, image);
+                    break;
+                }
+                case ENCODING:
+                    mapnik::save_to_string(t->image, fixture_->encoding);
+                    break;
+                default:
+                {
+                    mapnik::image_32 image(t->map.width(), t->map.height());
+                    render(t->map, image);
+                    mapnik::save_to_string(image, fixture_->encoding);
+                    break;
+                }
+                }
+            }
+        }
+    }
+};
+
+std::vector<std::string> split_list(std::string const& list)
+{
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+    items.erase(std::remove(items.begin(), items.end(), std::string()), items.end());
+    return items;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        mapnik::parameters params;
+        benchmark::handle_args(argc,argv,params);
+        std::string data = *params.get<std::string>("data","benchmark/data/render_suite");
+        std::vector<std::string> styles = split_list(*params.get<std::string>("styles","roads,polygons,markers,raster,compositing"));
+        std::vector<std::string> phases = split_list(*params.get<std::string>("phases",""));
+        std::vector<unsigned> zooms;
+        for (std::string const& zoom : split_list(*params.get<std::string>("zooms","12,14,16")))
+        {
+            zooms.push_back(static_cast<unsigned>(std::stoul(zoom)));
+        }
+        unsigned tiles = *params.get<mapnik::value_integer>("tiles",2);
+        unsigned tile_size = *params.get<mapnik::value_integer>("tile_size",256);
+        int buffer_size = *params.get<mapnik::value_integer>("buffer_size",64);
+        std::string encoding = *params.get<std::string>("encoding","png8:m=h");
+
+        bool success = mapnik::freetype_engine::register_fonts("./fonts", true);
+        if (!success) {
+           std::clog << "warning, did not register any new fonts!\n";
+           return -1;
+        }
+
+        int result = 0;
+        for (std::string const& style : styles)
+        {
+            auto fixture = std::make_shared<suite_fixture>(data + "/" + style + ".xml",
+                                                           zooms, tiles, tile_size,
+                                                           buffer_size, encoding);
+            for (int phase = 0; phase < phase_e_MAX; ++phase)
+            {
+                if (!phases.empty() &&
+                    std::find(phases.begin(), phases.end(), phase_names[phase]) == phases.end())
+                {
+                    continue;
+                }
+                test test_runner(params, fixture, static_cast<phase_e>(phase));
+                int status = run(test_runner, "render suite " + style + " " + phase_names[phase]);
+                if (status != 0) result = status;
+            }
+        }
+        return result;
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        return -1;
+    }
+}
@@ -4,6 +4,7 @@
 #include <mapnik/load_map.hpp>
 #include <mapnik/graphics.hpp>
 #include <mapnik/agg_renderer.hpp>
+#include <mapnik/agg_render_context.hpp>
 #include <mapnik/datasource_cache.hpp>
 #include <stdexcept>
 
@@ -14,6 +15,7 @@ class test : public benchmark::test_case
     mapnik::value_integer width_;
     mapnik::value_integer height_;
     std::string preview_;
+    bool context_;
 public:
     test(mapnik::parameters const& params)
      : test_case(params),
@@ -21,7 +23,8 @@ public:
        extent_(),
        width_(*params.get<mapnik::value_integer>("width",256)),
        height_(*params.get<mapnik::value_integer>("height",256)),
-       preview_(*params.get<std::string>("preview",""))
+       preview_(*params.get<std::string>("preview","")),
+       context_(*params.get<mapnik::value_integer>("context",0) != 0)
       {
         boost::optional<std::string> map = params.get<std::string>("map");
         if (!map)
@@ -58,11 +61,21 @@ public:
         mapnik::Map m(width_,height_);
         mapnik::load_map(m,xml_);
         m.zoom_to_box(extent_);
+        // every thread runs its own copy of the test, so this is per thread
+        mapnik::agg_render_context context;
         for (unsigned i=0;i<iterations_;++i)
         {
             mapnik::image_32 im(m.width(),m.height());
-            mapnik::agg_renderer<mapnik::image_32> ren(m,im);
-            ren.apply();
+            if (context_)
+            {
+                mapnik::agg_renderer<mapnik::image_32> ren(m,im,context);
+                ren.apply();
+            }
+            else
+            {
+                mapnik::agg_renderer<mapnik::image_32> ren(m,im);
+                ren.apply();
+            }
         }
     }
 };
@@ -0,0 +1,123 @@
+#include "bench_framework.hpp"
+#include <mapnik/rule.hpp>
+#include <mapnik/rule_cache.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/attribute.hpp>
+
+// road rules in the shape of an OSM carto style: per class a casing,
+// a fill, bridge and tunnel variants, and a few rules on other tags
+std::vector<mapnik::rule> make_road_rules()
+{
+    static const char* classes[] = {
+        "motorway", "motorway_link", "trunk", "trunk_link", "primary",
+        "primary_link", "secondary", "secondary_link", "tertiary",
+        "tertiary_link", "residential", "unclassified", "living_street",
+        "service", "pedestrian", "track", "footway", "cycleway" };
+    std::vector<mapnik::rule> rules;
+    for (char const* c : classes)
+    {
+        std::string cls(c);
+        for (std::string const& filter : {
+                 "[highway] = '" + cls + "' and [tunnel] = 'yes'",
+                 "[highway] = '" + cls + "' and [bridge] = 'yes'",
+                 "[highway] = '" + cls + "'",
+                 "[highway] = '" + cls + "' and [oneway] = 1" })
+        {
+            mapnik::rule r;
+            r.set_filter(mapnik::parse_expression(filter));
+            rules.push_back(std::move(r));
+        }
+    }
+    for (char const* filter : { "[railway] = 'rail'", "[aeroway] = 'runway'",
+                                "[highway] = 'steps' or [highway] = 'path' or [highway] = 'bridleway'" })
+    {
+        mapnik::rule r;
+        r.set_filter(mapnik::parse_expression(filter));
+        rules.push_back(std::move(r));
+    }
+    return rules;
+}
+
+class test : public benchmark::test_case
+{
+    std::vector<mapnik::rule> rules_;
+    std::vector<mapnik::feature_ptr> features_;
+    bool indexed_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       rules_(make_road_rules()),
+       features_(),
+       indexed_(*params.get<mapnik::value_integer>("indexed",1) != 0)
+    {
+        static const char* values[] = { "residential", "service", "footway", "primary",
+                                        "track", "tertiary", "motorway", "path", "unknown" };
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("highway");
+        ctx->push("bridge");
+        ctx->push("oneway");
+        mapnik::transcoder tr("utf-8");
+        for (std::size_t i = 0; i < 10000; ++i)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i));
+            feature->put("highway", tr.transcode(values[i % 9]));
+            feature->put("bridge", tr.transcode(i % 13 == 0 ? "yes" : "no"));
+            feature->put("oneway", mapnik::value_integer(i % 5 == 0));
+            features_.push_back(feature);
+        }
+    }
+
+    std::size_t matches(bool indexed) const
+    {
+        mapnik::rule_cache rc;
+        for (mapnik::rule const& r : rules_) rc.add_rule(r);
+        if (indexed) rc.build_index();
+        mapnik::attributes vars;
+        std::size_t count = 0;
+        for (mapnik::feature_ptr const& feature : features_)
+        {
+            for (mapnik::rule const* r : rc.get_if_rules(*feature))
+            {
+                mapnik::value_type result = mapnik::util::apply_visitor(
+                    mapnik::evaluate<mapnik::feature_impl,mapnik::value_type,mapnik::attributes>(*feature,vars),
+                    *r->get_filter());
+                if (result.to_bool()) ++count;
+            }
+        }
+        return count;
+    }
+
+    bool validate() const
+    {
+        std::size_t linear = matches(false);
+        std::size_t indexed = matches(true);
+        if (linear != indexed)
+        {
+            std::clog << "indexed dispatch matched " << indexed << " rules, linear " << linear << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    void operator()() const
+    {
+        for (std::size_t i=0;i<iterations_;++i)
+        {
+            matches(indexed_);
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::parameters params;
+    benchmark::handle_args(argc,argv,params);
+    test test_runner(params);
+    bool indexed = *params.get<mapnik::value_integer>("indexed",1) != 0;
+    return run(test_runner, indexed ? "rule dispatch indexed" : "rule dispatch linear");
+}
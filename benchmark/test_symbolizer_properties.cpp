@@ -0,0 +1,108 @@
+#include "bench_framework.hpp"
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/parse_path.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/color.hpp>
+#include <mapnik/unicode.hpp>
+
+// the properties process_line_symbolizer and process_point_symbolizer
+// read per feature, set up the way load_map leaves them
+mapnik::line_symbolizer make_line_symbolizer()
+{
+    mapnik::line_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::stroke, mapnik::color(200,100,50));
+    mapnik::put(sym, mapnik::keys::stroke_width, mapnik::parse_expression("[width] * 1.5"));
+    mapnik::put(sym, mapnik::keys::stroke_opacity, mapnik::parse_expression("0.25 + 0.5"));
+    mapnik::put(sym, mapnik::keys::stroke_linejoin, mapnik::ROUND_JOIN);
+    mapnik::put(sym, mapnik::keys::stroke_linecap, mapnik::ROUND_CAP);
+    mapnik::put(sym, mapnik::keys::stroke_gamma, 1.0);
+    mapnik::put(sym, mapnik::keys::offset, 0.0);
+    mapnik::put(sym, mapnik::keys::smooth, 0.5);
+    mapnik::put(sym, mapnik::keys::clip, false);
+    mapnik::put(sym, mapnik::keys::file, mapnik::parse_path("shields/motorway.svg"));
+    return sym;
+}
+
+class test : public benchmark::test_case
+{
+    mapnik::line_symbolizer sym_;
+    std::vector<mapnik::feature_ptr> features_;
+    mapnik::attributes vars_;
+    bool compiled_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       sym_(make_line_symbolizer()),
+       features_(),
+       vars_(),
+       compiled_(*params.get<mapnik::value_integer>("compiled",1) != 0)
+    {
+        if (compiled_) mapnik::compile_properties(sym_);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("width");
+        for (std::size_t i = 0; i < 10000; ++i)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i));
+            feature->put("width", mapnik::value_integer(i % 7));
+            features_.push_back(feature);
+        }
+    }
+
+    double read_all(mapnik::line_symbolizer const& sym) const
+    {
+        using namespace mapnik;
+        double sum = 0;
+        for (feature_ptr const& f : features_)
+        {
+            color stroke = get<color>(sym, keys::stroke, *f, vars_, color(0,0,0));
+            sum += stroke.red();
+            sum += get<value_double>(sym, keys::stroke_width, *f, vars_, 1.0);
+            sum += get<value_double>(sym, keys::stroke_opacity, *f, vars_, 1.0);
+            sum += get<line_join_enum>(sym, keys::stroke_linejoin, *f, vars_, MITER_JOIN);
+            sum += get<line_cap_enum>(sym, keys::stroke_linecap, *f, vars_, BUTT_CAP);
+            sum += get<value_double>(sym, keys::stroke_gamma, *f, vars_, 1.0);
+            sum += get<value_double>(sym, keys::offset, *f, vars_, 0.0);
+            sum += get<value_double>(sym, keys::smooth, *f, vars_, 0.0);
+            sum += get<value_double>(sym, keys::simplify_tolerance, *f, vars_, 0.0);
+            sum += get<value_bool>(sym, keys::clip, *f, vars_, true);
+            sum += get<std::string>(sym, keys::file, *f, vars_).size();
+            auto dash = get_optional<dash_array>(sym, keys::stroke_dasharray, *f, vars_);
+            if (dash) sum += dash->size();
+        }
+        return sum;
+    }
+
+    bool validate() const
+    {
+        mapnik::line_symbolizer other = make_line_symbolizer();
+        if (compiled_) other.compiled.reset();
+        else mapnik::compile_properties(other);
+        double expected = read_all(other);
+        double actual = read_all(sym_);
+        if (expected != actual)
+        {
+            std::clog << "compiled and uncompiled lookups differ: " << actual << " vs " << expected << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    void operator()() const
+    {
+        for (std::size_t i=0;i<iterations_;++i)
+        {
+            read_all(sym_);
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::parameters params;
+    benchmark::handle_args(argc,argv,params);
+    test test_runner(params);
+    bool compiled = *params.get<mapnik::value_integer>("compiled",1) != 0;
+    return run(test_runner, compiled ? "symbolizer properties compiled" : "symbolizer properties");
+}
@@ -0,0 +1,182 @@
+#include "bench_framework.hpp"
+#include <mapnik/geometry.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/ctrans.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/vertex_converters.hpp>
+#include <mapnik/batch_vertex_converter.hpp>
+#include <mapnik/wkt/wkt_factory.hpp>
+#include <mapnik/wkt/wkt_grammar_impl.hpp>
+
+// agg
+#include "agg_trans_affine.h"
+
+// stl
+#include <fstream>
+#include <stdexcept>
+#include <sstream>
+#include <cmath>
+
+// collects converter output instead of rasterizing it
+struct vertex_sink
+{
+    vertex_sink()
+        : count(0),
+          checksum(0) {}
+
+    template <typename T>
+    void add_path(T & path)
+    {
+        double x,y;
+        unsigned cmd;
+        path.rewind(0);
+        while ((cmd = path.vertex(&x, &y)) != mapnik::SEG_END)
+        {
+            ++count;
+            if (cmd != mapnik::SEG_CLOSE) checksum += x + y;
+        }
+    }
+
+    std::size_t count;
+    double checksum;
+};
+
+using conv_types = boost::mpl::vector<mapnik::clip_line_tag,
+                                      mapnik::transform_tag,
+                                      mapnik::affine_transform_tag,
+                                      mapnik::simplify_tag>;
+
+template <template <typename, typename, typename, typename,
+                    typename, typename, typename, typename> class Converter>
+void convert(mapnik::geometry_container & paths,
+             mapnik::box2d<double> const& extent,
+             vertex_sink & sink)
+{
+    mapnik::projection merc(mapnik::MAPNIK_GMERC_PROJ);
+    mapnik::proj_transform prj_trans(merc,merc);
+    mapnik::CoordTransform tr(256,256,extent);
+    agg::trans_affine affine;
+    mapnik::line_symbolizer sym;
+    mapnik::put<mapnik::value_double>(sym, mapnik::keys::simplify_tolerance, 1.0);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_impl feature(ctx,0);
+    mapnik::attributes vars;
+    mapnik::box2d<double> clip_box(extent);
+    clip_box.pad(extent.width() * 0.1);
+    Converter<mapnik::box2d<double>, vertex_sink, mapnik::line_symbolizer,
+              mapnik::CoordTransform, mapnik::proj_transform, agg::trans_affine,
+              conv_types, mapnik::feature_impl>
+        converter(clip_box, sink, sym, tr, prj_trans, affine, feature, vars, 1.0);
+    converter.template set<mapnik::clip_line_tag>();
+    converter.template set<mapnik::transform_tag>();
+    converter.template set<mapnik::affine_transform_tag>();
+    converter.template set<mapnik::simplify_tag>();
+    for (mapnik::geometry_type & geom : paths)
+    {
+        if (geom.size() > 1)
+        {
+            converter.apply(geom);
+        }
+    }
+}
+
+void parse_csv(std::string const& csv, mapnik::geometry_container & paths)
+{
+    std::istringstream in(csv);
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line))
+    {
+        std::string::size_type start = line.find('"');
+        std::string::size_type end = line.find('"', start + 1);
+        if (start == std::string::npos || end == std::string::npos) continue;
+        if (!mapnik::from_wkt(line.substr(start + 1, end - start - 1), paths))
+        {
+            throw std::runtime_error("Failed to parse WKT");
+        }
+    }
+}
+
+class test : public benchmark::test_case
+{
+    std::string csv_;
+    // parsed up front so that only the conversion is timed; the pull-style
+    // converters rewind the geometries, hence mutable and one set per copy
+    mutable mapnik::geometry_container paths_;
+    mapnik::box2d<double> extent_;
+    bool batch_;
+public:
+    test(mapnik::parameters const& params,
+         std::string const& csv,
+         mapnik::box2d<double> const& extent,
+         bool batch)
+     : test_case(params),
+       csv_(csv),
+       paths_(),
+       extent_(extent),
+       batch_(batch)
+    {
+        parse_csv(csv_, paths_);
+    }
+
+    test(test const& rhs)
+     : test_case(rhs),
+       csv_(rhs.csv_),
+       paths_(),
+       extent_(rhs.extent_),
+       batch_(rhs.batch_)
+    {
+        parse_csv(csv_, paths_);
+    }
+
+    bool validate() const
+    {
+        vertex_sink pull;
+        vertex_sink batch;
+        convert<mapnik::vertex_converter>(paths_, extent_, pull);
+        convert<mapnik::batch_vertex_converter>(paths_, extent_, batch);
+        if (pull.count != batch.count)
+        {
+            std::clog << "vertex count mismatch: " << pull.count << " != " << batch.count << "\n";
+            return false;
+        }
+        return std::fabs(pull.checksum - batch.checksum) < 1e-6 * pull.count;
+    }
+
+    void operator()() const
+    {
+        for (unsigned i=0;i<iterations_;++i)
+        {
+            vertex_sink sink;
+            if (batch_) convert<mapnik::batch_vertex_converter>(paths_, extent_, sink);
+            else convert<mapnik::vertex_converter>(paths_, extent_, sink);
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::parameters params;
+    benchmark::handle_args(argc,argv,params);
+    std::string filename("./benchmark/data/roads.csv");
+    std::ifstream in(filename.c_str(),std::ios_base::in | std::ios_base::binary);
+    if (!in.is_open())
+        throw std::runtime_error("could not open: '" + filename + "'");
+    std::string csv((std::istreambuf_iterator<char>(in)),
+                    (std::istreambuf_iterator<char>()));
+    mapnik::box2d<double> extent(1477001.12245,6890242.37746,1480004.49012,6892244.62256);
+    int return_value = 0;
+    {
+        test test_runner(params,csv,extent,false);
+        return_value = return_value | run(test_runner,"vertex_converter (pull)");
+    }
+    {
+        test test_runner(params,csv,extent,true);
+        return_value = return_value | run(test_runner,"batch_vertex_converter (push)");
+    }
+    return return_value;
+}
@@ -34,6 +34,7 @@
 #include <mapnik/grid/grid.hpp>
 #include <mapnik/grid/grid_util.hpp>
 #include <mapnik/grid/grid_view.hpp>
+#include <mapnik/grid/grid_utf.hpp>
 #include <mapnik/value_error.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_kv_iterator.hpp>
@@ -50,61 +51,23 @@ void grid2utf(T const& grid_type,
                      boost::python::list& l,
                      std::vector<typename T::lookup_type>& key_order)
 {
-    using keys_type = std::map< typename T::lookup_type, typename T::value_type>;
-    using keys_iterator = typename keys_type::iterator;
-
     typename T::data_type const& data = grid_type.data();
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::feature_key_type::const_iterator feature_pos;
-
-    keys_type keys;
-    // start counting at utf8 codepoint 32, aka space character
-    std::uint16_t codepoint = 32;
+    mapnik::utf_grid_keys<T> keys(grid_type);
 
     unsigned array_size = data.width();
     for (unsigned y = 0; y < data.height(); ++y)
     {
-        std::uint16_t idx = 0;
         const std::unique_ptr<Py_UNICODE[]> line(new Py_UNICODE[array_size]);
         typename T::value_type const* row = data.getRow(y);
         for (unsigned x = 0; x < data.width(); ++x)
         {
-            typename T::value_type feature_id = row[x];
-            feature_pos = feature_keys.find(feature_id);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                keys_iterator key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    if (feature_id == mapnik::grid::base_mask)
-                    {
-                        keys[""] = codepoint;
-                        key_order.push_back("");
-                    }
-                    else
-                    {
-                        keys[val] = codepoint;
-                        key_order.push_back(val);
-                    }
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
+            line[x] = static_cast<Py_UNICODE>(keys.codepoint(row[x]));
         }
         l.append(boost::python::object(
                      boost::python::handle<>(
                          PyUnicode_FromUnicode(line.get(), array_size))));
     }
+    key_order = keys.key_order();
 }
 
 
@@ -114,60 +77,23 @@ void grid2utf(T const& grid_type,
                      std::vector<typename T::lookup_type>& key_order,
                      unsigned int resolution)
 {
-    using keys_type = std::map< typename T::lookup_type, typename T::value_type>;
-    using keys_iterator = typename keys_type::iterator;
-
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::feature_key_type::const_iterator feature_pos;
-
-    keys_type keys;
-    // start counting at utf8 codepoint 32, aka space character
-    std::uint16_t codepoint = 32;
+    mapnik::utf_grid_keys<T> keys(grid_type);
 
     unsigned array_size = std::ceil(grid_type.width()/static_cast<float>(resolution));
     for (unsigned y = 0; y < grid_type.height(); y=y+resolution)
     {
         std::uint16_t idx = 0;
         const std::unique_ptr<Py_UNICODE[]> line(new Py_UNICODE[array_size]);
-        mapnik::grid::value_type const* row = grid_type.getRow(y);
+        typename T::value_type const* row = grid_type.getRow(y);
         for (unsigned x = 0; x < grid_type.width(); x=x+resolution)
         {
-            typename T::value_type feature_id = row[x];
-            feature_pos = feature_keys.find(feature_id);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                keys_iterator key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    if (feature_id == mapnik::grid::base_mask)
-                    {
-                        keys[""] = codepoint;
-                        key_order.push_back("");
-                    }
-                    else
-                    {
-                        keys[val] = codepoint;
-                        key_order.push_back(val);
-                    }
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
+            line[idx++] = static_cast<Py_UNICODE>(keys.codepoint(row[x]));
         }
         l.append(boost::python::object(
                      boost::python::handle<>(
                          PyUnicode_FromUnicode(line.get(), array_size))));
     }
+    key_order = keys.key_order();
 }
 
 
@@ -177,16 +103,8 @@ void grid2utf2(T const& grid_type,
                       std::vector<typename T::lookup_type>& key_order,
                       unsigned int resolution)
 {
-    using keys_type = std::map< typename T::lookup_type, typename T::value_type>;
-    using keys_iterator = typename keys_type::iterator;
-
     typename T::data_type const& data = grid_type.data();
-    typename T::feature_key_type const& feature_keys = grid_type.get_feature_keys();
-    typename T::feature_key_type::const_iterator feature_pos;
-
-    keys_type keys;
-    // start counting at utf8 codepoint 32, aka space character
-    uint16_t codepoint = 32;
+    mapnik::utf_grid_keys<T> keys(grid_type);
 
     mapnik::grid::data_type target(data.width()/resolution,data.height()/resolution);
     mapnik::scale_grid(target,grid_type.data(),0.0,0.0);
@@ -194,39 +112,17 @@ void grid2utf2(T const& grid_type,
     unsigned array_size = target.width();
     for (unsigned y = 0; y < target.height(); ++y)
     {
-        uint16_t idx = 0;
         const std::unique_ptr<Py_UNICODE[]> line(new Py_UNICODE[array_size]);
         mapnik::grid::value_type * row = target.getRow(y);
-        unsigned x;
-        for (x = 0; x < target.width(); ++x)
+        for (unsigned x = 0; x < target.width(); ++x)
         {
-            feature_pos = feature_keys.find(row[x]);
-            if (feature_pos != feature_keys.end())
-            {
-                mapnik::grid::lookup_type val = feature_pos->second;
-                keys_iterator key_pos = keys.find(val);
-                if (key_pos == keys.end())
-                {
-                    // Create a new entry for this key. Skip the codepoints that
-                    // can't be encoded directly in JSON.
-                    if (codepoint == 34) ++codepoint;      // Skip "
-                    else if (codepoint == 92) ++codepoint; // Skip backslash
-                    keys[val] = codepoint;
-                    key_order.push_back(val);
-                    line[idx++] = static_cast<Py_UNICODE>(codepoint);
-                    ++codepoint;
-                }
-                else
-                {
-                    line[idx++] = static_cast<Py_UNICODE>(key_pos->second);
-                }
-            }
-            // else, shouldn't get here...
+            line[x] = static_cast<Py_UNICODE>(keys.codepoint(row[x]));
         }
         l.append(boost::python::object(
                      boost::python::handle<>(
                          PyUnicode_FromUnicode(line.get(), array_size))));
     }
+    key_order = keys.key_order();
 }
 
 
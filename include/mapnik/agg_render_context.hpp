@@ -0,0 +1,90 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_AGG_RENDER_CONTEXT_HPP
+#define MAPNIK_AGG_RENDER_CONTEXT_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/noncopyable.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/per_thread_pool.hpp>
+
+// stl
+#include <memory>
+
+// fwd declaration to avoid dependence on agg headers
+namespace agg { class scanline_u8; }
+
+namespace mapnik {
+
+struct rasterizer;
+class image_32;
+class label_collision_detector4;
+template <typename T0, typename T1> class agg_renderer;
+
+// What an agg_renderer would otherwise allocate for every render, kept
+// for the next one: the rasterizer and scanline with their cell and span
+// storage, the buffer styles are composited in and the nodes of the
+// label collision detector. A renderer constructed with a context
+// resets these in constant time and hands them back when destroyed.
+//
+// A context serves one renderer at a time; use one per thread, e.g.
+// through an agg_render_context_pool.
+class MAPNIK_DECL agg_render_context : private mapnik::noncopyable
+{
+public:
+    agg_render_context();
+    ~agg_render_context();
+
+    // the detector, emptied and covering `extent`; throws when a renderer
+    // is using the context
+    std::shared_ptr<label_collision_detector4> const& detector(box2d<double> const& extent);
+
+private:
+    template <typename T0, typename T1> friend class agg_renderer;
+
+    std::shared_ptr<rasterizer> rasterizer_;
+    std::shared_ptr<agg::scanline_u8> scanline_;
+    std::shared_ptr<image_32> style_buffer_;
+    // region of style_buffer_ that may hold non-transparent pixels
+    box2d<int> style_buffer_dirty_;
+    std::shared_ptr<label_collision_detector4> detector_;
+    bool in_use_;
+};
+
+// Hands every thread its own agg_render_context.
+class MAPNIK_DECL agg_render_context_pool : private mapnik::noncopyable
+{
+public:
+    agg_render_context_pool();
+
+    // the calling thread's context, created on first use
+    std::shared_ptr<agg_render_context> local();
+
+private:
+    per_thread_pool<agg_render_context> contexts_;
+};
+
+}
+
+#endif // MAPNIK_AGG_RENDER_CONTEXT_HPP
@@ -37,11 +37,12 @@
 #include <mapnik/symbolizer_enumerations.hpp>
 #include <mapnik/renderer_common.hpp>
 #include <mapnik/image_data.hpp>
+#include <mapnik/marker_sprite_cache.hpp>
 // stl
 #include <memory>
 
 // fwd declaration to avoid dependence on agg headers
-namespace agg { struct trans_affine; }
+namespace agg { struct trans_affine; class scanline_u8; }
 
 // fwd declarations to speed up compile
 namespace mapnik {
@@ -54,6 +55,7 @@ namespace mapnik {
   class proj_transform;
   struct rasterizer;
   class image_32;
+  class agg_render_context;
 }
 
 namespace mapnik {
@@ -74,6 +76,10 @@ public:
                  double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
     // pass in mapnik::request object to provide the mutable things per render
     agg_renderer(Map const& m, request const& req, attributes const& vars, buffer_type & pixmap, double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
+    // reuse the allocations of earlier renders kept in `context`, with an
+    // emptied placement detector; the context must outlive the renderer
+    agg_renderer(Map const& m, buffer_type & pixmap, agg_render_context & context,
+                 double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
     ~agg_renderer();
     void start_map_processing(Map const& map);
     void end_map_processing(Map const& map);
@@ -155,11 +161,27 @@ protected:
     void draw_geo_extent(box2d<double> const& extent,mapnik::color const& color);
 
 private:
+    // Grow dirty_extent_ as symbolizers draw into the style buffer:
+    // mark_rasterized() after agg::render_scanlines(*ras_ptr, ...),
+    // mark_dirty() for blits, and mark_untracked() for drawing that reports
+    // no extent, which makes end_style_processing scan the buffer instead.
+    void mark_rasterized();
+    void mark_dirty(box2d<int> const& extent);
+    void mark_untracked();
+
     buffer_type & pixmap_;
     std::shared_ptr<buffer_type> internal_buffer_;
     mutable buffer_type * current_buffer_;
     mutable bool style_level_compositing_;
-    const std::unique_ptr<rasterizer> ras_ptr;
+    // region of internal_buffer_ that may hold non-transparent pixels
+    box2d<int> dirty_extent_;
+    // false once the current style drew something mark_* couldn't bound
+    bool dirty_tracked_;
+    marker_sprite_cache sprite_cache_;
+    const std::shared_ptr<rasterizer> ras_ptr;
+    // reused by the symbolizers rendering with agg::scanline_u8
+    const std::shared_ptr<agg::scanline_u8> sl_ptr;
+    agg_render_context * context_;
     gamma_method_enum gamma_method_;
     double gamma_;
     renderer_common common_;
@@ -0,0 +1,241 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_BATCH_VERTEX_CONVERTER_HPP
+#define MAPNIK_BATCH_VERTEX_CONVERTER_HPP
+
+// mapnik
+#include <mapnik/vertex_converters.hpp>
+#include <mapnik/vertex_batch.hpp>
+
+// boost
+#include <boost/mpl/bool.hpp>
+#include <boost/mpl/next.hpp>
+
+namespace mapnik {
+
+namespace detail {
+
+// Stages that have a whole-array implementation. Anything else (smooth,
+// offset, dash, stroke) is handed over to the pull-style dispatcher.
+template <typename Tag>
+struct batch_stage
+{
+    static const bool value = false;
+};
+
+template <>
+struct batch_stage<clip_line_tag>
+{
+    static const bool value = true;
+    template <typename Args>
+    static void apply(vertex_batch & batch, vertex_batch & scratch, Args const& args)
+    {
+        batch::clip_polyline(batch, boost::fusion::at_c<0>(args), scratch);
+        batch.swap(scratch);
+    }
+};
+
+template <>
+struct batch_stage<clip_poly_tag>
+{
+    static const bool value = true;
+    template <typename Args>
+    static void apply(vertex_batch & batch, vertex_batch & scratch, Args const& args)
+    {
+        batch::clip_polygon(batch, boost::fusion::at_c<0>(args), scratch);
+        batch.swap(scratch);
+    }
+};
+
+template <>
+struct batch_stage<close_poly_tag>
+{
+    static const bool value = true;
+    template <typename Args>
+    static void apply(vertex_batch & batch, vertex_batch & scratch, Args const&)
+    {
+        batch::close_polygons(batch, scratch);
+        batch.swap(scratch);
+    }
+};
+
+template <>
+struct batch_stage<transform_tag>
+{
+    static const bool value = true;
+    template <typename Args>
+    static void apply(vertex_batch & batch, vertex_batch &, Args const& args)
+    {
+        batch::proj_transform_vertices(batch, boost::fusion::at_c<4>(args));
+        batch::view_transform_vertices(batch, boost::fusion::at_c<3>(args));
+    }
+};
+
+template <>
+struct batch_stage<affine_transform_tag>
+{
+    static const bool value = true;
+    template <typename Args>
+    static void apply(vertex_batch & batch, vertex_batch &, Args const& args)
+    {
+        batch::affine_transform_vertices(batch, boost::fusion::at_c<5>(args));
+    }
+};
+
+template <>
+struct batch_stage<simplify_tag>
+{
+    static const bool value = true;
+    template <typename Args>
+    static void apply(vertex_batch & batch, vertex_batch & scratch, Args const& args)
+    {
+        auto const& sym = boost::fusion::at_c<2>(args);
+        auto const& feat = boost::fusion::at_c<6>(args);
+        auto const& vars = boost::fusion::at_c<7>(args);
+        simplify_algorithm_e algorithm = static_cast<simplify_algorithm_e>(get<value_integer>(sym, keys::simplify_algorithm, feat, vars));
+        double tolerance = get<value_double>(sym, keys::simplify_tolerance, feat, vars);
+        batch::simplify_vertices(batch, algorithm, tolerance, scratch);
+        batch.swap(scratch);
+    }
+};
+
+}
+
+// Push-style counterpart of vertex_converter: takes the same arguments and
+// the same list of converter tags, but runs the leading transform, clip and
+// simplify stages as tight loops over a vertex_batch. The first stage
+// without a batch implementation and everything after it runs through the
+// regular pull-style dispatcher, reading from the batch.
+template <typename B, typename R, typename S, typename T, typename P, typename A, typename C, typename F >
+struct batch_vertex_converter : private mapnik::noncopyable
+{
+    using conv_types = C;
+    using bbox_type = B;
+    using rasterizer_type = R;
+    using symbolizer_type = S;
+    using trans_type = T;
+    using proj_trans_type = P;
+    using affine_trans_type = A;
+    using feature_type = F;
+    using args_type =  typename boost::fusion::vector<
+    bbox_type const&,
+    rasterizer_type&,
+    symbolizer_type const&,
+    trans_type const&,
+    proj_trans_type const&,
+    affine_trans_type const&,
+    feature_type const&,
+    attributes const&,
+    double //scale-factor
+    >;
+
+    batch_vertex_converter(bbox_type const& b,
+                           rasterizer_type & ras,
+                           symbolizer_type const& sym,
+                           trans_type const& tr,
+                           proj_trans_type const& prj_trans,
+                           affine_trans_type const& affine_trans,
+                           feature_type const& feature,
+                           attributes const& vars,
+                           double scale_factor)
+        : disp_(args_type(boost::cref(b),
+                          boost::ref(ras),
+                          boost::cref(sym),
+                          boost::cref(tr),
+                          boost::cref(prj_trans),
+                          boost::cref(affine_trans),
+                          boost::cref(feature),
+                          boost::cref(vars),
+                          scale_factor)) {}
+
+    template <typename Geometry>
+    void apply(Geometry const& geom)
+    {
+        batch_.assign(geom);
+        using begin = typename boost::mpl::begin<conv_types>::type;
+        using end = typename boost::mpl::end<conv_types>::type;
+        process<begin,end>(boost::mpl::false_());
+    }
+
+    template <typename Conv>
+    void set()
+    {
+        using iter = typename boost::mpl::find<conv_types,Conv>::type;
+        using end = typename boost::mpl::end<conv_types>::type;
+        std::size_t index = boost::mpl::distance<iter,end>::value - 1;
+        if (index < disp_.vec_.size())
+            disp_.vec_[index]=1;
+    }
+
+    template <typename Conv>
+    void unset()
+    {
+        using iter = typename boost::mpl::find<conv_types,Conv>::type;
+        using end = typename boost::mpl::end<conv_types>::type;
+        std::size_t index = boost::mpl::distance<iter,end>::value - 1;
+        if (index < disp_.vec_.size())
+            disp_.vec_[index]=0;
+    }
+
+private:
+    template <typename Iter, typename End>
+    void process(boost::mpl::true_)
+    {
+        boost::fusion::at_c<1>(disp_.args_).add_path(batch_);
+    }
+
+    template <typename Iter, typename End>
+    void process(boost::mpl::false_)
+    {
+        using conv_tag = typename boost::mpl::deref<Iter>::type;
+        forward<Iter,End>(boost::mpl::bool_<detail::batch_stage<conv_tag>::value>());
+    }
+
+    template <typename Iter, typename End>
+    void forward(boost::mpl::true_)
+    {
+        using conv_tag = typename boost::mpl::deref<Iter>::type;
+        using Next = typename boost::mpl::next<Iter>::type;
+        std::size_t index = boost::mpl::distance<Iter,End>::value - 1;
+        if (disp_.vec_[index] == 1)
+        {
+            detail::batch_stage<conv_tag>::apply(batch_, scratch_, disp_.args_);
+        }
+        process<Next,End>(typename boost::is_same<Next,End>::type());
+    }
+
+    template <typename Iter, typename End>
+    void forward(boost::mpl::false_)
+    {
+        // hand the remaining (pull-only) stages over to the dispatcher
+        disp_.template dispatch<Iter,End>(batch_, boost::mpl::false_());
+    }
+
+    detail::dispatcher<args_type,conv_types> disp_;
+    vertex_batch batch_;
+    vertex_batch scratch_;
+};
+
+}
+
+#endif // MAPNIK_BATCH_VERTEX_CONVERTER_HPP
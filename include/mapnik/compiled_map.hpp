@@ -0,0 +1,48 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_COMPILED_MAP_HPP
+#define MAPNIK_COMPILED_MAP_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <string>
+
+namespace mapnik
+{
+class Map;
+
+// Compiled maps are a binary snapshot of a loaded Map: styles, rules,
+// expression trees, symbolizer properties, fontsets and layers with their
+// datasource parameters. Loading one only deserializes, nothing is parsed
+// again. Files are versioned and tied to the byte order of the machine
+// that wrote them; a mismatch throws config_error. Font directories given
+// in the XML are not recorded and have to be registered by the caller.
+MAPNIK_DECL void save_compiled_map(Map const& map, std::string const& filename);
+MAPNIK_DECL std::string save_compiled_map_to_string(Map const& map);
+MAPNIK_DECL void load_compiled_map(Map & map, std::string const& filename);
+MAPNIK_DECL void load_compiled_map_string(Map & map, std::string const& str);
+}
+
+#endif // MAPNIK_COMPILED_MAP_HPP
@@ -347,6 +347,7 @@ struct evaluate_global_attributes : mapnik::noncopyable
             {
                 util::apply_visitor(evaluator<Attributes>(prop, attributes_), prop.second);
             }
+            compile_properties(sym);
         }
         Attributes const& attributes_;
     };
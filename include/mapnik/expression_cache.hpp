@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_EXPRESSION_CACHE_HPP
+#define MAPNIK_EXPRESSION_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/noncopyable.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/path_expression.hpp>
+#include <mapnik/transform_expression.hpp>
+
+// stl
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+// Process wide interning of parsed expressions, path expressions and
+// transforms, keyed by their source string. Identical strings share one
+// tree, so equal filters can be compared by pointer. Only weak references
+// are held: a tree goes away with the last map using it.
+class MAPNIK_DECL expression_cache :
+        public singleton<expression_cache, CreateStatic>,
+        private mapnik::noncopyable
+{
+    friend class CreateStatic<expression_cache>;
+public:
+    // these throw like parse_expression, parse_path and parse_transform
+    expression_ptr expression(std::string const& str);
+    path_expression_ptr path(std::string const& str);
+    transform_list_ptr transform(std::string const& str);
+    std::size_t size() const;
+    void clear();
+private:
+    expression_cache();
+    template <typename T, typename Parse>
+    std::shared_ptr<T> intern(std::unordered_map<std::string, std::weak_ptr<T> > & cache,
+                              std::string const& str, Parse parse);
+    void prune();
+
+    std::unordered_map<std::string, std::weak_ptr<expr_node> > expressions_;
+    std::unordered_map<std::string, std::weak_ptr<path_expression> > paths_;
+    std::unordered_map<std::string, std::weak_ptr<transform_list> > transforms_;
+    std::size_t prune_at_;
+};
+
+extern template class MAPNIK_DECL singleton<expression_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_EXPRESSION_CACHE_HPP
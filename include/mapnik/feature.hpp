@@ -136,6 +136,19 @@ public:
         }
     }
 
+    // for readers that looked the key's index up in the context once
+    inline void put(std::size_t index, value && val)
+    {
+        if (index < data_.size())
+        {
+            data_[index] = std::move(val);
+        }
+        else
+        {
+            throw std::out_of_range("Key index does not exist");
+        }
+    }
+
     inline void put_new(context_type::key_type const& key, value && val)
     {
         context_type::map_type::const_iterator itr = ctx_->mapping_.find(key);
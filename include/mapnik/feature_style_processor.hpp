@@ -28,6 +28,7 @@
 #include <mapnik/featureset.hpp>
 #include <mapnik/config.hpp>
 #include <mapnik/feature_style_processor_context.hpp>
+#include <mapnik/render_stats.hpp>
 
 // stl
 #include <set>
@@ -84,6 +85,44 @@ public:
                         int buffer_size,
                         std::set<std::string>& names);
 
+    /*!
+     * \brief collect timings and counters of the following renders into
+     * `stats`, which must outlive them; null stops collecting.
+     */
+    void set_stats(render_stats * stats)
+    {
+        stats_ = stats;
+    }
+
+    render_stats * stats() const
+    {
+        return stats_;
+    }
+
+protected:
+    /*!
+     * \brief for renderers: count a label attempt placing `placed` labels.
+     */
+    void record_labels(std::size_t placed)
+    {
+        if (current_style_stats_)
+        {
+            ++current_style_stats_->labels_attempted;
+            current_style_stats_->labels_placed += placed;
+        }
+    }
+
+    /*!
+     * \brief for renderers: count an image buffer allocated for the style.
+     */
+    void record_allocation(std::size_t bytes)
+    {
+        if (current_style_stats_)
+        {
+            current_style_stats_->bytes_allocated += bytes;
+        }
+    }
+
 private:
     /*!
      * \brief renders a featureset with the given styles.
@@ -92,7 +131,8 @@ private:
                       feature_type_style const* style,
                       rule_cache const& rules,
                       featureset_ptr features,
-                      proj_transform const& prj_trans);
+                      proj_transform const& prj_trans,
+                      style_stats * stats);
 
     /*!
      * \brief prepare features for rendering asynchronously.
@@ -114,6 +154,8 @@ private:
     void render_material(layer_rendering_material & mat, Processor & p );
 
     Map const& m_;
+    render_stats * stats_;
+    style_stats * current_style_stats_;
 };
 }
 
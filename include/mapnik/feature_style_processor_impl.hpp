@@ -45,6 +45,9 @@
 #include <mapnik/proj_transform.hpp>
 #include <mapnik/util/featureset_buffer.hpp>
 #include <mapnik/util/variant.hpp>
+#include <mapnik/util/timer.hpp>
+#include <mapnik/symbolizer_utils.hpp>
+#include <mapnik/render_stats.hpp>
 // stl
 #include <vector>
 #include <stdexcept>
@@ -129,8 +132,11 @@ struct layer_rendering_material
     projection proj1_;
     box2d<double> layer_ext2_;
     std::vector<feature_type_style const*> active_styles_;
+    std::vector<std::string> active_style_names_;
     std::vector<featureset_ptr> featureset_ptr_list_;
     std::vector<rule_cache> rule_caches_;
+    // only filled when the processor collects render_stats
+    layer_stats stats_;
 
     layer_rendering_material(layer const& lay, projection const& dest)
         :
@@ -139,12 +145,39 @@ struct layer_rendering_material
         proj1_(lay.srs(),true) {}
 };
 
+// Counts the features read from a datasource featureset and the time
+// spent reading them
+class timed_featureset : public Featureset
+{
+public:
+    timed_featureset(featureset_ptr const& features, layer_stats & stats)
+        : features_(features),
+          stats_(stats) {}
+
+    feature_ptr next()
+    {
+        feature_ptr feature;
+        {
+            accumulating_timer timer(stats_.query_ms);
+            feature = features_->next();
+        }
+        if (feature) ++stats_.features_fetched;
+        return feature;
+    }
+
+private:
+    featureset_ptr features_;
+    layer_stats & stats_;
+};
+
 using layer_rendering_material_ptr = std::shared_ptr<layer_rendering_material>;
 
 
 template <typename Processor>
 feature_style_processor<Processor>::feature_style_processor(Map const& m, double scale_factor)
-    : m_(m)
+    : m_(m),
+      stats_(nullptr),
+      current_style_stats_(nullptr)
 {
     // https://github.com/mapnik/mapnik/issues/1100
     if (scale_factor <= 0)
@@ -157,6 +190,8 @@ template <typename Processor>
 void feature_style_processor<Processor>::apply(double scale_denom)
 {
     Processor & p = static_cast<Processor&>(*this);
+    std::unique_ptr<accumulating_timer> render_timer;
+    if (stats_) render_timer.reset(new accumulating_timer(stats_->render_ms));
     p.start_map_processing(m_);
 
     projection proj(m_.srs(),true);
@@ -219,6 +254,8 @@ void feature_style_processor<Processor>::apply(mapnik::layer const& lyr,
                                                double scale_denom)
 {
     Processor & p = static_cast<Processor&>(*this);
+    std::unique_ptr<accumulating_timer> render_timer;
+    if (stats_) render_timer.reset(new accumulating_timer(stats_->render_ms));
     p.start_map_processing(m_);
     projection proj(m_.srs(),true);
     if (scale_denom <= 0.0)
@@ -388,6 +425,7 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
                 {
                     // we'll have to handle compositing ops
                     active_styles.push_back(&(*style));
+                    mat.active_style_names_.push_back(style_name);
                 }
             }
         }
@@ -450,8 +488,10 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
         }
         if (active_rules)
         {
+            rc.build_index();
             rule_caches.push_back(std::move(rc));
             active_styles.push_back(&(*style));
+            mat.active_style_names_.push_back(style_name);
         }
     }
 
@@ -469,6 +509,23 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     query q(layer_ext,res,scale_denom,extent);
     q.set_variables(p.variables());
 
+    // let the datasource skip features no active `if` rule accepts, unless
+    // an else rule may render anything the `if` rules reject
+    std::vector<expression_ptr> filters;
+    for (rule_cache const& rc : rule_caches)
+    {
+        if (!rc.get_else_rules().empty())
+        {
+            filters.clear();
+            break;
+        }
+        for (rule const* r : rc.get_if_rules())
+        {
+            filters.push_back(r->get_filter());
+        }
+    }
+    q.set_filters(filters);
+
     if (p.attribute_collection_policy() == COLLECT_ALL)
     {
         layer_descriptor lay_desc = ds->get_descriptor();
@@ -496,16 +553,24 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     bool cache_features = lay.cache_features() && active_styles.size() > 1;
 
     std::vector<featureset_ptr> & featureset_ptr_list = mat.featureset_ptr_list_;
-    if (!group_by.empty() || cache_features)
+    std::size_t num_featuresets = (!group_by.empty() || cache_features) ? 1 : active_styles.size();
+    for (std::size_t i = 0; i < num_featuresets; ++i)
     {
-        featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
-    }
-    else
-    {
-        for(std::size_t i = 0; i < active_styles.size(); ++i)
+        if (!stats_)
         {
             featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
+            continue;
         }
+        featureset_ptr features;
+        {
+            accumulating_timer timer(mat.stats_.query_ms);
+            features = ds->features_with_context(q,current_ctx);
+        }
+        if (features)
+        {
+            features = std::make_shared<timed_featureset>(features, mat.stats_);
+        }
+        featureset_ptr_list.push_back(features);
     }
 }
 
@@ -516,15 +581,35 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
 {
     std::vector<feature_type_style const*> & active_styles = mat.active_styles_;
     std::vector<featureset_ptr> & featureset_ptr_list = mat.featureset_ptr_list_;
+
+    // one entry per active style, collected into stats_ when done
+    std::vector<style_stats> & styles_stats = mat.stats_.styles;
+    if (stats_)
+    {
+        mat.stats_.name = mat.lay_.name();
+        for (std::string const& name : mat.active_style_names_)
+        {
+            styles_stats.emplace_back(name);
+        }
+    }
+    auto stats_for = [&](std::size_t i) -> style_stats *
+    {
+        return stats_ ? &styles_stats[i] : nullptr;
+    };
+
     if (featureset_ptr_list.empty())
     {
         // The datasource wasn't queried because of early return
         // but we have to apply compositing operations on styles
+        std::size_t i = 0;
         for (feature_type_style const* style : active_styles)
         {
+            current_style_stats_ = stats_for(i++);
             p.start_style_processing(*style);
             p.end_style_processing(*style);
         }
+        current_style_stats_ = nullptr;
+        if (stats_) stats_->layers.push_back(std::move(mat.stats_));
         return;
     }
 
@@ -565,7 +650,8 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
                         render_style(p, style,
                                      rule_caches[i],
                                      cache,
-                                     prj_trans);
+                                     prj_trans,
+                                     stats_for(i));
                         ++i;
                     }
                     cache->clear();
@@ -578,7 +664,7 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             for (feature_type_style const* style : active_styles)
             {
                 cache->prepare();
-                render_style(p, style, rule_caches[i], cache, prj_trans);
+                render_style(p, style, rule_caches[i], cache, prj_trans, stats_for(i));
                 ++i;
             }
             cache->clear();
@@ -604,7 +690,8 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             cache->prepare();
             render_style(p, style,
                          rule_caches[i],
-                         cache, prj_trans);
+                         cache, prj_trans,
+                         stats_for(i));
             ++i;
         }
     }
@@ -619,11 +706,13 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             render_style(p, style,
                          rule_caches[i],
                          features,
-                         prj_trans);
+                         prj_trans,
+                         stats_for(i));
             ++i;
         }
     }
     p.end_layer_processing(mat.lay_);
+    if (stats_) stats_->layers.push_back(std::move(mat.stats_));
 }
 
 template <typename Processor>
@@ -632,38 +721,81 @@ void feature_style_processor<Processor>::render_style(
     feature_type_style const* style,
     rule_cache const& rc,
     featureset_ptr features,
-    proj_transform const& prj_trans)
+    proj_transform const& prj_trans,
+    style_stats * stats)
 {
+    std::unique_ptr<accumulating_timer> style_timer;
+    if (stats) style_timer.reset(new accumulating_timer(stats->time_ms));
+    current_style_stats_ = stats;
     p.start_style_processing(*style);
     if (!features)
     {
         p.end_style_processing(*style);
+        current_style_stats_ = nullptr;
         return;
     }
     mapnik::attributes vars = p.variables();
     feature_ptr feature;
     bool was_painted = false;
+    auto render_symbolizers = [&](rule::symbolizers const& symbols)
+    {
+        if (!stats)
+        {
+            if(!p.process(symbols,*feature,prj_trans))
+            {
+                for (symbolizer const& sym : symbols)
+                {
+                    util::apply_visitor(symbol_dispatch(p,*feature,prj_trans),sym);
+                }
+            }
+            return;
+        }
+        double elapsed = 0.0;
+        bool processed;
+        {
+            accumulating_timer timer(elapsed);
+            processed = p.process(symbols,*feature,prj_trans);
+        }
+        if (processed)
+        {
+            // the renderer took all symbolizers of the rule at once
+            symbolizer_stats & sym_stats = stats->symbolizers["rule"];
+            ++sym_stats.count;
+            sym_stats.time_ms += elapsed;
+            return;
+        }
+        for (symbolizer const& sym : symbols)
+        {
+            symbolizer_stats & sym_stats = stats->symbolizers[symbolizer_name(sym)];
+            ++sym_stats.count;
+            accumulating_timer timer(sym_stats.time_ms);
+            util::apply_visitor(symbol_dispatch(p,*feature,prj_trans),sym);
+        }
+    };
     while ((feature = features->next()))
     {
         bool do_else = true;
         bool do_also = false;
-        for (rule const* r : rc.get_if_rules() )
+        // filters are interned at load time, so rules sharing a filter
+        // string share a pointer; when such rules follow each other the
+        // filter is evaluated once for the run
+        expr_node const* last_filter = nullptr;
+        bool last_result = false;
+        for (rule const* r : rc.get_if_rules(*feature) )
         {
             expression_ptr const& expr = r->get_filter();
-            value_type result = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*feature,vars),*expr);
-            if (result.to_bool())
+            if (expr.get() != last_filter)
+            {
+                value_type result = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*feature,vars),*expr);
+                last_filter = expr.get();
+                last_result = result.to_bool();
+            }
+            if (last_result)
             {
                 was_painted = true;
                 do_else=false;
                 do_also=true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if(!p.process(symbols,*feature,prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbol_dispatch(p,*feature,prj_trans),sym);
-                    }
-                }
+                render_symbolizers(r->get_symbolizers());
                 if (style->get_filter_mode() == FILTER_FIRST)
                 {
                     // Stop iterating over rules and proceed with next feature.
@@ -672,19 +804,17 @@ void feature_style_processor<Processor>::render_style(
                 }
             }
         }
+        if (stats)
+        {
+            ++stats->features_fetched;
+            if (!do_else || !rc.get_else_rules().empty()) ++stats->features_matched;
+        }
         if (do_else)
         {
             for( rule const* r : rc.get_else_rules() )
             {
                 was_painted = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if(!p.process(symbols,*feature,prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbol_dispatch(p,*feature,prj_trans),sym);
-                    }
-                }
+                render_symbolizers(r->get_symbolizers());
             }
         }
         if (do_also)
@@ -692,19 +822,13 @@ void feature_style_processor<Processor>::render_style(
             for( rule const* r : rc.get_also_rules() )
             {
                 was_painted = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if(!p.process(symbols,*feature,prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbol_dispatch(p,*feature,prj_trans),sym);
-                    }
-                }
+                render_symbolizers(r->get_symbolizers());
             }
         }
     }
     p.painted(was_painted);
     p.end_style_processing(*style);
+    current_style_stats_ = nullptr;
 }
 
 }
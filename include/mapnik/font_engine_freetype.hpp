@@ -86,6 +86,8 @@ private:
     static std::map<std::string, std::pair<std::unique_ptr<char[]>, std::size_t> > memory_fonts_;
 };
 
+class text_layout_cache;
+
 template <typename T>
 class MAPNIK_DECL face_manager : private mapnik::noncopyable
 {
@@ -96,7 +98,8 @@ public:
     face_manager(T & engine)
         : engine_(engine),
         stroker_(engine_.create_stroker()),
-        face_ptr_cache_()  {}
+        face_ptr_cache_(),
+        layout_cache_()  {}
 
     face_ptr get_face(std::string const& name);
     face_set_ptr get_face_set(std::string const& name);
@@ -105,11 +108,14 @@ public:
 
 
     inline stroker_ptr get_stroker() { return stroker_; }
+    // Layouts shaped with this manager, shared between features.
+    text_layout_cache & get_layout_cache();
 
 private:
     font_engine_type & engine_;
     stroker_ptr stroker_;
     face_ptr_cache_type face_ptr_cache_;
+    std::shared_ptr<text_layout_cache> layout_cache_;
 };
 
 using face_manager_freetype = face_manager<freetype_engine>;
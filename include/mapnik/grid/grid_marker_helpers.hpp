@@ -28,6 +28,7 @@
 #include <mapnik/markers_placement.hpp>
 #include <mapnik/geometry.hpp>
 #include <mapnik/geom_util.hpp>
+#include <mapnik/marker.hpp> // for svg_path_ptr
 
 // agg
 #include "agg_renderer_scanline.h"
@@ -155,6 +156,7 @@ struct vector_markers_rasterizer_dispatch_grid : mapnik::noncopyable
 
     vector_markers_rasterizer_dispatch_grid(vertex_source_type & path,
                                             attribute_source_type const& attrs,
+                                            svg_path_ptr const& /*marker*/,
                                             box2d<double> const& bbox,
                                             agg::trans_affine const& marker_trans,
                                             markers_symbolizer const& sym,
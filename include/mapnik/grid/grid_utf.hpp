@@ -0,0 +1,123 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_GRID_UTF_HPP
+#define MAPNIK_GRID_UTF_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+// Assigns UTFGrid keys to the pixel ids of a hit_grid/hit_grid_view in the
+// order they are first seen. Pixel ids that share a key share an index.
+template <typename T>
+class utf_grid_keys
+{
+public:
+    using value_type = typename T::value_type;
+    using lookup_type = typename T::lookup_type;
+    using feature_key_type = typename T::feature_key_type;
+
+    explicit utf_grid_keys(T const& grid)
+        : feature_keys_(grid.get_feature_keys()),
+          ids_(),
+          indexes_(),
+          key_order_() {}
+
+    // index of the key of a pixel id into key_order()
+    std::uint32_t index(value_type feature_id)
+    {
+        auto id_pos = ids_.find(feature_id);
+        if (id_pos != ids_.end()) return id_pos->second;
+        static const lookup_type empty_key;
+        auto feature_pos = feature_keys_.find(feature_id);
+        lookup_type const& key = (feature_pos != feature_keys_.end()) ? feature_pos->second : empty_key;
+        auto key_pos = indexes_.find(key);
+        std::uint32_t idx;
+        if (key_pos == indexes_.end())
+        {
+            idx = static_cast<std::uint32_t>(key_order_.size());
+            indexes_.emplace(key, idx);
+            key_order_.push_back(key);
+        }
+        else
+        {
+            idx = key_pos->second;
+        }
+        ids_.emplace(feature_id, idx);
+        return idx;
+    }
+
+    std::uint32_t codepoint(value_type feature_id)
+    {
+        return codepoint_of(index(feature_id));
+    }
+
+    // Codepoints start at 32 (space) and skip the ones that can't be
+    // encoded directly in JSON (" and backslash) or in UTF-8 (surrogates).
+    static std::uint32_t codepoint_of(std::uint32_t idx)
+    {
+        std::uint32_t codepoint = 32 + idx;
+        if (codepoint >= 34) ++codepoint;
+        if (codepoint >= 92) ++codepoint;
+        if (codepoint >= 0xd800) codepoint += 0x800;
+        return codepoint;
+    }
+
+    std::vector<lookup_type> const& key_order() const
+    {
+        return key_order_;
+    }
+
+private:
+    feature_key_type const& feature_keys_;
+    std::unordered_map<value_type, std::uint32_t> ids_;
+    std::unordered_map<lookup_type, std::uint32_t> indexes_;
+    std::vector<lookup_type> key_order_;
+};
+
+// Encodes a hit_grid or hit_grid_view as UTFGrid JSON into `output`:
+//
+//   {"grid":["  !!",...],"keys":["","1"],"data":{"1":{"name":"foo"}}}
+//
+// Every `resolution`th pixel of every `resolution`th row is sampled. The
+// attributes named by property_names() go into "data" when `add_features`
+// is set. With `rle_rows` each row is written as an array of
+// [key index, run length] pairs instead of a string, e.g. [0,2,1,2].
+template <typename T>
+MAPNIK_DECL void encode_utf_grid(T const& grid,
+                                 std::string & output,
+                                 unsigned resolution = 1,
+                                 bool add_features = true,
+                                 bool rle_rows = false);
+
+}
+
+#endif // MAPNIK_GRID_UTF_HPP
@@ -29,6 +29,7 @@
 
 // stl
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <stdexcept>
 
@@ -195,6 +196,8 @@ private:
 
 using image_data_32 = ImageData<unsigned>;
 using image_data_8 = ImageData<byte> ;
+using image_data_16 = ImageData<std::uint16_t>;
+using image_data_32f = ImageData<float>;
 }
 
 #endif // MAPNIK_IMAGE_DATA_HPP
@@ -27,6 +27,7 @@
 //mapnik
 #include <mapnik/image_filter_types.hpp>
 #include <mapnik/util/hsl.hpp>
+#include <mapnik/util/process_bands.hpp>
 
 // boost GIL
 #include <boost/gil/gil_all.hpp>
@@ -41,6 +42,9 @@
 #include "agg_gradient_lut.h"
 // stl
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
 
 // 8-bit YUV
 //Y = ( (  66 * R + 129 * G +  25 * B + 128) >> 8) +  16
@@ -383,6 +387,164 @@ void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& fi
     }
 }
 
+namespace detail {
+
+// Integer versions of the 3x3 kernels above, each taking the neighbourhood
+// c0..c8 of one channel. They produce exactly what process_channel()
+// produces, but operate on plain bytes so the row loops vectorize.
+struct emboss_kernel
+{
+    static int apply(int c0, int c1, int, int c3, int c4, int c5, int, int c7, int c8)
+    {
+        return -2*c0 - c1 - c3 + c4 + c5 + c7 + 2*c8;
+    }
+};
+
+struct sharpen_kernel
+{
+    static int apply(int, int c1, int, int c3, int c4, int c5, int, int c7, int)
+    {
+        return -c1 - c3 + 5*c4 - c5 - c7;
+    }
+};
+
+struct edge_detect_kernel
+{
+    static int apply(int, int c1, int, int c3, int c4, int c5, int, int c7, int)
+    {
+        return c1 + c3 - 4*c4 + c5 + c7;
+    }
+};
+
+struct sobel_kernel
+{
+    static int apply(int c0, int c1, int c2, int c3, int, int c5, int c6, int c7, int c8)
+    {
+        int x_gradient = (c2 + 2*c5 + c8) - (c0 + 2*c3 + c6);
+        int y_gradient = (c0 + 2*c1 + c2) - (c6 + 2*c7 + c8);
+        float out_value = static_cast<float>(std::sqrt(static_cast<double>(x_gradient * x_gradient + y_gradient * y_gradient)));
+        return out_value > 255 ? 255 : static_cast<int>(out_value);
+    }
+};
+
+inline std::uint8_t clamp_channel(int value)
+{
+    return static_cast<std::uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// One output pixel at column x, replicating the left/right edges the same
+// way apply_convolution_3x3 does.
+template <typename Kernel>
+void convolve_edge_pixel(std::uint8_t const* up, std::uint8_t const* mid, std::uint8_t const* down,
+                         std::uint8_t * out, int x, int width)
+{
+    int l = 4 * (x > 0 ? x - 1 : x);
+    int m = 4 * x;
+    int r = 4 * (x < width - 1 ? x + 1 : x);
+    for (int i = 0; i < 3; ++i)
+    {
+        out[m + i] = clamp_channel(Kernel::apply(up[l + i], up[m + i], up[r + i],
+                                                 mid[l + i], mid[m + i], mid[r + i],
+                                                 down[l + i], down[m + i], down[r + i]));
+    }
+    out[m + 3] = mid[m + 3];
+}
+
+template <typename Kernel>
+void convolve_row(std::uint8_t const* up, std::uint8_t const* mid, std::uint8_t const* down,
+                  std::uint8_t * out, int width, std::vector<std::uint16_t> &)
+{
+    // interior pixels: all four channels in one flat loop, alpha fixed up below
+    int end = 4 * (width - 1);
+    for (int i = 4; i < end; ++i)
+    {
+        out[i] = clamp_channel(Kernel::apply(up[i - 4], up[i], up[i + 4],
+                                             mid[i - 4], mid[i], mid[i + 4],
+                                             down[i - 4], down[i], down[i + 4]));
+    }
+    for (int x = 1; x < width - 1; ++x)
+    {
+        out[4 * x + 3] = mid[4 * x + 3];
+    }
+    convolve_edge_pixel<Kernel>(up, mid, down, out, 0, width);
+    if (width > 1) convolve_edge_pixel<Kernel>(up, mid, down, out, width - 1, width);
+}
+
+// The box blur is separable: sum the three rows per column first, then
+// three neighbouring column sums. 0.1111f * sum truncates to the same byte
+// as the nine float products in blur_matrix for every sum up to 9 * 255.
+struct blur_kernel
+{
+    static int apply(int c0, int c1, int c2, int c3, int c4, int c5, int c6, int c7, int c8)
+    {
+        return from_sum(c0 + c1 + c2 + c3 + c4 + c5 + c6 + c7 + c8);
+    }
+
+    static int from_sum(int sum)
+    {
+        return static_cast<int>(0.1111f * static_cast<float>(sum));
+    }
+};
+
+template <>
+inline void convolve_row<blur_kernel>(std::uint8_t const* up, std::uint8_t const* mid, std::uint8_t const* down,
+                                      std::uint8_t * out, int width, std::vector<std::uint16_t> & column_sums)
+{
+    int bytes = 4 * width;
+    column_sums.resize(bytes);
+    std::uint16_t * sums = column_sums.data();
+    for (int i = 0; i < bytes; ++i)
+    {
+        sums[i] = static_cast<std::uint16_t>(up[i] + mid[i] + down[i]);
+    }
+    int end = 4 * (width - 1);
+    for (int i = 4; i < end; ++i)
+    {
+        out[i] = static_cast<std::uint8_t>(blur_kernel::from_sum(sums[i - 4] + sums[i] + sums[i + 4]));
+    }
+    for (int x = 1; x < width - 1; ++x)
+    {
+        out[4 * x + 3] = mid[4 * x + 3];
+    }
+    convolve_edge_pixel<blur_kernel>(up, mid, down, out, 0, width);
+    if (width > 1) convolve_edge_pixel<blur_kernel>(up, mid, down, out, width - 1, width);
+}
+
+// Row-oriented replacement for apply_convolution_3x3 over raw rgba8 rows.
+// Like the original, the rows above the first and below the last are
+// mirrored and columns are clamped.
+template <typename Kernel>
+void convolve_3x3(std::uint8_t const* src, std::uint8_t * dst, unsigned width, unsigned height)
+{
+    if (width == 0 || height == 0) return;
+    std::size_t stride = 4 * static_cast<std::size_t>(width);
+    unsigned last = height - 1;
+    util::process_bands(width, height, [=](unsigned y0, unsigned y1)
+    {
+        std::vector<std::uint16_t> scratch;
+        for (unsigned y = y0; y < y1; ++y)
+        {
+            unsigned y_up = y > 0 ? y - 1 : (last > 0 ? 1 : 0);
+            unsigned y_down = y < last ? y + 1 : (last > 0 ? last - 1 : 0);
+            convolve_row<Kernel>(src + y_up * stride, src + y * stride, src + y_down * stride,
+                                 dst + y * stride, static_cast<int>(width), scratch);
+        }
+    });
+}
+
+template <typename Src, typename Kernel>
+void apply_kernel_3x3(Src & src)
+{
+    src.demultiply();
+    std::size_t size = 4 * static_cast<std::size_t>(src.width()) * src.height();
+    std::uint8_t * data = reinterpret_cast<std::uint8_t*>(src.raw_data());
+    std::vector<std::uint8_t> copy(data, data + size);
+    convolve_3x3<Kernel>(copy.data(), data, src.width(), src.height());
+    src.premultiply();
+}
+
+}
+
 template <typename Src, typename Filter>
 void apply_filter(Src & src, Filter const& filter)
 {
@@ -394,12 +556,59 @@ void apply_filter(Src & src, Filter const& filter)
     src.premultiply();
 }
 
+template <typename Src>
+void apply_filter(Src & src, blur const&)
+{
+    detail::apply_kernel_3x3<Src, detail::blur_kernel>(src);
+}
+
+template <typename Src>
+void apply_filter(Src & src, emboss const&)
+{
+    detail::apply_kernel_3x3<Src, detail::emboss_kernel>(src);
+}
+
+template <typename Src>
+void apply_filter(Src & src, sharpen const&)
+{
+    detail::apply_kernel_3x3<Src, detail::sharpen_kernel>(src);
+}
+
+template <typename Src>
+void apply_filter(Src & src, edge_detect const&)
+{
+    detail::apply_kernel_3x3<Src, detail::edge_detect_kernel>(src);
+}
+
+template <typename Src>
+void apply_filter(Src & src, sobel const&)
+{
+    detail::apply_kernel_3x3<Src, detail::sobel_kernel>(src);
+}
+
+// The stack blur is separable, so the horizontal pass runs over bands of
+// rows and the vertical pass over bands of columns (a sub-buffer keeping the
+// full stride), each band on its own thread for large images when
+// util::max_band_threads() allows.
 template <typename Src>
 void apply_filter(Src & src, agg_stack_blur const& op)
 {
-    agg::rendering_buffer buf(src.raw_data(),src.width(),src.height(), src.width() * 4);
-    agg::pixfmt_rgba32_pre pixf(buf);
-    agg::stack_blur_rgba32(pixf,op.rx,op.ry);
+    unsigned width = src.width();
+    unsigned height = src.height();
+    agg::int8u * data = reinterpret_cast<agg::int8u*>(src.raw_data());
+    int stride = static_cast<int>(width * 4);
+    util::process_bands(width, height, [=](unsigned y0, unsigned y1)
+    {
+        agg::rendering_buffer buf(data + y0 * stride, width, y1 - y0, stride);
+        agg::pixfmt_rgba32_pre pixf(buf);
+        agg::stack_blur_rgba32(pixf, op.rx, 0);
+    });
+    util::process_bands(height, width, [=](unsigned x0, unsigned x1)
+    {
+        agg::rendering_buffer buf(data + x0 * 4, x1 - x0, height, stride);
+        agg::pixfmt_rgba32_pre pixf(buf);
+        agg::stack_blur_rgba32(pixf, 0, op.ry);
+    });
 }
 
 inline double channel_delta(double source, double match)
@@ -786,6 +995,52 @@ struct filter_radius_visitor : util::static_visitor<void>
     }
 };
 
+// Adds up how far a filter chain can spread painted pixels: the radius of
+// every agg-stack-blur and 1px for every 3x3 kernel. Chained filters
+// compound, so the largest radius alone is not enough.
+struct filter_spread_visitor : util::static_visitor<void>
+{
+    int & spread_;
+    filter_spread_visitor(int & spread)
+        : spread_(spread) {}
+    template <typename T>
+    void operator () (T const& /*filter*/) {}
+
+    void operator () (agg_stack_blur const& op)
+    {
+        spread_ += static_cast<int>(std::max(op.rx, op.ry));
+    }
+
+    void operator () (blur const&) { ++spread_; }
+    void operator () (emboss const&) { ++spread_; }
+    void operator () (sharpen const&) { ++spread_; }
+    void operator () (edge_detect const&) { ++spread_; }
+    void operator () (sobel const&) { ++spread_; }
+};
+
+// Tells whether a filter chain only ever turns transparent pixels into
+// something visible within filter_spread_visitor's spread. The gradient
+// filters write opaque pixels across the whole image, so they need the
+// full buffer.
+struct filter_region_visitor : util::static_visitor<void>
+{
+    bool & local_;
+    filter_region_visitor(bool & local)
+        : local_(local) {}
+    template <typename T>
+    void operator () (T const& /*filter*/) {}
+
+    void operator () (x_gradient const&)
+    {
+        local_ = false;
+    }
+
+    void operator () (y_gradient const&)
+    {
+        local_ = false;
+    }
+};
+
 }}
 
 #endif // MAPNIK_IMAGE_FILTER_HPP
@@ -60,6 +60,13 @@ struct MAPNIK_DECL image_reader : private mapnik::noncopyable
     virtual bool has_alpha() const=0;
     virtual bool premultiplied_alpha() const=0;
     virtual void read(unsigned x,unsigned y,image_data_32& image)=0;
+    // Largest factor, not above max_factor, by which this reader can shrink the
+    // image while decoding. Readers without reduced decoding return 1.
+    virtual unsigned reduction(unsigned /*max_factor*/) const { return 1; }
+    // Reads the image shrunk by factor (as returned by reduction()). x, y and the
+    // size of image are in reduced pixels; the reduced image is
+    // ceil(width() / factor) by ceil(height() / factor) pixels.
+    virtual void read_reduced(unsigned x, unsigned y, unsigned factor, image_data_32& image);
     virtual ~image_reader() {}
 };
 
@@ -33,6 +33,8 @@
 
 // stl
 #include <vector>
+#include <cstdint>
+#include <unordered_map>
 
 namespace mapnik
 {
@@ -125,22 +127,48 @@ public:
 };
 
 
+struct unicode_string_hash
+{
+    std::size_t operator()(mapnik::value_unicode_string const& text) const
+    {
+        return static_cast<std::size_t>(text.hashCode());
+    }
+};
+
 //quad tree based label collision detector so labels dont appear within a given distance
 class label_collision_detector4 : mapnik::noncopyable
 {
 public:
+    // interned label text, see intern()
+    using key_type = std::uint64_t;
+
     struct label
     {
-        label(box2d<double> const& b) : box(b), text() {}
-        label(box2d<double> const& b, mapnik::value_unicode_string const& t) : box(b), text(t) {}
+        label(box2d<double> const& b) : box(b), key(0) {}
+        label(box2d<double> const& b, key_type k) : box(b), key(k) {}
 
         box2d<double> box;
-        mapnik::value_unicode_string text;
+        key_type key;
     };
 
 private:
     using tree_t = quad_tree< label >;
+    using key_map = std::unordered_map<mapnik::value_unicode_string, key_type, unicode_string_hash>;
+    using repeat_map = std::unordered_map<key_type, std::vector<box2d<double> > >;
     tree_t tree_;
+    // every distinct text gets an id once; repeat-distance checks then only
+    // look at the boxes placed with the same id instead of comparing strings.
+    // The boxes of one id are scanned linearly rather than kept in a quad
+    // tree of their own: a text rarely has more than a handful of labels,
+    // and a tree per distinct text would cost allocations for every label.
+    key_map keys_;
+    repeat_map repeats_;
+
+    key_type find_key(mapnik::value_unicode_string const& text) const
+    {
+        key_map::const_iterator itr = keys_.find(text);
+        return itr != keys_.end() ? itr->second : 0;
+    }
 
 public:
     using query_iterator = tree_t::query_iterator;
@@ -183,43 +211,58 @@ public:
 
     bool has_placement(box2d<double> const& box, double minimum_distance, mapnik::value_unicode_string const& text, double repeat_distance)
     {
-        box2d<double> const& minimum_box = (minimum_distance > 0
-                                               ? box2d<double>(box.minx() - minimum_distance, box.miny() - minimum_distance,
-                                                               box.maxx() + minimum_distance, box.maxy() + minimum_distance)
-                                               : box);
+        if (!has_placement(box, minimum_distance)) return false;
+        key_type key = find_key(text);
+        if (key == 0) return true; // no label with this text yet
 
         box2d<double> const& repeat_box = (repeat_distance > 0
                                                ? box2d<double>(box.minx() - repeat_distance, box.miny() - repeat_distance,
                                                                box.maxx() + repeat_distance, box.maxy() + repeat_distance)
                                                : box);
 
-        tree_t::query_iterator itr = tree_.query_in_box(repeat_distance > minimum_distance ? repeat_box : minimum_box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
+        repeat_map::const_iterator itr = repeats_.find(key);
+        if (itr != repeats_.end())
         {
-            if (itr->box.intersects(minimum_box) || (text == itr->text && itr->box.intersects(repeat_box)))
+            for (box2d<double> const& other : itr->second)
             {
-                return false;
+                if (other.intersects(repeat_box)) return false;
             }
         }
-
         return true;
     }
 
+    // ids start at 1. The empty text has an id like any other: labels
+    // without text repeat each other, as do labels inserted without one.
+    key_type intern(mapnik::value_unicode_string const& text)
+    {
+        return keys_.emplace(text, keys_.size() + 1).first->second;
+    }
+
     void insert(box2d<double> const& box)
     {
-        tree_.insert(label(box), box);
+        insert(box, mapnik::value_unicode_string());
     }
 
     void insert(box2d<double> const& box, mapnik::value_unicode_string const& text)
     {
-        tree_.insert(label(box, text), box);
+        key_type key = intern(text);
+        tree_.insert(label(box, key), box);
+        repeats_[key].push_back(box);
     }
 
     void clear()
     {
         tree_.clear();
+        keys_.clear();
+        repeats_.clear();
+    }
+
+    // like clear(), also moving the detector to `extent`
+    void reset(box2d<double> const& extent)
+    {
+        tree_.reset(extent);
+        keys_.clear();
+        repeats_.clear();
     }
 
     box2d<double> const& extent() const
@@ -38,6 +38,8 @@
 #include <mapnik/box2d.hpp>
 #include <mapnik/vertex_converters.hpp>
 #include <mapnik/label_collision_detector.hpp>
+#include <mapnik/marker_sprite_cache.hpp>
+#include <mapnik/image_compositing.hpp>
 
 // agg
 #include "agg_ellipse.h"
@@ -58,6 +60,7 @@
 #include <boost/optional.hpp>
 
 // stl
+#include <cmath>
 #include <memory>
 #include <type_traits> // remove_reference
 
@@ -65,6 +68,10 @@ namespace mapnik {
 
 struct clip_poly_tag;
 
+// RendererContext is (buffer, rasterizer, pixmap, marker_sprite_cache).
+// Markers drawn with src-over whose appearance repeats are rasterized once
+// into a sprite and composited afterwards; every other placement is
+// rendered as vectors.
 template <typename SvgRenderer, typename Detector, typename RendererContext>
 struct vector_markers_rasterizer_dispatch : mapnik::noncopyable
 {
@@ -76,8 +83,16 @@ struct vector_markers_rasterizer_dispatch : mapnik::noncopyable
     using BufferType = typename std::tuple_element<0,RendererContext>::type;
     using RasterizerType = typename std::tuple_element<1,RendererContext>::type;
 
+    // sprites above this many pixels are not worth caching
+    static const int max_sprite_pixels = 256 * 256;
+    // translations are binned to 1/subpixel_bins of a pixel
+    static const int subpixel_bins = 4;
+
+    // `marker` is the cached marker `path` and `attrs` come from, or null
+    // for a path built for this feature
     vector_markers_rasterizer_dispatch(vertex_source_type & path,
                                        attribute_source_type const& attrs,
+                                       svg_path_ptr const& marker,
                                        box2d<double> const& bbox,
                                        agg::trans_affine const& marker_trans,
                                        markers_symbolizer const& sym,
@@ -99,9 +114,22 @@ struct vector_markers_rasterizer_dispatch : mapnik::noncopyable
         feature_(feature),
         vars_(vars),
         scale_factor_(scale_factor),
-        snap_to_pixels_(snap_to_pixels)
+        snap_to_pixels_(snap_to_pixels),
+        sprite_cache_(std::get<3>(renderer_context)),
+        sprites_(0)
     {
-        pixf_.comp_op(static_cast<agg::comp_op_e>(get<composite_mode_e>(sym, keys::comp_op, feature_, vars_, src_over)));
+        composite_mode_e comp_op = get<composite_mode_e>(sym, keys::comp_op, feature_, vars_, src_over);
+        pixf_.comp_op(static_cast<agg::comp_op_e>(comp_op));
+        // only src-over is associative, so only then does drawing a
+        // pre-composited sprite equal drawing the paths one by one
+        if (comp_op == src_over)
+        {
+            marker_sprite_cache::marker_key key;
+            if (make_marker_key(path, attrs, marker, key))
+            {
+                sprites_ = &sprite_cache_.find(key);
+            }
+        }
     }
 
     template <typename T>
@@ -132,11 +160,163 @@ struct vector_markers_rasterizer_dispatch : mapnik::noncopyable
                 matrix.tx = std::floor(matrix.tx + .5);
                 matrix.ty = std::floor(matrix.ty + .5);
             }
-            svg_renderer_.render(ras_, sl_, renb_, matrix, opacity, bbox_);
+            if (!sprites_ || !render_sprite(sl_, matrix, opacity))
+            {
+                svg_renderer_.render(ras_, sl_, renb_, matrix, opacity, bbox_);
+            }
         }
     }
 
 private:
+    // content of the marker that affects its pixels; false if it has
+    // gradients, which are not worth describing here
+    bool make_marker_key(vertex_source_type & path,
+                         attribute_source_type const& attrs,
+                         svg_path_ptr const& marker,
+                         marker_sprite_cache::marker_key & key) const
+    {
+        for (unsigned i = 0; i < attrs.size(); ++i)
+        {
+            svg::path_attributes const& attr = attrs[i];
+            if (attr.fill_gradient.get_gradient_type() != NO_GRADIENT ||
+                attr.stroke_gradient.get_gradient_type() != NO_GRADIENT)
+            {
+                return false;
+            }
+        }
+        key.push_back(get<double>(sym_, keys::opacity, feature_, vars_, 1.0));
+        key.push_back(get<value_double>(sym_, keys::gamma, feature_, vars_, 1.0));
+        key.push_back(get<gamma_method_enum>(sym_, keys::gamma_method, feature_, vars_, GAMMA_POWER));
+        key.push_back(bbox_.minx());
+        key.push_back(bbox_.miny());
+        key.push_back(bbox_.maxx());
+        key.push_back(bbox_.maxy());
+        // a cached marker's path is its own, so its id stands for the
+        // vertices; the attributes are its own unless the symbolizer
+        // overrides fill or stroke
+        bool own_attrs = marker && &attrs == &marker->attributes();
+        if (marker)
+        {
+            key.push_back(-1.0);
+            key.push_back(sprite_cache_.marker_id(marker));
+        }
+        if (!own_attrs)
+        {
+            key.push_back(attrs.size());
+            for (unsigned i = 0; i < attrs.size(); ++i)
+            {
+                svg::path_attributes const& attr = attrs[i];
+                double values[] = { double(attr.index), attr.opacity,
+                                    double(attr.fill_color.r), double(attr.fill_color.g),
+                                    double(attr.fill_color.b), double(attr.fill_color.a), attr.fill_opacity,
+                                    double(attr.stroke_color.r), double(attr.stroke_color.g),
+                                    double(attr.stroke_color.b), double(attr.stroke_color.a), attr.stroke_opacity,
+                                    double(attr.fill_flag), double(attr.stroke_flag), double(attr.even_odd_flag),
+                                    double(attr.visibility_flag), double(attr.line_join), double(attr.line_cap),
+                                    attr.miter_limit, attr.stroke_width,
+                                    attr.transform.sx, attr.transform.shy, attr.transform.shx,
+                                    attr.transform.sy, attr.transform.tx, attr.transform.ty };
+                key.insert(key.end(), std::begin(values), std::end(values));
+            }
+        }
+        if (!marker)
+        {
+            unsigned count = path.total_vertices();
+            key.push_back(count);
+            for (unsigned i = 0; i < count; ++i)
+            {
+                double vx, vy;
+                unsigned cmd = path.vertex(i, &vx, &vy);
+                key.push_back(cmd);
+                key.push_back(vx);
+                key.push_back(vy);
+            }
+        }
+        return true;
+    }
+
+    // Composites the sprite for this placement, rasterizing it on the second
+    // use of the same transform. Returns false when the placement has to be
+    // rendered as vectors.
+    template <typename Scanline>
+    bool render_sprite(Scanline & sl, agg::trans_affine const& matrix, double opacity)
+    {
+        double bx = std::floor(matrix.tx * subpixel_bins + .5);
+        double by = std::floor(matrix.ty * subpixel_bins + .5);
+        int ix = static_cast<int>(std::floor(bx / subpixel_bins));
+        int iy = static_cast<int>(std::floor(by / subpixel_bins));
+        double fx = (bx - ix * subpixel_bins) / subpixel_bins;
+        double fy = (by - iy * subpixel_bins) / subpixel_bins;
+        marker_sprite_cache::transform_key key = {{ matrix.sx, matrix.shy, matrix.shx, matrix.sy, fx, fy }};
+        marker_sprite_cache::sprite_entry & entry = (*sprites_)[key];
+        if (!entry.cacheable) return false;
+        if (!entry.image)
+        {
+            // a transform seen once is cheaper to draw than to cache
+            if (++entry.uses < 2) return false;
+            if (!rasterize_sprite(sl, matrix, opacity, fx, fy, entry))
+            {
+                entry.cacheable = false;
+                return false;
+            }
+        }
+        image_data_32 target(buf_.width(), buf_.height(),
+                             reinterpret_cast<image_data_32::pixel_type*>(buf_.buf()));
+        composite(target, *entry.image, src_over, 1.0f, ix + entry.x, iy + entry.y);
+        return true;
+    }
+
+    template <typename Scanline>
+    bool rasterize_sprite(Scanline & sl, agg::trans_affine const& matrix, double opacity,
+                          double fx, double fy, marker_sprite_cache::sprite_entry & entry)
+    {
+        agg::trans_affine linear(matrix.sx, matrix.shy, matrix.shx, matrix.sy, fx, fy);
+        box2d<double> extent = bbox_ * linear;
+        // room for strokes, which the marker box does not include
+        double stroke = 0.0;
+        attribute_source_type const& attrs = svg_renderer_.attributes();
+        for (unsigned i = 0; i < attrs.size(); ++i)
+        {
+            if (attrs[i].stroke_flag)
+            {
+                stroke = std::max(stroke, attrs[i].stroke_width * attrs[i].transform.scale());
+            }
+        }
+        int pad = 2 + static_cast<int>(std::ceil(stroke * linear.scale()));
+        int x0 = static_cast<int>(std::floor(extent.minx())) - pad;
+        int y0 = static_cast<int>(std::floor(extent.miny())) - pad;
+        int width = static_cast<int>(std::ceil(extent.maxx())) + pad - x0;
+        int height = static_cast<int>(std::ceil(extent.maxy())) + pad - y0;
+        if (width <= 0 || height <= 0 || width * height > max_sprite_pixels ||
+            width > static_cast<int>(buf_.width()) || height > static_cast<int>(buf_.height()))
+        {
+            return false;
+        }
+        std::unique_ptr<image_data_32> image(new image_data_32(width, height));
+        agg::rendering_buffer sprite_buf(image->getBytes(), width, height, width * 4);
+        pixfmt_type sprite_pixf(sprite_buf);
+        sprite_pixf.comp_op(agg::comp_op_src_over);
+        renderer_base sprite_renb(sprite_pixf);
+        agg::trans_affine local(linear);
+        local.tx = fx - x0;
+        local.ty = fy - y0;
+        svg_renderer_.render(ras_, sl, sprite_renb, local, opacity, bbox_);
+        // anything on the border may have been clipped
+        for (int x = 0; x < width; ++x)
+        {
+            if ((*image)(x, 0) || (*image)(x, height - 1)) return false;
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            if ((*image)(0, y) || (*image)(width - 1, y)) return false;
+        }
+        if (!sprite_cache_.reserve(width * height * 4)) return false;
+        entry.x = x0;
+        entry.y = y0;
+        entry.image = std::move(image);
+        return true;
+    }
+
     BufferType & buf_;
     pixfmt_type pixf_;
     renderer_base renb_;
@@ -150,6 +330,8 @@ private:
     attributes const& vars_;
     double scale_factor_;
     bool snap_to_pixels_;
+    marker_sprite_cache & sprite_cache_;
+    marker_sprite_cache::marker_entry * sprites_;
 };
 
 template <typename Detector,typename RendererContext>
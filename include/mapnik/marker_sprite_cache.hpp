@@ -0,0 +1,131 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_MARKER_SPRITE_CACHE_HPP
+#define MAPNIK_MARKER_SPRITE_CACHE_HPP
+
+// mapnik
+#include <mapnik/image_data.hpp>
+#include <mapnik/noncopyable.hpp>
+
+// stl
+#include <array>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+namespace mapnik {
+
+// Vector markers rasterized once per distinct appearance and then blitted.
+// Owned by one agg_renderer, so it lives for a single render and needs no
+// locking. Markers are identified by content (path, attributes, opacity,
+// gamma), sprites within a marker by the linear part of the placement
+// transform plus a quarter-pixel bin of its translation. Paths of markers
+// from the marker cache are not read vertex by vertex for every feature:
+// such a marker stands for its content by a number, see marker_id().
+class marker_sprite_cache : private mapnik::noncopyable
+{
+public:
+    // sx, shy, shx, sy, subpixel x, subpixel y
+    using transform_key = std::array<double, 6>;
+    using marker_key = std::vector<double>;
+
+    struct sprite_entry
+    {
+        sprite_entry()
+            : uses(0),
+              cacheable(true),
+              x(0),
+              y(0),
+              image() {}
+        unsigned uses;
+        bool cacheable;
+        // offset of the sprite's top left corner from the integer position
+        int x;
+        int y;
+        std::unique_ptr<image_data_32> image;
+    };
+
+    template <typename Key>
+    struct key_hash
+    {
+        std::size_t operator()(Key const& key) const
+        {
+            std::size_t seed = 0;
+            std::hash<double> hasher;
+            for (double value : key)
+            {
+                seed ^= hasher(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            }
+            return seed;
+        }
+    };
+
+    using marker_entry = std::unordered_map<transform_key, sprite_entry, key_hash<transform_key> >;
+
+    explicit marker_sprite_cache(std::size_t max_bytes = 16 * 1024 * 1024)
+        : max_bytes_(max_bytes),
+          bytes_(0) {}
+
+    marker_entry & find(marker_key const& key)
+    {
+        return markers_[key];
+    }
+
+    // A number for the content of an immutable marker. The marker is held
+    // until clear(), so its address is not reused by another one meanwhile.
+    double marker_id(std::shared_ptr<void const> const& marker)
+    {
+        auto itr = marker_ids_.find(marker.get());
+        if (itr != marker_ids_.end()) return itr->second.second;
+        double id = static_cast<double>(marker_ids_.size());
+        marker_ids_.emplace(marker.get(), std::make_pair(marker, id));
+        return id;
+    }
+
+    // accounts for a new sprite, false once the cache is full
+    bool reserve(std::size_t bytes)
+    {
+        if (bytes_ + bytes > max_bytes_) return false;
+        bytes_ += bytes;
+        return true;
+    }
+
+    void clear()
+    {
+        markers_.clear();
+        marker_ids_.clear();
+        bytes_ = 0;
+    }
+
+private:
+    std::unordered_map<marker_key, marker_entry, key_hash<marker_key> > markers_;
+    std::unordered_map<void const*, std::pair<std::shared_ptr<void const>, double> > marker_ids_;
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+};
+
+}
+
+#endif // MAPNIK_MARKER_SPRITE_CACHE_HPP
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_METATILE_HPP
+#define MAPNIK_METATILE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/image_data.hpp>
+#include <mapnik/image_view.hpp>
+
+// stl
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace mapnik
+{
+
+class Map;
+class render_stats;
+
+// A block of columns x rows tiles rendered as one image, so datasources
+// are queried once for all of them and labels are placed across tile
+// borders without being cut off or repeated.
+struct MAPNIK_DECL metatile
+{
+    metatile(box2d<double> const& _extent,
+             unsigned _columns,
+             unsigned _rows,
+             unsigned _tile_size = 256);
+
+    // the whole block in map coordinates, used as is, so it should have
+    // the aspect of columns x rows tiles
+    box2d<double> extent;
+    unsigned columns;
+    unsigned rows;
+    unsigned tile_size;
+    // pixels around the block that features are queried for, so symbols
+    // centered just outside still reach into the edge tiles
+    int buffer_size;
+    double scale_factor;
+    // how many threads encode the tiles, the calling one included; the
+    // default keeps encoding on the calling thread, 0 uses one per core
+    unsigned threads;
+};
+
+// Receives each encoded tile, column 0 and row 0 being the top left one.
+// Called from several threads at once when metatile::threads allows it.
+using tile_sink = std::function<void(unsigned column, unsigned row, std::string && data)>;
+
+// The tiles of a rendered metatile image, row by row, as views into it.
+MAPNIK_DECL std::vector<image_view<image_data_32> > slice_metatile(image_data_32 const& image,
+                                                                   unsigned columns,
+                                                                   unsigned rows,
+                                                                   unsigned tile_size);
+
+// Renders `tile` with the layers and styles of `map` (its size, extent
+// and buffer are ignored), then encodes the tiles as `format` (see
+// save_to_string) on up to `tile.threads` threads and hands them to
+// `sink`. An exception thrown by an encoder or the sink is rethrown once
+// all threads are done.
+// With `stats` the render is recorded into it, and encode_ms gets the
+// encoding time summed over all tiles.
+MAPNIK_DECL void render_metatile(Map const& map,
+                                 metatile const& tile,
+                                 std::string const& format,
+                                 tile_sink const& sink,
+                                 render_stats * stats = nullptr);
+
+}
+
+#endif // MAPNIK_METATILE_HPP
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PER_THREAD_POOL_HPP
+#define MAPNIK_PER_THREAD_POOL_HPP
+
+// mapnik
+#include <mapnik/noncopyable.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <mapnik/unique_lock.hpp>
+#endif
+
+// stl
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mapnik {
+
+// Objects that must not be used from two threads at once, e.g. database
+// connections, kept per thread and handed out again to the thread that
+// created them. An object is in use while someone besides the pool holds
+// it. Once the pool has seen 64 threads, the objects of threads holding
+// none of theirs are dropped, so the pool doesn't grow with threads that
+// are gone.
+template <typename T>
+class per_thread_pool : private mapnik::noncopyable
+{
+public:
+    using value_ptr = std::shared_ptr<T>;
+
+    per_thread_pool()
+        : objects_() {}
+
+    // the calling thread's object, made with create() on first use
+    template <typename Create>
+    value_ptr local(Create const& create)
+    {
+#ifdef MAPNIK_THREADSAFE
+        scoped_lock lock(mutex_);
+#endif
+        std::vector<value_ptr> & objects = thread_objects();
+        if (objects.empty())
+        {
+            objects.push_back(create());
+        }
+        return objects.front();
+    }
+
+    // an object of the calling thread that is not in use, made with
+    // create() when all of them are
+    template <typename Create>
+    value_ptr idle(Create const& create)
+    {
+#ifdef MAPNIK_THREADSAFE
+        scoped_lock lock(mutex_);
+#endif
+        std::vector<value_ptr> & objects = thread_objects();
+        for (value_ptr const& object : objects)
+        {
+            if (object.use_count() == 1) return object;
+        }
+        objects.push_back(create());
+        return objects.back();
+    }
+
+private:
+    std::vector<value_ptr> & thread_objects()
+    {
+        std::thread::id id = std::this_thread::get_id();
+        auto itr = objects_.find(id);
+        if (itr != objects_.end()) return itr->second;
+        if (objects_.size() >= 64)
+        {
+            for (itr = objects_.begin(); itr != objects_.end();)
+            {
+                bool in_use = false;
+                for (value_ptr const& object : itr->second)
+                {
+                    if (object.use_count() > 1) in_use = true;
+                }
+                if (in_use) ++itr;
+                else itr = objects_.erase(itr);
+            }
+        }
+        return objects_[id];
+    }
+
+    std::map<std::thread::id, std::vector<value_ptr> > objects_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+};
+
+}
+
+#endif // MAPNIK_PER_THREAD_POOL_HPP
@@ -55,6 +55,14 @@ class quad_tree : mapnik::noncopyable
             std::memset(children_,0,4*sizeof(node*));
         }
 
+        // empties the node for reuse, keeping the capacity of cont_
+        void reset(box2d<double> const& ext)
+        {
+            extent_ = ext;
+            cont_.clear();
+            std::memset(children_,0,4*sizeof(node*));
+        }
+
         box2d<double> const& extent() const
         {
             return extent_;
@@ -99,10 +107,10 @@ public:
         : max_depth_(max_depth),
           ratio_(ratio),
           query_result_(),
-          nodes_()
+          nodes_(),
+          used_(0)
     {
-        nodes_.push_back(new node(ext));
-        root_ = &nodes_[0];
+        root_ = acquire_node(ext);
     }
 
     void insert(T data, box2d<double> const& box)
@@ -131,15 +139,21 @@ public:
 
     const_iterator end() const
     {
-        return  nodes_.end();
+        return nodes_.begin() + used_;
     }
 
     void clear ()
     {
         box2d<double> ext = root_->extent_;
-        nodes_.clear();
-        nodes_.push_back(new node(ext));
-        root_ = &nodes_[0];
+        reset(ext);
+    }
+
+    // empties the tree and sets its extent in constant time; the nodes
+    // are kept and reused by the following inserts
+    void reset(box2d<double> const& ext)
+    {
+        used_ = 0;
+        root_ = acquire_node(ext);
     }
 
     box2d<double> const& extent() const
@@ -149,6 +163,19 @@ public:
 
 private:
 
+    node * acquire_node(box2d<double> const& ext)
+    {
+        if (used_ < nodes_.size())
+        {
+            node & n = nodes_[used_++];
+            n.reset(ext);
+            return &n;
+        }
+        nodes_.push_back(new node(ext));
+        ++used_;
+        return &nodes_.back();
+    }
+
     void query_node(box2d<double> const& box, result_t & result, node * node_) const
     {
         if (node_)
@@ -188,8 +215,7 @@ private:
                 {
                     if (!n->children_[i])
                     {
-                        nodes_.push_back(new node(ext[i]));
-                        n->children_[i]=&nodes_.back();
+                        n->children_[i] = acquire_node(ext[i]);
                     }
                     do_insert_data(data,box,n->children_[i],depth);
                     return;
@@ -221,6 +247,8 @@ private:
     const double ratio_;
     result_t query_result_;
     nodes_t nodes_;
+    // nodes_ past the first used_ are left from before the last reset
+    std::size_t used_;
     node * root_;
 
 };
@@ -26,11 +26,13 @@
 //mapnik
 #include <mapnik/box2d.hpp>
 #include <mapnik/attribute.hpp>
+#include <mapnik/expression.hpp>
 
 // stl
 #include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace mapnik {
 
@@ -49,7 +51,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(unbuffered_bbox),
           names_(),
-          vars_()
+          vars_(),
+          filters_()
     {}
 
     query(box2d<double> const& bbox,
@@ -61,7 +64,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          filters_()
     {}
 
     query(box2d<double> const& bbox)
@@ -71,7 +75,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          filters_()
     {}
 
     query(query const& other)
@@ -81,7 +86,8 @@ public:
           filter_factor_(other.filter_factor_),
           unbuffered_bbox_(other.unbuffered_bbox_),
           names_(other.names_),
-          vars_(other.vars_)
+          vars_(other.vars_),
+          filters_(other.filters_)
     {}
 
     query& operator=(query const& other)
@@ -94,6 +100,7 @@ public:
         unbuffered_bbox_=other.unbuffered_bbox_;
         names_=other.names_;
         vars_=other.vars_;
+        filters_=other.filters_;
         return *this;
     }
 
@@ -157,6 +164,18 @@ public:
         return vars_;
     }
 
+    // Features matching none of these filters won't be rendered and may
+    // be skipped by the datasource. Empty means every feature is needed.
+    void set_filters(std::vector<expression_ptr> const& filters)
+    {
+        filters_ = filters;
+    }
+
+    std::vector<expression_ptr> const& filters() const
+    {
+        return filters_;
+    }
+
 private:
     box2d<double> bbox_;
     resolution_type resolution_;
@@ -165,6 +184,7 @@ private:
     box2d<double> unbuffered_bbox_;
     std::set<std::string> names_;
     attributes vars_;
+    std::vector<expression_ptr> filters_;
 };
 
 }
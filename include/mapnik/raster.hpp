@@ -32,6 +32,18 @@
 #include <boost/optional.hpp>
 
 namespace mapnik {
+
+// Pixel type of the values a raster was read with. RASTER_RGBA rasters hold
+// everything in data_; the single band types keep the source values in a
+// band of their own until they are colorized.
+enum raster_band_e
+{
+    RASTER_RGBA = 0,
+    RASTER_GRAY8,
+    RASTER_GRAY16,
+    RASTER_FLOAT32
+};
+
 class raster : private mapnik::noncopyable
 {
 public:
@@ -48,7 +60,34 @@ public:
         : ext_(ext),
           data_(width,height),
           filter_factor_(filter_factor),
-          premultiplied_alpha_(premultiplied_alpha) {}
+          premultiplied_alpha_(premultiplied_alpha),
+          band_type_(RASTER_RGBA),
+          band_8_(0,0),
+          band_16_(0,0),
+          band_32f_(0,0) {}
+
+    // Single band raster: only the band of the given type is allocated,
+    // data_ stays empty until colorize() or unpack_band() fills it.
+    raster(box2d<double> const& ext,
+           unsigned width,
+           unsigned height,
+           double filter_factor,
+           raster_band_e band_type)
+        : ext_(ext),
+          data_(0,0),
+          filter_factor_(filter_factor),
+          premultiplied_alpha_(false),
+          band_type_(band_type),
+          band_8_(band_type == RASTER_GRAY8 ? width : 0, band_type == RASTER_GRAY8 ? height : 0),
+          band_16_(band_type == RASTER_GRAY16 ? width : 0, band_type == RASTER_GRAY16 ? height : 0),
+          band_32f_(band_type == RASTER_FLOAT32 ? width : 0, band_type == RASTER_FLOAT32 ? height : 0)
+    {
+        if (band_type == RASTER_RGBA)
+        {
+            image_data_32 data(width, height);
+            data_.swap(data);
+        }
+    }
 
     void set_nodata(double nodata)
     {
@@ -70,6 +109,52 @@ public:
         filter_factor_ = factor;
     }
 
+    raster_band_e band_type() const { return band_type_; }
+    image_data_8 & band_8() { return band_8_; }
+    image_data_8 const& band_8() const { return band_8_; }
+    image_data_16 & band_16() { return band_16_; }
+    image_data_16 const& band_16() const { return band_16_; }
+    image_data_32f & band_32f() { return band_32f_; }
+    image_data_32f const& band_32f() const { return band_32f_; }
+
+    // Fills data_ with the band values stored as float32, the layout single
+    // bands had before they were kept in their own type.
+    void unpack_band()
+    {
+        if (band_type_ == RASTER_RGBA || data_.width() > 0) return;
+        switch (band_type_)
+        {
+        case RASTER_GRAY8:
+            unpack_band(band_8_);
+            break;
+        case RASTER_GRAY16:
+            unpack_band(band_16_);
+            break;
+        default:
+            unpack_band(band_32f_);
+            break;
+        }
+    }
+
+private:
+    template <typename T>
+    void unpack_band(ImageData<T> const& band)
+    {
+        image_data_32 data(band.width(), band.height());
+        float * out = reinterpret_cast<float *>(data.getData());
+        T const* in = band.getData();
+        std::size_t size = static_cast<std::size_t>(band.width()) * band.height();
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            out[i] = static_cast<float>(in[i]);
+        }
+        data_.swap(data);
+    }
+
+    raster_band_e band_type_;
+    image_data_8 band_8_;
+    image_data_16 band_16_;
+    image_data_32f band_32f_;
 };
 }
 
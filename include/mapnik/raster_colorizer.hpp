@@ -218,6 +218,14 @@ public:
     inline float get_epsilon() const { return epsilon_; }
 
 private:
+    //! \brief Index of the stop the value falls in, -1 before the first stop.
+    //!
+    //! Uses a binary search when the stops are known to be sorted.
+    int find_stop(float value, bool sorted) const;
+
+    //! \brief Color for value, given its stop index from find_stop. Requires at least one stop.
+    unsigned get_color(float value, int stopIdx) const;
+
     colorizer_stops stops_;         //!< The vector of stops
 
     colorizer_mode default_mode_;   //!< The default mode inherited by stops
@@ -0,0 +1,123 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RENDER_STATS_HPP
+#define MAPNIK_RENDER_STATS_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+struct symbolizer_stats
+{
+    symbolizer_stats()
+        : count(0),
+          time_ms(0.0) {}
+
+    // symbolizers processed, one per feature and rule
+    std::size_t count;
+    double time_ms;
+};
+
+struct style_stats
+{
+    style_stats(std::string const& _name)
+        : name(_name),
+          features_fetched(0),
+          features_matched(0),
+          labels_attempted(0),
+          labels_placed(0),
+          bytes_allocated(0),
+          time_ms(0.0),
+          symbolizers() {}
+
+    std::string name;
+    // features the style was given
+    std::size_t features_fetched;
+    // features passing the filter of at least one rule, else rules included
+    std::size_t features_matched;
+    // text and shield symbolizers processed, and the labels they placed
+    std::size_t labels_attempted;
+    std::size_t labels_placed;
+    // image buffers the renderer allocated for the style
+    std::size_t bytes_allocated;
+    // includes time spent fetching features from lazy featuresets
+    double time_ms;
+    // keyed by symbolizer name, e.g. "LineSymbolizer", or "rule" for
+    // renderers processing all symbolizers of a rule at once
+    std::map<std::string, symbolizer_stats> symbolizers;
+};
+
+struct layer_stats
+{
+    layer_stats()
+        : name(),
+          query_ms(0.0),
+          features_fetched(0),
+          styles() {}
+
+    std::string name;
+    // time in the datasource: creating featuresets and reading from them
+    double query_ms;
+    std::size_t features_fetched;
+    std::vector<style_stats> styles;
+};
+
+// Collects what a render spent its time on, per layer and style. Pass
+// one to a renderer with set_stats() before apply(); the renderer appends
+// a layer_stats per rendered layer. Without stats the renderer skips all
+// bookkeeping.
+//
+// encode_ms isn't filled by renderers: callers encoding the image time it
+// themselves, e.g. with an accumulating_timer (mapnik/util/timer.hpp).
+class MAPNIK_DECL render_stats
+{
+public:
+    render_stats();
+
+    void clear();
+
+    // features_fetched, labels and bytes summed over all layers and styles
+    std::size_t features_fetched() const;
+    std::size_t labels_attempted() const;
+    std::size_t labels_placed() const;
+    std::size_t bytes_allocated() const;
+
+    // one JSON object with the totals and a "layers" array
+    std::string to_json() const;
+
+    std::vector<layer_stats> layers;
+    double render_ms;
+    double encode_ms;
+};
+
+}
+
+#endif // MAPNIK_RENDER_STATS_HPP
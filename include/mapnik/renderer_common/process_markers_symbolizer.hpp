@@ -86,8 +86,10 @@ void render_markers_symbolizer(markers_symbolizer const& sym,
                     auto image_transform = get_optional<transform_type>(sym, keys::image_transform);
                     if (image_transform) evaluate_transform(tr, feature, common.vars_, *image_transform);
                     box2d<double> bbox = marker_ellipse.bounding_box();
+                    // the path is built for this feature, there is no cached marker
                     vector_dispatch_type rasterizer_dispatch(svg_path,
                                                              result ? attributes : (*stock_vector_marker)->attributes(),
+                                                             svg_path_ptr(),
                                                              bbox,
                                                              tr,
                                                              sym,
@@ -127,6 +129,7 @@ void render_markers_symbolizer(markers_symbolizer const& sym,
                     bool result = push_explicit_style( (*stock_vector_marker)->attributes(), attributes, sym, feature, common.vars_);
                     vector_dispatch_type rasterizer_dispatch(svg_path,
                                                              result ? attributes : (*stock_vector_marker)->attributes(),
+                                                             *stock_vector_marker,
                                                              bbox,
                                                              tr,
                                                              sym,
@@ -50,6 +50,8 @@ void render_raster_symbolizer(raster_symbolizer const &sym,
         raster_colorizer_ptr colorizer = get<raster_colorizer_ptr>(sym, keys::colorizer);
         if (colorizer)
             colorizer->colorize(source,feature);
+        else
+            source->unpack_band();
 
         box2d<double> target_ext = box2d<double>(source->ext_);
         prj_trans.backward(target_ext, PROJ_ENVELOPE_POINTS);
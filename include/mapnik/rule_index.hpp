@@ -0,0 +1,85 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RULE_INDEX_HPP
+#define MAPNIK_RULE_INDEX_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/value_types.hpp>
+#include <mapnik/unicode.hpp>
+
+// stl
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+class rule;
+class feature_impl;
+
+// Narrows the `if` rules of a style down to those that can match a feature.
+//
+// Filters of the form [attr] = 'value', [attr] = 1, an `or` of those on the
+// same attribute (IN), or an `and` with one of those as an operand are keyed
+// by the value they require. When enough rules share an attribute, features
+// look up that attribute's value and get the keyed rules for it merged with
+// all rules that could not be keyed, in the original rule order. Candidates
+// still have their full filter evaluated, the index only skips rules that
+// cannot match.
+class MAPNIK_DECL rule_index
+{
+public:
+    using rule_ptrs = std::vector<rule const*>;
+
+    rule_index();
+    // rules with fewer keyed filters than this are not worth a lookup
+    static const std::size_t min_keyed_rules = 4;
+
+    void build(rule_ptrs const& rules);
+    bool indexed() const { return indexed_; }
+    std::string const& attribute_name() const { return attribute_; }
+    rule_ptrs const& candidates(feature_impl const& feature) const;
+
+private:
+    struct string_hash
+    {
+        std::size_t operator() (value_unicode_string const& val) const
+        {
+            return hash_value(val);
+        }
+    };
+
+    bool indexed_;
+    std::string attribute_;
+    std::unordered_map<value_unicode_string, rule_ptrs, string_hash> strings_;
+    std::unordered_map<value_integer, rule_ptrs> integers_;
+    rule_ptrs unkeyed_;
+    // for values too large to look up exactly
+    rule_ptrs all_;
+};
+
+}
+
+#endif // MAPNIK_RULE_INDEX_HPP
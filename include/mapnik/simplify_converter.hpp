@@ -195,7 +195,7 @@ private:
             return SEG_CLOSE;
         }
 
-        vertex2d last(vertex2d::no_init);
+        vertex2d last; // cmd stays SEG_END (== no_init) until a vertex is skipped
         vertex2d vtx(vertex2d::no_init);
         while ((vtx.cmd = geom_.vertex(&vtx.x, &vtx.y)) != SEG_END)
         {
@@ -0,0 +1,65 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_SQL_FILTER_HPP
+#define MAPNIK_SQL_FILTER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/expression.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+class layer_descriptor;
+
+namespace sql_utils {
+
+// Translates the OR of `filters` (see query::filters()) into a SQL
+// boolean expression for a WHERE clause or an OGR attribute filter.
+//
+// The result may let through rows none of the filters accept, but never
+// drops a row one of them accepts. Parts that can't be translated with
+// that guarantee are left out of `and`s and make an `or` untranslatable:
+// functions, arithmetic, regexes, global attributes and comparisons
+// against columns missing from `desc` or of another type than the
+// literal, and non-finite numbers. Strings are only compared for
+// equality since collations may order them differently than mapnik
+// does. SQL may find more strings equal than mapnik, and orders NaN or
+// text in numeric columns above every number, so NOT is only translated
+// around numeric = and <>. Comparisons are written so NULL columns
+// behave like mapnik's null values under NOT.
+//
+// Returns none when no restriction could be derived.
+MAPNIK_DECL boost::optional<std::string> filters_to_sql(std::vector<expression_ptr> const& filters,
+                                                        layer_descriptor const& desc);
+
+}}
+
+#endif // MAPNIK_SQL_FILTER_HPP
@@ -51,6 +51,9 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <array>
+#include <bitset>
+#include <cstdint>
 
 namespace agg { struct trans_affine; }
 
@@ -125,6 +128,22 @@ struct strict_value : value_base_type
         : value_base_type(std::move(obj)) {}
 
 };
+
+// symbolizer properties laid out for lookups by key on the render path
+struct compiled_properties
+{
+    static constexpr std::size_t num_keys = static_cast<std::size_t>(keys::MAX_SYMBOLIZER_KEY);
+    static constexpr std::uint8_t absent = 0xff;
+
+    // index into raw and resolved, or absent
+    std::array<std::uint8_t, num_keys> slots;
+    // values as stored in symbolizer_base::properties
+    std::vector<strict_value> raw;
+    // same, with constant expressions and paths folded to their result
+    std::vector<strict_value> resolved;
+    // resolved values still to be evaluated against feature and variables
+    std::bitset<num_keys> evaluate;
+};
 }
 
 struct MAPNIK_DECL symbolizer_base
@@ -133,6 +152,9 @@ struct MAPNIK_DECL symbolizer_base
     using key_type =  mapnik::keys;
     using cont_type = std::map<key_type, value_type>;
     cont_type properties;
+    // set by compile_properties() and dropped by put(); lookups fall
+    // back to `properties` without it
+    std::shared_ptr<detail::compiled_properties const> compiled;
 };
 
 inline bool is_expression(symbolizer_base::value_type const& val)
@@ -482,6 +504,7 @@ MAPNIK_DECL void put(symbolizer_base & sym, keys key, T const& val)
 {
     constexpr bool enum_ = std::is_enum<T>::value;
     detail::put_impl<T, enum_ >::apply(sym, key, val);
+    sym.compiled.reset();
 }
 
 template <typename T>
@@ -490,9 +513,39 @@ MAPNIK_DECL bool has_key(symbolizer_base const& sym, keys key)
     return (sym.properties.count(key) == 1);
 }
 
+namespace detail {
+
+inline strict_value const* compiled_value(compiled_properties const& props,
+                                          std::vector<strict_value> const& values,
+                                          keys key)
+{
+    std::uint8_t slot = props.slots[static_cast<std::size_t>(key)];
+    return slot != compiled_properties::absent ? &values[slot] : nullptr;
+}
+
+template <typename T>
+T compiled_get(compiled_properties const& props, strict_value const& val, keys key,
+               mapnik::feature_impl const& feature, attributes const& vars)
+{
+    if (props.evaluate[static_cast<std::size_t>(key)])
+    {
+        return util::apply_visitor(extract_value<T>(feature,vars), val);
+    }
+    return util::apply_visitor(extract_raw_value<T>(), val);
+}
+
+}
+
 template <typename T>
 MAPNIK_DECL T get(symbolizer_base const& sym, keys key, mapnik::feature_impl const& feature, attributes const& vars, T const& _default_value = T())
 {
+    if (sym.compiled)
+    {
+        detail::compiled_properties const& props = *sym.compiled;
+        detail::strict_value const* val = detail::compiled_value(props, props.resolved, key);
+        if (val) return detail::compiled_get<T>(props, *val, key, feature, vars);
+        return _default_value;
+    }
     using const_iterator = symbolizer_base::cont_type::const_iterator;
     const_iterator itr = sym.properties.find(key);
     if (itr != sym.properties.end())
@@ -505,6 +558,13 @@ MAPNIK_DECL T get(symbolizer_base const& sym, keys key, mapnik::feature_impl con
 template <typename T>
 MAPNIK_DECL boost::optional<T> get_optional(symbolizer_base const& sym, keys key, mapnik::feature_impl const& feature, attributes const& vars)
 {
+    if (sym.compiled)
+    {
+        detail::compiled_properties const& props = *sym.compiled;
+        detail::strict_value const* val = detail::compiled_value(props, props.resolved, key);
+        if (val) return detail::compiled_get<T>(props, *val, key, feature, vars);
+        return boost::optional<T>();
+    }
     using const_iterator = symbolizer_base::cont_type::const_iterator;
     const_iterator itr = sym.properties.find(key);
     if (itr != sym.properties.end())
@@ -517,6 +577,12 @@ MAPNIK_DECL boost::optional<T> get_optional(symbolizer_base const& sym, keys key
 template <typename T>
 MAPNIK_DECL T get(symbolizer_base const& sym, keys key, T const& _default_value = T())
 {
+    if (sym.compiled)
+    {
+        detail::strict_value const* val = detail::compiled_value(*sym.compiled, sym.compiled->raw, key);
+        if (val) return util::apply_visitor(extract_raw_value<T>(), *val);
+        return _default_value;
+    }
     using const_iterator = symbolizer_base::cont_type::const_iterator;
     const_iterator itr = sym.properties.find(key);
     if (itr != sym.properties.end())
@@ -529,6 +595,12 @@ MAPNIK_DECL T get(symbolizer_base const& sym, keys key, T const& _default_value
 template <typename T>
 MAPNIK_DECL boost::optional<T> get_optional(symbolizer_base const& sym, keys key)
 {
+    if (sym.compiled)
+    {
+        detail::strict_value const* val = detail::compiled_value(*sym.compiled, sym.compiled->raw, key);
+        if (val) return util::apply_visitor(extract_raw_value<T>(), *val);
+        return boost::optional<T>();
+    }
     using const_iterator = symbolizer_base::cont_type::const_iterator;
     const_iterator itr = sym.properties.find(key);
     if (itr != sym.properties.end())
@@ -548,6 +620,11 @@ using property_meta_type = std::tuple<const char*, mapnik::symbolizer_base::valu
 MAPNIK_DECL property_meta_type const& get_meta(mapnik::keys key);
 MAPNIK_DECL mapnik::keys get_key(std::string const& name);
 
+// Builds sym.compiled from sym.properties, folding expressions and paths
+// that depend on neither the feature nor render variables. Renderers
+// read compiled symbolizers through get() and get_optional() as before.
+MAPNIK_DECL void compile_properties(symbolizer_base & sym);
+
 // concrete symbolizer types
 struct MAPNIK_DECL point_symbolizer : public symbolizer_base {};
 struct MAPNIK_DECL line_symbolizer : public symbolizer_base {};
@@ -576,6 +653,8 @@ using symbolizer = util::variant<point_symbolizer,
                                  group_symbolizer,
                                  debug_symbolizer>;
 
+MAPNIK_DECL void compile_properties(symbolizer & sym);
+
 }
 
 #endif // MAPNIK_SYMBOLIZER_HPP
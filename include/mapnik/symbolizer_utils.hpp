@@ -37,6 +37,7 @@
 #include <mapnik/config_error.hpp>
 #include <mapnik/evaluate_global_attributes.hpp>
 #include <mapnik/parse_transform.hpp>
+#include <mapnik/expression_cache.hpp>
 #include <mapnik/util/variant.hpp>
 
 namespace mapnik {
@@ -384,7 +385,7 @@ struct set_symbolizer_property_impl<Symbolizer,transform_type,false>
     static void apply(Symbolizer & sym, keys key, std::string const& name, xml_node const & node)
     {
         boost::optional<std::string> transform = node.get_opt_attr<std::string>(name);
-        if (transform) put(sym, key, mapnik::parse_transform(*transform));
+        if (transform) put(sym, key, mapnik::expression_cache::instance().transform(*transform));
     }
 };
 
@@ -39,6 +39,7 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <string>
 #include <utility>
 
 namespace mapnik
@@ -71,6 +72,14 @@ public:
     // Clear all data stored in this object. The object's state is the same as directly after construction.
     void clear();
 
+    // Returns true once layout() has run. Laid out layouts are never processed again,
+    // which allows sharing them through text_layout_cache.
+    inline bool laid_out() const { return laid_out_; }
+
+    // Key identifying the layout output: text, evaluated format and layout properties
+    // of this layout and all its children. Valid after evaluate_properties() and add_text().
+    std::string cache_key() const;
+
     // Height of all lines together (in pixels).
     inline double height() const { return height_; }
     // Width of the longest line (in pixels).
@@ -150,6 +159,9 @@ private:
     double text_ratio_ = 0.0;
     pixel_position displacement_ = {0,0};
     box2d<double> bounds_;
+    bool laid_out_ = false;
+    // text and formats added so far, see cache_key()
+    std::string text_key_;
 
     //children
     text_layout_vector child_layout_list_;
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+#ifndef MAPNIK_TEXT_LAYOUT_CACHE_HPP
+#define MAPNIK_TEXT_LAYOUT_CACHE_HPP
+
+//mapnik
+#include <mapnik/noncopyable.hpp>
+
+//stl
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+class text_layout;
+
+// Finished (shaped and line-broken) layouts of one render, keyed by
+// text_layout::cache_key(). Features sharing text and evaluated properties,
+// e.g. the segments of a long road, reuse the glyphs of the first one.
+// Cached layouts are immutable once stored.
+class text_layout_cache : mapnik::noncopyable
+{
+public:
+    using layout_ptr = std::shared_ptr<text_layout>;
+
+    explicit text_layout_cache(std::size_t max_entries = 4096)
+        : max_entries_(max_entries),
+          layouts_() {}
+
+    layout_ptr find(std::string const& key) const
+    {
+        auto itr = layouts_.find(key);
+        if (itr != layouts_.end()) return itr->second;
+        return layout_ptr();
+    }
+
+    void insert(std::string const& key, layout_ptr const& layout)
+    {
+        // labels are mostly unique per feature when the cache overflows,
+        // so start over rather than tracking recency
+        if (layouts_.size() >= max_entries_) layouts_.clear();
+        layouts_.emplace(key, layout);
+    }
+
+    void clear() { layouts_.clear(); }
+    std::size_t size() const { return layouts_.size(); }
+
+private:
+    std::size_t max_entries_;
+    std::unordered_map<std::string, layout_ptr> layouts_;
+};
+
+}
+
+#endif // MAPNIK_TEXT_LAYOUT_CACHE_HPP
@@ -0,0 +1,111 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_PROCESS_BANDS_HPP
+#define MAPNIK_UTIL_PROCESS_BANDS_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#include <exception>
+#include <system_error>
+#endif
+
+namespace mapnik { namespace util {
+
+// Images below this many pixels per band are not worth an extra thread.
+static const std::size_t min_band_pixels = 128 * 1024;
+
+// Process wide cap on the threads one process_bands call may use. The
+// default of 1 keeps banded work serial, which is what a server already
+// rendering on every core wants; 0 allows one thread per hardware thread.
+MAPNIK_DECL unsigned max_band_threads();
+MAPNIK_DECL void set_max_band_threads(unsigned threads);
+
+// Runs func(y0, y1) over horizontal bands covering [0, height). Large images
+// are split across up to `threads` threads (0: as many as the cap allows),
+// never more than max_band_threads(). Every band writes disjoint rows, so
+// the result does not depend on the number of bands. An exception thrown
+// by any band is rethrown here once all bands are done.
+template <typename Func>
+void process_bands(unsigned width, unsigned height, Func const& func, unsigned threads = 0)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::size_t limit = max_band_threads();
+    if (limit == 0) limit = std::thread::hardware_concurrency();
+    if (threads > 0) limit = std::min<std::size_t>(limit, threads);
+    std::size_t bands = (static_cast<std::size_t>(width) * height) / min_band_pixels;
+    bands = std::min<std::size_t>(bands, limit);
+    bands = std::min<std::size_t>(bands, height);
+    if (bands > 1)
+    {
+        std::vector<std::exception_ptr> errors(bands);
+        auto run_band = [&func, &errors, height, bands](std::size_t i)
+        {
+            try
+            {
+                func(static_cast<unsigned>(height * i / bands),
+                     static_cast<unsigned>(height * (i + 1) / bands));
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(bands - 1);
+        for (std::size_t i = 1; i < bands; ++i)
+        {
+            try
+            {
+                workers.emplace_back(run_band, i);
+            }
+            catch (std::system_error const&)
+            {
+                // out of threads, do this band here
+                run_band(i);
+            }
+        }
+        run_band(0);
+        for (std::thread & worker : workers)
+        {
+            worker.join();
+        }
+        for (std::exception_ptr const& error : errors)
+        {
+            if (error) std::rethrow_exception(error);
+        }
+        return;
+    }
+#endif
+    func(0, height);
+}
+
+}}
+
+#endif // MAPNIK_UTIL_PROCESS_BANDS_HPP
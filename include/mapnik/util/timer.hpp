@@ -25,6 +25,7 @@
 
 #include <string>
 #include <chrono>
+#include <ostream>
 
 namespace mapnik {
 
@@ -47,6 +48,24 @@ private:
     std::string message_;
 };
 
+// adds the milliseconds elapsed in its lifetime to `total`
+class accumulating_timer
+{
+public:
+    explicit accumulating_timer(double & total)
+        : start_(std::chrono::steady_clock::now()),
+          total_(total) {}
+
+    ~accumulating_timer()
+    {
+        std::chrono::duration<double,std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+        total_ += elapsed.count();
+    }
+private:
+    std::chrono::time_point<std::chrono::steady_clock> start_;
+    double & total_;
+};
+
 // NOTE : add more timers here
 
 }
@@ -0,0 +1,525 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_VERTEX_BATCH_HPP
+#define MAPNIK_VERTEX_BATCH_HPP
+
+// mapnik
+#include <mapnik/vertex.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/ctrans.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/simplify.hpp>
+#include <mapnik/simplify_converter.hpp>
+
+// agg
+#include "agg_basics.h"
+#include "agg_trans_affine.h"
+#include "agg_vpgen_clip_polygon.h"
+
+// stl
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace mapnik {
+
+// Contiguous (structure-of-arrays) vertex storage used by the push-style
+// converter pipeline. Stages below consume and produce whole coordinate
+// arrays so that the hot loops are free of per-vertex dispatch. A batch is
+// also an AGG vertex source and can be handed to the pull-style adapters
+// (smooth, offset, dash, stroke) and to rasterizers directly.
+class vertex_batch
+{
+public:
+    using size_type = std::size_t;
+    using command_type = std::uint8_t;
+
+    vertex_batch()
+        : type_(0),
+          pos_(0) {}
+
+    size_type size() const
+    {
+        return cmds_.size();
+    }
+
+    bool empty() const
+    {
+        return cmds_.empty();
+    }
+
+    void clear()
+    {
+        xs_.clear();
+        ys_.clear();
+        cmds_.clear();
+        pos_ = 0;
+    }
+
+    void reserve(size_type size)
+    {
+        xs_.reserve(size);
+        ys_.reserve(size);
+        cmds_.reserve(size);
+    }
+
+    void swap(vertex_batch & rhs)
+    {
+        xs_.swap(rhs.xs_);
+        ys_.swap(rhs.ys_);
+        cmds_.swap(rhs.cmds_);
+        std::swap(type_, rhs.type_);
+        pos_ = rhs.pos_ = 0;
+    }
+
+    void push_back(double x, double y, unsigned cmd)
+    {
+        xs_.push_back(x);
+        ys_.push_back(y);
+        cmds_.push_back(static_cast<command_type>(cmd));
+    }
+
+    void resize(size_type size)
+    {
+        xs_.resize(size);
+        ys_.resize(size);
+        cmds_.resize(size);
+    }
+
+    double * xs() { return xs_.data(); }
+    double * ys() { return ys_.data(); }
+    command_type * cmds() { return cmds_.data(); }
+    double const* xs() const { return xs_.data(); }
+    double const* ys() const { return ys_.data(); }
+    command_type const* cmds() const { return cmds_.data(); }
+
+    // geometry type, as reported by mapnik::geometry::type()
+    unsigned type() const
+    {
+        return type_;
+    }
+
+    void set_type(unsigned type)
+    {
+        type_ = type;
+    }
+
+    // copy vertices out of any indexed vertex source (mapnik::geometry)
+    template <typename Geometry>
+    void assign(Geometry const& geom)
+    {
+        clear();
+        type_ = static_cast<unsigned>(geom.type());
+        size_type count = geom.size();
+        resize(count);
+        for (size_type i = 0; i < count; ++i)
+        {
+            cmds_[i] = static_cast<command_type>(geom.vertex(i, &xs_[i], &ys_[i]));
+        }
+    }
+
+    // AGG vertex source interface
+    void rewind(unsigned) const
+    {
+        pos_ = 0;
+    }
+
+    unsigned vertex(double * x, double * y) const
+    {
+        if (pos_ >= cmds_.size()) return SEG_END;
+        *x = xs_[pos_];
+        *y = ys_[pos_];
+        return cmds_[pos_++];
+    }
+
+private:
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+    std::vector<command_type> cmds_;
+    unsigned type_;
+    mutable size_type pos_;
+};
+
+namespace batch {
+
+// Reproject from the layer srs into the map srs (in place). Points that fail
+// to reproject are dropped and the following segment restarts with a
+// SEG_MOVETO, exactly like mapnik::coord_transform.
+inline void proj_transform_vertices(vertex_batch & batch, proj_transform const& prj_trans)
+{
+    if (prj_trans.equal() || batch.empty()) return;
+    std::size_t size = batch.size();
+    std::vector<double> zs(size, 0.0);
+    std::vector<double> xs(batch.xs(), batch.xs() + size);
+    std::vector<double> ys(batch.ys(), batch.ys() + size);
+    if (prj_trans.backward(xs.data(), ys.data(), zs.data(), static_cast<int>(size)))
+    {
+        double * x = batch.xs();
+        double * y = batch.ys();
+        vertex_batch::command_type const* cmd = batch.cmds();
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            // SEG_CLOSE carries no meaningful coordinates
+            if (cmd[i] == SEG_CLOSE) continue;
+            x[i] = xs[i];
+            y[i] = ys[i];
+        }
+        return;
+    }
+    // slow path: transform point by point, compacting out failures
+    double * x = batch.xs();
+    double * y = batch.ys();
+    vertex_batch::command_type * cmd = batch.cmds();
+    std::size_t out = 0;
+    bool skipped_points = false;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        unsigned command = cmd[i];
+        double vx = x[i];
+        double vy = y[i];
+        double z = 0;
+        if (command != SEG_CLOSE && !prj_trans.backward(vx, vy, z))
+        {
+            skipped_points = true;
+            continue;
+        }
+        if (skipped_points && command == SEG_LINETO)
+        {
+            command = SEG_MOVETO;
+        }
+        skipped_points = false;
+        x[out] = vx;
+        y[out] = vy;
+        cmd[out] = static_cast<vertex_batch::command_type>(command);
+        ++out;
+    }
+    batch.resize(out);
+}
+
+// Map coordinates to screen coordinates (in place).
+inline void view_transform_vertices(vertex_batch & batch, CoordTransform const& tr)
+{
+    double const minx = tr.extent().minx();
+    double const maxy = tr.extent().maxy();
+    double const sx = tr.scale_x();
+    double const sy = tr.scale_y();
+    double const ox = tr.offset_x() - tr.offset();
+    double const oy = tr.offset_y() - tr.offset();
+    std::size_t const size = batch.size();
+    double * x = batch.xs();
+    double * y = batch.ys();
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        x[i] = (x[i] - minx) * sx - ox;
+    }
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        y[i] = (maxy - y[i]) * sy - oy;
+    }
+}
+
+// Apply an affine transform (in place), same arithmetic as agg::trans_affine::transform.
+inline void affine_transform_vertices(vertex_batch & batch, agg::trans_affine const& tr)
+{
+    if (tr.is_identity()) return;
+    double const sx = tr.sx;
+    double const shx = tr.shx;
+    double const shy = tr.shy;
+    double const sy = tr.sy;
+    double const tx = tr.tx;
+    double const ty = tr.ty;
+    std::size_t const size = batch.size();
+    double * x = batch.xs();
+    double * y = batch.ys();
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        double tmp = x[i];
+        x[i] = tmp * sx  + y[i] * shx + tx;
+        y[i] = tmp * shy + y[i] * sy  + ty;
+    }
+}
+
+// Clip polylines against a box (Liang-Barsky per segment). Every segment
+// re-entering the box starts a new sub-path with SEG_MOVETO.
+inline void clip_polyline(vertex_batch const& in, box2d<double> const& box, vertex_batch & out)
+{
+    out.clear();
+    out.set_type(in.type());
+    out.reserve(in.size());
+    double const minx = box.minx();
+    double const miny = box.miny();
+    double const maxx = box.maxx();
+    double const maxy = box.maxy();
+    double const* xs = in.xs();
+    double const* ys = in.ys();
+    vertex_batch::command_type const* cmds = in.cmds();
+    std::size_t const size = in.size();
+    double x0 = 0;
+    double y0 = 0;
+    bool connected = false;
+    bool have_start = false;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        unsigned cmd = cmds[i];
+        double x1 = xs[i];
+        double y1 = ys[i];
+        if (cmd == SEG_MOVETO)
+        {
+            x0 = x1;
+            y0 = y1;
+            have_start = true;
+            connected = false;
+            continue;
+        }
+        if (cmd != SEG_LINETO || !have_start) continue;
+        double t0 = 0.0;
+        double t1 = 1.0;
+        double dx = x1 - x0;
+        double dy = y1 - y0;
+        double p[4] = { -dx, dx, -dy, dy };
+        double q[4] = { x0 - minx, maxx - x0, y0 - miny, maxy - y0 };
+        bool visible = true;
+        for (int k = 0; k < 4; ++k)
+        {
+            if (p[k] == 0.0)
+            {
+                if (q[k] < 0.0) { visible = false; break; }
+            }
+            else
+            {
+                double r = q[k] / p[k];
+                if (p[k] < 0.0)
+                {
+                    if (r > t1) { visible = false; break; }
+                    if (r > t0) t0 = r;
+                }
+                else
+                {
+                    if (r < t0) { visible = false; break; }
+                    if (r < t1) t1 = r;
+                }
+            }
+        }
+        if (visible && t0 < t1)
+        {
+            if (!connected || t0 > 0.0)
+            {
+                out.push_back(x0 + t0 * dx, y0 + t0 * dy, SEG_MOVETO);
+            }
+            out.push_back(x0 + t1 * dx, y0 + t1 * dy, SEG_LINETO);
+            connected = (t1 == 1.0);
+        }
+        else
+        {
+            connected = false;
+        }
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+// Clip polygon rings against a box. This drives agg::vpgen_clip_polygon
+// straight from the arrays, with the same ring bookkeeping as
+// agg::conv_clip_polygon, so the output is vertex for vertex the same as
+// the pull-style clip_poly_tag stage (including the closing SEG_CLOSE of
+// rings clipped away entirely).
+inline void clip_polygon(vertex_batch const& in, box2d<double> const& box, vertex_batch & out)
+{
+    out.clear();
+    out.set_type(in.type());
+    out.reserve(in.size() + 8);
+    double const* xs = in.xs();
+    double const* ys = in.ys();
+    vertex_batch::command_type const* cmds = in.cmds();
+    std::size_t const size = in.size();
+    agg::vpgen_clip_polygon clipper;
+    clipper.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+    double start_x = 0;
+    double start_y = 0;
+    unsigned poly_flags = 0;
+    int vertices = 0;
+    auto flush = [&]()
+    {
+        double x, y;
+        unsigned cmd;
+        while (!agg::is_stop(cmd = clipper.vertex(&x, &y)))
+        {
+            out.push_back(x, y, cmd);
+        }
+        if (poly_flags)
+        {
+            out.push_back(0, 0, poly_flags);
+            poly_flags = 0;
+        }
+    };
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        unsigned cmd = cmds[i];
+        if (agg::is_vertex(cmd))
+        {
+            if (agg::is_move_to(cmd))
+            {
+                if (vertices > 2)
+                {
+                    // unclosed ring followed by another one
+                    clipper.line_to(start_x, start_y);
+                    poly_flags = agg::path_cmd_end_poly | agg::path_flags_close;
+                    flush();
+                }
+                clipper.move_to(xs[i], ys[i]);
+                start_x = xs[i];
+                start_y = ys[i];
+                vertices = 1;
+            }
+            else
+            {
+                clipper.line_to(xs[i], ys[i]);
+                ++vertices;
+            }
+        }
+        else if (agg::is_end_poly(cmd))
+        {
+            poly_flags = cmd | agg::path_flags_close;
+            if (vertices > 2)
+            {
+                clipper.line_to(start_x, start_y);
+            }
+            vertices = 0;
+        }
+        flush();
+    }
+    if (vertices > 2)
+    {
+        clipper.line_to(start_x, start_y);
+        poly_flags = agg::path_cmd_end_poly | agg::path_flags_close;
+    }
+    flush();
+}
+
+// Make sure every ring ends with SEG_CLOSE (agg::conv_close_polygon).
+inline void close_polygons(vertex_batch const& in, vertex_batch & out)
+{
+    out.clear();
+    out.set_type(in.type());
+    out.reserve(in.size() + 1);
+    double const* xs = in.xs();
+    double const* ys = in.ys();
+    vertex_batch::command_type const* cmds = in.cmds();
+    std::size_t const size = in.size();
+    bool open = false;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        unsigned cmd = cmds[i];
+        if (cmd == SEG_MOVETO && open)
+        {
+            out.push_back(0, 0, SEG_CLOSE);
+        }
+        out.push_back(xs[i], ys[i], cmd);
+        open = (cmd != SEG_CLOSE);
+    }
+    if (open) out.push_back(0, 0, SEG_CLOSE);
+}
+
+// Radial-distance simplification, matching the output of
+// simplify_converter<> with the radial_distance algorithm. Other algorithms
+// are run through simplify_converter itself.
+inline void simplify_vertices(vertex_batch const& in,
+                              simplify_algorithm_e algorithm,
+                              double tolerance,
+                              vertex_batch & out)
+{
+    out.clear();
+    out.set_type(in.type());
+    if (tolerance == 0.0 || algorithm != radial_distance)
+    {
+        out.reserve(in.size());
+        simplify_converter<vertex_batch const> conv(in);
+        conv.set_simplify_algorithm(algorithm);
+        conv.set_simplify_tolerance(tolerance);
+        in.rewind(0);
+        double x, y;
+        unsigned cmd;
+        while ((cmd = conv.vertex(&x, &y)) != SEG_END)
+        {
+            out.push_back(x, y, cmd);
+        }
+        return;
+    }
+    out.reserve(in.size());
+    double const* xs = in.xs();
+    double const* ys = in.ys();
+    vertex_batch::command_type const* cmds = in.cmds();
+    std::size_t const size = in.size();
+    double px = 0;
+    double py = 0;
+    bool pending = false;
+    double lx = 0;
+    double ly = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        unsigned cmd = cmds[i];
+        double x = xs[i];
+        double y = ys[i];
+        if (cmd == SEG_LINETO)
+        {
+            double dx = x - px;
+            double dy = y - py;
+            // squared distance, as in simplify_converter::distance_to_previous
+            if (dx * dx + dy * dy > tolerance)
+            {
+                out.push_back(x, y, cmd);
+                px = x;
+                py = y;
+                pending = false;
+            }
+            else
+            {
+                lx = x;
+                ly = y;
+                pending = true;
+            }
+        }
+        else if (cmd == SEG_CLOSE)
+        {
+            if (pending)
+            {
+                out.push_back(lx, ly, SEG_LINETO);
+                pending = false;
+            }
+            out.push_back(x, y, cmd);
+            px = x;
+            py = y;
+        }
+        else
+        {
+            out.push_back(x, y, cmd);
+            px = x;
+            py = y;
+            pending = false;
+        }
+    }
+}
+
+}}
+
+#endif // MAPNIK_VERTEX_BATCH_HPP
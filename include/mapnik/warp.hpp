@@ -32,12 +32,16 @@ namespace mapnik {
 class raster;
 class proj_transform;
 
+// Warps on the calling thread unless `threads` asks for more (0: as many
+// as util::max_band_threads() allows); large targets are then split into
+// bands of rows. The result is the same with any number of threads.
 MAPNIK_DECL void reproject_and_scale_raster(raster & target,
                                 raster const& source,
                                 proj_transform const& prj_trans,
                                 double offset_x, double offset_y,
                                 unsigned mesh_size,
-                                scaling_method_e scaling_method);
+                                scaling_method_e scaling_method,
+                                unsigned threads = 1);
 
 }
 
@@ -31,6 +31,7 @@
 #include <mapnik/color.hpp>
 #include <mapnik/color_factory.hpp>
 #include <mapnik/expression.hpp>
+#include <mapnik/expression_cache.hpp>
 #include <mapnik/util/conversions.hpp>
 #include <mapnik/attribute.hpp>
 
@@ -186,17 +187,7 @@ struct do_xml_attribute_cast<mapnik::expression_ptr>
 {
     static inline boost::optional<mapnik::expression_ptr> xml_attribute_cast_impl(xml_tree const& tree, std::string const& source)
     {
-        std::map<std::string,mapnik::expression_ptr>::const_iterator itr = tree.expr_cache_.find(source);
-        if (itr != tree.expr_cache_.end())
-        {
-            return itr->second;
-        }
-        else
-        {
-            mapnik::expression_ptr expr = parse_expression(source);
-            tree.expr_cache_.emplace(source,expr);
-            return expr;
-        }
+        return expression_cache::instance().expression(source);
     }
 };
 
@@ -44,8 +44,6 @@ public:
 private:
     xml_node node_;
     std::string file_;
-public:
-    mutable std::map<std::string,mapnik::expression_ptr> expr_cache_;
 };
 
 } //ns mapnik
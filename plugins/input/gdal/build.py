@@ -31,6 +31,8 @@ plugin_sources = Split(
   """
   %(PLUGIN_NAME)s_datasource.cpp
   %(PLUGIN_NAME)s_featureset.cpp
+  %(PLUGIN_NAME)s_block_cache.cpp
+  %(PLUGIN_NAME)s_dataset_pool.cpp
   """ % locals()
 )
 
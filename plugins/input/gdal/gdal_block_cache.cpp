@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "gdal_block_cache.hpp"
+
+gdal_block_cache::gdal_block_cache()
+    : capacity_(0),
+      size_(0) {}
+
+gdal_block_ptr gdal_block_cache::find(gdal_block_key const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    auto itr = index_.find(key);
+    if (itr == index_.end()) return gdal_block_ptr();
+    // move to the front: most recently used
+    lru_.splice(lru_.begin(), lru_, itr->second);
+    return itr->second->second;
+}
+
+void gdal_block_cache::insert(gdal_block_key const& key, gdal_block_ptr const& block)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (block->size() > capacity_) return;
+    if (index_.find(key) != index_.end()) return; // another thread got there first
+    lru_.emplace_front(key, block);
+    index_.emplace(key, lru_.begin());
+    size_ += block->size();
+    evict();
+}
+
+void gdal_block_cache::reserve(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (bytes > capacity_) capacity_ = bytes;
+}
+
+std::size_t gdal_block_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return size_;
+}
+
+void gdal_block_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    index_.clear();
+    lru_.clear();
+    size_ = 0;
+}
+
+void gdal_block_cache::evict()
+{
+    while (size_ > capacity_ && !lru_.empty())
+    {
+        entry_type const& last = lru_.back();
+        size_ -= last.second->size();
+        index_.erase(last.first);
+        lru_.pop_back();
+    }
+}
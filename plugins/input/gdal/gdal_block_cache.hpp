@@ -0,0 +1,96 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GDAL_BLOCK_CACHE_HPP
+#define GDAL_BLOCK_CACHE_HPP
+
+// mapnik
+#include <mapnik/utils.hpp>
+#include <mapnik/unique_lock.hpp>
+#include <mapnik/noncopyable.hpp>
+
+// stl
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+// identifies one native block of a band or of one of its overviews
+struct gdal_block_key
+{
+    std::string dataset;
+    int band;
+    int overview; // -1 for the full resolution band
+    int block_x;
+    int block_y;
+
+    bool operator==(gdal_block_key const& rhs) const
+    {
+        return band == rhs.band && overview == rhs.overview &&
+            block_x == rhs.block_x && block_y == rhs.block_y &&
+            dataset == rhs.dataset;
+    }
+};
+
+struct gdal_block_key_hash
+{
+    std::size_t operator()(gdal_block_key const& key) const
+    {
+        std::size_t seed = std::hash<std::string>()(key.dataset);
+        seed ^= std::hash<int>()(key.band) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= std::hash<int>()(key.overview) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= std::hash<int>()(key.block_x) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= std::hash<int>()(key.block_y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+// decoded block in the band's native data type, block_x_size * block_y_size pixels
+using gdal_block_ptr = std::shared_ptr<std::vector<unsigned char> const>;
+
+// Process-wide LRU of decoded GDAL blocks, bounded by total bytes and
+// shared by every gdal datasource with block_cache=true.
+class gdal_block_cache :
+        public mapnik::singleton<gdal_block_cache, mapnik::CreateStatic>,
+        private mapnik::noncopyable
+{
+    friend class mapnik::CreateStatic<gdal_block_cache>;
+    using entry_type = std::pair<gdal_block_key, gdal_block_ptr>;
+    using list_type = std::list<entry_type>;
+    list_type lru_;
+    std::unordered_map<gdal_block_key, list_type::iterator, gdal_block_key_hash> index_;
+    std::size_t capacity_;
+    std::size_t size_;
+    gdal_block_cache();
+    void evict();
+public:
+    gdal_block_ptr find(gdal_block_key const& key);
+    void insert(gdal_block_key const& key, gdal_block_ptr const& block);
+    // the capacity only grows, so the largest request of all datasources wins
+    void reserve(std::size_t bytes);
+    std::size_t size() const;
+    void clear();
+};
+
+#endif // GDAL_BLOCK_CACHE_HPP
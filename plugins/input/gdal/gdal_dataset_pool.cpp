@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "gdal_dataset_pool.hpp"
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/unique_lock.hpp>
+
+#include <gdal_priv.h>
+
+gdal_dataset_pool::gdal_dataset_pool(std::size_t max_idle)
+    : max_idle_(max_idle) {}
+
+gdal_dataset_pool::~gdal_dataset_pool()
+{
+    for (GDALDataset* dataset : idle_)
+    {
+        GDALClose(dataset);
+    }
+}
+
+GDALDataset* gdal_dataset_pool::acquire()
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (idle_.empty()) return 0;
+    GDALDataset* dataset = idle_.back();
+    idle_.pop_back();
+    return dataset;
+}
+
+void gdal_dataset_pool::release(GDALDataset* dataset)
+{
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        if (idle_.size() < max_idle_)
+        {
+            idle_.push_back(dataset);
+            return;
+        }
+    }
+    MAPNIK_LOG_DEBUG(gdal) << "gdal_dataset_pool: Closing surplus Dataset=" << dataset;
+    GDALClose(dataset);
+}
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GDAL_DATASET_POOL_HPP
+#define GDAL_DATASET_POOL_HPP
+
+// mapnik
+#include <mapnik/noncopyable.hpp>
+#include <mapnik/config.hpp>
+
+// stl
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+class GDALDataset;
+
+// Keeps idle, privately opened dataset handles of one datasource for reuse.
+// A featureset borrows a handle for its whole lifetime, so concurrent
+// renders never share a GDALDataset and never wait on each other inside
+// GDAL, while still avoiding a full GDALOpen per query.
+class gdal_dataset_pool : private mapnik::noncopyable
+{
+public:
+    explicit gdal_dataset_pool(std::size_t max_idle);
+    ~gdal_dataset_pool();
+    // returns an idle handle, or 0 if the caller has to open a new one
+    GDALDataset* acquire();
+    // takes the handle back, closing it if enough are already idle
+    void release(GDALDataset* dataset);
+private:
+    std::size_t max_idle_;
+    std::vector<GDALDataset*> idle_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+};
+
+#endif // GDAL_DATASET_POOL_HPP
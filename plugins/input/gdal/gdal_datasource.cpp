@@ -22,6 +22,7 @@
 
 #include "gdal_datasource.hpp"
 #include "gdal_featureset.hpp"
+#include "gdal_block_cache.hpp"
 
 // mapnik
 #include <mapnik/debug.hpp>
@@ -74,12 +75,24 @@ inline GDALDataset* gdal_datasource::open_dataset() const
     return dataset;
 }
 
+/*
+ * Returns an idle handle from the pool when pooling is enabled,
+ * otherwise opens the dataset as above.
+ */
+inline GDALDataset* gdal_datasource::acquire_dataset() const
+{
+    GDALDataset *dataset = pool_ ? pool_->acquire() : 0;
+    return dataset ? dataset : open_dataset();
+}
+
 
 gdal_datasource::gdal_datasource(parameters const& params)
     : datasource(params),
       desc_(gdal_datasource::name(), "utf-8"),
       nodata_value_(params.get<double>("nodata")),
-      nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12))
+      nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12)),
+      block_cache_(*params.get<mapnik::boolean_type>("block_cache", false)),
+      pool_()
 {
     MAPNIK_LOG_DEBUG(gdal) << "gdal_datasource: Initializing...";
 
@@ -105,6 +118,22 @@ gdal_datasource::gdal_datasource(parameters const& params)
     shared_dataset_ = *params.get<mapnik::boolean_type>("shared", false);
     band_ = *params.get<mapnik::value_integer>("band", -1);
 
+    // keep up to pool_size idle private handles instead of opening the
+    // dataset for every query; shared handles are reused by GDAL already
+    mapnik::value_integer pool_size = *params.get<mapnik::value_integer>("pool_size", 0);
+    if (pool_size > 0 && !shared_dataset_)
+    {
+        pool_ = std::make_shared<gdal_dataset_pool>(static_cast<std::size_t>(pool_size));
+    }
+
+    // read whole native blocks of the best overview and keep them decoded
+    // in a process-wide LRU of block_cache_size megabytes
+    if (block_cache_)
+    {
+        mapnik::value_integer cache_size = *params.get<mapnik::value_integer>("block_cache_size", 64);
+        gdal_block_cache::instance().reserve(static_cast<std::size_t>(cache_size) * 1024 * 1024);
+    }
+
     GDALDataset *dataset = open_dataset();
 
     nbands_ = dataset->GetRasterCount();
@@ -188,7 +217,14 @@ gdal_datasource::gdal_datasource(parameters const& params)
         extent_.init(x0, y0, x1, y1);
     }
 
-    GDALClose(dataset);
+    if (pool_)
+    {
+        pool_->release(dataset);
+    }
+    else
+    {
+        GDALClose(dataset);
+    }
 
     MAPNIK_LOG_DEBUG(gdal) << "gdal_datasource: Raster Size=" << width_ << "," << height_;
     MAPNIK_LOG_DEBUG(gdal) << "gdal_datasource: Raster Extent=" << extent_;
@@ -233,7 +269,7 @@ featureset_ptr gdal_datasource::features(query const& q) const
     gdal_query gq = q;
 
     // TODO - move to std::make_shared, but must reduce # of args to <= 9
-    return featureset_ptr(new gdal_featureset(*open_dataset(),
+    return featureset_ptr(new gdal_featureset(*acquire_dataset(),
                                               band_,
                                               gq,
                                               extent_,
@@ -243,7 +279,9 @@ featureset_ptr gdal_datasource::features(query const& q) const
                                               dx_,
                                               dy_,
                                               nodata_value_,
-                                              nodata_tolerance_));
+                                              nodata_tolerance_,
+                                              pool_,
+                                              block_cache_ ? dataset_name_ : std::string()));
 }
 
 featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol) const
@@ -255,7 +293,7 @@ featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol)
     gdal_query gq = pt;
 
     // TODO - move to std::make_shared, but must reduce # of args to <= 9
-    return featureset_ptr(new gdal_featureset(*open_dataset(),
+    return featureset_ptr(new gdal_featureset(*acquire_dataset(),
                                               band_,
                                               gq,
                                               extent_,
@@ -265,5 +303,7 @@ featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol)
                                               dx_,
                                               dy_,
                                               nodata_value_,
-                                              nodata_tolerance_));
+                                              nodata_tolerance_,
+                                              pool_,
+                                              block_cache_ ? dataset_name_ : std::string()));
 }
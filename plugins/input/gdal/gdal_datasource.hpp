@@ -38,10 +38,13 @@
 // stl
 #include <vector>
 #include <string>
+#include <memory>
 
 // gdal
 #include <gdal_priv.h>
 
+#include "gdal_dataset_pool.hpp"
+
 class gdal_datasource : public mapnik::datasource
 {
 public:
@@ -56,6 +59,7 @@ public:
     mapnik::layer_descriptor get_descriptor() const;
 private:
     GDALDataset* open_dataset() const;
+    GDALDataset* acquire_dataset() const;
     mapnik::box2d<double> extent_;
     std::string dataset_name_;
     int band_;
@@ -68,6 +72,8 @@ private:
     bool shared_dataset_;
     boost::optional<double> nodata_value_;
     double nodata_tolerance_;
+    bool block_cache_;
+    std::shared_ptr<gdal_dataset_pool> pool_;
 };
 
 #endif // GDAL_DATASOURCE_HPP
@@ -35,8 +35,11 @@
 // stl
 #include <cmath>
 #include <memory>
+#include <vector>
+#include <algorithm>
 
 #include "gdal_featureset.hpp"
+#include "gdal_block_cache.hpp"
 #include <gdal_priv.h>
 
 using mapnik::query;
@@ -58,7 +61,9 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
                                  double dx,
                                  double dy,
                                  boost::optional<double> const& nodata,
-                                 double nodata_tolerance)
+                                 double nodata_tolerance,
+                                 std::shared_ptr<gdal_dataset_pool> const& pool,
+                                 std::string const& block_cache_name)
     : dataset_(dataset),
       ctx_(std::make_shared<mapnik::context_type>()),
       band_(band),
@@ -71,6 +76,8 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
       nbands_(nbands),
       nodata_value_(nodata),
       nodata_tolerance_(nodata_tolerance),
+      pool_(pool),
+      block_cache_name_(block_cache_name),
       first_(true)
 {
     ctx_->push("nodata");
@@ -78,6 +85,12 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
 
 gdal_featureset::~gdal_featureset()
 {
+    if (pool_)
+    {
+        pool_->release(&dataset_);
+        return;
+    }
+
     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Closing Dataset=" << &dataset_;
 
     GDALClose(&dataset_);
@@ -198,7 +211,29 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
 
         if (im_width > 0 && im_height > 0)
         {
-            mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, im_width, im_height, filter_factor);
+            // a single band keeps its values in their own type (8/16 bit or float)
+            // until the raster colorizer turns them into colors
+            mapnik::raster_band_e band_type = mapnik::RASTER_RGBA;
+            if (band_ > 0)
+            {
+                if (band_ > nbands_)
+                {
+                    throw datasource_exception((boost::format("GDAL Plugin: '%d' is an invalid band, dataset only has '%d' bands\n") % band_ % nbands_).str());
+                }
+                switch (dataset_.GetRasterBand(band_)->GetRasterDataType())
+                {
+                case GDT_Byte:
+                    band_type = mapnik::RASTER_GRAY8;
+                    break;
+                case GDT_UInt16:
+                    band_type = mapnik::RASTER_GRAY16;
+                    break;
+                default:
+                    band_type = mapnik::RASTER_FLOAT32;
+                    break;
+                }
+            }
+            mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, im_width, im_height, filter_factor, band_type);
             feature->set_raster(raster);
             mapnik::image_data_32 & image = raster->data_;
             image.set(0xffffffff);
@@ -208,16 +243,26 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
 
             if (band_ > 0) // we are querying a single band
             {
-                if (band_ > nbands_)
-                {
-                    throw datasource_exception((boost::format("GDAL Plugin: '%d' is an invalid band, dataset only has '%d' bands\n") % band_ % nbands_).str());
-                }
-                float* imageData = (float*)image.getBytes();
                 GDALRasterBand * band = dataset_.GetRasterBand(band_);
                 raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                band->RasterIO(GF_Read, x_off, y_off, width, height,
-                               imageData, image.width(), image.height(),
-                               GDT_Float32, 0, 0);
+                if (band_type == mapnik::RASTER_GRAY8)
+                {
+                    read_window(band, x_off, y_off, width, height,
+                                raster->band_8().getData(), im_width, im_height,
+                                GDT_Byte, 0, 0);
+                }
+                else if (band_type == mapnik::RASTER_GRAY16)
+                {
+                    read_window(band, x_off, y_off, width, height,
+                                raster->band_16().getData(), im_width, im_height,
+                                GDT_UInt16, 0, 0);
+                }
+                else
+                {
+                    read_window(band, x_off, y_off, width, height,
+                                raster->band_32f().getData(), im_width, im_height,
+                                GDT_Float32, 0, 0);
+                }
             }
             else // working with all bands
             {
@@ -307,9 +352,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         // TODO - we assume here the nodata value for the red band applies to all bands
                         // more details about this at http://trac.osgeo.org/gdal/ticket/2734
                         float* imageData = (float*)image.getBytes();
-                        red->RasterIO(GF_Read, x_off, y_off, width, height,
-                                      imageData, image.width(), image.height(),
-                                      GDT_Float32, 0, 0);
+                        read_window(red, x_off, y_off, width, height,
+                                    imageData, image.width(), image.height(),
+                                    GDT_Float32, 0, 0);
                         int len = image.width() * image.height();
                         for (int i = 0; i < len; ++i)
                         {
@@ -323,12 +368,12 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                             }
                         }
                     }
-                    red->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 0,
-                                  image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
-                    green->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 1,
-                                    image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
-                    blue->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 2,
-                                   image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    read_window(red, x_off, y_off, width, height, image.getBytes() + 0,
+                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    read_window(green, x_off, y_off, width, height, image.getBytes() + 1,
+                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    read_window(blue, x_off, y_off, width, height, image.getBytes() + 2,
+                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                 }
                 else if (grey)
                 {
@@ -342,9 +387,9 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: applying nodata value for layer=" << apply_nodata;
                         // first read the data in and create an alpha channel from the nodata values
                         float* imageData = (float*)image.getBytes();
-                        grey->RasterIO(GF_Read, x_off, y_off, width, height,
-                                       imageData, image.width(), image.height(),
-                                       GDT_Float32, 0, 0);
+                        read_window(grey, x_off, y_off, width, height,
+                                    imageData, image.width(), image.height(),
+                                    GDT_Float32, 0, 0);
                         int len = image.width() * image.height();
                         for (int i = 0; i < len; ++i)
                         {
@@ -358,12 +403,12 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                             }
                         }
                     }
-                    grey->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 0,
-                                   image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
-                    grey->RasterIO(GF_Read,x_off, y_off, width, height, image.getBytes() + 1,
-                                   image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
-                    grey->RasterIO(GF_Read,x_off, y_off, width, height, image.getBytes() + 2,
-                                   image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    read_window(grey, x_off, y_off, width, height, image.getBytes() + 0,
+                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    read_window(grey, x_off, y_off, width, height, image.getBytes() + 1,
+                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    read_window(grey, x_off, y_off, width, height, image.getBytes() + 2,
+                                image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
 
                     if (color_table)
                     {
@@ -394,8 +439,8 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: processing alpha band...";
                     if (!raster_has_nodata)
                     {
-                        alpha->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 3,
-                                        image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                        read_window(alpha, x_off, y_off, width, height, image.getBytes() + 3,
+                                    image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                     }
                     else
                     {
@@ -424,6 +469,122 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
 }
 
 
+CPLErr gdal_featureset::read_window(GDALRasterBand * band, int x_off, int y_off, int width, int height,
+                                    void * data, int buf_width, int buf_height, GDALDataType type,
+                                    int pixel_space, int line_space)
+{
+    if (block_cache_name_.empty())
+    {
+        return band->RasterIO(GF_Read, x_off, y_off, width, height,
+                              data, buf_width, buf_height, type, pixel_space, line_space);
+    }
+    return read_cached_window(band, x_off, y_off, width, height,
+                              data, buf_width, buf_height, type, pixel_space, line_space);
+}
+
+/*
+ * Same contract as GDALRasterBand::RasterIO with nearest neighbour
+ * resampling, but served from whole native blocks of the coarsest overview
+ * that still has at least the requested resolution. Decoded blocks are kept
+ * in gdal_block_cache, so neighbouring tiles reuse them.
+ */
+CPLErr gdal_featureset::read_cached_window(GDALRasterBand * band, int x_off, int y_off, int width, int height,
+                                           void * data, int buf_width, int buf_height, GDALDataType type,
+                                           int pixel_space, int line_space)
+{
+    // best overview for the requested decimation
+    GDALRasterBand * source = band;
+    int overview = -1;
+    double factor = std::min(static_cast<double>(width) / buf_width,
+                             static_cast<double>(height) / buf_height);
+    double best_factor = 1.0;
+    for (int i = 0; i < band->GetOverviewCount(); ++i)
+    {
+        GDALRasterBand * candidate = band->GetOverview(i);
+        if (! candidate) continue;
+        double candidate_factor = static_cast<double>(band->GetXSize()) / candidate->GetXSize();
+        if (candidate_factor <= factor && candidate_factor > best_factor)
+        {
+            best_factor = candidate_factor;
+            source = candidate;
+            overview = i;
+        }
+    }
+    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Reading overview=" << overview << " for decimation=" << factor;
+
+    int source_width = source->GetXSize();
+    int source_height = source->GetYSize();
+    double scale_x = static_cast<double>(band->GetXSize()) / source_width;
+    double scale_y = static_cast<double>(band->GetYSize()) / source_height;
+    int block_width;
+    int block_height;
+    source->GetBlockSize(&block_width, &block_height);
+    GDALDataType block_type = source->GetRasterDataType();
+    int type_size = GDALGetDataTypeSize(block_type) / 8;
+    if (pixel_space == 0) pixel_space = GDALGetDataTypeSize(type) / 8;
+    if (line_space == 0) line_space = pixel_space * buf_width;
+
+    // source pixel sampled by every output column and row
+    std::vector<int> columns(buf_width);
+    for (int i = 0; i < buf_width; ++i)
+    {
+        int x = static_cast<int>((x_off + (i + 0.5) * width / buf_width) / scale_x);
+        columns[i] = std::max(0, std::min(x, source_width - 1));
+    }
+
+    gdal_block_key key = { block_cache_name_, band->GetBand(), overview, -1, -1 };
+    gdal_block_cache & cache = gdal_block_cache::instance();
+    gdal_block_ptr block;
+    unsigned char * output = static_cast<unsigned char *>(data);
+    for (int j = 0; j < buf_height; ++j)
+    {
+        int y = static_cast<int>((y_off + (j + 0.5) * height / buf_height) / scale_y);
+        y = std::max(0, std::min(y, source_height - 1));
+        int block_y = y / block_height;
+        unsigned char * row = output + static_cast<std::ptrdiff_t>(j) * line_space;
+        int i = 0;
+        while (i < buf_width)
+        {
+            int block_x = columns[i] / block_width;
+            if (! block || key.block_x != block_x || key.block_y != block_y)
+            {
+                key.block_x = block_x;
+                key.block_y = block_y;
+                block = cache.find(key);
+                if (! block)
+                {
+                    std::shared_ptr<std::vector<unsigned char> > decoded =
+                        std::make_shared<std::vector<unsigned char> >(
+                            static_cast<std::size_t>(block_width) * block_height * type_size);
+                    if (source->ReadBlock(block_x, block_y, decoded->data()) != CE_None)
+                    {
+                        return CE_Failure;
+                    }
+                    block = decoded;
+                    cache.insert(key, block);
+                }
+            }
+            // convert a run of consecutive source pixels within this block at once
+            int run = 1;
+            while (i + run < buf_width &&
+                   columns[i + run] == columns[i] + run &&
+                   columns[i + run] / block_width == block_x)
+            {
+                ++run;
+            }
+            std::size_t offset = static_cast<std::size_t>(y - block_y * block_height) * block_width
+                + (columns[i] - block_x * block_width);
+            GDALCopyWords(const_cast<unsigned char *>(block->data()) + offset * type_size,
+                          block_type, type_size,
+                          row + static_cast<std::ptrdiff_t>(i) * pixel_space,
+                          type, pixel_space, run);
+            i += run;
+        }
+    }
+    return CE_None;
+}
+
+
 feature_ptr gdal_featureset::get_feature_at_point(mapnik::coord2d const& pt)
 {
     if (band_ > 0)
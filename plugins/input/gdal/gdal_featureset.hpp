@@ -28,6 +28,9 @@
 #include <mapnik/util/variant.hpp>
 // boost
 #include <boost/optional.hpp>
+// stl
+#include <memory>
+#include <string>
 
 #include "gdal_datasource.hpp"
 
@@ -67,13 +70,21 @@ public:
                     double dx,
                     double dy,
                     boost::optional<double> const& nodata,
-                    double nodata_tolerance);
+                    double nodata_tolerance,
+                    std::shared_ptr<gdal_dataset_pool> const& pool,
+                    std::string const& block_cache_name);
     virtual ~gdal_featureset();
     mapnik::feature_ptr next();
 
 private:
     mapnik::feature_ptr get_feature(mapnik::query const& q);
     mapnik::feature_ptr get_feature_at_point(mapnik::coord2d const& p);
+    CPLErr read_window(GDALRasterBand * band, int x_off, int y_off, int width, int height,
+                       void * data, int buf_width, int buf_height, GDALDataType type,
+                       int pixel_space, int line_space);
+    CPLErr read_cached_window(GDALRasterBand * band, int x_off, int y_off, int width, int height,
+                              void * data, int buf_width, int buf_height, GDALDataType type,
+                              int pixel_space, int line_space);
 
 #ifdef MAPNIK_LOG
     void get_overview_meta(GDALRasterBand * band);
@@ -91,6 +102,8 @@ private:
     int nbands_;
     boost::optional<double> nodata_value_;
     double nodata_tolerance_;
+    std::shared_ptr<gdal_dataset_pool> pool_;
+    std::string block_cache_name_;
     bool first_;
 };
 
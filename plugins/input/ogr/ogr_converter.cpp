@@ -84,48 +84,41 @@ void ogr_converter::convert_point(OGRPoint* geom, feature_ptr feature)
     feature->paths().push_back(point.release());
 }
 
-void ogr_converter::convert_linestring(OGRLineString* geom, feature_ptr feature)
+void ogr_converter::append_points(OGRLineString* line, geometry_type & path, bool close)
 {
-    int num_points = geom->getNumPoints();
-    std::unique_ptr<geometry_type> line(new geometry_type(mapnik::geometry_type::types::LineString));
-    line->move_to(geom->getX(0), geom->getY(0));
+    int num_points = line->getNumPoints();
+    if (num_points <= 0) return;
+    if (points_.size() < static_cast<std::size_t>(num_points))
+    {
+        points_.resize(num_points);
+    }
+    line->getPoints(points_.data());
+    path.move_to(points_[0].x, points_[0].y);
     for (int i = 1; i < num_points; ++i)
     {
-        line->line_to (geom->getX(i), geom->getY(i));
+        path.line_to(points_[i].x, points_[i].y);
+    }
+    if (close)
+    {
+        path.close_path();
     }
+}
+
+void ogr_converter::convert_linestring(OGRLineString* geom, feature_ptr feature)
+{
+    std::unique_ptr<geometry_type> line(new geometry_type(mapnik::geometry_type::types::LineString));
+    append_points(geom, *line, false);
     feature->paths().push_back(line.release());
 }
 
 void ogr_converter::convert_polygon(OGRPolygon* geom, feature_ptr feature)
 {
-    OGRLinearRing* exterior = geom->getExteriorRing();
-    int num_points = exterior->getNumPoints();
-    int num_interior = geom->getNumInteriorRings();
-    int capacity = 0;
-    for (int r = 0; r < num_interior; ++r)
-    {
-        OGRLinearRing* interior = geom->getInteriorRing(r);
-        capacity += interior->getNumPoints();
-    }
-
     std::unique_ptr<geometry_type> poly(new geometry_type(mapnik::geometry_type::types::Polygon));
-
-    poly->move_to(exterior->getX(0), exterior->getY(0));
-    for (int i = 1; i < num_points; ++i)
-    {
-        poly->line_to(exterior->getX(i), exterior->getY(i));
-    }
-    poly->close_path();
+    append_points(geom->getExteriorRing(), *poly, true);
+    int num_interior = geom->getNumInteriorRings();
     for (int r = 0; r < num_interior; ++r)
     {
-        OGRLinearRing* interior = geom->getInteriorRing(r);
-        num_points = interior->getNumPoints();
-        poly->move_to(interior->getX(0), interior->getY(0));
-        for (int i = 1; i < num_points; ++i)
-        {
-            poly->line_to(interior->getX(i), interior->getY(i));
-        }
-        poly->close_path();
+        append_points(geom->getInteriorRing(r), *poly, true);
     }
     feature->paths().push_back(poly.release());
 }
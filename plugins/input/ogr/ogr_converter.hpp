@@ -26,22 +26,35 @@
 // mapnik
 #include <mapnik/datasource.hpp>
 #include <mapnik/params.hpp>
+#include <mapnik/geometry.hpp>
+
+// stl
+#include <vector>
 
 // ogr
 #include <ogrsf_frmts.h>
 
+// Converts OGR geometries into mapnik paths. Coordinates of each ring
+// are copied out in one getPoints() call into a buffer reused across
+// features, rather than read back one vertex at a time.
 class ogr_converter
 {
 public:
 
-    static void convert_geometry (OGRGeometry* geom, mapnik::feature_ptr feature);
-    static void convert_collection (OGRGeometryCollection* geom, mapnik::feature_ptr feature);
-    static void convert_point (OGRPoint* geom, mapnik::feature_ptr feature);
-    static void convert_linestring (OGRLineString* geom, mapnik::feature_ptr feature);
-    static void convert_polygon (OGRPolygon* geom, mapnik::feature_ptr feature);
-    static void convert_multipoint (OGRMultiPoint* geom, mapnik::feature_ptr feature);
-    static void convert_multilinestring (OGRMultiLineString* geom, mapnik::feature_ptr feature);
-    static void convert_multipolygon (OGRMultiPolygon* geom, mapnik::feature_ptr feature);
+    void convert_geometry (OGRGeometry* geom, mapnik::feature_ptr feature);
+    void convert_collection (OGRGeometryCollection* geom, mapnik::feature_ptr feature);
+    void convert_point (OGRPoint* geom, mapnik::feature_ptr feature);
+    void convert_linestring (OGRLineString* geom, mapnik::feature_ptr feature);
+    void convert_polygon (OGRPolygon* geom, mapnik::feature_ptr feature);
+    void convert_multipoint (OGRMultiPoint* geom, mapnik::feature_ptr feature);
+    void convert_multilinestring (OGRMultiLineString* geom, mapnik::feature_ptr feature);
+    void convert_multipolygon (OGRMultiPolygon* geom, mapnik::feature_ptr feature);
+
+private:
+    // appends the vertices of `line` to `path`, closing it if `close`
+    void append_points (OGRLineString* line, mapnik::geometry_type & path, bool close);
+
+    std::vector<OGRRawPoint> points_;
 };
 
 #endif // OGR_CONVERTER_HPP
@@ -32,6 +32,9 @@
 #include <mapnik/geom_util.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/utils.hpp>
+#include <mapnik/sql_filter.hpp>
+#ifdef MAPNIK_THREADSAFE
+#endif
 
 // boost
 #include <boost/algorithm/string.hpp>
@@ -61,20 +64,79 @@ ogr_datasource::ogr_datasource(parameters const& params)
     : datasource(params),
       extent_(),
       type_(datasource::Vector),
+      handle_(std::make_shared<ogr_handle>()),
+      layer_index_(-1),
       desc_(ogr_datasource::name(), *params.get<std::string>("encoding", "utf-8")),
       indexed_(false)
 {
     init(params);
 }
 
-ogr_datasource::~ogr_datasource()
+ogr_datasource::~ogr_datasource() {}
+
+gdal_dataset_type ogr_datasource::open_dataset() const
 {
-    // free layer before destroying the datasource
-    layer_.free_layer();
+    gdal_dataset_type dataset = nullptr;
+    if (! driver_.empty())
+    {
+#if GDAL_VERSION_MAJOR >= 2
+        unsigned int nOpenFlags = GDAL_OF_READONLY | GDAL_OF_VECTOR;
+        const char* papszAllowedDrivers[] = { driver_.c_str(), nullptr };
+        dataset = reinterpret_cast<gdal_dataset_type>(GDALOpenEx(dataset_name_.c_str(),nOpenFlags,papszAllowedDrivers, nullptr, nullptr));
+#else
+        OGRSFDriver * ogr_driver = OGRSFDriverRegistrar::GetRegistrar()->GetDriverByName(driver_.c_str());
+        if (ogr_driver && ogr_driver != nullptr)
+        {
+            dataset = ogr_driver->Open((dataset_name_).c_str(), false);
+        }
+#endif
+    }
+    else
+    {
+        // open ogr driver
 #if GDAL_VERSION_MAJOR >= 2
-    GDALClose(( GDALDatasetH) dataset_);
+        dataset = reinterpret_cast<gdal_dataset_type>(OGROpen(dataset_name_.c_str(), false, nullptr));
+#else
+        dataset = OGRSFDriverRegistrar::Open(dataset_name_.c_str(), false);
+#endif
+    }
+    return dataset;
+}
+
+std::shared_ptr<ogr_handle> ogr_datasource::open_handle() const
+{
+    std::shared_ptr<ogr_handle> h = std::make_shared<ogr_handle>();
+    h->dataset = open_dataset();
+    if (! h->dataset)
+    {
+        throw datasource_exception("OGR Plugin: could not reopen " + dataset_name_);
+    }
+    if (! layer_sql_.empty())
+    {
+        h->layer.layer_by_sql(h->dataset, layer_sql_);
+    }
+    else if (layer_index_ >= 0)
+    {
+        h->layer.layer_by_index(h->dataset, layer_index_);
+    }
+    else
+    {
+        h->layer.layer_by_name(h->dataset, layer_name_);
+    }
+    if (! h->layer.is_valid())
+    {
+        throw datasource_exception("OGR Plugin: could not reopen layer '" + layer_name_ + "' in dataset '" + dataset_name_ + "'");
+    }
+    return h;
+}
+
+std::shared_ptr<ogr_handle> ogr_datasource::handle() const
+{
+#ifdef MAPNIK_THREADSAFE
+    // a thread reading two featuresets at once gets two handles
+    return handles_.idle([this] { return open_handle(); });
 #else
-    OGRDataSource::DestroyDataSource (dataset_);
+    return handle_;
 #endif
 }
 
@@ -113,33 +175,11 @@ void ogr_datasource::init(mapnik::parameters const& params)
         }
     }
 
-    std::string driver = *params.get<std::string>("driver","");
+    driver_ = *params.get<std::string>("driver","");
+    handle_->dataset = open_dataset();
+    gdal_dataset_type dataset = handle_->dataset;
 
-    if (! driver.empty())
-    {
-#if GDAL_VERSION_MAJOR >= 2
-        unsigned int nOpenFlags = GDAL_OF_READONLY | GDAL_OF_VECTOR;
-        const char* papszAllowedDrivers[] = { driver.c_str(), nullptr };
-        dataset_ = reinterpret_cast<gdal_dataset_type>(GDALOpenEx(dataset_name_.c_str(),nOpenFlags,papszAllowedDrivers, nullptr, nullptr));
-#else
-        OGRSFDriver * ogr_driver = OGRSFDriverRegistrar::GetRegistrar()->GetDriverByName(driver.c_str());
-        if (ogr_driver && ogr_driver != nullptr)
-        {
-            dataset_ = ogr_driver->Open((dataset_name_).c_str(), false);
-        }
-#endif
-    }
-    else
-    {
-        // open ogr driver
-#if GDAL_VERSION_MAJOR >= 2
-        dataset_ = reinterpret_cast<gdal_dataset_type>(OGROpen(dataset_name_.c_str(), false, nullptr));
-#else
-        dataset_ = OGRSFDriverRegistrar::Open(dataset_name_.c_str(), false);
-#endif
-    }
-
-    if (! dataset_)
+    if (! dataset)
     {
         const std::string err = CPLGetLastErrorMsg();
         if (err.size() == 0)
@@ -173,11 +213,11 @@ void ogr_datasource::init(mapnik::parameters const& params)
     if (layer_by_name)
     {
         layer_name_ = *layer_by_name;
-        layer_.layer_by_name(dataset_, layer_name_);
+        handle_->layer.layer_by_name(dataset, layer_name_);
     }
     else if (layer_by_index)
     {
-        int num_layers = dataset_->GetLayerCount();
+        int num_layers = dataset->GetLayerCount();
         if (*layer_by_index >= num_layers)
         {
             std::ostringstream s;
@@ -185,8 +225,9 @@ void ogr_datasource::init(mapnik::parameters const& params)
             throw datasource_exception(s.str());
         }
 
-        layer_.layer_by_index(dataset_, *layer_by_index);
-        layer_name_ = layer_.layer_name();
+        layer_index_ = static_cast<int>(*layer_by_index);
+        handle_->layer.layer_by_index(dataset, layer_index_);
+        layer_name_ = handle_->layer.layer_name();
     }
     else if (layer_by_sql)
     {
@@ -194,19 +235,20 @@ void ogr_datasource::init(mapnik::parameters const& params)
         mapnik::progress_timer __stats_sql__(std::clog, "ogr_datasource::init(layer_by_sql)");
 #endif
 
-        layer_.layer_by_sql(dataset_, *layer_by_sql);
-        layer_name_ = layer_.layer_name();
+        layer_sql_ = *layer_by_sql;
+        handle_->layer.layer_by_sql(dataset, layer_sql_);
+        layer_name_ = handle_->layer.layer_name();
     }
     else
     {
         std::string s("OGR Plugin: missing <layer> or <layer_by_index> or <layer_by_sql>  parameter, available layers are: ");
 
-        unsigned num_layers = dataset_->GetLayerCount();
+        unsigned num_layers = dataset->GetLayerCount();
         bool layer_found = false;
         std::vector<std::string> layer_names;
         for (unsigned i = 0; i < num_layers; ++i )
         {
-            OGRLayer* ogr_layer = dataset_->GetLayer(i);
+            OGRLayer* ogr_layer = dataset->GetLayer(i);
             OGRFeatureDefn* ogr_layer_def = ogr_layer->GetLayerDefn();
             if (ogr_layer_def != 0)
             {
@@ -227,7 +269,7 @@ void ogr_datasource::init(mapnik::parameters const& params)
         throw datasource_exception(s);
     }
 
-    if (! layer_.is_valid())
+    if (! handle_->layer.is_valid())
     {
         std::ostringstream s;
         s << "OGR Plugin: ";
@@ -251,7 +293,7 @@ void ogr_datasource::init(mapnik::parameters const& params)
     }
 
     // work with real OGR layer
-    OGRLayer* layer = layer_.layer();
+    OGRLayer* layer = handle_->layer.layer();
 
     // initialize envelope
     boost::optional<std::string> ext = params.get<std::string>("extent");
@@ -381,9 +423,9 @@ box2d<double> ogr_datasource::envelope() const
 boost::optional<mapnik::datasource::geometry_t> ogr_datasource::get_geometry_type() const
 {
     boost::optional<mapnik::datasource::geometry_t> result;
-    if (dataset_ && layer_.is_valid())
+    if (handle_->dataset && handle_->layer.is_valid())
     {
-        OGRLayer* layer = layer_.layer();
+        OGRLayer* layer = handle_->layer.layer();
         // NOTE: wkbFlatten macro in ogr flattens 2.5d types into base 2d type
 #if GDAL_VERSION_NUM < 1800
         switch (wkbFlatten(layer->GetLayerDefn()->GetGeomType()))
@@ -412,9 +454,9 @@ boost::optional<mapnik::datasource::geometry_t> ogr_datasource::get_geometry_typ
             {
                 // fallback to inspecting first actual geometry
                 // TODO - csv and shapefile inspect first 4 features
-                if (dataset_ && layer_.is_valid())
+                if (handle_->dataset && handle_->layer.is_valid())
                 {
-                    layer = layer_.layer();
+                    layer = handle_->layer.layer();
                     // only new either reset of setNext
                     //layer->ResetReading();
                     layer->SetNextByIndex(0);
@@ -502,43 +544,89 @@ void validate_attribute_names(query const& q, std::vector<attribute_descriptor>
     }
 }
 
+namespace {
+
+// pushes `names` to `ctx` and returns their OGR field indices in the
+// same order, telling the layer to skip reading every other field
+std::vector<int> project_fields(OGRLayer* layer,
+                                std::vector<std::string> const& names,
+                                mapnik::context_ptr const& ctx)
+{
+    OGRFeatureDefn* def = layer->GetLayerDefn();
+    std::vector<int> fields;
+    std::vector<bool> wanted(def->GetFieldCount(), false);
+    for (std::string const& name : names)
+    {
+        int index = def->GetFieldIndex(name.c_str());
+        if (index < 0) continue;
+        ctx->push(name);
+        fields.push_back(index);
+        wanted[index] = true;
+    }
+#if GDAL_VERSION_NUM >= 1800
+    std::vector<const char*> ignored;
+    for (int i = 0; i < def->GetFieldCount(); ++i)
+    {
+        if (! wanted[i]) ignored.push_back(def->GetFieldDefn(i)->GetNameRef());
+    }
+#if GDAL_VERSION_MAJOR >= 2
+    // only the first geometry field is rendered
+    for (int i = 1; i < def->GetGeomFieldCount(); ++i)
+    {
+        ignored.push_back(def->GetGeomFieldDefn(i)->GetNameRef());
+    }
+#endif
+    ignored.push_back("OGR_STYLE");
+    ignored.push_back(nullptr);
+    // a driver that can't skip fields still reads them all
+    layer->SetIgnoredFields(ignored.data());
+#endif
+    return fields;
+}
+
+}
+
 featureset_ptr ogr_datasource::features(query const& q) const
 {
 #ifdef MAPNIK_STATS
     mapnik::progress_timer __stats__(std::clog, "ogr_datasource::features");
 #endif
 
-    if (dataset_ && layer_.is_valid())
+    if (handle_->dataset && handle_->layer.is_valid())
     {
         // First we validate query fields: https://github.com/mapnik/mapnik/issues/792
+        validate_attribute_names(q, desc_.get_descriptors());
 
-        std::vector<attribute_descriptor> const& desc_ar = desc_.get_descriptors();
-        // feature context (schema)
-        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
-
-        std::vector<attribute_descriptor>::const_iterator itr = desc_ar.begin();
-        std::vector<attribute_descriptor>::const_iterator end = desc_ar.end();
-
-        for (; itr!=end; ++itr) ctx->push(itr->get_name()); // TODO only push query attributes
+        std::shared_ptr<ogr_handle> h = handle();
+        OGRLayer* layer = h->layer.layer();
 
-        validate_attribute_names(q, desc_ar);
-
-        OGRLayer* layer = layer_.layer();
+        // feature context (schema) of just the queried fields
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        std::set<std::string> const& names = q.property_names();
+        std::vector<int> fields = project_fields(layer, std::vector<std::string>(names.begin(), names.end()), ctx);
 
         if (indexed_)
         {
             filter_in_box filter(q.get_bbox());
 
             return featureset_ptr(new ogr_index_featureset<filter_in_box>(ctx,
-                                                                          *layer,
+                                                                          h,
+                                                                          fields,
                                                                           filter,
                                                                           index_name_,
                                                                           desc_.get_encoding()));
         }
         else
         {
+            // the index reads features by id, which ignores attribute filters
+            boost::optional<std::string> filter_sql = mapnik::sql_utils::filters_to_sql(q.filters(), desc_);
+            if (!filter_sql || layer->SetAttributeFilter(filter_sql->c_str()) != OGRERR_NONE)
+            {
+                layer->SetAttributeFilter(nullptr);
+            }
             return featureset_ptr(new ogr_featureset(ctx,
-                                                      *layer,
+                                                      h,
+                                                      fields,
                                                       q.get_bbox(),
                                                       desc_.get_encoding()));
         }
@@ -553,24 +641,27 @@ featureset_ptr ogr_datasource::features_at_point(coord2d const& pt, double tol)
     mapnik::progress_timer __stats__(std::clog, "ogr_datasource::features_at_point");
 #endif
 
-    if (dataset_ && layer_.is_valid())
+    if (handle_->dataset && handle_->layer.is_valid())
     {
-        std::vector<attribute_descriptor> const& desc_ar = desc_.get_descriptors();
-        // feature context (schema)
-        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        std::shared_ptr<ogr_handle> h = handle();
+        OGRLayer* layer = h->layer.layer();
 
-        std::vector<attribute_descriptor>::const_iterator itr = desc_ar.begin();
-        std::vector<attribute_descriptor>::const_iterator end = desc_ar.end();
-        for (; itr!=end; ++itr) ctx->push(itr->get_name());
-
-        OGRLayer* layer = layer_.layer();
+        // feature context (schema) of every field
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        std::vector<std::string> names;
+        for (attribute_descriptor const& attr : desc_.get_descriptors())
+        {
+            names.push_back(attr.get_name());
+        }
+        std::vector<int> fields = project_fields(layer, names, ctx);
 
         if (indexed_)
         {
             filter_at_point filter(pt, tol);
 
             return featureset_ptr(new ogr_index_featureset<filter_at_point> (ctx,
-                                                                             *layer,
+                                                                             h,
+                                                                             fields,
                                                                              filter,
                                                                              index_name_,
                                                                              desc_.get_encoding()));
@@ -579,8 +670,11 @@ featureset_ptr ogr_datasource::features_at_point(coord2d const& pt, double tol)
         {
             mapnik::box2d<double> bbox(pt, pt);
             bbox.pad(tol);
+            // don't inherit the filter of the last features() call
+            layer->SetAttributeFilter(nullptr);
             return featureset_ptr(new ogr_featureset (ctx,
-                                                      *layer,
+                                                      h,
+                                                      fields,
                                                       bbox,
                                                       desc_.get_encoding()));
         }
@@ -31,6 +31,7 @@
 #include <mapnik/box2d.hpp>
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/per_thread_pool.hpp>
 
 // boost
 #include <boost/optional.hpp>
@@ -59,15 +60,27 @@ public:
 
 private:
     void init(mapnik::parameters const& params);
+    gdal_dataset_type open_dataset() const;
+    // reopens the dataset and selects the layer init() selected
+    std::shared_ptr<ogr_handle> open_handle() const;
+    // a handle no featureset is reading from, owned by the calling
+    // thread, so concurrent queries don't share a layer cursor
+    std::shared_ptr<ogr_handle> handle() const;
+
     mapnik::box2d<double> extent_;
     mapnik::datasource::datasource_t type_;
     std::string dataset_name_;
+    std::string driver_;
     std::string index_name_;
-    gdal_dataset_type dataset_;
-    ogr_layer_ptr layer_;
+    std::shared_ptr<ogr_handle> handle_;
     std::string layer_name_;
+    int layer_index_;
+    std::string layer_sql_;
     mapnik::layer_descriptor desc_;
     bool indexed_;
+#ifdef MAPNIK_THREADSAFE
+    mutable mapnik::per_thread_pool<ogr_handle> handles_;
+#endif
 };
 
 #endif // OGR_DATASOURCE_HPP
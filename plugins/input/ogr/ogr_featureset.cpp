@@ -46,12 +46,15 @@ using mapnik::feature_factory;
 
 
 ogr_featureset::ogr_featureset(mapnik::context_ptr const & ctx,
-                               OGRLayer & layer,
+                               std::shared_ptr<ogr_handle> const& handle,
+                               std::vector<int> const& fields,
                                OGRGeometry & extent,
                                std::string const& encoding)
     : ctx_(ctx),
-      layer_(layer),
-      layerdef_(layer.GetLayerDefn()),
+      handle_(handle),
+      layer_(*handle->layer.layer()),
+      layerdef_(layer_.GetLayerDefn()),
+      fields_(fields),
       tr_(new transcoder(encoding)),
       fidcolumn_(layer_.GetFIDColumn ()),
       count_(0)
@@ -61,12 +64,15 @@ ogr_featureset::ogr_featureset(mapnik::context_ptr const & ctx,
 }
 
 ogr_featureset::ogr_featureset(mapnik::context_ptr const& ctx,
-                               OGRLayer & layer,
+                               std::shared_ptr<ogr_handle> const& handle,
+                               std::vector<int> const& fields,
                                mapnik::box2d<double> const& extent,
                                std::string const& encoding)
     : ctx_(ctx),
-      layer_(layer),
-      layerdef_(layer.GetLayerDefn()),
+      handle_(handle),
+      layer_(*handle->layer.layer()),
+      layerdef_(layer_.GetLayerDefn()),
+      fields_(fields),
       tr_(new transcoder(encoding)),
       fidcolumn_(layer_.GetFIDColumn()), // TODO - unused
       count_(0)
@@ -101,7 +107,7 @@ feature_ptr ogr_featureset::next()
         OGRGeometry* geom = poFeature->GetGeometryRef();
         if (geom && ! geom->IsEmpty())
         {
-            ogr_converter::convert_geometry(geom, feature);
+            converter_.convert_geometry(geom, feature);
         }
         else
         {
@@ -113,31 +119,31 @@ feature_ptr ogr_featureset::next()
 
         ++count_;
 
-        int fld_count = layerdef_->GetFieldCount();
-        for (int i = 0; i < fld_count; i++)
+        std::size_t fld_count = fields_.size();
+        for (std::size_t i = 0; i < fld_count; ++i)
         {
-            OGRFieldDefn* fld = layerdef_->GetFieldDefn(i);
+            int fld_index = fields_[i];
+            OGRFieldDefn* fld = layerdef_->GetFieldDefn(fld_index);
             const OGRFieldType type_oid = fld->GetType();
-            const std::string fld_name = fld->GetNameRef();
 
             switch (type_oid)
             {
             case OFTInteger:
             {
-                feature->put<mapnik::value_integer>( fld_name, poFeature->GetFieldAsInteger(i));
+                feature->put(i, mapnik::value_integer(poFeature->GetFieldAsInteger(fld_index)));
                 break;
             }
 
             case OFTReal:
             {
-                feature->put( fld_name, poFeature->GetFieldAsDouble(i));
+                feature->put(i, mapnik::value_double(poFeature->GetFieldAsDouble(fld_index)));
                 break;
             }
 
             case OFTString:
             case OFTWideString:     // deprecated !
             {
-                feature->put( fld_name, tr_->transcode(poFeature->GetFieldAsString(i)));
+                feature->put(i, tr_->transcode(poFeature->GetFieldAsString(fld_index)));
                 break;
             }
 
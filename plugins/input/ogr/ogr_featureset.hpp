@@ -29,22 +29,27 @@
 #include <mapnik/unicode.hpp>
 #include <mapnik/geom_util.hpp>
 
-// boost
-
+// stl
+#include <memory>
+#include <vector>
 
 // ogr
 #include <ogrsf_frmts.h>
+#include "ogr_converter.hpp"
+#include "ogr_layer_ptr.hpp"
 
 class ogr_featureset : public mapnik::Featureset
 {
 public:
     ogr_featureset(mapnik::context_ptr const& ctx,
-                   OGRLayer & layer,
+                   std::shared_ptr<ogr_handle> const& handle,
+                   std::vector<int> const& fields,
                    OGRGeometry & extent,
                    std::string const& encoding);
 
     ogr_featureset(mapnik::context_ptr const& ctx,
-                   OGRLayer & layer,
+                   std::shared_ptr<ogr_handle> const& handle,
+                   std::vector<int> const& fields,
                    mapnik::box2d<double> const& extent,
                    std::string const& encoding);
 
@@ -52,8 +57,13 @@ public:
     mapnik::feature_ptr next();
 private:
     mapnik::context_ptr ctx_;
+    // keeps the layer open and out of the handle pool while read from
+    std::shared_ptr<ogr_handle> handle_;
     OGRLayer& layer_;
     OGRFeatureDefn* layerdef_;
+    // OGR field index of each context field
+    std::vector<int> fields_;
+    ogr_converter converter_;
     const std::unique_ptr<mapnik::transcoder> tr_;
     const char* fidcolumn_;
     mutable int count_;
@@ -53,13 +53,16 @@ using mapnik::feature_factory;
 
 template <typename filterT>
 ogr_index_featureset<filterT>::ogr_index_featureset(mapnik::context_ptr const & ctx,
-                                                    OGRLayer & layer,
+                                                    std::shared_ptr<ogr_handle> const& handle,
+                                                    std::vector<int> const& fields,
                                                     filterT const& filter,
                                                     std::string const& index_file,
                                                     std::string const& encoding)
     : ctx_(ctx),
-      layer_(layer),
-      layerdef_(layer.GetLayerDefn()),
+      handle_(handle),
+      layer_(*handle->layer.layer()),
+      layerdef_(layer_.GetLayerDefn()),
+      fields_(fields),
       filter_(filter),
       tr_(new transcoder(encoding)),
       fidcolumn_(layer_.GetFIDColumn()),
@@ -120,7 +123,7 @@ feature_ptr ogr_index_featureset<filterT>::next()
             geom->getEnvelope(&feature_envelope_);
             if (!filter_.pass(mapnik::box2d<double>(feature_envelope_.MinX,feature_envelope_.MinY,
                                             feature_envelope_.MaxX,feature_envelope_.MaxY))) continue;
-            ogr_converter::convert_geometry (geom, feature);
+            converter_.convert_geometry (geom, feature);
         }
         else
         {
@@ -130,31 +133,31 @@ feature_ptr ogr_index_featureset<filterT>::next()
             continue;
         }
 
-        int fld_count = layerdef_->GetFieldCount();
-        for (int i = 0; i < fld_count; i++)
+        std::size_t fld_count = fields_.size();
+        for (std::size_t i = 0; i < fld_count; ++i)
         {
-            OGRFieldDefn* fld = layerdef_->GetFieldDefn (i);
+            int fld_index = fields_[i];
+            OGRFieldDefn* fld = layerdef_->GetFieldDefn(fld_index);
             OGRFieldType type_oid = fld->GetType ();
-            std::string fld_name = fld->GetNameRef ();
 
             switch (type_oid)
             {
             case OFTInteger:
             {
-                feature->put<mapnik::value_integer>(fld_name,poFeature->GetFieldAsInteger (i));
+                feature->put(i, mapnik::value_integer(poFeature->GetFieldAsInteger(fld_index)));
                 break;
             }
 
             case OFTReal:
             {
-                feature->put(fld_name,poFeature->GetFieldAsDouble (i));
+                feature->put(i, mapnik::value_double(poFeature->GetFieldAsDouble(fld_index)));
                 break;
             }
 
             case OFTString:
             case OFTWideString:     // deprecated !
             {
-                feature->put(fld_name,tr_->transcode(poFeature->GetFieldAsString (i)));
+                feature->put(i, tr_->transcode(poFeature->GetFieldAsString(fld_index)));
                 break;
             }
 
@@ -34,7 +34,8 @@ class ogr_index_featureset : public mapnik::Featureset
 {
 public:
     ogr_index_featureset(mapnik::context_ptr const& ctx,
-                         OGRLayer& layer,
+                         std::shared_ptr<ogr_handle> const& handle,
+                         std::vector<int> const& fields,
                          filterT const& filter,
                          std::string const& index_file,
                          std::string const& encoding);
@@ -43,8 +44,11 @@ public:
     mapnik::feature_ptr next();
 private:
     mapnik::context_ptr ctx_;
+    std::shared_ptr<ogr_handle> handle_;
     OGRLayer& layer_;
     OGRFeatureDefn* layerdef_;
+    std::vector<int> fields_;
+    ogr_converter converter_;
     filterT filter_;
     std::vector<int> ids_;
     std::vector<int>::iterator itr_;
@@ -25,6 +25,7 @@
 
 // mapnik
 #include <mapnik/debug.hpp>
+#include <mapnik/noncopyable.hpp>
 
 // stl
 #include <stdexcept>
@@ -193,4 +194,32 @@ private:
     bool is_valid_;
 };
 
+// A dataset with a layer selected on it. OGR keeps the read cursor and
+// the filters in the layer, so each concurrent reader needs its own.
+struct ogr_handle : private mapnik::noncopyable
+{
+    ogr_handle()
+        : dataset(nullptr),
+          layer()
+    {
+    }
+
+    ~ogr_handle()
+    {
+        // free layer before destroying the datasource
+        layer.free_layer();
+        if (dataset != nullptr)
+        {
+#if GDAL_VERSION_MAJOR >= 2
+            GDALClose(( GDALDatasetH) dataset);
+#else
+            OGRDataSource::DestroyDataSource (dataset);
+#endif
+        }
+    }
+
+    gdal_dataset_type dataset;
+    ogr_layer_ptr layer;
+};
+
 #endif // OGR_LAYER_PTR_HPP
@@ -31,6 +31,7 @@
 #include <mapnik/global.hpp>
 #include <mapnik/boolean.hpp>
 #include <mapnik/sql_utils.hpp>
+#include <mapnik/sql_filter.hpp>
 #include <mapnik/util/conversions.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/value_types.hpp>
@@ -550,10 +551,12 @@ std::string postgis_datasource::populate_tokens(
                                 box2d<double> const& env,
                                 double pixel_width,
                                 double pixel_height,
-                                mapnik::attributes const& vars) const
+                                mapnik::attributes const& vars,
+                                std::string const& filter_sql) const
 {
     std::string populated_sql = sql;
     std::string box = sql_bbox(env);
+    bool has_where = false;
 
     if (boost::algorithm::icontains(populated_sql, scale_denom_token_))
     {
@@ -587,6 +590,7 @@ std::string postgis_datasource::populate_tokens(
         if (intersect_min_scale_ > 0 && (scale_denom <= intersect_min_scale_))
         {
             s << " WHERE ST_Intersects(\"" << geometryColumn_ << "\"," << box << ")";
+            has_where = true;
         }
         else if (intersect_max_scale_ > 0 && (scale_denom >= intersect_max_scale_))
         {
@@ -595,6 +599,7 @@ std::string postgis_datasource::populate_tokens(
         else
         {
             s << " WHERE \"" << geometryColumn_ << "\" && " << box;
+            has_where = true;
         }
         populated_sql += s.str();
     }
@@ -616,6 +621,13 @@ std::string postgis_datasource::populate_tokens(
             }
         }
     }
+    // appended after the variable substitution, string literals in the
+    // filter may contain '@'
+    if (!filter_sql.empty())
+    {
+        populated_sql += has_where ? " AND " : " WHERE ";
+        populated_sql += filter_sql;
+    }
     return populated_sql;
 }
 
@@ -812,7 +824,9 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             }
         }
 
-        std::string table_with_bbox = populate_tokens(table_, scale_denom, box, px_gw, px_gh, q.variables());
+        boost::optional<std::string> filter_sql = mapnik::sql_utils::filters_to_sql(q.filters(), desc_);
+        std::string table_with_bbox = populate_tokens(table_, scale_denom, box, px_gw, px_gh, q.variables(),
+                                                      filter_sql ? *filter_sql : std::string());
 
         s << " FROM " << table_with_bbox;
 
@@ -51,11 +51,24 @@ raster_featureset<LookupPolicy>::raster_featureset(LookupPolicy const& policy,
       ctx_(std::make_shared<mapnik::context_type>()),
       extent_(extent),
       bbox_(q.get_bbox()),
+      resolution_(q.resolution()),
       curIter_(policy_.begin()),
       endIter_(policy_.end())
 {
 }
 
+template <typename LookupPolicy>
+unsigned raster_featureset<LookupPolicy>::max_reduction(int image_width, int image_height) const
+{
+    if (std::get<0>(resolution_) <= 0 || std::get<1>(resolution_) <= 0) return 1;
+    // image pixels per output pixel
+    double ratio_x = image_width / (extent_.width() * std::get<0>(resolution_));
+    double ratio_y = image_height / (extent_.height() * std::get<1>(resolution_));
+    double ratio = std::min(ratio_x, ratio_y);
+    if (!(ratio >= 2.0)) return 1;
+    return static_cast<unsigned>(std::min(ratio, 256.0));
+}
+
 template <typename LookupPolicy>
 raster_featureset<LookupPolicy>::~raster_featureset()
 {
@@ -103,6 +116,17 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                             end_x = image_width;
                         if (end_y > image_height)
                             end_y = image_height;
+                        // decode at a reduced size when the output is much coarser than the image,
+                        // snapping the window to whole reduced pixels
+                        unsigned factor = reader->reduction(max_reduction(image_width, image_height));
+                        if (factor > 1)
+                        {
+                            int f = static_cast<int>(factor);
+                            x_off = (x_off / f) * f;
+                            y_off = (y_off / f) * f;
+                            end_x = ((end_x + f - 1) / f) * f;
+                            end_y = ((end_y + f - 1) / f) * f;
+                        }
                         int width = end_x - x_off;
                         int height = end_y - y_off;
 
@@ -113,8 +137,15 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                                                             rem.maxy() + y_off + height);
                         intersect = t.backward(feature_raster_extent);
 
-                        mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, width, height, 1.0);
-                        reader->read(x_off, y_off, raster->data_);
+                        mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, width / factor, height / factor, 1.0);
+                        if (factor > 1)
+                        {
+                            reader->read_reduced(x_off / factor, y_off / factor, factor, raster->data_);
+                        }
+                        else
+                        {
+                            reader->read(x_off, y_off, raster->data_);
+                        }
                         raster->premultiplied_alpha_ = reader->premultiplied_alpha();
                         feature->set_raster(raster);
                     }
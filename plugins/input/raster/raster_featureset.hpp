@@ -314,11 +314,15 @@ public:
     mapnik::feature_ptr next();
 
 private:
+    // largest factor the image can be shrunk by without dropping below the query resolution
+    unsigned max_reduction(int image_width, int image_height) const;
+
     LookupPolicy policy_;
     mapnik::value_integer feature_id_;
     mapnik::context_ptr ctx_;
     mapnik::box2d<double> extent_;
     mapnik::box2d<double> bbox_;
+    mapnik::query::resolution_type resolution_;
     iterator_type curIter_;
     iterator_type endIter_;
 };
@@ -25,11 +25,17 @@
 
 // stl
 #include <string.h>
+#include <map>
+#include <vector>
 
 // mapnik
 #include <mapnik/datasource.hpp>
 #include <mapnik/params.hpp>
 #include <mapnik/timer.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <mapnik/unique_lock.hpp>
+#include <mutex>
+#endif
 
 // boost
 #include <memory>
@@ -45,7 +51,7 @@ extern "C" {
 
 //==============================================================================
 
-class sqlite_connection
+class sqlite_connection : public std::enable_shared_from_this<sqlite_connection>
 {
 public:
 
@@ -94,6 +100,13 @@ public:
 
     virtual ~sqlite_connection ()
     {
+        for (auto & item : cached_)
+        {
+            for (sqlite3_stmt* stmt : item.second)
+            {
+                sqlite3_finalize (stmt);
+            }
+        }
         if (db_)
         {
             sqlite3_close (db_);
@@ -128,7 +141,47 @@ public:
             throw_sqlite_error(sql);
         }
 
-        return std::make_shared<sqlite_resultset>(stmt);
+        // keep the connection open for as long as the statement lives
+        std::shared_ptr<sqlite_connection> self = shared_from_this();
+        return std::make_shared<sqlite_resultset>(stmt, [self](sqlite3_stmt* released)
+        {
+            sqlite3_finalize (released);
+        });
+    }
+
+    // Like execute_query, but the statement is kept when the resultset is
+    // released and handed out again for the next query with the same sql,
+    // with its parameters cleared. The connection must be shared_ptr owned.
+    std::shared_ptr<sqlite_resultset> execute_cached_query(std::string const& sql)
+    {
+        sqlite3_stmt* stmt = 0;
+        {
+#ifdef MAPNIK_THREADSAFE
+            mapnik::scoped_lock lock(cached_mutex_);
+#endif
+            auto itr = cached_.find(sql);
+            if (itr != cached_.end() && !itr->second.empty())
+            {
+                stmt = itr->second.back();
+                itr->second.pop_back();
+            }
+        }
+        if (!stmt)
+        {
+#ifdef MAPNIK_STATS
+            mapnik::progress_timer __stats__(std::clog, std::string("sqlite_resultset::execute_cached_query ") + sql);
+#endif
+            const int rc = sqlite3_prepare_v2 (db_, sql.c_str(), -1, &stmt, 0);
+            if (rc != SQLITE_OK)
+            {
+                throw_sqlite_error(sql);
+            }
+        }
+        std::shared_ptr<sqlite_connection> self = shared_from_this();
+        return std::make_shared<sqlite_resultset>(stmt, [self, sql](sqlite3_stmt* released)
+        {
+            self->release_cached(sql, released);
+        });
     }
 
     void execute(std::string const& sql)
@@ -168,8 +221,22 @@ public:
 
 private:
 
+    void release_cached(std::string const& sql, sqlite3_stmt* stmt)
+    {
+        sqlite3_reset (stmt);
+        sqlite3_clear_bindings (stmt);
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(cached_mutex_);
+#endif
+        cached_[sql].push_back(stmt);
+    }
+
     sqlite3* db_;
     std::string file_;
+    std::map<std::string, std::vector<sqlite3_stmt*> > cached_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex cached_mutex_;
+#endif
 };
 
 #endif // MAPNIK_SQLITE_CONNECTION_HPP
@@ -29,11 +29,14 @@
 #include <mapnik/debug.hpp>
 #include <mapnik/boolean.hpp>
 #include <mapnik/sql_utils.hpp>
+#include <mapnik/sql_filter.hpp>
 #include <mapnik/util/geometry_to_ds_type.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/wkb.hpp>
 #include <mapnik/util/trim.hpp>
 #include <mapnik/util/fs.hpp>
+#ifdef MAPNIK_THREADSAFE
+#endif
 
 // boost
 #include <boost/algorithm/string.hpp>
@@ -130,16 +133,37 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
     {
         parse_attachdb(*attachdb);
     }
+    // only the attach statements are replayed on other connections
+    std::size_t attach_statements = init_statements_.size();
 
+    // initdb runs once, and what it creates (temp tables, rows in
+    // attached in-memory databases) only exists on dataset_
     boost::optional<std::string> initdb = params.get<std::string>("initdb");
     if (initdb)
     {
         init_statements_.push_back(*initdb);
     }
+    shared_connection_ = initdb || dataset_name_.compare(":memory:") == 0;
 
     // now actually create the connection and start executing setup sql
     dataset_ = std::make_shared<sqlite_connection>(dataset_name_);
 
+    // page cache settings, see https://www.sqlite.org/pragma.html
+    boost::optional<mapnik::value_integer> mmap_size = params.get<mapnik::value_integer>("mmap_size");
+    if (mmap_size)
+    {
+        connection_statements_.push_back("PRAGMA mmap_size=" + std::to_string(*mmap_size));
+    }
+    boost::optional<mapnik::value_integer> cache_size = params.get<mapnik::value_integer>("cache_size");
+    if (cache_size)
+    {
+        connection_statements_.push_back("PRAGMA cache_size=" + std::to_string(*cache_size));
+    }
+    for (std::string const& sql : connection_statements_)
+    {
+        dataset_->execute(sql);
+    }
+
     boost::optional<mapnik::value_integer> table_by_index = params.get<mapnik::value_integer>("table_by_index");
 
     int passed_parameters = 0;
@@ -198,12 +222,12 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
     }
 
     // Execute init_statements_
-    for (std::vector<std::string>::const_iterator iter = init_statements_.begin();
-         iter != init_statements_.end(); ++iter)
+    for (std::size_t i = 0; i < init_statements_.size(); ++i)
     {
-        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: Execute init sql=" << *iter;
+        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: Execute init sql=" << init_statements_[i];
 
-        dataset_->execute(*iter);
+        dataset_->execute(init_statements_[i]);
+        if (i < attach_statements) connection_statements_.push_back(init_statements_[i]);
     }
 
     bool found_types_via_subquery = false;
@@ -324,6 +348,11 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
         }
     }
 
+    if (has_spatial_index_ && mapnik::util::exists(index_db))
+    {
+        connection_statements_.push_back("attach database '" + index_db + "' as " + index_table_);
+    }
+
     if (! extent_initialized_)
     {
 #ifdef MAPNIK_STATS
@@ -353,6 +382,30 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
 
 }
 
+std::shared_ptr<sqlite_connection> sqlite_datasource::connection() const
+{
+#ifdef MAPNIK_THREADSAFE
+    if (shared_connection_) return dataset_;
+    return connections_.local([this]
+    {
+        // with a private page cache: connections sharing one serialize on it
+        int flags = SQLITE_OPEN_READWRITE;
+#if SQLITE_VERSION_NUMBER >= 3006018
+        flags |= SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE;
+#endif
+        std::shared_ptr<sqlite_connection> conn = std::make_shared<sqlite_connection>(dataset_name_, flags);
+        sqlite3_busy_timeout(*(*conn), 5000);
+        for (std::string const& sql : connection_statements_)
+        {
+            conn->execute(sql);
+        }
+        return conn;
+    });
+#else
+    return dataset_;
+#endif
+}
+
 std::string sqlite_datasource::populate_tokens(std::string const& sql) const
 {
     std::string populated_sql = sql;
@@ -504,23 +557,36 @@ featureset_ptr sqlite_datasource::features(query const& q) const
         s << " FROM ";
 
         std::string query(table_);
+        bool has_where = false;
 
         if (! key_field_.empty() && has_spatial_index_)
         {
             // TODO - debug warn if fails
-            sqlite_utils::apply_spatial_filter(query,
-                                               e,
-                                               table_,
-                                               key_field_,
-                                               index_table_,
-                                               geometry_table_,
-                                               intersects_token_);
+            has_where = sqlite_utils::apply_spatial_filter(query,
+                                                           e,
+                                                           table_,
+                                                           key_field_,
+                                                           index_table_,
+                                                           geometry_table_,
+                                                           intersects_token_,
+                                                           true);
         }
         else
         {
             query = populate_tokens(table_);
         }
 
+        // only plain tables: where a WHERE would land in a subquery is unknown
+        if (!using_subquery_)
+        {
+            boost::optional<std::string> filter_sql = mapnik::sql_utils::filters_to_sql(q.filters(), desc_);
+            if (filter_sql)
+            {
+                query += has_where ? " AND " : " WHERE ";
+                query += *filter_sql;
+            }
+        }
+
         s << query ;
 
         if (row_limit_ > 0)
@@ -535,7 +601,20 @@ featureset_ptr sqlite_datasource::features(query const& q) const
 
         MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        std::shared_ptr<sqlite_resultset> rs;
+        if (has_where)
+        {
+            // only the extent changes between renders of a layer
+            rs = connection()->execute_cached_query(s.str());
+            rs->bind_double(1, e.minx());
+            rs->bind_double(2, e.maxx());
+            rs->bind_double(3, e.miny());
+            rs->bind_double(4, e.maxy());
+        }
+        else
+        {
+            rs = connection()->execute_query(s.str());
+        }
 
         return std::make_shared<sqlite_featureset>(rs,
                                                      ctx,
@@ -616,7 +695,7 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
 
         MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        std::shared_ptr<sqlite_resultset> rs(connection()->execute_query(s.str()));
 
         return std::make_shared<sqlite_featureset>(rs,
                                                      ctx,
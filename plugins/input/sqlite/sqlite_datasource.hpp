@@ -33,6 +33,7 @@
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/wkb.hpp>
 #include <mapnik/value_types.hpp>
+#include <mapnik/per_thread_pool.hpp>
 
 // boost
 #include <boost/optional.hpp>
@@ -63,6 +64,9 @@ private:
     // needed to attach auxillary databases
     void parse_attachdb(std::string const& attachdb) const;
     std::string populate_tokens(std::string const& sql) const;
+    // connection for the calling thread, so concurrent queries don't
+    // share one sqlite handle unless shared_connection_ is set
+    std::shared_ptr<sqlite_connection> connection() const;
 
     mapnik::box2d<double> extent_;
     bool extent_initialized_;
@@ -85,7 +89,15 @@ private:
     bool use_spatial_index_;
     bool has_spatial_index_;
     bool using_subquery_;
+    // initdb and in-memory databases leave state only dataset_ has, so
+    // those datasources query dataset_ from every thread
+    bool shared_connection_;
     mutable std::vector<std::string> init_statements_;
+    // pragmas and attached databases, replayed on every connection
+    std::vector<std::string> connection_statements_;
+#ifdef MAPNIK_THREADSAFE
+    mutable mapnik::per_thread_pool<sqlite_connection> connections_;
+#endif
 };
 
 #endif // MAPNIK_SQLITE_DATASOURCE_HPP
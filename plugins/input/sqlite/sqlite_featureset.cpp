@@ -56,8 +56,35 @@ sqlite_featureset::sqlite_featureset(std::shared_ptr<sqlite_resultset> rs,
       bbox_(bbox),
       format_(format),
       spatial_index_(spatial_index),
-      using_subquery_(using_subquery)
-{}
+      using_subquery_(using_subquery),
+      columns_()
+{
+    // the first two columns are the geometry and the feature id
+    int count = rs_->is_valid() ? rs_->column_count() : 0;
+    for (int i = 2; i < count; ++i)
+    {
+        int index = -1;
+        const char* fld_name = rs_->column_name(i);
+        if (fld_name)
+        {
+            std::string fld_name_str(fld_name);
+            // subqueries in sqlite lead to field double quoting which we need to strip
+            if (using_subquery_)
+            {
+                sqlite_utils::dequote(fld_name_str);
+            }
+            for (auto const& item : *ctx_)
+            {
+                if (item.first == fld_name_str)
+                {
+                    index = static_cast<int>(item.second);
+                    break;
+                }
+            }
+        }
+        columns_.push_back(index);
+    }
+}
 
 sqlite_featureset::~sqlite_featureset() {}
 
@@ -90,33 +117,26 @@ feature_ptr sqlite_featureset::next()
                 continue;
         }
 
-        for (int i = 2; i < rs_->column_count(); ++i)
+        for (std::size_t col = 0; col < columns_.size(); ++col)
         {
-            const int type_oid = rs_->column_type(i);
-            const char* fld_name = rs_->column_name(i);
-
-            if (! fld_name)
+            if (columns_[col] < 0)
                 continue;
 
-            std::string fld_name_str(fld_name);
-
-            // subqueries in sqlite lead to field double quoting which we need to strip
-            if (using_subquery_)
-            {
-                sqlite_utils::dequote(fld_name_str);
-            }
+            const int i = static_cast<int>(col) + 2;
+            const std::size_t index = static_cast<std::size_t>(columns_[col]);
+            const int type_oid = rs_->column_type(i);
 
             switch (type_oid)
             {
             case SQLITE_INTEGER:
             {
-                feature->put<mapnik::value_integer>(fld_name_str, rs_->column_integer64(i));
+                feature->put(index, mapnik::value(static_cast<mapnik::value_integer>(rs_->column_integer64(i))));
                 break;
             }
 
             case SQLITE_FLOAT:
             {
-                feature->put(fld_name_str, rs_->column_double(i));
+                feature->put(index, mapnik::value(rs_->column_double(i)));
                 break;
             }
 
@@ -124,7 +144,7 @@ feature_ptr sqlite_featureset::next()
             {
                 int text_col_size;
                 const char * text_data = rs_->column_text(i, text_col_size);
-                feature->put(fld_name_str, tr_->transcode(text_data, text_col_size));
+                feature->put(index, mapnik::value(tr_->transcode(text_data, text_col_size)));
                 break;
             }
 
@@ -139,7 +159,7 @@ feature_ptr sqlite_featureset::next()
                 break;
 
             default:
-                MAPNIK_LOG_WARN(sqlite) << "sqlite_featureset: Field=" << fld_name_str << " unhandled type_oid=" << type_oid;
+                MAPNIK_LOG_WARN(sqlite) << "sqlite_featureset: Field=" << rs_->column_name(i) << " unhandled type_oid=" << type_oid;
                 break;
             }
         }
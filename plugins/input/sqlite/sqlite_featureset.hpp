@@ -31,6 +31,7 @@
 // boost
 
 #include <memory>
+#include <vector>
 
 // sqlite
 #include "sqlite_resultset.hpp"
@@ -57,7 +58,8 @@ private:
     mapnik::wkbFormat format_;
     bool spatial_index_;
     bool using_subquery_;
-
+    // context index of each attribute column, or -1 to skip it
+    std::vector<int> columns_;
 };
 
 #endif // MAPNIK_SQLITE_FEATURESET_HPP
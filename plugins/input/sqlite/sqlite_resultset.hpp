@@ -30,6 +30,7 @@
 
 // stl
 #include <string.h>
+#include <functional>
 
 // sqlite
 extern "C" {
@@ -44,8 +45,18 @@ class sqlite_resultset
 {
 public:
 
+    using release_type = std::function<void(sqlite3_stmt*)>;
+
     sqlite_resultset (sqlite3_stmt* stmt)
-        : stmt_(stmt)
+        : stmt_(stmt),
+          release_()
+    {
+    }
+
+    // `release` takes the statement back instead of it being finalized
+    sqlite_resultset (sqlite3_stmt* stmt, release_type const& release)
+        : stmt_(stmt),
+          release_(release)
     {
     }
 
@@ -53,7 +64,22 @@ public:
     {
         if (stmt_)
         {
-            sqlite3_finalize (stmt_);
+            if (release_)
+            {
+                release_(stmt_);
+            }
+            else
+            {
+                sqlite3_finalize (stmt_);
+            }
+        }
+    }
+
+    void bind_double (int index, double val)
+    {
+        if (sqlite3_bind_double (stmt_, index, val) != SQLITE_OK)
+        {
+            throw mapnik::datasource_exception("SQLite Plugin: binding query parameter failed");
         }
     }
 
@@ -140,6 +166,7 @@ public:
 private:
 
     sqlite3_stmt* stmt_;
+    release_type release_;
 };
 
 #endif // MAPNIK_SQLITE_RESULTSET_HPP
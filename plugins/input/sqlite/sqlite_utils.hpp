@@ -109,19 +109,29 @@ public:
         //}
     }
 
+    // With `bind_bbox` the extent is left as parameters ?1 to ?4 (minx,
+    // maxx, miny, maxy) so the statement can be reused for other extents.
     static bool apply_spatial_filter(std::string & query,
                                      mapnik::box2d<double> const& e,
                                      std::string const& table,
                                      std::string const& key_field,
                                      std::string const& index_table,
                                      std::string const& geometry_table,
-                                     std::string const& intersects_token)
+                                     std::string const& intersects_token,
+                                     bool bind_bbox = false)
     {
         std::ostringstream spatial_sql;
         spatial_sql << std::setprecision(16);
         spatial_sql << key_field << " IN (SELECT pkid FROM " << index_table;
-        spatial_sql << " WHERE xmax>=" << e.minx() << " AND xmin<=" << e.maxx() ;
-        spatial_sql << " AND ymax>=" << e.miny() << " AND ymin<=" << e.maxy() << ")";
+        if (bind_bbox)
+        {
+            spatial_sql << " WHERE xmax>=?1 AND xmin<=?2 AND ymax>=?3 AND ymin<=?4)";
+        }
+        else
+        {
+            spatial_sql << " WHERE xmax>=" << e.minx() << " AND xmin<=" << e.maxx() ;
+            spatial_sql << " AND ymax>=" << e.miny() << " AND ymin<=" << e.maxy() << ")";
+        }
         if (boost::algorithm::ifind_first(query,  intersects_token))
         {
             boost::algorithm::ireplace_all(query, intersects_token, spatial_sql.str());
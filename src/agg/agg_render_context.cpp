@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/agg_render_context.hpp>
+#include <mapnik/agg_rasterizer.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/label_collision_detector.hpp>
+
+// agg
+#include "agg_scanline_u.h"
+
+// stl
+#include <stdexcept>
+
+namespace mapnik {
+
+agg_render_context::agg_render_context()
+    : rasterizer_(std::make_shared<rasterizer>()),
+      scanline_(std::make_shared<agg::scanline_u8>()),
+      style_buffer_(),
+      style_buffer_dirty_(),
+      detector_(),
+      in_use_(false) {}
+
+agg_render_context::~agg_render_context() {}
+
+std::shared_ptr<label_collision_detector4> const& agg_render_context::detector(box2d<double> const& extent)
+{
+    if (in_use_)
+    {
+        throw std::runtime_error("agg_render_context: already in use by another renderer");
+    }
+    // a detector still held from an earlier render, e.g. by a caller
+    // that passed it to another renderer, is left alone
+    if (!detector_ || detector_.use_count() > 1)
+    {
+        detector_ = std::make_shared<label_collision_detector4>(extent);
+    }
+    else
+    {
+        detector_->reset(extent);
+    }
+    return detector_;
+}
+
+agg_render_context_pool::agg_render_context_pool()
+    : contexts_() {}
+
+std::shared_ptr<agg_render_context> agg_render_context_pool::local()
+{
+    return contexts_.local([] { return std::make_shared<agg_render_context>(); });
+}
+
+}
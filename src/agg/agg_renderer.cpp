@@ -22,6 +22,7 @@
 
 // mapnik
 #include <mapnik/agg_renderer.hpp>
+#include <mapnik/agg_render_context.hpp>
 #include <mapnik/agg_rasterizer.hpp>
 #include <mapnik/agg_helpers.hpp>
 #include <mapnik/graphics.hpp>
@@ -58,10 +59,87 @@
 
 // stl
 #include <cmath>
+#include <cstring>
 
 namespace mapnik
 {
 
+namespace detail {
+
+// composite modes that leave the destination untouched wherever the source
+// is fully transparent, so compositing can be limited to the painted region
+inline bool transparent_source_is_noop(composite_mode_e mode)
+{
+    switch (mode)
+    {
+    case dst:
+    case src_over:
+    case dst_over:
+    case src_atop:
+    case _xor:
+    case plus:
+    case minus:
+    case multiply:
+    case screen:
+    case overlay:
+    case darken:
+    case lighten:
+    case color_dodge:
+    case color_burn:
+    case hard_light:
+    case soft_light:
+    case difference:
+    case exclusion:
+    case invert:
+    case invert_rgb:
+    case grain_merge:
+    case linear_dodge:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// bounding box (max exclusive) of the pixels that are not fully zero
+inline box2d<int> painted_extent(image_data_32 const& data)
+{
+    int width = data.width();
+    int height = data.height();
+    int minx = width;
+    int maxx = 0;
+    int miny = -1;
+    int maxy = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        image_data_32::pixel_type const* row = data.getRow(y);
+        int x0 = 0;
+        while (x0 < width && row[x0] == 0) ++x0;
+        if (x0 == width) continue;
+        int x1 = width;
+        while (x1 > x0 && row[x1 - 1] == 0) --x1;
+        if (miny < 0) miny = y;
+        maxy = y + 1;
+        minx = std::min(minx, x0);
+        maxx = std::max(maxx, x1);
+    }
+    if (miny < 0) return box2d<int>();
+    return box2d<int>(minx, miny, maxx, maxy);
+}
+
+inline void clear_extent(image_data_32 & data, box2d<int> const& extent)
+{
+    int x0 = std::max(0, extent.minx());
+    int x1 = std::min(static_cast<int>(data.width()), extent.maxx());
+    int y1 = std::min(static_cast<int>(data.height()), extent.maxy());
+    if (x0 >= x1) return;
+    for (int y = std::max(0, extent.miny()); y < y1; ++y)
+    {
+        std::memset(data.getRow(y) + x0, 0, (x1 - x0) * sizeof(image_data_32::pixel_type));
+    }
+}
+
+}
+
 template <typename T0, typename T1>
 agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
@@ -69,7 +147,12 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, double scale_factor
       internal_buffer_(),
       current_buffer_(&pixmap),
       style_level_compositing_(false),
+      dirty_extent_(),
+      dirty_tracked_(true),
+      sprite_cache_(),
       ras_ptr(new rasterizer),
+      sl_ptr(new agg::scanline_u8),
+      context_(nullptr),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
       common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor)
@@ -84,7 +167,12 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, request const& req, attributes c
       internal_buffer_(),
       current_buffer_(&pixmap),
       style_level_compositing_(false),
+      dirty_extent_(),
+      dirty_tracked_(true),
+      sprite_cache_(),
       ras_ptr(new rasterizer),
+      sl_ptr(new agg::scanline_u8),
+      context_(nullptr),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
       common_(req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
@@ -100,7 +188,12 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
       internal_buffer_(),
       current_buffer_(&pixmap),
       style_level_compositing_(false),
+      dirty_extent_(),
+      dirty_tracked_(true),
+      sprite_cache_(),
       ras_ptr(new rasterizer),
+      sl_ptr(new agg::scanline_u8),
+      context_(nullptr),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
       common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor, detector)
@@ -108,6 +201,34 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
     setup(m);
 }
 
+template <typename T0, typename T1>
+agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, agg_render_context & context,
+                                  double scale_factor, unsigned offset_x, unsigned offset_y)
+    : feature_style_processor<agg_renderer>(m, scale_factor),
+      pixmap_(pixmap),
+      internal_buffer_(context.style_buffer_),
+      current_buffer_(&pixmap),
+      style_level_compositing_(false),
+      dirty_extent_(context.style_buffer_dirty_),
+      dirty_tracked_(true),
+      sprite_cache_(),
+      ras_ptr(context.rasterizer_),
+      sl_ptr(context.scanline_),
+      context_(&context),
+      gamma_method_(GAMMA_POWER),
+      gamma_(1.0),
+      common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor,
+              context.detector(box2d<double>(-m.buffer_size(), -m.buffer_size(),
+                                             m.width() + m.buffer_size(), m.height() + m.buffer_size())))
+{
+    // the last render may have left any fill rule and gamma behind
+    ras_ptr->reset();
+    ras_ptr->filling_rule(agg::fill_non_zero);
+    ras_ptr->gamma(agg::gamma_power());
+    setup(m);
+    context.in_use_ = true;
+}
+
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::setup(Map const &m)
 {
@@ -155,7 +276,15 @@ void agg_renderer<T0,T1>::setup(Map const &m)
 }
 
 template <typename T0, typename T1>
-agg_renderer<T0,T1>::~agg_renderer() {}
+agg_renderer<T0,T1>::~agg_renderer()
+{
+    if (context_)
+    {
+        context_->style_buffer_ = internal_buffer_;
+        context_->style_buffer_dirty_ = dirty_extent_;
+        context_->in_use_ = false;
+    }
+}
 
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::start_map_processing(Map const& map)
@@ -236,26 +365,37 @@ void agg_renderer<T0,T1>::start_style_processing(feature_type_style const& st)
                 internal_buffer_->height() < target_height))
             {
                 internal_buffer_ = std::make_shared<buffer_type>(target_width,target_height);
+                this->record_allocation(target_width * target_height * sizeof(image_data_32::pixel_type));
+                dirty_extent_ = box2d<int>();
             }
             else
             {
-                internal_buffer_->set_background(color(0,0,0,0)); // fill with transparent colour
+                // only the region touched by the previous style needs clearing
+                detail::clear_extent(internal_buffer_->data(), dirty_extent_);
             }
         }
         else
         {
-            if (!internal_buffer_)
+            // a buffer kept in a render context may be from a smaller map
+            if (!internal_buffer_ ||
+               (internal_buffer_->width() < common_.width_ ||
+                internal_buffer_->height() < common_.height_))
             {
                 internal_buffer_ = std::make_shared<buffer_type>(common_.width_,common_.height_);
+                this->record_allocation(common_.width_ * common_.height_ * sizeof(image_data_32::pixel_type));
+                dirty_extent_ = box2d<int>();
             }
             else
             {
-                internal_buffer_->set_background(color(0,0,0,0)); // fill with transparent colour
+                detail::clear_extent(internal_buffer_->data(), dirty_extent_);
             }
             common_.t_.set_offset(0);
             ras_ptr->clip_box(0,0,common_.width_,common_.height_);
         }
         current_buffer_ = internal_buffer_.get();
+        // grown by the mark_* calls as the style's symbolizers draw
+        dirty_extent_ = box2d<int>();
+        dirty_tracked_ = true;
     }
     else
     {
@@ -270,29 +410,86 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
 {
     if (style_level_compositing_)
     {
-        bool blend_from = false;
-        if (st.image_filters().size() > 0)
+        composite_mode_e comp_op = st.comp_op() ? *st.comp_op() : src_over;
+        bool blend_from = st.image_filters().size() > 0;
+        bool local = detail::transparent_source_is_noop(comp_op);
+        int spread = 0;
+        mapnik::filter::filter_spread_visitor spread_visitor(spread);
+        mapnik::filter::filter_region_visitor region_visitor(local);
+        for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
         {
-            blend_from = true;
-            mapnik::filter::filter_visitor<image_32> visitor(*current_buffer_);
-            for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
-            {
-                util::apply_visitor(visitor, filter_tag);
-            }
+            util::apply_visitor(spread_visitor, filter_tag);
+            util::apply_visitor(region_visitor, filter_tag);
         }
-        if (st.comp_op())
+        int width = current_buffer_->width();
+        int height = current_buffer_->height();
+        box2d<int> full_extent(0, 0, width, height);
+        if (!local)
         {
-            composite(pixmap_.data(), current_buffer_->data(),
-                      *st.comp_op(), st.get_opacity(),
-                      -common_.t_.offset(),
-                      -common_.t_.offset(), false);
+            dirty_extent_ = full_extent;
+        }
+        else if (!dirty_tracked_)
+        {
+            // something was drawn without reporting its extent
+            dirty_extent_ = detail::painted_extent(current_buffer_->data());
+        }
+        box2d<int> region = full_extent;
+        if (local && dirty_extent_.valid())
+        {
+            // filters may spread painted pixels by up to `spread`; one more
+            // pixel keeps the region's edges transparent for the kernels'
+            // edge handling
+            int pad = blend_from ? spread + 1 : 0;
+            region.init(std::max(0, dirty_extent_.minx() - pad),
+                        std::max(0, dirty_extent_.miny() - pad),
+                        std::min(width, dirty_extent_.maxx() + pad),
+                        std::min(height, dirty_extent_.maxy() + pad));
         }
-        else if (blend_from || st.get_opacity() < 1.0)
+        if (local && !dirty_extent_.valid())
         {
+            // nothing was drawn and the composite would be a no-op
+        }
+        else if (region == full_extent)
+        {
+            if (blend_from)
+            {
+                mapnik::filter::filter_visitor<image_32> visitor(*current_buffer_);
+                for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
+                {
+                    util::apply_visitor(visitor, filter_tag);
+                }
+            }
             composite(pixmap_.data(), current_buffer_->data(),
-                      src_over, st.get_opacity(),
+                      comp_op, st.get_opacity(),
                       -common_.t_.offset(),
                       -common_.t_.offset(), false);
+            if (blend_from) dirty_extent_ = full_extent;
+        }
+        else
+        {
+            int region_width = region.width();
+            int region_height = region.height();
+            image_32 region_buffer(region_width, region_height);
+            image_data_32 & region_data = region_buffer.data();
+            image_data_32 const& data = current_buffer_->data();
+            for (int y = 0; y < region_height; ++y)
+            {
+                std::memcpy(region_data.getRow(y),
+                            data.getRow(region.miny() + y) + region.minx(),
+                            region_width * sizeof(image_data_32::pixel_type));
+            }
+            if (blend_from)
+            {
+                mapnik::filter::filter_visitor<image_32> visitor(region_buffer);
+                for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
+                {
+                    util::apply_visitor(visitor, filter_tag);
+                }
+            }
+            composite(pixmap_.data(), region_data,
+                      comp_op, st.get_opacity(),
+                      region.minx() - common_.t_.offset(),
+                      region.miny() - common_.t_.offset(), false);
         }
     }
     // apply any 'direct' image filters
@@ -304,6 +501,32 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End processing style";
 }
 
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::mark_rasterized()
+{
+    // cell bounds of what was last added to the rasterizer, max inclusive
+    if (ras_ptr->min_x() > ras_ptr->max_x()) return;
+    mark_dirty(box2d<int>(ras_ptr->min_x(), ras_ptr->min_y(),
+                          ras_ptr->max_x() + 1, ras_ptr->max_y() + 1));
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::mark_dirty(box2d<int> const& extent)
+{
+    if (!style_level_compositing_ || !dirty_tracked_ || !extent.valid()) return;
+    if (dirty_extent_.valid()) dirty_extent_.expand_to_include(extent);
+    else dirty_extent_ = extent;
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::mark_untracked()
+{
+    if (!style_level_compositing_) return;
+    dirty_tracked_ = false;
+    // the whole buffer needs clearing should the style be cut short
+    dirty_extent_ = box2d<int>(0, 0, internal_buffer_->width(), internal_buffer_->height());
+}
+
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
                                     marker const& marker,
@@ -326,7 +549,7 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
         gamma_method_ = GAMMA_POWER;
         gamma_ = 1.0;
     }
-    agg::scanline_u8 sl;
+    agg::scanline_u8 & sl = *sl_ptr;
     agg::rendering_buffer buf(current_buffer_->raw_data(),
                               current_buffer_->width(),
                               current_buffer_->height(),
@@ -360,6 +583,8 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
         mtx.tx = std::floor(mtx.tx+.5);
         mtx.ty = std::floor(mtx.ty+.5);
         svg_renderer.render(*ras_ptr, sl, renb, mtx, opacity, bbox);
+        // each path is rasterized on its own, with strokes past the bbox
+        mark_untracked();
     }
     else
     {
@@ -373,11 +598,11 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
         {
             double cx = 0.5 * width;
             double cy = 0.5 * height;
+            int x0 = static_cast<int>(std::floor(pos.x - cx + .5));
+            int y0 = static_cast<int>(std::floor(pos.y - cy + .5));
             composite(current_buffer_->data(), **marker.get_bitmap_data(),
-                      comp_op, opacity,
-                      std::floor(pos.x - cx + .5),
-                      std::floor(pos.y - cy + .5),
-                      false);
+                      comp_op, opacity, x0, y0, false);
+            mark_dirty(box2d<int>(x0, y0, x0 + static_cast<int>(width), y0 + static_cast<int>(height)));
         }
         else
         {
@@ -433,6 +658,7 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
             span_gen_type sg(ia, interpolator, filter);
             renderer_type rp(renb,sa, sg, unsigned(opacity*255));
             agg::render_scanlines(*ras_ptr, sl, rp);
+            mark_rasterized();
         }
     }
 }
@@ -490,6 +716,7 @@ void agg_renderer<T0,T1>::debug_draw_box(R& buf, box2d<double> const& box,
     ras_ptr->add_path(sbox);
     ren.color(agg::rgba8_pre(0x33, 0x33, 0xff, 0xcc)); // blue is fine
     agg::render_scanlines(*ras_ptr, sl_line, ren);
+    mark_rasterized();
 }
 
 template <typename T0, typename T1>
@@ -68,7 +68,7 @@ void agg_renderer<T0,T1>::process(building_symbolizer const& sym,
     unsigned b=fill.blue();
     unsigned a=fill.alpha();
     renderer ren(renb);
-    agg::scanline_u8 sl;
+    agg::scanline_u8 & sl = *sl_ptr;
 
     ras_ptr->reset();
     double gamma = get<value_double>(sym, keys::gamma, feature, common_.vars_, 1.0);
@@ -89,6 +89,7 @@ void agg_renderer<T0,T1>::process(building_symbolizer const& sym,
             ras_ptr->add_path(faces_path);
             ren.color(agg::rgba8_pre(int(r*0.8), int(g*0.8), int(b*0.8), int(a * opacity)));
             agg::render_scanlines(*ras_ptr, sl, ren);
+            this->mark_rasterized();
             this->ras_ptr->reset();
         },
         [&,r,g,b,a,opacity](geometry_type &frame) {
@@ -98,6 +99,7 @@ void agg_renderer<T0,T1>::process(building_symbolizer const& sym,
             ras_ptr->add_path(stroke);
             ren.color(agg::rgba8_pre(int(r*0.8), int(g*0.8), int(b*0.8), int(a * opacity)));
             agg::render_scanlines(*ras_ptr, sl, ren);
+            mark_rasterized();
             ras_ptr->reset();
         },
         [&,r,g,b,a,opacity](geometry_type &roof) {
@@ -105,6 +107,7 @@ void agg_renderer<T0,T1>::process(building_symbolizer const& sym,
             ras_ptr->add_path(roof_path);
             ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
             agg::render_scanlines(*ras_ptr, sl, ren);
+            mark_rasterized();
         });
 }
 
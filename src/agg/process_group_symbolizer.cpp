@@ -106,6 +106,8 @@ void agg_renderer<T0,T1>::process(group_symbolizer const& sym,
         sym, feature, common_.vars_, prj_trans, clipping_extent(common_), common_,
         [&](render_thunk_list const& thunks, pixel_position const& render_offset)
         {
+            // text thunks don't report what they draw
+            if (!thunks.empty()) mark_untracked();
             thunk_renderer ren(*this, current_buffer_, common_, render_offset);
             for (render_thunk_ptr const& thunk : thunks)
             {
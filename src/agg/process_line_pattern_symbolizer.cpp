@@ -104,6 +104,8 @@ void  agg_renderer<T0,T1>::process(line_pattern_symbolizer const& sym,
     pattern_type pattern (filter,source);
     renderer_type ren(ren_base, pattern);
     rasterizer_type ras(ren);
+    // the outline renderer draws straight to the buffer
+    mark_untracked();
 
     agg::trans_affine tr;
     auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
@@ -169,6 +169,8 @@ void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
         ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
         rasterizer_type ras(ren);
         set_join_caps_aa(sym, ras, feature, common_.vars_);
+        // the outline renderer draws straight to the buffer
+        mark_untracked();
 
         vertex_converter<box2d<double>, rasterizer_type, line_symbolizer,
                          CoordTransform, proj_transform, agg::trans_affine, conv_types, feature_impl>
@@ -215,9 +217,10 @@ void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
         using renderer_type = agg::renderer_scanline_aa_solid<renderer_base>;
         renderer_type ren(renb);
         ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
-        agg::scanline_u8 sl;
+        agg::scanline_u8 & sl = *sl_ptr;
         ras_ptr->filling_rule(agg::fill_non_zero);
         agg::render_scanlines(*ras_ptr, sl, ren);
+        mark_rasterized();
     }
 }
 
@@ -92,11 +92,13 @@ void agg_renderer<T0,T1>::process(markers_symbolizer const& sym,
     buf_type render_buffer(current_buffer_->raw_data(), current_buffer_->width(), current_buffer_->height(), current_buffer_->width() * 4);
     box2d<double> clip_box = clipping_extent(common_);
 
-    auto renderer_context = std::tie(render_buffer,*ras_ptr,pixmap_);
+    auto renderer_context = std::tie(render_buffer,*ras_ptr,pixmap_,sprite_cache_);
     using context_type = decltype(renderer_context);
     using vector_dispatch_type = vector_markers_rasterizer_dispatch<svg_renderer_type, detector_type, context_type>;
     using raster_dispatch_type = raster_markers_rasterizer_dispatch<detector_type, context_type>;
 
+    // markers are drawn and blitted by the dispatchers, which report no extent
+    mark_untracked();
     render_markers_symbolizer<vector_dispatch_type, raster_dispatch_type>(
         sym, feature, prj_trans, common_, clip_box, renderer_context);
 }
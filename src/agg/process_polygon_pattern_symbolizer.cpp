@@ -175,9 +175,10 @@ void agg_renderer<T0,T1>::process(polygon_pattern_symbolizer const& sym,
             converter.apply(geom);
         }
     }
-    agg::scanline_u8 sl;
+    agg::scanline_u8 & sl = *sl_ptr;
     ras_ptr->filling_rule(agg::fill_even_odd);
     agg::render_scanlines(*ras_ptr, sl, rp);
+    mark_rasterized();
 }
 
 
@@ -56,6 +56,9 @@ void agg_renderer<T0,T1>::process(raster_symbolizer const& sym,
             int start_x, int start_y) {
             composite(current_buffer_->data(), target,
                       comp_op, opacity, start_x, start_y, false);
+            mark_dirty(box2d<int>(start_x, start_y,
+                                  start_x + static_cast<int>(target.width()),
+                                  start_y + static_cast<int>(target.height())));
         }
     );
 }
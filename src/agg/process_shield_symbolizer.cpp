@@ -61,6 +61,9 @@ void  agg_renderer<T0,T1>::process(shield_symbolizer const& sym,
     double opacity = get<double>(sym,keys::opacity, feature, common_.vars_, 1.0);
 
     placements_list const& placements = helper.get();
+    this->record_labels(placements.size());
+    // glyphs and halos are blended without reporting their extent
+    if (!placements.empty()) mark_untracked();
     for (glyph_positions_ptr glyphs : placements)
     {
         if (glyphs->marker())
@@ -69,6 +69,9 @@ void agg_renderer<T0,T1>::process(text_symbolizer const& sym,
     }
 
     placements_list const& placements = helper.get();
+    this->record_labels(placements.size());
+    // glyphs and halos are blended without reporting their extent
+    if (!placements.empty()) mark_untracked();
     for (glyph_positions_ptr glyphs : placements)
     {
         ren.render(*glyphs);
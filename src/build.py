@@ -162,6 +162,8 @@ source = Split(
     expression_node.cpp
     expression_string.cpp
     expression.cpp
+    expression_cache.cpp
+    sql_filter.cpp
     transform_expression.cpp
     feature_kv_iterator.cpp
     feature_style_processor.cpp
@@ -176,11 +178,15 @@ source = Split(
     image_util.cpp
     layer.cpp
     map.cpp
+    metatile.cpp
     load_map.cpp
+    compiled_map.cpp
     memory.cpp
     palette.cpp
     plugin.cpp
     rule.cpp
+    rule_index.cpp
+    render_stats.cpp
     save_map.cpp
     wkb.cpp
     projection.cpp
@@ -194,6 +200,7 @@ source = Split(
     symbolizer_enumerations.cpp
     unicode.cpp
     raster_colorizer.cpp
+    process_bands.cpp
     mapped_memory_cache.cpp
     marker_cache.cpp
     svg/svg_parser.cpp
@@ -295,6 +302,7 @@ for cpp in enabled_imaging_libraries:
 source += Split(
     """
     agg/agg_renderer.cpp
+    agg/agg_render_context.cpp
     agg/process_building_symbolizer.cpp
     agg/process_line_symbolizer.cpp
     agg/process_line_pattern_symbolizer.cpp
@@ -325,6 +333,7 @@ if env['GRID_RENDERER']:
         """
         grid/grid.cpp
         grid/grid_renderer.cpp
+        grid/grid_utf.cpp
         grid/process_building_symbolizer.cpp
         grid/process_line_pattern_symbolizer.cpp
         grid/process_line_symbolizer.cpp
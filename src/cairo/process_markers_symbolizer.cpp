@@ -52,6 +52,7 @@ struct markers_dispatch : mapnik::noncopyable
 {
     markers_dispatch(SvgPath & marker,
                      Attributes const& attributes,
+                     svg_path_ptr const& /*stock_marker*/,
                      box2d<double> const& bbox,
                      agg::trans_affine const& marker_trans,
                      markers_symbolizer const& sym,
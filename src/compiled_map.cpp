@@ -0,0 +1,1655 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/compiled_map.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/font_set.hpp>
+#include <mapnik/config_error.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/function_call.hpp>
+#include <mapnik/path_expression.hpp>
+#include <mapnik/transform_expression.hpp>
+#include <mapnik/raster_colorizer.hpp>
+#include <mapnik/image_filter_types.hpp>
+#include <mapnik/text/placements/base.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/text/placements/simple.hpp>
+#include <mapnik/text/placements/list.hpp>
+#include <mapnik/text/formatting/text.hpp>
+#include <mapnik/text/formatting/format.hpp>
+#include <mapnik/text/formatting/layout.hpp>
+#include <mapnik/text/formatting/list.hpp>
+#include <mapnik/group/group_layout.hpp>
+#include <mapnik/group/group_rule.hpp>
+#include <mapnik/group/group_symbolizer_properties.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+namespace mapnik
+{
+
+namespace {
+
+const char compiled_map_magic[8] = { 'M','A','P','N','I','K','C','\0' };
+const std::uint32_t compiled_map_version = 1;
+const std::uint32_t byte_order_mark = 0x01020304;
+
+// Tags are written explicitly instead of variant indexes so that
+// reordering a variant does not silently change the meaning of old files.
+enum expr_tag : std::uint8_t
+{
+    EXPR_NULL = 0,
+    EXPR_BOOL,
+    EXPR_INTEGER,
+    EXPR_DOUBLE,
+    EXPR_STRING,
+    EXPR_ATTRIBUTE,
+    EXPR_GLOBAL_ATTRIBUTE,
+    EXPR_GEOMETRY_TYPE,
+    EXPR_NEGATE,
+    EXPR_PLUS,
+    EXPR_MINUS,
+    EXPR_MULT,
+    EXPR_DIV,
+    EXPR_MOD,
+    EXPR_LESS,
+    EXPR_LESS_EQUAL,
+    EXPR_GREATER,
+    EXPR_GREATER_EQUAL,
+    EXPR_EQUAL_TO,
+    EXPR_NOT_EQUAL_TO,
+    EXPR_LOGICAL_NOT,
+    EXPR_LOGICAL_AND,
+    EXPR_LOGICAL_OR,
+    EXPR_REGEX_MATCH,
+    EXPR_REGEX_REPLACE,
+    EXPR_UNARY_CALL,
+    EXPR_BINARY_CALL
+};
+
+template <typename Tag> struct expr_tag_of;
+template <> struct expr_tag_of<tags::negate> { static const expr_tag value = EXPR_NEGATE; };
+template <> struct expr_tag_of<tags::plus> { static const expr_tag value = EXPR_PLUS; };
+template <> struct expr_tag_of<tags::minus> { static const expr_tag value = EXPR_MINUS; };
+template <> struct expr_tag_of<tags::mult> { static const expr_tag value = EXPR_MULT; };
+template <> struct expr_tag_of<tags::div> { static const expr_tag value = EXPR_DIV; };
+template <> struct expr_tag_of<tags::mod> { static const expr_tag value = EXPR_MOD; };
+template <> struct expr_tag_of<tags::less> { static const expr_tag value = EXPR_LESS; };
+template <> struct expr_tag_of<tags::less_equal> { static const expr_tag value = EXPR_LESS_EQUAL; };
+template <> struct expr_tag_of<tags::greater> { static const expr_tag value = EXPR_GREATER; };
+template <> struct expr_tag_of<tags::greater_equal> { static const expr_tag value = EXPR_GREATER_EQUAL; };
+template <> struct expr_tag_of<tags::equal_to> { static const expr_tag value = EXPR_EQUAL_TO; };
+template <> struct expr_tag_of<tags::not_equal_to> { static const expr_tag value = EXPR_NOT_EQUAL_TO; };
+template <> struct expr_tag_of<tags::logical_not> { static const expr_tag value = EXPR_LOGICAL_NOT; };
+template <> struct expr_tag_of<tags::logical_and> { static const expr_tag value = EXPR_LOGICAL_AND; };
+template <> struct expr_tag_of<tags::logical_or> { static const expr_tag value = EXPR_LOGICAL_OR; };
+
+enum property_tag : std::uint8_t
+{
+    PROP_BOOL = 0,
+    PROP_INTEGER,
+    PROP_ENUM,
+    PROP_DOUBLE,
+    PROP_STRING,
+    PROP_COLOR,
+    PROP_EXPRESSION,
+    PROP_PATH_EXPRESSION,
+    PROP_TRANSFORM,
+    PROP_TEXT_PLACEMENTS,
+    PROP_DASH_ARRAY,
+    PROP_COLORIZER,
+    PROP_GROUP_PROPERTIES
+};
+
+enum symbolizer_tag : std::uint8_t
+{
+    SYM_POINT = 0,
+    SYM_LINE,
+    SYM_LINE_PATTERN,
+    SYM_POLYGON,
+    SYM_POLYGON_PATTERN,
+    SYM_RASTER,
+    SYM_SHIELD,
+    SYM_TEXT,
+    SYM_BUILDING,
+    SYM_MARKERS,
+    SYM_GROUP,
+    SYM_DEBUG
+};
+
+inline symbolizer_tag tag_of(point_symbolizer const&) { return SYM_POINT; }
+inline symbolizer_tag tag_of(line_symbolizer const&) { return SYM_LINE; }
+inline symbolizer_tag tag_of(line_pattern_symbolizer const&) { return SYM_LINE_PATTERN; }
+inline symbolizer_tag tag_of(polygon_symbolizer const&) { return SYM_POLYGON; }
+inline symbolizer_tag tag_of(polygon_pattern_symbolizer const&) { return SYM_POLYGON_PATTERN; }
+inline symbolizer_tag tag_of(raster_symbolizer const&) { return SYM_RASTER; }
+inline symbolizer_tag tag_of(shield_symbolizer const&) { return SYM_SHIELD; }
+inline symbolizer_tag tag_of(text_symbolizer const&) { return SYM_TEXT; }
+inline symbolizer_tag tag_of(building_symbolizer const&) { return SYM_BUILDING; }
+inline symbolizer_tag tag_of(markers_symbolizer const&) { return SYM_MARKERS; }
+inline symbolizer_tag tag_of(group_symbolizer const&) { return SYM_GROUP; }
+inline symbolizer_tag tag_of(debug_symbolizer const&) { return SYM_DEBUG; }
+
+enum transform_tag : std::uint8_t
+{
+    TRANSFORM_IDENTITY = 0,
+    TRANSFORM_MATRIX,
+    TRANSFORM_TRANSLATE,
+    TRANSFORM_SCALE,
+    TRANSFORM_ROTATE,
+    TRANSFORM_SKEW_X,
+    TRANSFORM_SKEW_Y
+};
+
+enum filter_tag : std::uint8_t
+{
+    FILTER_BLUR = 0,
+    FILTER_GRAY,
+    FILTER_AGG_STACK_BLUR,
+    FILTER_EMBOSS,
+    FILTER_SHARPEN,
+    FILTER_EDGE_DETECT,
+    FILTER_SOBEL,
+    FILTER_X_GRADIENT,
+    FILTER_Y_GRADIENT,
+    FILTER_INVERT,
+    FILTER_SCALE_HSLA,
+    FILTER_COLORIZE_ALPHA,
+    FILTER_COLOR_TO_ALPHA
+};
+
+enum placements_tag : std::uint8_t
+{
+    PLACEMENTS_DUMMY = 0,
+    PLACEMENTS_SIMPLE,
+    PLACEMENTS_LIST
+};
+
+enum format_node_tag : std::uint8_t
+{
+    NODE_NONE = 0,
+    NODE_TEXT,
+    NODE_FORMAT,
+    NODE_LAYOUT,
+    NODE_LIST
+};
+
+enum param_tag : std::uint8_t
+{
+    PARAM_NULL = 0,
+    PARAM_INTEGER,
+    PARAM_DOUBLE,
+    PARAM_STRING
+};
+
+class compiled_writer
+{
+public:
+    explicit compiled_writer(std::string & out)
+        : out_(out) {}
+
+    template <typename T>
+    void pod(T const& val)
+    {
+        out_.append(reinterpret_cast<char const*>(&val), sizeof(T));
+    }
+
+    void u8(std::uint8_t val) { pod(val); }
+    void u32(std::uint32_t val) { pod(val); }
+    void boolean(bool val) { pod(static_cast<std::uint8_t>(val ? 1 : 0)); }
+
+    void str(std::string const& val)
+    {
+        u32(static_cast<std::uint32_t>(val.size()));
+        out_.append(val);
+    }
+
+    void str(value_unicode_string const& val)
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        str(utf8);
+    }
+
+    void col(color const& c)
+    {
+        u8(c.red());
+        u8(c.green());
+        u8(c.blue());
+        u8(c.alpha());
+    }
+
+    void box(box2d<double> const& b)
+    {
+        pod(b.minx());
+        pod(b.miny());
+        pod(b.maxx());
+        pod(b.maxy());
+    }
+
+    void fontset(font_set const& fset)
+    {
+        str(fset.get_name());
+        u32(static_cast<std::uint32_t>(fset.get_face_names().size()));
+        for (std::string const& face_name : fset.get_face_names())
+        {
+            str(face_name);
+        }
+    }
+
+    void parameters(mapnik::parameters const& params);
+    void expression(expr_node const& expr);
+    void expression(expression_ptr const& expr);
+    void property(symbolizer_base::value_type const& val);
+    void properties(symbolizer_base::cont_type const& props);
+    void symbolizer(mapnik::symbolizer const& sym);
+    void text_properties(text_symbolizer_properties const& props);
+    void format_tree(formatting::node_ptr const& node);
+    void image_filters(std::vector<filter::filter_type> const& filters);
+    void style(feature_type_style const& style);
+    void layer(mapnik::layer const& lyr);
+
+private:
+    std::string & out_;
+};
+
+struct parameter_writer : util::static_visitor<>
+{
+    explicit parameter_writer(compiled_writer & out)
+        : out_(out) {}
+
+    void operator() (value_null) const { out_.u8(PARAM_NULL); }
+    void operator() (value_integer val) const { out_.u8(PARAM_INTEGER); out_.pod(val); }
+    void operator() (value_double val) const { out_.u8(PARAM_DOUBLE); out_.pod(val); }
+    void operator() (std::string const& val) const { out_.u8(PARAM_STRING); out_.str(val); }
+
+    compiled_writer & out_;
+};
+
+void compiled_writer::parameters(mapnik::parameters const& params)
+{
+    u32(static_cast<std::uint32_t>(params.size()));
+    for (auto const& kv : params)
+    {
+        str(kv.first);
+        util::apply_visitor(parameter_writer(*this), kv.second);
+    }
+}
+
+struct expression_writer : util::static_visitor<>
+{
+    explicit expression_writer(compiled_writer & out)
+        : out_(out) {}
+
+    void operator() (value_null) const { out_.u8(EXPR_NULL); }
+    void operator() (value_bool val) const { out_.u8(EXPR_BOOL); out_.boolean(val); }
+    void operator() (value_integer val) const { out_.u8(EXPR_INTEGER); out_.pod(val); }
+    void operator() (value_double val) const { out_.u8(EXPR_DOUBLE); out_.pod(val); }
+    void operator() (value_unicode_string const& val) const { out_.u8(EXPR_STRING); out_.str(val); }
+    void operator() (attribute const& attr) const { out_.u8(EXPR_ATTRIBUTE); out_.str(attr.name()); }
+    void operator() (global_attribute const& attr) const { out_.u8(EXPR_GLOBAL_ATTRIBUTE); out_.str(attr.name); }
+    void operator() (geometry_type_attribute const&) const { out_.u8(EXPR_GEOMETRY_TYPE); }
+
+    template <typename Tag>
+    void operator() (unary_node<Tag> const& x) const
+    {
+        out_.u8(expr_tag_of<Tag>::value);
+        out_.expression(x.expr);
+    }
+
+    template <typename Tag>
+    void operator() (binary_node<Tag> const& x) const
+    {
+        out_.u8(expr_tag_of<Tag>::value);
+        out_.expression(x.left);
+        out_.expression(x.right);
+    }
+
+    void operator() (regex_match_node const& x) const
+    {
+        out_.u8(EXPR_REGEX_MATCH);
+        out_.expression(x.expr);
+        out_.str(pattern(x));
+    }
+
+    void operator() (regex_replace_node const& x) const
+    {
+        out_.u8(EXPR_REGEX_REPLACE);
+        out_.expression(x.expr);
+        out_.str(pattern(x));
+        out_.str(x.format);
+    }
+
+    void operator() (unary_function_call const& call) const
+    {
+        out_.u8(EXPR_UNARY_CALL);
+        out_.str(std::string(unary_function_name(call.fun)));
+        out_.expression(call.arg);
+    }
+
+    void operator() (binary_function_call const& call) const
+    {
+        out_.u8(EXPR_BINARY_CALL);
+        out_.str(std::string(binary_function_name(call.fun)));
+        out_.expression(call.arg1);
+        out_.expression(call.arg2);
+    }
+
+    template <typename Node>
+    static std::string pattern(Node const& x)
+    {
+#if defined(BOOST_REGEX_HAS_ICU)
+        std::string utf8;
+        to_utf8(value_unicode_string::fromUTF32(&x.pattern.str()[0], x.pattern.str().length()), utf8);
+        return utf8;
+#else
+        return x.pattern.str();
+#endif
+    }
+
+    compiled_writer & out_;
+};
+
+void compiled_writer::expression(expr_node const& expr)
+{
+    util::apply_visitor(expression_writer(*this), expr);
+}
+
+void compiled_writer::expression(expression_ptr const& expr)
+{
+    boolean(static_cast<bool>(expr));
+    if (expr) expression(*expr);
+}
+
+struct transform_writer : util::static_visitor<>
+{
+    explicit transform_writer(compiled_writer & out)
+        : out_(out) {}
+
+    void operator() (identity_node const&) const
+    {
+        out_.u8(TRANSFORM_IDENTITY);
+    }
+
+    void operator() (matrix_node const& node) const
+    {
+        out_.u8(TRANSFORM_MATRIX);
+        out_.expression(node.a_);
+        out_.expression(node.b_);
+        out_.expression(node.c_);
+        out_.expression(node.d_);
+        out_.expression(node.e_);
+        out_.expression(node.f_);
+    }
+
+    void operator() (translate_node const& node) const
+    {
+        out_.u8(TRANSFORM_TRANSLATE);
+        out_.expression(node.tx_);
+        out_.expression(node.ty_);
+    }
+
+    void operator() (scale_node const& node) const
+    {
+        out_.u8(TRANSFORM_SCALE);
+        out_.expression(node.sx_);
+        out_.expression(node.sy_);
+    }
+
+    void operator() (rotate_node const& node) const
+    {
+        out_.u8(TRANSFORM_ROTATE);
+        out_.expression(node.angle_);
+        out_.expression(node.cx_);
+        out_.expression(node.cy_);
+    }
+
+    void operator() (skewX_node const& node) const
+    {
+        out_.u8(TRANSFORM_SKEW_X);
+        out_.expression(node.angle_);
+    }
+
+    void operator() (skewY_node const& node) const
+    {
+        out_.u8(TRANSFORM_SKEW_Y);
+        out_.expression(node.angle_);
+    }
+
+    compiled_writer & out_;
+};
+
+struct group_layout_writer : util::static_visitor<>
+{
+    explicit group_layout_writer(compiled_writer & out)
+        : out_(out) {}
+
+    void operator() (simple_row_layout const& layout) const
+    {
+        out_.u8(0);
+        out_.pod(layout.get_item_margin());
+    }
+
+    void operator() (pair_layout const& layout) const
+    {
+        out_.u8(1);
+        out_.pod(layout.get_item_margin());
+        out_.pod(layout.get_max_difference());
+    }
+
+    compiled_writer & out_;
+};
+
+struct property_writer : util::static_visitor<>
+{
+    explicit property_writer(compiled_writer & out)
+        : out_(out) {}
+
+    void operator() (value_bool val) const { out_.u8(PROP_BOOL); out_.boolean(val); }
+    void operator() (value_integer val) const { out_.u8(PROP_INTEGER); out_.pod(val); }
+    void operator() (enumeration_wrapper const& e) const { out_.u8(PROP_ENUM); out_.pod(static_cast<std::int32_t>(e.value)); }
+    void operator() (value_double val) const { out_.u8(PROP_DOUBLE); out_.pod(val); }
+    void operator() (std::string const& val) const { out_.u8(PROP_STRING); out_.str(val); }
+    void operator() (color const& val) const { out_.u8(PROP_COLOR); out_.col(val); }
+    void operator() (expression_ptr const& expr) const { out_.u8(PROP_EXPRESSION); out_.expression(expr); }
+
+    void operator() (path_expression_ptr const& expr) const
+    {
+        out_.u8(PROP_PATH_EXPRESSION);
+        out_.boolean(static_cast<bool>(expr));
+        if (!expr) return;
+        out_.u32(static_cast<std::uint32_t>(expr->size()));
+        for (path_component const& component : *expr)
+        {
+            if (component.is<attribute>())
+            {
+                out_.u8(1);
+                out_.str(component.get<attribute>().name());
+            }
+            else
+            {
+                out_.u8(0);
+                out_.str(component.get<std::string>());
+            }
+        }
+    }
+
+    void operator() (transform_type const& expr) const
+    {
+        out_.u8(PROP_TRANSFORM);
+        out_.boolean(static_cast<bool>(expr));
+        if (!expr) return;
+        out_.u32(static_cast<std::uint32_t>(expr->size()));
+        for (transform_node const& node : *expr)
+        {
+            util::apply_visitor(transform_writer(out_), *node);
+        }
+    }
+
+    void operator() (text_placements_ptr const& placements) const
+    {
+        out_.u8(PROP_TEXT_PLACEMENTS);
+        out_.boolean(static_cast<bool>(placements));
+        if (!placements) return;
+        if (text_placements_list * list = dynamic_cast<text_placements_list *>(placements.get()))
+        {
+            out_.u8(PLACEMENTS_LIST);
+            out_.text_properties(list->defaults);
+            out_.u32(list->size());
+            for (unsigned i = 0; i < list->size(); ++i)
+            {
+                out_.text_properties(list->get(i));
+            }
+        }
+        else if (text_placements_simple * simple = dynamic_cast<text_placements_simple *>(placements.get()))
+        {
+            out_.u8(PLACEMENTS_SIMPLE);
+            out_.text_properties(simple->defaults);
+            out_.str(simple->get_positions());
+        }
+        else if (dynamic_cast<text_placements_dummy *>(placements.get()))
+        {
+            out_.u8(PLACEMENTS_DUMMY);
+            out_.text_properties(placements->defaults);
+        }
+        else
+        {
+            throw config_error("compiled maps do not support this text placements type");
+        }
+    }
+
+    void operator() (dash_array const& dash) const
+    {
+        out_.u8(PROP_DASH_ARRAY);
+        out_.u32(static_cast<std::uint32_t>(dash.size()));
+        for (auto const& pair : dash)
+        {
+            out_.pod(pair.first);
+            out_.pod(pair.second);
+        }
+    }
+
+    void operator() (raster_colorizer_ptr const& colorizer) const
+    {
+        out_.u8(PROP_COLORIZER);
+        out_.boolean(static_cast<bool>(colorizer));
+        if (!colorizer) return;
+        out_.pod(static_cast<std::int32_t>(colorizer_mode_enum(colorizer->get_default_mode())));
+        out_.col(colorizer->get_default_color());
+        out_.pod(colorizer->get_epsilon());
+        colorizer_stops const& stops = colorizer->get_stops();
+        out_.u32(static_cast<std::uint32_t>(stops.size()));
+        for (colorizer_stop const& stop : stops)
+        {
+            out_.pod(stop.get_value());
+            out_.pod(static_cast<std::int32_t>(colorizer_mode_enum(stop.get_mode())));
+            out_.col(stop.get_color());
+            out_.str(stop.get_label());
+        }
+    }
+
+    void operator() (group_symbolizer_properties_ptr const& props) const
+    {
+        out_.u8(PROP_GROUP_PROPERTIES);
+        out_.boolean(static_cast<bool>(props));
+        if (!props) return;
+        util::apply_visitor(group_layout_writer(out_), props->get_layout());
+        out_.u32(static_cast<std::uint32_t>(props->get_rules().size()));
+        for (group_rule_ptr const& rule : props->get_rules())
+        {
+            out_.expression(rule->get_filter());
+            out_.expression(rule->get_repeat_key());
+            out_.u32(static_cast<std::uint32_t>(rule->get_symbolizers().size()));
+            for (mapnik::symbolizer const& sym : rule->get_symbolizers())
+            {
+                out_.symbolizer(sym);
+            }
+        }
+    }
+
+    compiled_writer & out_;
+};
+
+void compiled_writer::property(symbolizer_base::value_type const& val)
+{
+    util::apply_visitor(property_writer(*this), val);
+}
+
+void compiled_writer::properties(symbolizer_base::cont_type const& props)
+{
+    u32(static_cast<std::uint32_t>(props.size()));
+    for (auto const& kv : props)
+    {
+        u8(static_cast<std::uint8_t>(kv.first));
+        property(kv.second);
+    }
+}
+
+struct symbolizer_writer : util::static_visitor<>
+{
+    explicit symbolizer_writer(compiled_writer & out)
+        : out_(out) {}
+
+    template <typename Symbolizer>
+    void operator() (Symbolizer const& sym) const
+    {
+        out_.u8(tag_of(sym));
+        out_.properties(sym.properties);
+    }
+
+    compiled_writer & out_;
+};
+
+void compiled_writer::symbolizer(mapnik::symbolizer const& sym)
+{
+    util::apply_visitor(symbolizer_writer(*this), sym);
+}
+
+void compiled_writer::text_properties(text_symbolizer_properties const& props)
+{
+    text_properties_expressions const& expr = props.expressions;
+    property(expr.label_placement);
+    property(expr.label_spacing);
+    property(expr.label_position_tolerance);
+    property(expr.avoid_edges);
+    property(expr.repeat_distance);
+    property(expr.minimum_distance);
+    property(expr.minimum_padding);
+    property(expr.minimum_path_length);
+    property(expr.max_char_angle_delta);
+    property(expr.allow_overlap);
+    property(expr.largest_bbox_only);
+    property(expr.upright);
+
+    text_layout_properties const& layout = props.layout_defaults;
+    property(layout.dx);
+    property(layout.dy);
+    property(layout.orientation);
+    property(layout.text_ratio);
+    property(layout.wrap_width);
+    property(layout.wrap_before);
+    property(layout.rotate_displacement);
+    property(layout.halign);
+    property(layout.jalign);
+    property(layout.valign);
+
+    format_properties const& format = props.format_defaults;
+    str(format.face_name);
+    boolean(static_cast<bool>(format.fontset));
+    if (format.fontset) fontset(*format.fontset);
+    property(format.text_size);
+    property(format.character_spacing);
+    property(format.line_spacing);
+    property(format.text_opacity);
+    property(format.halo_opacity);
+    property(format.fill);
+    property(format.halo_fill);
+    property(format.halo_radius);
+    property(format.text_transform);
+
+    format_tree(props.format_tree());
+}
+
+template <typename T>
+void write_optional(compiled_writer & out, boost::optional<T> const& val);
+
+template <>
+void write_optional(compiled_writer & out, boost::optional<symbolizer_base::value_type> const& val)
+{
+    out.boolean(static_cast<bool>(val));
+    if (val) out.property(*val);
+}
+
+void compiled_writer::format_tree(formatting::node_ptr const& node)
+{
+    if (!node)
+    {
+        u8(NODE_NONE);
+    }
+    else if (formatting::text_node const* text = dynamic_cast<formatting::text_node const*>(node.get()))
+    {
+        u8(NODE_TEXT);
+        expression(text->get_text());
+    }
+    else if (formatting::format_node const* format = dynamic_cast<formatting::format_node const*>(node.get()))
+    {
+        u8(NODE_FORMAT);
+        boolean(static_cast<bool>(format->face_name));
+        if (format->face_name) str(*format->face_name);
+        boolean(static_cast<bool>(format->fontset));
+        if (format->fontset) fontset(*format->fontset);
+        write_optional(*this, format->text_size);
+        write_optional(*this, format->character_spacing);
+        write_optional(*this, format->line_spacing);
+        write_optional(*this, format->text_opacity);
+        write_optional(*this, format->wrap_before);
+        write_optional(*this, format->text_transform);
+        write_optional(*this, format->fill);
+        write_optional(*this, format->halo_fill);
+        write_optional(*this, format->halo_radius);
+        format_tree(format->get_child());
+    }
+    else if (formatting::layout_node const* layout = dynamic_cast<formatting::layout_node const*>(node.get()))
+    {
+        u8(NODE_LAYOUT);
+        write_optional(*this, layout->dx);
+        write_optional(*this, layout->dy);
+        write_optional(*this, layout->halign);
+        write_optional(*this, layout->valign);
+        write_optional(*this, layout->jalign);
+        write_optional(*this, layout->text_ratio);
+        write_optional(*this, layout->wrap_width);
+        write_optional(*this, layout->wrap_before);
+        write_optional(*this, layout->rotate_displacement);
+        write_optional(*this, layout->orientation);
+        format_tree(layout->get_child());
+    }
+    else if (formatting::list_node const* list = dynamic_cast<formatting::list_node const*>(node.get()))
+    {
+        u8(NODE_LIST);
+        u32(static_cast<std::uint32_t>(list->get_children().size()));
+        for (formatting::node_ptr const& child : list->get_children())
+        {
+            format_tree(child);
+        }
+    }
+    else
+    {
+        throw config_error("compiled maps do not support this text formatting node");
+    }
+}
+
+struct image_filter_writer : util::static_visitor<>
+{
+    explicit image_filter_writer(compiled_writer & out)
+        : out_(out) {}
+
+    void operator() (filter::blur const&) const { out_.u8(FILTER_BLUR); }
+    void operator() (filter::gray const&) const { out_.u8(FILTER_GRAY); }
+    void operator() (filter::emboss const&) const { out_.u8(FILTER_EMBOSS); }
+    void operator() (filter::sharpen const&) const { out_.u8(FILTER_SHARPEN); }
+    void operator() (filter::edge_detect const&) const { out_.u8(FILTER_EDGE_DETECT); }
+    void operator() (filter::sobel const&) const { out_.u8(FILTER_SOBEL); }
+    void operator() (filter::x_gradient const&) const { out_.u8(FILTER_X_GRADIENT); }
+    void operator() (filter::y_gradient const&) const { out_.u8(FILTER_Y_GRADIENT); }
+    void operator() (filter::invert const&) const { out_.u8(FILTER_INVERT); }
+
+    void operator() (filter::agg_stack_blur const& f) const
+    {
+        out_.u8(FILTER_AGG_STACK_BLUR);
+        out_.u32(f.rx);
+        out_.u32(f.ry);
+    }
+
+    void operator() (filter::scale_hsla const& f) const
+    {
+        out_.u8(FILTER_SCALE_HSLA);
+        out_.pod(f.h0); out_.pod(f.h1);
+        out_.pod(f.s0); out_.pod(f.s1);
+        out_.pod(f.l0); out_.pod(f.l1);
+        out_.pod(f.a0); out_.pod(f.a1);
+    }
+
+    void operator() (filter::colorize_alpha const& f) const
+    {
+        out_.u8(FILTER_COLORIZE_ALPHA);
+        out_.u32(static_cast<std::uint32_t>(f.size()));
+        for (filter::color_stop const& stop : f)
+        {
+            out_.col(stop.color);
+            out_.pod(stop.offset);
+        }
+    }
+
+    void operator() (filter::color_to_alpha const& f) const
+    {
+        out_.u8(FILTER_COLOR_TO_ALPHA);
+        out_.col(f.color);
+    }
+
+    compiled_writer & out_;
+};
+
+void compiled_writer::image_filters(std::vector<filter::filter_type> const& filters)
+{
+    u32(static_cast<std::uint32_t>(filters.size()));
+    for (filter::filter_type const& f : filters)
+    {
+        util::apply_visitor(image_filter_writer(*this), f);
+    }
+}
+
+void compiled_writer::style(feature_type_style const& style)
+{
+    u8(static_cast<std::uint8_t>(filter_mode_enum(style.get_filter_mode())));
+    boost::optional<composite_mode_e> comp_op = style.comp_op();
+    boolean(static_cast<bool>(comp_op));
+    if (comp_op) pod(static_cast<std::int32_t>(*comp_op));
+    pod(style.get_opacity());
+    boolean(style.image_filters_inflate());
+    image_filters(style.image_filters());
+    image_filters(style.direct_image_filters());
+
+    u32(static_cast<std::uint32_t>(style.get_rules().size()));
+    for (rule const& r : style.get_rules())
+    {
+        str(r.get_name());
+        pod(r.get_min_scale());
+        pod(r.get_max_scale());
+        expression(r.get_filter());
+        boolean(r.has_else_filter());
+        boolean(r.has_also_filter());
+        u32(static_cast<std::uint32_t>(r.get_symbolizers().size()));
+        for (mapnik::symbolizer const& sym : r.get_symbolizers())
+        {
+            symbolizer(sym);
+        }
+    }
+}
+
+void compiled_writer::layer(mapnik::layer const& lyr)
+{
+    str(lyr.name());
+    str(lyr.srs());
+    pod(lyr.min_zoom());
+    pod(lyr.max_zoom());
+    boolean(lyr.active());
+    boolean(lyr.queryable());
+    boolean(lyr.clear_label_cache());
+    boolean(lyr.cache_features());
+    str(lyr.group_by());
+    boolean(static_cast<bool>(lyr.buffer_size()));
+    if (lyr.buffer_size()) pod(static_cast<std::int32_t>(*lyr.buffer_size()));
+    boolean(static_cast<bool>(lyr.maximum_extent()));
+    if (lyr.maximum_extent()) box(*lyr.maximum_extent());
+    u32(static_cast<std::uint32_t>(lyr.styles().size()));
+    for (std::string const& style_name : lyr.styles())
+    {
+        str(style_name);
+    }
+    datasource_ptr ds = lyr.datasource();
+    boolean(static_cast<bool>(ds));
+    if (ds) parameters(ds->params());
+}
+
+class compiled_reader
+{
+public:
+    compiled_reader(char const* begin, char const* end)
+        : pos_(begin),
+          end_(end) {}
+
+    template <typename T>
+    T pod()
+    {
+        ensure(sizeof(T));
+        T val;
+        std::memcpy(&val, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return val;
+    }
+
+    std::uint8_t u8() { return pod<std::uint8_t>(); }
+    std::uint32_t u32() { return pod<std::uint32_t>(); }
+
+    // An element count read ahead of a reserve(); each element takes at
+    // least `min_size` bytes, so a corrupt count cannot allocate more
+    // than the rest of the input could ever fill.
+    std::uint32_t element_count(std::size_t min_size)
+    {
+        std::uint32_t val = u32();
+        if (val > static_cast<std::size_t>(end_ - pos_) / min_size)
+        {
+            throw config_error("compiled map is truncated");
+        }
+        return val;
+    }
+    bool boolean() { return pod<std::uint8_t>() != 0; }
+
+    std::string str()
+    {
+        std::uint32_t size = u32();
+        ensure(size);
+        std::string val(pos_, size);
+        pos_ += size;
+        return val;
+    }
+
+    value_unicode_string ustr()
+    {
+        return value_unicode_string::fromUTF8(str());
+    }
+
+    color col()
+    {
+        std::uint8_t r = u8();
+        std::uint8_t g = u8();
+        std::uint8_t b = u8();
+        std::uint8_t a = u8();
+        return color(r, g, b, a);
+    }
+
+    box2d<double> box()
+    {
+        double minx = pod<double>();
+        double miny = pod<double>();
+        double maxx = pod<double>();
+        double maxy = pod<double>();
+        return box2d<double>(minx, miny, maxx, maxy);
+    }
+
+    font_set fontset()
+    {
+        font_set fset(str());
+        std::uint32_t count = u32();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            fset.add_face_name(str());
+        }
+        return fset;
+    }
+
+    bool at_end() const { return pos_ == end_; }
+
+    mapnik::parameters parameters();
+    expr_node expression();
+    expression_ptr expression_ptr_value();
+    symbolizer_base::value_type property();
+    void properties(symbolizer_base::cont_type & props);
+    mapnik::symbolizer symbolizer();
+    void text_properties(text_symbolizer_properties & props);
+    formatting::node_ptr format_tree();
+    void image_filters(std::vector<filter::filter_type> & filters);
+    feature_type_style style();
+    mapnik::layer layer();
+
+private:
+    void ensure(std::size_t size) const
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < size)
+        {
+            throw config_error("compiled map is truncated");
+        }
+    }
+
+    template <typename Symbolizer>
+    mapnik::symbolizer read_symbolizer()
+    {
+        Symbolizer sym;
+        properties(sym.properties);
+        return mapnik::symbolizer(std::move(sym));
+    }
+
+    char const* pos_;
+    char const* end_;
+};
+
+mapnik::parameters compiled_reader::parameters()
+{
+    mapnik::parameters params;
+    std::uint32_t count = u32();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        std::string key = str();
+        switch (u8())
+        {
+        case PARAM_NULL: params[key] = value_holder(); break;
+        case PARAM_INTEGER: params[key] = pod<value_integer>(); break;
+        case PARAM_DOUBLE: params[key] = pod<value_double>(); break;
+        case PARAM_STRING: params[key] = str(); break;
+        default: throw config_error("compiled map has an unknown parameter type");
+        }
+    }
+    return params;
+}
+
+template <typename Tag>
+expr_node make_unary(compiled_reader & in)
+{
+    return unary_node<Tag>(in.expression());
+}
+
+template <typename Tag>
+expr_node make_binary(compiled_reader & in)
+{
+    expr_node left = in.expression();
+    expr_node right = in.expression();
+    return binary_node<Tag>(left, right);
+}
+
+expr_node compiled_reader::expression()
+{
+    switch (u8())
+    {
+    case EXPR_NULL: return value_null();
+    case EXPR_BOOL: return value_bool(boolean());
+    case EXPR_INTEGER: return pod<value_integer>();
+    case EXPR_DOUBLE: return pod<value_double>();
+    case EXPR_STRING: return ustr();
+    case EXPR_ATTRIBUTE: return attribute(str());
+    case EXPR_GLOBAL_ATTRIBUTE: return global_attribute(str());
+    case EXPR_GEOMETRY_TYPE: return geometry_type_attribute();
+    case EXPR_NEGATE: return make_unary<tags::negate>(*this);
+    case EXPR_PLUS: return make_binary<tags::plus>(*this);
+    case EXPR_MINUS: return make_binary<tags::minus>(*this);
+    case EXPR_MULT: return make_binary<tags::mult>(*this);
+    case EXPR_DIV: return make_binary<tags::div>(*this);
+    case EXPR_MOD: return make_binary<tags::mod>(*this);
+    case EXPR_LESS: return make_binary<tags::less>(*this);
+    case EXPR_LESS_EQUAL: return make_binary<tags::less_equal>(*this);
+    case EXPR_GREATER: return make_binary<tags::greater>(*this);
+    case EXPR_GREATER_EQUAL: return make_binary<tags::greater_equal>(*this);
+    case EXPR_EQUAL_TO: return make_binary<tags::equal_to>(*this);
+    case EXPR_NOT_EQUAL_TO: return make_binary<tags::not_equal_to>(*this);
+    case EXPR_LOGICAL_NOT: return make_unary<tags::logical_not>(*this);
+    case EXPR_LOGICAL_AND: return make_binary<tags::logical_and>(*this);
+    case EXPR_LOGICAL_OR: return make_binary<tags::logical_or>(*this);
+    case EXPR_REGEX_MATCH:
+    {
+        expr_node expr = expression();
+#if defined(BOOST_REGEX_HAS_ICU)
+        return regex_match_node(expr, ustr());
+#else
+        return regex_match_node(expr, str());
+#endif
+    }
+    case EXPR_REGEX_REPLACE:
+    {
+        expr_node expr = expression();
+#if defined(BOOST_REGEX_HAS_ICU)
+        value_unicode_string pattern = ustr();
+        value_unicode_string format = ustr();
+#else
+        std::string pattern = str();
+        std::string format = str();
+#endif
+        return regex_replace_node(expr, pattern, format);
+    }
+    case EXPR_UNARY_CALL:
+    {
+        static const unary_function_types unary_functions;
+        std::string name = str();
+        unary_function_impl const* fun = unary_functions.find(name);
+        if (!fun) throw config_error("compiled map uses unknown function '" + name + "'");
+        return unary_function_call(*fun, expression());
+    }
+    case EXPR_BINARY_CALL:
+    {
+        static const binary_function_types binary_functions;
+        std::string name = str();
+        binary_function_impl const* fun = binary_functions.find(name);
+        if (!fun) throw config_error("compiled map uses unknown function '" + name + "'");
+        expr_node arg1 = expression();
+        expr_node arg2 = expression();
+        return binary_function_call(*fun, arg1, arg2);
+    }
+    default:
+        throw config_error("compiled map has an unknown expression node");
+    }
+}
+
+expression_ptr compiled_reader::expression_ptr_value()
+{
+    if (!boolean()) return expression_ptr();
+    return std::make_shared<expr_node>(expression());
+}
+
+symbolizer_base::value_type compiled_reader::property()
+{
+    switch (u8())
+    {
+    case PROP_BOOL: return value_bool(boolean());
+    case PROP_INTEGER: return pod<value_integer>();
+    case PROP_ENUM: return enumeration_wrapper(pod<std::int32_t>());
+    case PROP_DOUBLE: return pod<value_double>();
+    case PROP_STRING: return str();
+    case PROP_COLOR: return col();
+    case PROP_EXPRESSION: return expression_ptr_value();
+    case PROP_PATH_EXPRESSION:
+    {
+        if (!boolean()) return path_expression_ptr();
+        path_expression_ptr expr = std::make_shared<path_expression>();
+        // a kind byte and a string length per item
+        std::uint32_t count = element_count(1 + sizeof(std::uint32_t));
+        expr->reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            if (u8() == 1) expr->emplace_back(attribute(str()));
+            else expr->emplace_back(str());
+        }
+        return expr;
+    }
+    case PROP_TRANSFORM:
+    {
+        if (!boolean()) return transform_type();
+        transform_list_ptr list = std::make_shared<transform_list>();
+        std::uint32_t count = element_count(1);
+        list->reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            switch (u8())
+            {
+            case TRANSFORM_IDENTITY:
+                list->emplace_back(identity_node());
+                break;
+            case TRANSFORM_MATRIX:
+            {
+                expr_node a = expression();
+                expr_node b = expression();
+                expr_node c = expression();
+                expr_node d = expression();
+                expr_node e = expression();
+                expr_node f = expression();
+                list->emplace_back(matrix_node(a, b, c, d, e, f));
+                break;
+            }
+            case TRANSFORM_TRANSLATE:
+            {
+                expr_node tx = expression();
+                expr_node ty = expression();
+                list->emplace_back(translate_node(tx, ty));
+                break;
+            }
+            case TRANSFORM_SCALE:
+            {
+                expr_node sx = expression();
+                expr_node sy = expression();
+                list->emplace_back(scale_node(sx, sy));
+                break;
+            }
+            case TRANSFORM_ROTATE:
+            {
+                expr_node angle = expression();
+                expr_node cx = expression();
+                expr_node cy = expression();
+                list->emplace_back(rotate_node(angle, cx, cy));
+                break;
+            }
+            case TRANSFORM_SKEW_X:
+                list->emplace_back(skewX_node(expression()));
+                break;
+            case TRANSFORM_SKEW_Y:
+                list->emplace_back(skewY_node(expression()));
+                break;
+            default:
+                throw config_error("compiled map has an unknown transform");
+            }
+        }
+        return list;
+    }
+    case PROP_TEXT_PLACEMENTS:
+    {
+        if (!boolean()) return text_placements_ptr();
+        std::uint8_t type = u8();
+        if (type == PLACEMENTS_LIST)
+        {
+            std::shared_ptr<text_placements_list> list = std::make_shared<text_placements_list>();
+            text_properties(list->defaults);
+            std::uint32_t count = u32();
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                text_properties(list->add());
+            }
+            return text_placements_ptr(list);
+        }
+        else if (type == PLACEMENTS_SIMPLE)
+        {
+            text_symbolizer_properties defaults;
+            text_properties(defaults);
+            std::shared_ptr<text_placements_simple> simple = std::make_shared<text_placements_simple>(str());
+            simple->defaults = defaults;
+            return text_placements_ptr(simple);
+        }
+        else if (type == PLACEMENTS_DUMMY)
+        {
+            text_placements_ptr placements = std::make_shared<text_placements_dummy>();
+            text_properties(placements->defaults);
+            return placements;
+        }
+        throw config_error("compiled map has an unknown text placements type");
+    }
+    case PROP_DASH_ARRAY:
+    {
+        dash_array dash;
+        std::uint32_t count = element_count(2 * sizeof(double));
+        dash.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            double dash_length = pod<double>();
+            double gap_length = pod<double>();
+            dash.emplace_back(dash_length, gap_length);
+        }
+        return dash;
+    }
+    case PROP_COLORIZER:
+    {
+        if (!boolean()) return raster_colorizer_ptr();
+        colorizer_mode_enum mode = static_cast<colorizer_mode_enum>(pod<std::int32_t>());
+        color default_color = col();
+        raster_colorizer_ptr colorizer = std::make_shared<raster_colorizer>(mode, default_color);
+        colorizer->set_epsilon(pod<float>());
+        std::uint32_t count = u32();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            float value = pod<float>();
+            colorizer_mode_enum stop_mode = static_cast<colorizer_mode_enum>(pod<std::int32_t>());
+            color stop_color = col();
+            std::string label = str();
+            colorizer->add_stop(colorizer_stop(value, stop_mode, stop_color, label));
+        }
+        return colorizer;
+    }
+    case PROP_GROUP_PROPERTIES:
+    {
+        if (!boolean()) return group_symbolizer_properties_ptr();
+        group_symbolizer_properties_ptr props = std::make_shared<group_symbolizer_properties>();
+        if (u8() == 1)
+        {
+            double item_margin = pod<double>();
+            double max_difference = pod<double>();
+            props->set_layout(pair_layout(item_margin, max_difference));
+        }
+        else
+        {
+            props->set_layout(simple_row_layout(pod<double>()));
+        }
+        std::uint32_t count = u32();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            expression_ptr filter = expression_ptr_value();
+            expression_ptr repeat_key = expression_ptr_value();
+            group_rule_ptr rule = std::make_shared<group_rule>(filter, repeat_key);
+            std::uint32_t sym_count = u32();
+            for (std::uint32_t j = 0; j < sym_count; ++j)
+            {
+                rule->append(symbolizer());
+            }
+            props->add_rule(rule);
+        }
+        return props;
+    }
+    default:
+        throw config_error("compiled map has an unknown symbolizer property type");
+    }
+}
+
+void compiled_reader::properties(symbolizer_base::cont_type & props)
+{
+    std::uint32_t count = u32();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        std::uint8_t key = u8();
+        if (key >= static_cast<std::uint8_t>(keys::MAX_SYMBOLIZER_KEY))
+        {
+            throw config_error("compiled map has an unknown symbolizer property");
+        }
+        props.emplace(static_cast<keys>(key), property());
+    }
+}
+
+mapnik::symbolizer compiled_reader::symbolizer()
+{
+    switch (u8())
+    {
+    case SYM_POINT: return read_symbolizer<point_symbolizer>();
+    case SYM_LINE: return read_symbolizer<line_symbolizer>();
+    case SYM_LINE_PATTERN: return read_symbolizer<line_pattern_symbolizer>();
+    case SYM_POLYGON: return read_symbolizer<polygon_symbolizer>();
+    case SYM_POLYGON_PATTERN: return read_symbolizer<polygon_pattern_symbolizer>();
+    case SYM_RASTER: return read_symbolizer<raster_symbolizer>();
+    case SYM_SHIELD: return read_symbolizer<shield_symbolizer>();
+    case SYM_TEXT: return read_symbolizer<text_symbolizer>();
+    case SYM_BUILDING: return read_symbolizer<building_symbolizer>();
+    case SYM_MARKERS: return read_symbolizer<markers_symbolizer>();
+    case SYM_GROUP: return read_symbolizer<group_symbolizer>();
+    case SYM_DEBUG: return read_symbolizer<debug_symbolizer>();
+    default:
+        throw config_error("compiled map has an unknown symbolizer type");
+    }
+}
+
+void compiled_reader::text_properties(text_symbolizer_properties & props)
+{
+    text_properties_expressions & expr = props.expressions;
+    expr.label_placement = property();
+    expr.label_spacing = property();
+    expr.label_position_tolerance = property();
+    expr.avoid_edges = property();
+    expr.repeat_distance = property();
+    expr.minimum_distance = property();
+    expr.minimum_padding = property();
+    expr.minimum_path_length = property();
+    expr.max_char_angle_delta = property();
+    expr.allow_overlap = property();
+    expr.largest_bbox_only = property();
+    expr.upright = property();
+
+    text_layout_properties & layout = props.layout_defaults;
+    layout.dx = property();
+    layout.dy = property();
+    layout.orientation = property();
+    layout.text_ratio = property();
+    layout.wrap_width = property();
+    layout.wrap_before = property();
+    layout.rotate_displacement = property();
+    layout.halign = property();
+    layout.jalign = property();
+    layout.valign = property();
+
+    format_properties & format = props.format_defaults;
+    format.face_name = str();
+    if (boolean()) format.fontset = fontset();
+    else format.fontset = boost::none;
+    format.text_size = property();
+    format.character_spacing = property();
+    format.line_spacing = property();
+    format.text_opacity = property();
+    format.halo_opacity = property();
+    format.fill = property();
+    format.halo_fill = property();
+    format.halo_radius = property();
+    format.text_transform = property();
+
+    props.set_format_tree(format_tree());
+}
+
+void read_optional(compiled_reader & in, boost::optional<symbolizer_base::value_type> & val)
+{
+    if (in.boolean()) val = in.property();
+}
+
+formatting::node_ptr compiled_reader::format_tree()
+{
+    switch (u8())
+    {
+    case NODE_NONE:
+        return formatting::node_ptr();
+    case NODE_TEXT:
+        return std::make_shared<formatting::text_node>(expression_ptr_value());
+    case NODE_FORMAT:
+    {
+        std::shared_ptr<formatting::format_node> format = std::make_shared<formatting::format_node>();
+        if (boolean()) format->face_name = str();
+        if (boolean()) format->fontset = fontset();
+        read_optional(*this, format->text_size);
+        read_optional(*this, format->character_spacing);
+        read_optional(*this, format->line_spacing);
+        read_optional(*this, format->text_opacity);
+        read_optional(*this, format->wrap_before);
+        read_optional(*this, format->text_transform);
+        read_optional(*this, format->fill);
+        read_optional(*this, format->halo_fill);
+        read_optional(*this, format->halo_radius);
+        format->set_child(format_tree());
+        return format;
+    }
+    case NODE_LAYOUT:
+    {
+        std::shared_ptr<formatting::layout_node> layout = std::make_shared<formatting::layout_node>();
+        read_optional(*this, layout->dx);
+        read_optional(*this, layout->dy);
+        read_optional(*this, layout->halign);
+        read_optional(*this, layout->valign);
+        read_optional(*this, layout->jalign);
+        read_optional(*this, layout->text_ratio);
+        read_optional(*this, layout->wrap_width);
+        read_optional(*this, layout->wrap_before);
+        read_optional(*this, layout->rotate_displacement);
+        read_optional(*this, layout->orientation);
+        layout->set_child(format_tree());
+        return layout;
+    }
+    case NODE_LIST:
+    {
+        std::shared_ptr<formatting::list_node> list = std::make_shared<formatting::list_node>();
+        std::uint32_t count = u32();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            list->push_back(format_tree());
+        }
+        return list;
+    }
+    default:
+        throw config_error("compiled map has an unknown text formatting node");
+    }
+}
+
+void compiled_reader::image_filters(std::vector<filter::filter_type> & filters)
+{
+    std::uint32_t count = element_count(1);
+    filters.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        switch (u8())
+        {
+        case FILTER_BLUR: filters.emplace_back(filter::blur()); break;
+        case FILTER_GRAY: filters.emplace_back(filter::gray()); break;
+        case FILTER_EMBOSS: filters.emplace_back(filter::emboss()); break;
+        case FILTER_SHARPEN: filters.emplace_back(filter::sharpen()); break;
+        case FILTER_EDGE_DETECT: filters.emplace_back(filter::edge_detect()); break;
+        case FILTER_SOBEL: filters.emplace_back(filter::sobel()); break;
+        case FILTER_X_GRADIENT: filters.emplace_back(filter::x_gradient()); break;
+        case FILTER_Y_GRADIENT: filters.emplace_back(filter::y_gradient()); break;
+        case FILTER_INVERT: filters.emplace_back(filter::invert()); break;
+        case FILTER_AGG_STACK_BLUR:
+        {
+            unsigned rx = u32();
+            unsigned ry = u32();
+            filters.emplace_back(filter::agg_stack_blur(rx, ry));
+            break;
+        }
+        case FILTER_SCALE_HSLA:
+        {
+            double v[8];
+            for (double & d : v) d = pod<double>();
+            filters.emplace_back(filter::scale_hsla(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]));
+            break;
+        }
+        case FILTER_COLORIZE_ALPHA:
+        {
+            filter::colorize_alpha colorize;
+            std::uint32_t stops = u32();
+            for (std::uint32_t j = 0; j < stops; ++j)
+            {
+                color c = col();
+                colorize.emplace_back(c, pod<double>());
+            }
+            filters.emplace_back(colorize);
+            break;
+        }
+        case FILTER_COLOR_TO_ALPHA:
+            filters.emplace_back(filter::color_to_alpha(col()));
+            break;
+        default:
+            throw config_error("compiled map has an unknown image filter");
+        }
+    }
+}
+
+feature_type_style compiled_reader::style()
+{
+    feature_type_style style;
+    style.set_filter_mode(static_cast<filter_mode_enum>(u8()));
+    if (boolean()) style.set_comp_op(static_cast<composite_mode_e>(pod<std::int32_t>()));
+    style.set_opacity(pod<float>());
+    style.set_image_filters_inflate(boolean());
+    image_filters(style.image_filters());
+    image_filters(style.direct_image_filters());
+
+    // name length, scale range, filter flag, else and also, symbolizer count
+    std::uint32_t rule_count = element_count(sizeof(std::uint32_t) + 2 * sizeof(double) + 3 + sizeof(std::uint32_t));
+    style.reserve(rule_count);
+    for (std::uint32_t i = 0; i < rule_count; ++i)
+    {
+        rule r(str());
+        r.set_min_scale(pod<double>());
+        r.set_max_scale(pod<double>());
+        expression_ptr filter = expression_ptr_value();
+        if (filter) r.set_filter(filter);
+        r.set_else(boolean());
+        r.set_also(boolean());
+        // a type byte and a property count per symbolizer
+        std::uint32_t sym_count = element_count(1 + sizeof(std::uint32_t));
+        r.reserve(sym_count);
+        for (std::uint32_t j = 0; j < sym_count; ++j)
+        {
+            r.append(symbolizer());
+        }
+        style.add_rule(std::move(r));
+    }
+    return style;
+}
+
+mapnik::layer compiled_reader::layer()
+{
+    std::string name = str();
+    std::string srs = str();
+    mapnik::layer lyr(name, srs);
+    lyr.set_min_zoom(pod<double>());
+    lyr.set_max_zoom(pod<double>());
+    lyr.set_active(boolean());
+    lyr.set_queryable(boolean());
+    lyr.set_clear_label_cache(boolean());
+    lyr.set_cache_features(boolean());
+    lyr.set_group_by(str());
+    if (boolean()) lyr.set_buffer_size(pod<std::int32_t>());
+    if (boolean()) lyr.set_maximum_extent(box());
+    std::uint32_t style_count = u32();
+    for (std::uint32_t i = 0; i < style_count; ++i)
+    {
+        lyr.add_style(str());
+    }
+    if (boolean())
+    {
+        mapnik::parameters params = parameters();
+        try
+        {
+            lyr.set_datasource(datasource_cache::instance().create(params));
+        }
+        catch (std::exception const& ex)
+        {
+            throw config_error(ex.what());
+        }
+        catch (...)
+        {
+            throw config_error("Unknown exception occured attempting to create datasoure for layer '" + lyr.name() + "'");
+        }
+    }
+    return lyr;
+}
+
+}
+
+std::string save_compiled_map_to_string(Map const& map)
+{
+    std::string out;
+    compiled_writer writer(out);
+    out.append(compiled_map_magic, sizeof(compiled_map_magic));
+    writer.u32(compiled_map_version);
+    writer.u32(byte_order_mark);
+
+    writer.str(map.srs());
+    writer.pod(static_cast<std::int32_t>(map.buffer_size()));
+    writer.str(map.base_path());
+    writer.boolean(static_cast<bool>(map.background()));
+    if (map.background()) writer.col(*map.background());
+    writer.boolean(static_cast<bool>(map.background_image()));
+    if (map.background_image()) writer.str(*map.background_image());
+    writer.pod(static_cast<std::int32_t>(map.background_image_comp_op()));
+    writer.pod(map.background_image_opacity());
+    writer.boolean(static_cast<bool>(map.maximum_extent()));
+    if (map.maximum_extent()) writer.box(*map.maximum_extent());
+    writer.parameters(map.get_extra_parameters());
+
+    writer.u32(static_cast<std::uint32_t>(map.fontsets().size()));
+    for (auto const& kv : map.fontsets())
+    {
+        writer.str(kv.first);
+        writer.fontset(kv.second);
+    }
+    writer.u32(static_cast<std::uint32_t>(map.styles().size()));
+    for (auto const& kv : map.styles())
+    {
+        writer.str(kv.first);
+        writer.style(kv.second);
+    }
+    writer.u32(static_cast<std::uint32_t>(map.layers().size()));
+    for (layer const& lyr : map.layers())
+    {
+        writer.layer(lyr);
+    }
+    return out;
+}
+
+void save_compiled_map(Map const& map, std::string const& filename)
+{
+    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw config_error("Could not write compiled map to '" + filename + "'");
+    }
+    std::string data = save_compiled_map_to_string(map);
+    file.write(data.data(), data.size());
+}
+
+void load_compiled_map_string(Map & map, std::string const& str)
+{
+    if (str.size() < sizeof(compiled_map_magic) ||
+        std::memcmp(str.data(), compiled_map_magic, sizeof(compiled_map_magic)) != 0)
+    {
+        throw config_error("Not a compiled map");
+    }
+    compiled_reader reader(str.data() + sizeof(compiled_map_magic), str.data() + str.size());
+    std::uint32_t version = reader.u32();
+    if (version != compiled_map_version)
+    {
+        std::ostringstream s;
+        s << "Unsupported compiled map version " << version << ", expected " << compiled_map_version;
+        throw config_error(s.str());
+    }
+    if (reader.u32() != byte_order_mark)
+    {
+        throw config_error("Compiled map was written on a machine with a different byte order");
+    }
+
+    map.set_srs(reader.str());
+    map.set_buffer_size(reader.pod<std::int32_t>());
+    map.set_base_path(reader.str());
+    if (reader.boolean()) map.set_background(reader.col());
+    if (reader.boolean()) map.set_background_image(reader.str());
+    map.set_background_image_comp_op(static_cast<composite_mode_e>(reader.pod<std::int32_t>()));
+    map.set_background_image_opacity(reader.pod<float>());
+    if (reader.boolean()) map.set_maximum_extent(reader.box());
+    mapnik::parameters extra_params = reader.parameters();
+    map.set_extra_parameters(extra_params);
+
+    std::uint32_t fontset_count = reader.u32();
+    for (std::uint32_t i = 0; i < fontset_count; ++i)
+    {
+        std::string name = reader.str();
+        map.insert_fontset(name, reader.fontset());
+    }
+    std::uint32_t style_count = reader.u32();
+    for (std::uint32_t i = 0; i < style_count; ++i)
+    {
+        std::string name = reader.str();
+        map.insert_style(name, reader.style());
+    }
+    std::uint32_t layer_count = reader.u32();
+    for (std::uint32_t i = 0; i < layer_count; ++i)
+    {
+        map.add_layer(reader.layer());
+    }
+    if (!reader.at_end())
+    {
+        throw config_error("Compiled map has trailing data");
+    }
+}
+
+void load_compiled_map(Map & map, std::string const& filename)
+{
+    std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        throw config_error("Could not open compiled map '" + filename + "'");
+    }
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    load_compiled_map_string(map, data);
+}
+
+}
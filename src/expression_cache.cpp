@@ -0,0 +1,131 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/expression_cache.hpp>
+#include <mapnik/parse_path.hpp>
+#include <mapnik/parse_transform.hpp>
+
+// stl
+#include <algorithm>
+
+namespace mapnik
+{
+
+template class singleton<expression_cache, CreateStatic>;
+
+namespace {
+
+template <typename Cache>
+void prune_expired(Cache & cache)
+{
+    for (auto itr = cache.begin(); itr != cache.end();)
+    {
+        if (itr->second.expired()) itr = cache.erase(itr);
+        else ++itr;
+    }
+}
+
+}
+
+expression_cache::expression_cache()
+    : expressions_(),
+      paths_(),
+      transforms_(),
+      prune_at_(1024) {}
+
+template <typename T, typename Parse>
+std::shared_ptr<T> expression_cache::intern(std::unordered_map<std::string, std::weak_ptr<T> > & cache,
+                                            std::string const& str, Parse parse)
+{
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        auto itr = cache.find(str);
+        if (itr != cache.end())
+        {
+            std::shared_ptr<T> result = itr->second.lock();
+            if (result) return result;
+        }
+    }
+    // parse without holding the lock, a concurrent parse of the same
+    // string is resolved below in favour of whichever was stored first
+    std::shared_ptr<T> parsed = parse(str);
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    std::weak_ptr<T> & entry = cache[str];
+    std::shared_ptr<T> result = entry.lock();
+    if (result) return result;
+    entry = parsed;
+    if (expressions_.size() + paths_.size() + transforms_.size() > prune_at_)
+    {
+        prune();
+    }
+    return parsed;
+}
+
+void expression_cache::prune()
+{
+    prune_expired(expressions_);
+    prune_expired(paths_);
+    prune_expired(transforms_);
+    // grow the threshold with the live entries so pruning stays amortized
+    prune_at_ = std::max<std::size_t>(1024, 2 * (expressions_.size() + paths_.size() + transforms_.size()));
+}
+
+expression_ptr expression_cache::expression(std::string const& str)
+{
+    return intern(expressions_, str, [](std::string const& s) { return parse_expression(s); });
+}
+
+path_expression_ptr expression_cache::path(std::string const& str)
+{
+    return intern(paths_, str, [](std::string const& s) { return parse_path(s); });
+}
+
+transform_list_ptr expression_cache::transform(std::string const& str)
+{
+    return intern(transforms_, str, [](std::string const& s) { return parse_transform(s); });
+}
+
+std::size_t expression_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return expressions_.size() + paths_.size() + transforms_.size();
+}
+
+void expression_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    expressions_.clear();
+    paths_.clear();
+    transforms_.clear();
+    prune_at_ = 1024;
+}
+
+}
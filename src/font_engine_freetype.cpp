@@ -25,6 +25,7 @@
 #include <mapnik/font_engine_freetype.hpp>
 #include <mapnik/pixel_position.hpp>
 #include <mapnik/text/face.hpp>
+#include <mapnik/text/text_layout_cache.hpp>
 #include <mapnik/util/fs.hpp>
 #include <mapnik/utils.hpp>
 
@@ -426,6 +427,16 @@ face_set_ptr face_manager<T>::get_face_set(const std::string &name, boost::optio
     }
 }
 
+template <typename T>
+text_layout_cache & face_manager<T>::get_layout_cache()
+{
+    if (!layout_cache_)
+    {
+        layout_cache_ = std::make_shared<text_layout_cache>();
+    }
+    return *layout_cache_;
+}
+
 #ifdef MAPNIK_THREADSAFE
 std::mutex freetype_engine::mutex_;
 #endif
@@ -0,0 +1,299 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#if defined(GRID_RENDERER)
+
+// mapnik
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_view.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/conversions.hpp>
+
+// stl
+#include <cmath>
+
+namespace mapnik
+{
+
+namespace {
+
+void append_utf8(std::string & output, std::uint32_t codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        output += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        output += static_cast<char>(0xc0 | (codepoint >> 6));
+        output += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+    else if (codepoint < 0x10000)
+    {
+        output += static_cast<char>(0xe0 | (codepoint >> 12));
+        output += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        output += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+    else
+    {
+        output += static_cast<char>(0xf0 | (codepoint >> 18));
+        output += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+        output += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        output += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+}
+
+void append_json_string(std::string & output, std::string const& str)
+{
+    static const char hex[] = "0123456789abcdef";
+    output += '"';
+    for (char c : str)
+    {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\')
+        {
+            output += '\\';
+            output += c;
+        }
+        else if (uc < 0x20)
+        {
+            output += "\\u00";
+            output += hex[uc >> 4];
+            output += hex[uc & 0xf];
+        }
+        else
+        {
+            output += c;
+        }
+    }
+    output += '"';
+}
+
+void append_number(std::string & output, unsigned val)
+{
+    std::string str;
+    util::to_string(str, val);
+    output += str;
+}
+
+struct json_value_appender
+{
+    using result_type = void;
+
+    explicit json_value_appender(std::string & output)
+        : output_(output) {}
+
+    void operator() (value_null) const
+    {
+        output_ += "null";
+    }
+
+    void operator() (value_bool val) const
+    {
+        output_ += val ? "true" : "false";
+    }
+
+    void operator() (value_integer val) const
+    {
+        std::string str;
+        util::to_string(str, val);
+        output_ += str;
+    }
+
+    void operator() (value_double val) const
+    {
+        if (!std::isfinite(val))
+        {
+            output_ += "null";
+            return;
+        }
+        std::string str;
+        util::to_string(str, val);
+        output_ += str;
+    }
+
+    void operator() (value_unicode_string const& val) const
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        append_json_string(output_, utf8);
+    }
+
+    std::string & output_;
+};
+
+template <typename T>
+void append_rows(T const& grid, utf_grid_keys<T> & keys, std::string & output,
+                 unsigned resolution, bool rle_rows)
+{
+    using value_type = typename T::value_type;
+    unsigned width = grid.width();
+    unsigned height = grid.height();
+    std::string run_utf8;
+    output += '[';
+    for (unsigned y = 0; y < height; y += resolution)
+    {
+        if (y > 0) output += ',';
+        output += rle_rows ? '[' : '"';
+        value_type const* row = grid.getRow(y);
+        unsigned x = 0;
+        bool first_run = true;
+        while (x < width)
+        {
+            // extend the run while the sampled pixel ids repeat, so the
+            // key lookup happens once per run rather than once per pixel
+            value_type feature_id = row[x];
+            unsigned count = 1;
+            x += resolution;
+            while (x < width && row[x] == feature_id)
+            {
+                ++count;
+                x += resolution;
+            }
+            std::uint32_t idx = keys.index(feature_id);
+            if (rle_rows)
+            {
+                if (!first_run) output += ',';
+                append_number(output, idx);
+                output += ',';
+                append_number(output, count);
+            }
+            else
+            {
+                run_utf8.clear();
+                append_utf8(run_utf8, utf_grid_keys<T>::codepoint_of(idx));
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    output += run_utf8;
+                }
+            }
+            first_run = false;
+        }
+        output += rle_rows ? ']' : '"';
+    }
+    output += ']';
+}
+
+template <typename T>
+void append_features(T const& grid, std::vector<typename T::lookup_type> const& key_order,
+                     std::string & output)
+{
+    typename T::feature_type const& features = grid.get_grid_features();
+    std::set<std::string> const& attributes = grid.property_names();
+    json_value_appender append_value(output);
+    bool first_feature = true;
+    output += '{';
+    for (typename T::lookup_type const& key : key_order)
+    {
+        if (key.empty()) continue;
+        auto feat_itr = features.find(key);
+        if (feat_itr == features.end()) continue;
+
+        mapnik::feature_ptr const& feature = feat_itr->second;
+        std::size_t start = output.size();
+        if (!first_feature) output += ',';
+        append_json_string(output, feat_itr->first);
+        output += ":{";
+        bool found = false;
+        bool first_attr = true;
+        for (std::string const& attr : attributes)
+        {
+            if (attr == "__id__")
+            {
+                if (!first_attr) output += ',';
+                append_json_string(output, attr);
+                output += ':';
+                append_value(static_cast<value_integer>(feature->id()));
+                first_attr = false;
+            }
+            else if (feature->has_key(attr))
+            {
+                found = true;
+                if (!first_attr) output += ',';
+                append_json_string(output, attr);
+                output += ':';
+                util::apply_visitor(append_value, feature->get(attr).base());
+                first_attr = false;
+            }
+        }
+        output += '}';
+        if (found)
+        {
+            first_feature = false;
+        }
+        else
+        {
+            // features with none of the requested attributes are left out
+            output.resize(start);
+        }
+    }
+    output += '}';
+}
+
+}
+
+template <typename T>
+void encode_utf_grid(T const& grid,
+                     std::string & output,
+                     unsigned resolution,
+                     bool add_features,
+                     bool rle_rows)
+{
+    if (resolution == 0) resolution = 1;
+    utf_grid_keys<T> keys(grid);
+
+    // string rows take one byte for each of the first 95 keys, rle rows
+    // usually far less; reserve for the common case up front
+    std::size_t rows = (grid.height() + resolution - 1) / resolution;
+    std::size_t columns = (grid.width() + resolution - 1) / resolution;
+    output.reserve(output.size() + rows * ((rle_rows ? 8 : columns) + 3) + 64);
+
+    output += "{\"grid\":";
+    append_rows(grid, keys, output, resolution, rle_rows);
+    output += ",\"keys\":[";
+    bool first = true;
+    for (typename T::lookup_type const& key : keys.key_order())
+    {
+        if (!first) output += ',';
+        append_json_string(output, key);
+        first = false;
+    }
+    output += "],\"data\":";
+    if (add_features)
+    {
+        append_features(grid, keys.key_order(), output);
+    }
+    else
+    {
+        output += "{}";
+    }
+    output += '}';
+}
+
+template MAPNIK_DECL void encode_utf_grid(grid const&, std::string &, unsigned, bool, bool);
+template MAPNIK_DECL void encode_utf_grid(grid_view const&, std::string &, unsigned, bool, bool);
+
+}
+
+#endif
@@ -62,6 +62,7 @@ void  grid_renderer<T>::process(shield_symbolizer const& sym,
                               common_.scale_factor_);
 
     placements_list const& placements = helper.get();
+    this->record_labels(placements.size());
     value_integer feature_id = feature.id();
 
     for (glyph_positions_ptr glyphs : placements)
@@ -54,6 +54,7 @@ void grid_renderer<T>::process(text_symbolizer const& sym,
                               common_.scale_factor_);
 
     placements_list const& placements = helper.get();
+    this->record_labels(placements.size());
     value_integer feature_id = feature.id();
 
     for (glyph_positions_ptr glyphs : placements)
@@ -53,6 +53,7 @@ bool group_rule::operator==(const group_rule &rhs) const
 void group_rule::append(const mapnik::symbolizer &sym)
 {
    symbolizers_.push_back(sym);
+   compile_properties(symbolizers_.back());
 }
 
 }
@@ -36,6 +36,18 @@
 #include "agg_pixfmt_rgba.h"
 #include "agg_color_rgba.h"
 
+// stl
+#include <cstdint>
+#include <algorithm>
+
+// SIMD kernels for the most common modes, selected at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MAPNIK_COMPOSITE_SIMD
+#include <immintrin.h>
+#define MAPNIK_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define MAPNIK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 namespace mapnik
 {
 
@@ -117,6 +129,325 @@ For example, if you generate some pattern with AGG (premultiplied) and would lik
 */
 
 
+namespace detail {
+
+using row_blend_function = void (*)(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover);
+
+// Scalar rows, also used for the tail of every SIMD row. Calls the very same
+// AGG blend_pix as pixfmt_custom_blend_rgba so results are bit-for-bit equal.
+template <typename Op>
+void blend_row_scalar(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    for (unsigned i = 0; i < len; ++i, dst += 4, src += 4)
+    {
+        Op::blend_pix(dst, src[0], src[1], src[2], src[3], cover);
+    }
+}
+
+using color_type = agg::rgba8;
+using order_type = agg::order_rgba;
+using src_over_op = agg::comp_op_rgba_src_over<color_type, order_type>;
+using dst_out_op = agg::comp_op_rgba_dst_out<color_type, order_type>;
+using multiply_op = agg::comp_op_rgba_multiply<color_type, order_type>;
+using screen_op = agg::comp_op_rgba_screen<color_type, order_type>;
+using overlay_op = agg::comp_op_rgba_overlay<color_type, order_type>;
+
+#ifdef MAPNIK_COMPOSITE_SIMD
+
+// All kernels widen every channel to a 32 bit lane and reproduce the integer
+// arithmetic of the AGG blenders (including unsigned wrap-around and the
+// final truncation to 8 bits), so the output matches the scalar path exactly.
+
+// SSE4.1: one pixel per __m128i (r,g,b,a lanes)
+namespace sse41 {
+
+MAPNIK_TARGET_SSE41 inline __m128i alpha(__m128i v)
+{
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(3,3,3,3));
+}
+
+MAPNIK_TARGET_SSE41 inline __m128i div255(__m128i v)
+{
+    // (v + base_mask) >> base_shift
+    return _mm_srli_epi32(_mm_add_epi32(v, _mm_set1_epi32(255)), 8);
+}
+
+MAPNIK_TARGET_SSE41 inline __m128i with_alpha(__m128i rgb, __m128i a)
+{
+    return _mm_blend_epi16(rgb, a, 0xC0);
+}
+
+// Da' = Sa + Da - Sa.Da
+MAPNIK_TARGET_SSE41 inline __m128i union_alpha(__m128i sa, __m128i da)
+{
+    return _mm_sub_epi32(_mm_add_epi32(sa, da), div255(_mm_mullo_epi32(sa, da)));
+}
+
+// leave the destination untouched where source alpha is zero
+MAPNIK_TARGET_SSE41 inline __m128i skip_transparent(__m128i result, __m128i d, __m128i sa)
+{
+    return _mm_blendv_epi8(result, d, _mm_cmpeq_epi32(sa, _mm_setzero_si128()));
+}
+
+struct src_over
+{
+    MAPNIK_TARGET_SSE41 static inline __m128i apply(__m128i s, __m128i d)
+    {
+        __m128i s1a = _mm_sub_epi32(_mm_set1_epi32(255), alpha(s));
+        return _mm_add_epi32(s, div255(_mm_mullo_epi32(d, s1a)));
+    }
+};
+
+struct dst_out
+{
+    MAPNIK_TARGET_SSE41 static inline __m128i apply(__m128i s, __m128i d)
+    {
+        // note: AGG rounds with base_shift here, not base_mask
+        __m128i s1a = _mm_sub_epi32(_mm_set1_epi32(255), alpha(s));
+        return _mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(d, s1a), _mm_set1_epi32(8)), 8);
+    }
+};
+
+struct multiply
+{
+    MAPNIK_TARGET_SSE41 static inline __m128i apply(__m128i s, __m128i d)
+    {
+        __m128i sa = alpha(s);
+        __m128i da = alpha(d);
+        __m128i s1a = _mm_sub_epi32(_mm_set1_epi32(255), sa);
+        __m128i d1a = _mm_sub_epi32(_mm_set1_epi32(255), da);
+        __m128i rgb = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(s, d), _mm_mullo_epi32(s, d1a)),
+                                    _mm_mullo_epi32(d, s1a));
+        return skip_transparent(with_alpha(div255(rgb), union_alpha(sa, da)), d, sa);
+    }
+};
+
+struct screen
+{
+    MAPNIK_TARGET_SSE41 static inline __m128i apply(__m128i s, __m128i d)
+    {
+        __m128i result = _mm_sub_epi32(_mm_add_epi32(s, d), div255(_mm_mullo_epi32(s, d)));
+        return skip_transparent(result, d, alpha(s));
+    }
+};
+
+struct overlay
+{
+    MAPNIK_TARGET_SSE41 static inline __m128i apply(__m128i s, __m128i d)
+    {
+        __m128i sa = alpha(s);
+        __m128i da = alpha(d);
+        __m128i s1a = _mm_sub_epi32(_mm_set1_epi32(255), sa);
+        __m128i d1a = _mm_sub_epi32(_mm_set1_epi32(255), da);
+        __m128i common = _mm_add_epi32(_mm_mullo_epi32(s, d1a), _mm_mullo_epi32(d, s1a));
+        __m128i dark = _mm_add_epi32(_mm_slli_epi32(_mm_mullo_epi32(s, d), 1), common);
+        __m128i light = _mm_add_epi32(_mm_sub_epi32(_mm_mullo_epi32(sa, da),
+                                                    _mm_slli_epi32(_mm_mullo_epi32(_mm_sub_epi32(da, d),
+                                                                                   _mm_sub_epi32(sa, s)), 1)),
+                                      _mm_add_epi32(common, _mm_set1_epi32(255)));
+        __m128i is_dark = _mm_cmplt_epi32(_mm_slli_epi32(d, 1), da);
+        __m128i rgb = _mm_srli_epi32(_mm_blendv_epi8(light, dark, is_dark), 8);
+        return skip_transparent(with_alpha(rgb, union_alpha(sa, da)), d, sa);
+    }
+};
+
+template <typename Op, typename ScalarOp>
+MAPNIK_TARGET_SSE41 void blend_row(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    __m128i const mask = _mm_set1_epi32(0xff);
+    __m128i const cov = _mm_set1_epi32(cover);
+    unsigned i = 0;
+    for (; i + 4 <= len; i += 4, dst += 16, src += 16)
+    {
+        __m128i s16 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));
+        __m128i d16 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst));
+        __m128i r[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128i s = _mm_cvtepu8_epi32(s16);
+            __m128i d = _mm_cvtepu8_epi32(d16);
+            if (cover < 255) s = div255(_mm_mullo_epi32(s, cov));
+            r[k] = _mm_and_si128(Op::apply(s, d), mask);
+            s16 = _mm_srli_si128(s16, 4);
+            d16 = _mm_srli_si128(d16, 4);
+        }
+        __m128i out = _mm_packus_epi16(_mm_packus_epi32(r[0], r[1]), _mm_packus_epi32(r[2], r[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+    }
+    blend_row_scalar<ScalarOp>(dst, src, len - i, cover);
+}
+
+}
+
+// AVX2: two pixels per __m256i
+namespace avx2 {
+
+MAPNIK_TARGET_AVX2 inline __m256i alpha(__m256i v)
+{
+    return _mm256_shuffle_epi32(v, _MM_SHUFFLE(3,3,3,3));
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i div255(__m256i v)
+{
+    return _mm256_srli_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(255)), 8);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i with_alpha(__m256i rgb, __m256i a)
+{
+    return _mm256_blend_epi32(rgb, a, 0x88);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i union_alpha(__m256i sa, __m256i da)
+{
+    return _mm256_sub_epi32(_mm256_add_epi32(sa, da), div255(_mm256_mullo_epi32(sa, da)));
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i skip_transparent(__m256i result, __m256i d, __m256i sa)
+{
+    return _mm256_blendv_epi8(result, d, _mm256_cmpeq_epi32(sa, _mm256_setzero_si256()));
+}
+
+struct src_over
+{
+    MAPNIK_TARGET_AVX2 static inline __m256i apply(__m256i s, __m256i d)
+    {
+        __m256i s1a = _mm256_sub_epi32(_mm256_set1_epi32(255), alpha(s));
+        return _mm256_add_epi32(s, div255(_mm256_mullo_epi32(d, s1a)));
+    }
+};
+
+struct dst_out
+{
+    MAPNIK_TARGET_AVX2 static inline __m256i apply(__m256i s, __m256i d)
+    {
+        __m256i s1a = _mm256_sub_epi32(_mm256_set1_epi32(255), alpha(s));
+        return _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(d, s1a), _mm256_set1_epi32(8)), 8);
+    }
+};
+
+struct multiply
+{
+    MAPNIK_TARGET_AVX2 static inline __m256i apply(__m256i s, __m256i d)
+    {
+        __m256i sa = alpha(s);
+        __m256i da = alpha(d);
+        __m256i s1a = _mm256_sub_epi32(_mm256_set1_epi32(255), sa);
+        __m256i d1a = _mm256_sub_epi32(_mm256_set1_epi32(255), da);
+        __m256i rgb = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(s, d), _mm256_mullo_epi32(s, d1a)),
+                                       _mm256_mullo_epi32(d, s1a));
+        return skip_transparent(with_alpha(div255(rgb), union_alpha(sa, da)), d, sa);
+    }
+};
+
+struct screen
+{
+    MAPNIK_TARGET_AVX2 static inline __m256i apply(__m256i s, __m256i d)
+    {
+        __m256i result = _mm256_sub_epi32(_mm256_add_epi32(s, d), div255(_mm256_mullo_epi32(s, d)));
+        return skip_transparent(result, d, alpha(s));
+    }
+};
+
+struct overlay
+{
+    MAPNIK_TARGET_AVX2 static inline __m256i apply(__m256i s, __m256i d)
+    {
+        __m256i sa = alpha(s);
+        __m256i da = alpha(d);
+        __m256i s1a = _mm256_sub_epi32(_mm256_set1_epi32(255), sa);
+        __m256i d1a = _mm256_sub_epi32(_mm256_set1_epi32(255), da);
+        __m256i common = _mm256_add_epi32(_mm256_mullo_epi32(s, d1a), _mm256_mullo_epi32(d, s1a));
+        __m256i dark = _mm256_add_epi32(_mm256_slli_epi32(_mm256_mullo_epi32(s, d), 1), common);
+        __m256i light = _mm256_add_epi32(_mm256_sub_epi32(_mm256_mullo_epi32(sa, da),
+                                                          _mm256_slli_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(da, d),
+                                                                                               _mm256_sub_epi32(sa, s)), 1)),
+                                         _mm256_add_epi32(common, _mm256_set1_epi32(255)));
+        __m256i is_dark = _mm256_cmpgt_epi32(da, _mm256_slli_epi32(d, 1));
+        __m256i rgb = _mm256_srli_epi32(_mm256_blendv_epi8(light, dark, is_dark), 8);
+        return skip_transparent(with_alpha(rgb, union_alpha(sa, da)), d, sa);
+    }
+};
+
+template <typename Op, typename ScalarOp>
+MAPNIK_TARGET_AVX2 void blend_row(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    __m256i const mask = _mm256_set1_epi32(0xff);
+    __m256i const cov = _mm256_set1_epi32(cover);
+    // undo the lane interleaving of the two pack steps
+    __m256i const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    unsigned i = 0;
+    for (; i + 8 <= len; i += 8, dst += 32, src += 32)
+    {
+        __m256i r[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + 8 * k)));
+            __m256i d = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(dst + 8 * k)));
+            if (cover < 255) s = div255(_mm256_mullo_epi32(s, cov));
+            r[k] = _mm256_and_si256(Op::apply(s, d), mask);
+        }
+        __m256i out = _mm256_packus_epi16(_mm256_packus_epi32(r[0], r[1]), _mm256_packus_epi32(r[2], r[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(out, order));
+    }
+    blend_row_scalar<ScalarOp>(dst, src, len - i, cover);
+}
+
+}
+
+#endif // MAPNIK_COMPOSITE_SIMD
+
+enum simd_level
+{
+    SIMD_NONE,
+    SIMD_SSE41,
+    SIMD_AVX2
+};
+
+inline simd_level detect_simd_level()
+{
+#ifdef MAPNIK_COMPOSITE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SIMD_SSE41;
+#endif
+    return SIMD_NONE;
+}
+
+// returns null when the mode has no dedicated kernel
+row_blend_function select_row_blend(composite_mode_e mode)
+{
+#ifdef MAPNIK_COMPOSITE_SIMD
+    static const simd_level level = detect_simd_level();
+    if (level == SIMD_AVX2)
+    {
+        switch (mode)
+        {
+        case src_over: return &avx2::blend_row<avx2::src_over, src_over_op>;
+        case dst_out: return &avx2::blend_row<avx2::dst_out, dst_out_op>;
+        case multiply: return &avx2::blend_row<avx2::multiply, multiply_op>;
+        case screen: return &avx2::blend_row<avx2::screen, screen_op>;
+        case overlay: return &avx2::blend_row<avx2::overlay, overlay_op>;
+        default: break;
+        }
+    }
+    else if (level == SIMD_SSE41)
+    {
+        switch (mode)
+        {
+        case src_over: return &sse41::blend_row<sse41::src_over, src_over_op>;
+        case dst_out: return &sse41::blend_row<sse41::dst_out, dst_out_op>;
+        case multiply: return &sse41::blend_row<sse41::multiply, multiply_op>;
+        case screen: return &sse41::blend_row<sse41::screen, screen_op>;
+        case overlay: return &sse41::blend_row<sse41::overlay, overlay_op>;
+        default: break;
+        }
+    }
+#endif
+    return nullptr;
+}
+
+} // namespace detail
+
 template <typename T1, typename T2>
 void composite(T1 & dst, T2 & src, composite_mode_e mode,
                float opacity,
@@ -133,13 +464,33 @@ void composite(T1 & dst, T2 & src, composite_mode_e mode,
     agg::rendering_buffer dst_buffer(dst.getBytes(),dst.width(),dst.height(),dst.width() * 4);
     agg::rendering_buffer src_buffer(src.getBytes(),src.width(),src.height(),src.width() * 4);
 
-    pixfmt_type pixf(dst_buffer);
-    pixf.comp_op(static_cast<agg::comp_op_e>(mode));
-
     agg::pixfmt_rgba32 pixf_mask(src_buffer);
     if (premultiply_src)  pixf_mask.premultiply();
+    // same truncation as agg::cover_type
+    unsigned cover = static_cast<agg::int8u>(unsigned(255*opacity));
+
+    detail::row_blend_function blend_row = detail::select_row_blend(mode);
+    if (blend_row != nullptr && src.getBytes() != dst.getBytes())
+    {
+        int x0 = std::max(dx, 0);
+        int y0 = std::max(dy, 0);
+        int x1 = std::min(dx + static_cast<int>(src.width()), static_cast<int>(dst.width()));
+        int y1 = std::min(dy + static_cast<int>(src.height()), static_cast<int>(dst.height()));
+        if (x0 >= x1 || y0 >= y1) return;
+        unsigned len = static_cast<unsigned>(x1 - x0);
+        for (int y = y0; y < y1; ++y)
+        {
+            std::uint8_t * dst_row = dst_buffer.row_ptr(y) + (x0 << 2);
+            std::uint8_t const* src_row = src_buffer.row_ptr(y - dy) + ((x0 - dx) << 2);
+            blend_row(dst_row, src_row, len, cover);
+        }
+        return;
+    }
+
+    pixfmt_type pixf(dst_buffer);
+    pixf.comp_op(static_cast<agg::comp_op_e>(mode));
     renderer_type ren(pixf);
-    ren.blend_from(pixf_mask,0,dx,dy,unsigned(255*opacity));
+    ren.blend_from(pixf_mask,0,dx,dy,cover);
 }
 
 template void composite<mapnik::image_data_32,mapnik::image_data_32>(mapnik::image_data_32&,
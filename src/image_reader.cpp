@@ -25,6 +25,9 @@
 #include <mapnik/image_util.hpp>
 #include <mapnik/factory.hpp>
 
+// stl
+#include <algorithm>
+
 namespace mapnik
 {
 
@@ -63,6 +66,34 @@ inline boost::optional<std::string> type_from_bytes(char const* data, size_t siz
     return result_type();
 }
 
+void image_reader::read_reduced(unsigned x0, unsigned y0, unsigned factor, image_data_32& image)
+{
+    if (factor <= 1)
+    {
+        read(x0, y0, image);
+        return;
+    }
+    // no native support: read the covering full resolution window and keep every factor-th pixel
+    unsigned full_x0 = x0 * factor;
+    unsigned full_y0 = y0 * factor;
+    if (full_x0 >= width() || full_y0 >= height()) return;
+    unsigned full_width = std::min(image.width() * factor, width() - full_x0);
+    unsigned full_height = std::min(image.height() * factor, height() - full_y0);
+    image_data_32 full(full_width, full_height);
+    read(full_x0, full_y0, full);
+    unsigned w = std::min(unsigned(image.width()), (full_width + factor - 1) / factor);
+    unsigned h = std::min(unsigned(image.height()), (full_height + factor - 1) / factor);
+    for (unsigned y = 0; y < h; ++y)
+    {
+        unsigned const* src = full.getRow(y * factor);
+        unsigned * dst = image.getRow(y);
+        for (unsigned x = 0; x < w; ++x)
+        {
+            dst[x] = src[x * factor];
+        }
+    }
+}
+
 image_reader* get_image_reader(char const* data, size_t size)
 {
     boost::optional<std::string> type = type_from_bytes(data,size);
@@ -83,6 +83,8 @@ public:
     inline bool has_alpha() const { return false; }
     inline bool premultiplied_alpha() const { return true; }
     void read(unsigned x,unsigned y,image_data_32& image);
+    unsigned reduction(unsigned max_factor) const;
+    void read_reduced(unsigned x,unsigned y,unsigned factor,image_data_32& image);
 private:
     void init();
     static void on_error(j_common_ptr cinfo);
@@ -256,6 +258,21 @@ unsigned jpeg_reader<T>::height() const
 
 template <typename T>
 void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_data_32& image)
+{
+    read_reduced(x0, y0, 1, image);
+}
+
+template <typename T>
+unsigned jpeg_reader<T>::reduction(unsigned max_factor) const
+{
+    // libjpeg can scale by 1/2, 1/4 and 1/8 in the inverse DCT
+    unsigned factor = 1;
+    while (factor < 8 && factor * 2 <= max_factor) factor *= 2;
+    return factor;
+}
+
+template <typename T>
+void jpeg_reader<T>::read_reduced(unsigned x0, unsigned y0, unsigned factor, image_data_32& image)
 {
     stream_.clear();
     stream_.seekg(0, std::ios_base::beg);
@@ -270,6 +287,8 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_data_32& image)
     attach_stream(&cinfo, &stream_);
     int ret = jpeg_read_header(&cinfo, TRUE);
     if (ret != JPEG_HEADER_OK) throw image_reader_exception("JPEG Reader read(): failed to read header");
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = reduction(factor);
     jpeg_start_decompress(&cinfo);
     JSAMPARRAY buffer;
     int row_stride;
@@ -277,15 +296,21 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_data_32& image)
     row_stride = cinfo.output_width * cinfo.output_components;
     buffer = (*cinfo.mem->alloc_sarray) ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
 
-    unsigned w = std::min(unsigned(image.width()),width_ - x0);
-    unsigned h = std::min(unsigned(image.height()),height_ - y0);
+    if (x0 >= cinfo.output_width || y0 >= cinfo.output_height) return;
+    unsigned w = std::min(unsigned(image.width()),cinfo.output_width - x0);
+    unsigned h = std::min(unsigned(image.height()),cinfo.output_height - y0);
 
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER) && LIBJPEG_TURBO_VERSION_NUMBER >= 1005000
+    // rows above the region are skipped without running the inverse DCT
+    if (y0 > 0) jpeg_skip_scanlines(&cinfo, y0);
+#endif
     const std::unique_ptr<unsigned int[]> out_row(new unsigned int[w]);
-    unsigned row = 0;
-    while (cinfo.output_scanline < cinfo.output_height)
+    unsigned row = cinfo.output_scanline;
+    // stop decoding once the region is complete, the guard cleans up
+    while (row < y0 + h)
     {
         jpeg_read_scanlines(&cinfo, buffer, 1);
-        if (row >= y0 && row < y0 + h)
+        if (row >= y0)
         {
             for (unsigned int x = 0; x < w; ++x)
             {
@@ -306,7 +331,10 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_data_32& image)
         }
         ++row;
     }
-    jpeg_finish_decompress(&cinfo);
+    if (cinfo.output_scanline == cinfo.output_height)
+    {
+        jpeg_finish_decompress(&cinfo);
+    }
 }
 
 }
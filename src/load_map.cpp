@@ -40,6 +40,7 @@
 #include <mapnik/expression.hpp>
 #include <mapnik/parse_path.hpp>
 #include <mapnik/parse_transform.hpp>
+#include <mapnik/expression_cache.hpp>
 #include <mapnik/raster_colorizer.hpp>
 #include <mapnik/svg/svg_path_parser.hpp>
 #include <mapnik/text/placements/registry.hpp>
@@ -881,7 +882,7 @@ void map_parser::parse_point_symbolizer(rule & rule, xml_node const & node)
             *file = ensure_relative_to_xml(file);
             std::string filename = *file;
             ensure_exists(filename);
-            put(sym, keys::file, parse_path(filename));
+            put(sym, keys::file, expression_cache::instance().path(filename));
         }
 
         rule.append(std::move(sym));
@@ -940,7 +941,7 @@ void map_parser::parse_markers_symbolizer(rule & rule, xml_node const& node)
         if (!filename.empty())
         {
             ensure_exists(filename);
-            put(sym,keys::file, parse_path(filename));
+            put(sym,keys::file, expression_cache::instance().path(filename));
         }
 
         // overall opacity to be applied to all paths
@@ -1012,7 +1013,7 @@ void map_parser::parse_line_pattern_symbolizer(rule & rule, xml_node const & nod
 
         line_pattern_symbolizer symbol;
         parse_symbolizer_base(symbol, node);
-        put(symbol, keys::file, parse_path(file));
+        put(symbol, keys::file, expression_cache::instance().path(file));
         set_symbolizer_property<line_pattern_symbolizer,double>(symbol, keys::opacity, node);
 
         // offset value
@@ -1057,7 +1058,7 @@ void map_parser::parse_polygon_pattern_symbolizer(rule & rule,
         polygon_pattern_symbolizer sym;
 
         parse_symbolizer_base(sym, node);
-        put(sym, keys::file, parse_path(file));
+        put(sym, keys::file, expression_cache::instance().path(file));
 
         // image transform
         set_symbolizer_property<polygon_pattern_symbolizer, transform_type>(sym, keys::image_transform, node);
@@ -1191,7 +1192,7 @@ void map_parser::parse_shield_symbolizer(rule & rule, xml_node const& node)
 
         file = ensure_relative_to_xml(file);
         ensure_exists(file);
-        put(sym, keys::file , parse_path(file));
+        put(sym, keys::file , expression_cache::instance().path(file));
         optional<halo_rasterizer_e> halo_rasterizer_ = node.get_opt_attr<halo_rasterizer_e>("halo-rasterizer");
         if (halo_rasterizer_) put(sym, keys::halo_rasterizer, halo_rasterizer_enum(*halo_rasterizer_));
         rule.append(std::move(sym));
@@ -0,0 +1,197 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/scale_denominator.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/unique_lock.hpp>
+#include <mapnik/render_stats.hpp>
+#include <mapnik/util/timer.hpp>
+
+// stl
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <set>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#endif
+
+namespace mapnik
+{
+
+metatile::metatile(box2d<double> const& _extent,
+                   unsigned _columns,
+                   unsigned _rows,
+                   unsigned _tile_size)
+    : extent(_extent),
+      columns(_columns),
+      rows(_rows),
+      tile_size(_tile_size),
+      buffer_size(128),
+      scale_factor(1.0),
+      threads(1) {}
+
+std::vector<image_view<image_data_32> > slice_metatile(image_data_32 const& image,
+                                                       unsigned columns,
+                                                       unsigned rows,
+                                                       unsigned tile_size)
+{
+    if (image.width() < columns * tile_size || image.height() < rows * tile_size)
+    {
+        std::ostringstream s;
+        s << "slice_metatile: a " << image.width() << "x" << image.height()
+          << " image can't hold " << columns << "x" << rows << " tiles of " << tile_size << " pixels";
+        throw std::runtime_error(s.str());
+    }
+    std::vector<image_view<image_data_32> > tiles;
+    tiles.reserve(columns * rows);
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        for (unsigned column = 0; column < columns; ++column)
+        {
+            tiles.emplace_back(column * tile_size, row * tile_size, tile_size, tile_size, image);
+        }
+    }
+    return tiles;
+}
+
+void render_metatile(Map const& map,
+                     metatile const& tile,
+                     std::string const& format,
+                     tile_sink const& sink,
+                     render_stats * stats)
+{
+    if (tile.columns == 0 || tile.rows == 0 || tile.tile_size == 0) return;
+
+    // the size limits of Map::resize
+    std::size_t width = static_cast<std::size_t>(tile.columns) * tile.tile_size;
+    std::size_t height = static_cast<std::size_t>(tile.rows) * tile.tile_size;
+    if (width < 16 || width > (16 << 10) || height < 16 || height > (16 << 10))
+    {
+        throw std::runtime_error("render_metatile: metatile size out of the range a map can be rendered at");
+    }
+    // the block is rendered through a request, so the map is neither
+    // copied nor changed and can be shared between threads
+    request req(static_cast<unsigned>(width), static_cast<unsigned>(height), tile.extent);
+    req.set_buffer_size(tile.buffer_size);
+    attributes vars;
+    image_32 image(req.width(), req.height());
+    agg_renderer<image_32> ren(map, req, vars, image, tile.scale_factor);
+    ren.set_stats(stats);
+    {
+        // apply() would take the extent and size from the map, so the
+        // layers are walked here with the request's
+        double render_ms = 0.0;
+        {
+            accumulating_timer timer(render_ms);
+            ren.start_map_processing(map);
+            projection proj(map.srs(), true);
+            double scale_denom = scale_denominator(req.scale(), proj.is_geographic()) * tile.scale_factor;
+            for (layer const& lyr : map.layers())
+            {
+                if (lyr.visible(scale_denom))
+                {
+                    std::set<std::string> names;
+                    ren.apply_to_layer(lyr, ren, proj,
+                                       req.scale(), scale_denom,
+                                       req.width(), req.height(),
+                                       req.extent(), req.buffer_size(),
+                                       names);
+                }
+            }
+            ren.end_map_processing(map);
+        }
+        if (stats) stats->render_ms += render_ms;
+    }
+
+    std::vector<image_view<image_data_32> > tiles = slice_metatile(image.data(), tile.columns, tile.rows, tile.tile_size);
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::mutex mutex;
+    double encode_ms = 0.0;
+    auto encode = [&]
+    {
+        double thread_encode_ms = 0.0;
+        for (std::size_t i = next++; i < tiles.size(); i = next++)
+        {
+            try
+            {
+                std::string data;
+                {
+                    accumulating_timer timer(thread_encode_ms);
+                    data = save_to_string(tiles[i], format);
+                }
+                sink(static_cast<unsigned>(i % tile.columns),
+                     static_cast<unsigned>(i / tile.columns),
+                     std::move(data));
+            }
+            catch (...)
+            {
+                scoped_lock lock(mutex);
+                if (!error) error = std::current_exception();
+                // leave the remaining tiles to nobody
+                next = tiles.size();
+                break;
+            }
+        }
+        scoped_lock lock(mutex);
+        encode_ms += thread_encode_ms;
+    };
+
+#ifdef MAPNIK_THREADSAFE
+    std::size_t threads = tile.threads > 0 ? tile.threads : std::thread::hardware_concurrency();
+    threads = std::min<std::size_t>(tiles.size(), threads);
+    if (threads > 1)
+    {
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (std::size_t i = 1; i < threads; ++i)
+        {
+            workers.emplace_back(encode);
+        }
+        encode();
+        for (std::thread & worker : workers)
+        {
+            worker.join();
+        }
+    }
+    else
+#endif
+    {
+        encode();
+    }
+    if (stats) stats->encode_ms += encode_ms;
+    if (error) std::rethrow_exception(error);
+}
+
+}
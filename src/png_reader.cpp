@@ -79,6 +79,8 @@ public:
     inline bool has_alpha() const { return has_alpha_; }
     bool premultiplied_alpha() const { return false; } //http://www.libpng.org/pub/png/spec/1.1/PNG-Rationale.html
     void read(unsigned x,unsigned y,image_data_32& image);
+    unsigned reduction(unsigned max_factor) const;
+    void read_reduced(unsigned x,unsigned y,unsigned factor,image_data_32& image);
 private:
     void init();
     static void png_read_data(png_structp png_ptr, png_bytep data, png_size_t length);
@@ -218,6 +220,20 @@ unsigned png_reader<T>::height() const
 
 template <typename T>
 void png_reader<T>::read(unsigned x0, unsigned y0,image_data_32& image)
+{
+    read_reduced(x0, y0, 1, image);
+}
+
+template <typename T>
+unsigned png_reader<T>::reduction(unsigned max_factor) const
+{
+    unsigned factor = 1;
+    while (factor * 2 <= max_factor) factor *= 2;
+    return factor;
+}
+
+template <typename T>
+void png_reader<T>::read_reduced(unsigned x0, unsigned y0, unsigned factor, image_data_32& image)
 {
     stream_.clear();
     stream_.seekg(0, std::ios_base::beg);
@@ -260,7 +276,15 @@ void png_reader<T>::read(unsigned x0, unsigned y0,image_data_32& image)
     if (png_get_gAMA(png_ptr, info_ptr, &gamma))
         png_set_gamma(png_ptr, 2.2, gamma);
 
-    if (x0 == 0 && y0 == 0 && image.width() >= width_ && image.height() >= height_)
+    bool interlaced = png_get_interlace_type(png_ptr,info_ptr) == PNG_INTERLACE_ADAM7;
+    if (factor > 1 && interlaced)
+    {
+        // every pass touches every row, so rows can't be skipped
+        image_reader::read_reduced(x0, y0, factor, image);
+        return;
+    }
+
+    if (factor == 1 && x0 == 0 && y0 == 0 && image.width() >= width_ && image.height() >= height_)
     {
 
         if (png_get_interlace_type(png_ptr,info_ptr) == PNG_INTERLACE_ADAM7)
@@ -281,20 +305,37 @@ void png_reader<T>::read(unsigned x0, unsigned y0,image_data_32& image)
     else
     {
         png_read_update_info(png_ptr, info_ptr);
-        unsigned w=std::min(unsigned(image.width()),width_ - x0);
-        unsigned h=std::min(unsigned(image.height()),height_ - y0);
+        unsigned reduced_width = (width_ + factor - 1) / factor;
+        unsigned reduced_height = (height_ + factor - 1) / factor;
+        if (x0 >= reduced_width || y0 >= reduced_height) return;
+        unsigned w=std::min(unsigned(image.width()),reduced_width - x0);
+        unsigned h=std::min(unsigned(image.height()),reduced_height - y0);
         unsigned rowbytes=png_get_rowbytes(png_ptr, info_ptr);
         const std::unique_ptr<png_byte[]> row(new png_byte[rowbytes]);
+        const std::unique_ptr<unsigned[]> out_row(new unsigned[w]);
+        // rows below the region are never decoded (interlaced images are read as a whole)
+        unsigned last_row = interlaced ? height_ - 1 : (y0 + h - 1) * factor;
         //START read image rows
-        for (unsigned i = 0;i < height_; ++i)
+        for (unsigned i = 0;i <= last_row; ++i)
         {
             png_read_row(png_ptr,row.get(),0);
-            if (i >= y0 && i < (y0 + h))
+            if (i % factor == 0 && i / factor >= y0 && i / factor < y0 + h)
             {
-                image.setRow(i-y0,reinterpret_cast<unsigned*>(&row[x0 * 4]),w);
+                unsigned const* src = reinterpret_cast<unsigned const*>(row.get());
+                if (factor == 1)
+                {
+                    image.setRow(i - y0, src + x0, w);
+                    continue;
+                }
+                for (unsigned x = 0; x < w; ++x)
+                {
+                    out_row[x] = src[(x0 + x) * factor];
+                }
+                image.setRow(i / factor - y0, out_row.get(), w);
             }
         }
         //END
+        if (last_row + 1 < height_) return;
     }
     png_read_end(png_ptr,0);
 }
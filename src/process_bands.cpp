@@ -0,0 +1,53 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/util/process_bands.hpp>
+
+// stl
+#ifdef MAPNIK_THREADSAFE
+#include <atomic>
+#endif
+
+namespace mapnik { namespace util {
+
+namespace {
+
+#ifdef MAPNIK_THREADSAFE
+std::atomic<unsigned> band_threads(1);
+#else
+unsigned band_threads = 1;
+#endif
+
+}
+
+unsigned max_band_threads()
+{
+    return band_threads;
+}
+
+void set_max_band_threads(unsigned threads)
+{
+    band_threads = threads;
+}
+
+}}
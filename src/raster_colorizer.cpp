@@ -28,10 +28,15 @@
 #include <mapnik/raster.hpp>
 #include <mapnik/raster_colorizer.hpp>
 #include <mapnik/enumeration.hpp>
+#include <mapnik/util/process_bands.hpp>
 
 // stl
 #include <limits>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 namespace mapnik
 {
@@ -122,61 +127,180 @@ bool raster_colorizer::add_stop(colorizer_stop const& stop)
     return true;
 }
 
-void raster_colorizer::colorize(raster_ptr const& raster, feature_impl const& f) const
-{
-    unsigned *imageData = raster->data_.getData();
+namespace {
 
-    int len = raster->data_.width() * raster->data_.height();
-    boost::optional<double> const& nodata = raster->nodata();
-    for (int i=0; i<len; ++i)
+// integral values in this range (8 and 16 bit sources, signed or not) are
+// looked up in a precomputed table instead of searching the stops
+const int lut_min = std::numeric_limits<std::int16_t>::min();
+const int lut_max = std::numeric_limits<std::uint16_t>::max();
+// rasters smaller than this are not worth building the table for
+const std::size_t lut_min_pixels = 1 << 20;
+
+// 8 and 16 bit bands: each possible value is colored once, when there are
+// enough pixels to pay for it
+template <typename T, typename ColorFunc>
+void colorize_pixels(T const* in, unsigned * out, unsigned width, unsigned height,
+                     ColorFunc const& color_of, std::true_type)
+{
+    std::size_t range = static_cast<std::size_t>(std::numeric_limits<T>::max()) + 1;
+    std::vector<unsigned> lut;
+    if (static_cast<std::size_t>(width) * height >= range)
+    {
+        lut.resize(range);
+        for (std::size_t value = 0; value < range; ++value)
+        {
+            lut[value] = color_of(static_cast<float>(value));
+        }
+    }
+    util::process_bands(width, height, [&](unsigned y0, unsigned y1)
     {
-        // the GDAL plugin reads single bands as floats
-        float value = *reinterpret_cast<float *> (&imageData[i]);
-        if (nodata && (std::fabs(value - *nodata) < epsilon_))
+        std::size_t begin = static_cast<std::size_t>(y0) * width;
+        std::size_t end = static_cast<std::size_t>(y1) * width;
+        if (!lut.empty())
         {
-            imageData[i] = 0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                out[i] = lut[in[i]];
+            }
         }
         else
         {
-            imageData[i] = get_color(value);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                out[i] = color_of(static_cast<float>(in[i]));
+            }
+        }
+    });
+}
+
+// float bands: integral values in [lut_min, lut_max] are looked up in a
+// table on large rasters, anything else searches the stops
+template <typename ColorFunc>
+void colorize_pixels(float const* in, unsigned * out, unsigned width, unsigned height,
+                     ColorFunc const& color_of, std::false_type)
+{
+    std::vector<unsigned> lut;
+    if (static_cast<std::size_t>(width) * height >= lut_min_pixels)
+    {
+        lut.resize(lut_max - lut_min + 1);
+        for (int i = lut_min; i <= lut_max; ++i)
+        {
+            lut[i - lut_min] = color_of(static_cast<float>(i));
         }
     }
+    util::process_bands(width, height, [&](unsigned y0, unsigned y1)
+    {
+        std::size_t begin = static_cast<std::size_t>(y0) * width;
+        std::size_t end = static_cast<std::size_t>(y1) * width;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            float value = in[i];
+            if (!lut.empty() && value >= lut_min && value <= lut_max)
+            {
+                int index = static_cast<int>(value);
+                if (static_cast<float>(index) == value)
+                {
+                    out[i] = lut[index - lut_min];
+                    continue;
+                }
+            }
+            out[i] = color_of(value);
+        }
+    });
 }
 
-inline unsigned interpolate(unsigned start, unsigned end, float fraction)
+template <typename Band, typename ColorFunc>
+void colorize_band(raster & target, Band const& band, ColorFunc const& color_of)
 {
-    return static_cast<unsigned>(fraction * ((float)end - (float)start) + start);
+    using pixel_type = typename Band::pixel_type;
+    if (target.data_.width() != band.width() || target.data_.height() != band.height())
+    {
+        image_data_32 data(band.width(), band.height());
+        target.data_.swap(data);
+    }
+    colorize_pixels(band.getData(), target.data_.getData(), band.width(), band.height(),
+                    color_of, std::is_integral<pixel_type>());
 }
 
-unsigned raster_colorizer::get_color(float value) const
+}
+
+void raster_colorizer::colorize(raster_ptr const& raster, feature_impl const& f) const
 {
-    int stopCount = stops_.size();
+    boost::optional<double> const& nodata = raster->nodata();
+    bool sorted = std::is_sorted(stops_.begin(), stops_.end(),
+                                 [](colorizer_stop const& a, colorizer_stop const& b)
+                                 { return a.get_value() < b.get_value(); });
+    auto color_of = [&](float value) -> unsigned
+    {
+        if (nodata && (std::fabs(value - *nodata) < epsilon_)) return 0;
+        if (stops_.empty()) return default_color_.rgba();
+        return get_color(value, find_stop(value, sorted));
+    };
 
-    //use default color if no stops
-    if(stopCount == 0)
+    switch (raster->band_type())
     {
-        return default_color_.rgba();
+    case RASTER_GRAY8:
+        colorize_band(*raster, raster->band_8(), color_of);
+        break;
+    case RASTER_GRAY16:
+        colorize_band(*raster, raster->band_16(), color_of);
+        break;
+    case RASTER_FLOAT32:
+        colorize_band(*raster, raster->band_32f(), color_of);
+        break;
+    default:
+    {
+        // rgba rasters carrying a single float band in place of the pixels
+        image_data_32f band(raster->data_.width(), raster->data_.height(),
+                            reinterpret_cast<float *>(raster->data_.getData()));
+        colorize_band(*raster, band, color_of);
+        break;
     }
+    }
+}
 
-    //1 - Find the stop that the value is in
-    int stopIdx = -1;
-    bool foundStopIdx = false;
-
+int raster_colorizer::find_stop(float value, bool sorted) const
+{
+    int stopCount = stops_.size();
+    if (sorted)
+    {
+        // first stop above value, exactly what the linear scan below finds
+        colorizer_stops::const_iterator itr = std::upper_bound(stops_.begin(), stops_.end(), value,
+                                                               [](float v, colorizer_stop const& stop)
+                                                               { return v < stop.get_value(); });
+        return static_cast<int>(itr - stops_.begin()) - 1;
+    }
     for(int i=0; i<stopCount; ++i)
     {
         if(value < stops_[i].get_value())
         {
-            stopIdx = i-1;
-            foundStopIdx = true;
-            break;
+            return i-1;
         }
     }
+    return stopCount-1;
+}
 
-    if(!foundStopIdx)
+inline unsigned interpolate(unsigned start, unsigned end, float fraction)
+{
+    return static_cast<unsigned>(fraction * ((float)end - (float)start) + start);
+}
+
+unsigned raster_colorizer::get_color(float value) const
+{
+    //use default color if no stops
+    if(stops_.empty())
     {
-        stopIdx = stopCount-1;
+        return default_color_.rgba();
     }
 
+    //1 - Find the stop that the value is in
+    return get_color(value, find_stop(value, false));
+}
+
+unsigned raster_colorizer::get_color(float value, int stopIdx) const
+{
+    int stopCount = stops_.size();
+
     //2 - Find the next stop
     int nextStopIdx = stopIdx + 1;
     if(nextStopIdx >= stopCount)
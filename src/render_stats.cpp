@@ -0,0 +1,173 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/render_stats.hpp>
+
+// stl
+#include <sstream>
+#include <iomanip>
+#include <locale>
+
+namespace mapnik
+{
+
+namespace {
+
+void write_string(std::ostream & out, std::string const& str)
+{
+    out << '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<int>(c) << std::dec << std::setfill(' ');
+            }
+            else
+            {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+void write_style(std::ostream & out, style_stats const& style)
+{
+    out << "{\"name\":";
+    write_string(out, style.name);
+    out << ",\"time_ms\":" << style.time_ms
+        << ",\"features_fetched\":" << style.features_fetched
+        << ",\"features_matched\":" << style.features_matched
+        << ",\"labels_attempted\":" << style.labels_attempted
+        << ",\"labels_placed\":" << style.labels_placed
+        << ",\"bytes_allocated\":" << style.bytes_allocated
+        << ",\"symbolizers\":{";
+    bool first = true;
+    for (auto const& kv : style.symbolizers)
+    {
+        if (!first) out << ',';
+        first = false;
+        write_string(out, kv.first);
+        out << ":{\"count\":" << kv.second.count
+            << ",\"time_ms\":" << kv.second.time_ms << '}';
+    }
+    out << "}}";
+}
+
+void write_layer(std::ostream & out, layer_stats const& layer)
+{
+    out << "{\"name\":";
+    write_string(out, layer.name);
+    out << ",\"query_ms\":" << layer.query_ms
+        << ",\"features_fetched\":" << layer.features_fetched
+        << ",\"styles\":[";
+    for (std::size_t i = 0; i < layer.styles.size(); ++i)
+    {
+        if (i > 0) out << ',';
+        write_style(out, layer.styles[i]);
+    }
+    out << "]}";
+}
+
+}
+
+render_stats::render_stats()
+    : layers(),
+      render_ms(0.0),
+      encode_ms(0.0) {}
+
+void render_stats::clear()
+{
+    layers.clear();
+    render_ms = 0.0;
+    encode_ms = 0.0;
+}
+
+std::size_t render_stats::features_fetched() const
+{
+    std::size_t total = 0;
+    for (layer_stats const& layer : layers) total += layer.features_fetched;
+    return total;
+}
+
+std::size_t render_stats::labels_attempted() const
+{
+    std::size_t total = 0;
+    for (layer_stats const& layer : layers)
+    {
+        for (style_stats const& style : layer.styles) total += style.labels_attempted;
+    }
+    return total;
+}
+
+std::size_t render_stats::labels_placed() const
+{
+    std::size_t total = 0;
+    for (layer_stats const& layer : layers)
+    {
+        for (style_stats const& style : layer.styles) total += style.labels_placed;
+    }
+    return total;
+}
+
+std::size_t render_stats::bytes_allocated() const
+{
+    std::size_t total = 0;
+    for (layer_stats const& layer : layers)
+    {
+        for (style_stats const& style : layer.styles) total += style.bytes_allocated;
+    }
+    return total;
+}
+
+std::string render_stats::to_json() const
+{
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << std::fixed << std::setprecision(3);
+    out << "{\"render_ms\":" << render_ms
+        << ",\"encode_ms\":" << encode_ms
+        << ",\"features_fetched\":" << features_fetched()
+        << ",\"labels_attempted\":" << labels_attempted()
+        << ",\"labels_placed\":" << labels_placed()
+        << ",\"bytes_allocated\":" << bytes_allocated()
+        << ",\"layers\":[";
+    for (std::size_t i = 0; i < layers.size(); ++i)
+    {
+        if (i > 0) out << ',';
+        write_layer(out, layers[i]);
+    }
+    out << "]}";
+    return out.str();
+}
+
+}
@@ -120,6 +120,7 @@ std::string const& rule::get_name() const
 
 void rule::append(symbolizer && sym)
 {
+    compile_properties(sym);
     syms_.push_back(std::move(sym));
 }
 
@@ -0,0 +1,290 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/rule_index.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/expression_node.hpp>
+
+// stl
+#include <set>
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+namespace mapnik
+{
+
+namespace {
+
+struct key_set
+{
+    std::vector<value_unicode_string> strings;
+    std::vector<value_integer> integers;
+};
+
+bool is_key_literal(expr_node const& node)
+{
+    return node.is<value_unicode_string>() || node.is<value_integer>();
+}
+
+// [attr] = literal or literal = [attr]
+attribute const* equality_attribute(binary_node<tags::equal_to> const& x, expr_node const** literal)
+{
+    if (x.left.is<attribute>() && is_key_literal(x.right))
+    {
+        *literal = &x.right;
+        return &x.left.get<attribute>();
+    }
+    if (x.right.is<attribute>() && is_key_literal(x.left))
+    {
+        *literal = &x.left;
+        return &x.right.get<attribute>();
+    }
+    return nullptr;
+}
+
+// names of the attributes a filter could be keyed on
+struct key_attributes : util::static_visitor<std::set<std::string> >
+{
+    using names = std::set<std::string>;
+
+    template <typename T>
+    names operator() (T const&) const
+    {
+        return names();
+    }
+
+    names operator() (binary_node<tags::equal_to> const& x) const
+    {
+        names result;
+        expr_node const* literal = nullptr;
+        attribute const* attr = equality_attribute(x, &literal);
+        if (attr) result.insert(attr->name());
+        return result;
+    }
+
+    names operator() (binary_node<tags::logical_or> const& x) const
+    {
+        names left = util::apply_visitor(*this, x.left);
+        names right = util::apply_visitor(*this, x.right);
+        names result;
+        std::set_intersection(left.begin(), left.end(), right.begin(), right.end(),
+                              std::inserter(result, result.begin()));
+        return result;
+    }
+
+    names operator() (binary_node<tags::logical_and> const& x) const
+    {
+        names result = util::apply_visitor(*this, x.left);
+        names right = util::apply_visitor(*this, x.right);
+        result.insert(right.begin(), right.end());
+        return result;
+    }
+};
+
+// values of `name` a feature needs for the filter to be true, if the
+// filter can only be true for a finite set of them
+struct collect_keys : util::static_visitor<bool>
+{
+    collect_keys(std::string const& name, key_set & keys)
+        : name_(name),
+          keys_(keys) {}
+
+    template <typename T>
+    bool operator() (T const&) const
+    {
+        return false;
+    }
+
+    bool operator() (binary_node<tags::equal_to> const& x) const
+    {
+        expr_node const* literal = nullptr;
+        attribute const* attr = equality_attribute(x, &literal);
+        if (!attr || attr->name() != name_) return false;
+        if (literal->is<value_unicode_string>())
+        {
+            keys_.strings.push_back(literal->get<value_unicode_string>());
+        }
+        else
+        {
+            keys_.integers.push_back(literal->get<value_integer>());
+        }
+        return true;
+    }
+
+    bool operator() (binary_node<tags::logical_or> const& x) const
+    {
+        return util::apply_visitor(*this, x.left) &&
+               util::apply_visitor(*this, x.right);
+    }
+
+    bool operator() (binary_node<tags::logical_and> const& x) const
+    {
+        key_set left;
+        if (util::apply_visitor(collect_keys(name_, left), x.left))
+        {
+            keys_.strings.insert(keys_.strings.end(), left.strings.begin(), left.strings.end());
+            keys_.integers.insert(keys_.integers.end(), left.integers.begin(), left.integers.end());
+            return true;
+        }
+        return util::apply_visitor(*this, x.right);
+    }
+
+    std::string const& name_;
+    key_set & keys_;
+};
+
+template <typename Map, typename Key>
+void append_rule(Map & buckets, Key const& key, rule const* r)
+{
+    rule_index::rule_ptrs & bucket = buckets[key];
+    // an IN list may name the same value twice
+    if (bucket.empty() || bucket.back() != r) bucket.push_back(r);
+}
+
+template <typename Strings, typename Integers>
+struct candidate_lookup : util::static_visitor<rule_index::rule_ptrs const*>
+{
+    candidate_lookup(Strings const& strings, Integers const& integers,
+                     rule_index::rule_ptrs const& all)
+        : strings_(strings),
+          integers_(integers),
+          all_(all) {}
+
+    rule_index::rule_ptrs const* operator() (value_null) const
+    {
+        return nullptr;
+    }
+
+    rule_index::rule_ptrs const* operator() (value_unicode_string const& val) const
+    {
+        auto itr = strings_.find(val);
+        return itr != strings_.end() ? &itr->second : nullptr;
+    }
+
+    rule_index::rule_ptrs const* operator() (value_integer val) const
+    {
+        auto itr = integers_.find(val);
+        return itr != integers_.end() ? &itr->second : nullptr;
+    }
+
+    rule_index::rule_ptrs const* operator() (value_bool val) const
+    {
+        return (*this)(static_cast<value_integer>(val ? 1 : 0));
+    }
+
+    rule_index::rule_ptrs const* operator() (value_double val) const
+    {
+        // NaN equals nothing, so only the unkeyed rules can match
+        if (val != val) return nullptr;
+        // doubles compare equal to integers of the same value, and an
+        // integer key is converted to double for that. From 2^53 on
+        // several keys round to the same double, so every rule is a
+        // candidate and the filters decide.
+        if (std::fabs(val) >= 9007199254740992.0) return &all_;
+        value_integer integer = static_cast<value_integer>(val);
+        if (static_cast<value_double>(integer) != val) return nullptr;
+        return (*this)(integer);
+    }
+
+    Strings const& strings_;
+    Integers const& integers_;
+    rule_index::rule_ptrs const& all_;
+};
+
+}
+
+rule_index::rule_index()
+    : indexed_(false),
+      attribute_(),
+      strings_(),
+      integers_(),
+      unkeyed_(),
+      all_() {}
+
+void rule_index::build(rule_ptrs const& rules)
+{
+    indexed_ = false;
+    attribute_.clear();
+    strings_.clear();
+    integers_.clear();
+    unkeyed_.clear();
+    all_.clear();
+
+    // pick the attribute most rules can be keyed on
+    std::map<std::string, std::size_t> counts;
+    for (rule const* r : rules)
+    {
+        for (std::string const& name : util::apply_visitor(key_attributes(), *r->get_filter()))
+        {
+            ++counts[name];
+        }
+    }
+    auto best = std::max_element(counts.begin(), counts.end(),
+                                 [](std::pair<const std::string, std::size_t> const& lhs,
+                                    std::pair<const std::string, std::size_t> const& rhs)
+                                 { return lhs.second < rhs.second; });
+    if (best == counts.end() || best->second < min_keyed_rules) return;
+    attribute_ = best->first;
+
+    std::vector<key_set> keys(rules.size());
+    std::vector<bool> keyed(rules.size(), false);
+    for (std::size_t i = 0; i < rules.size(); ++i)
+    {
+        keyed[i] = util::apply_visitor(collect_keys(attribute_, keys[i]), *rules[i]->get_filter());
+        if (!keyed[i]) continue;
+        // create every bucket up front so unkeyed rules land in all of them
+        for (value_unicode_string const& key : keys[i].strings) strings_[key];
+        for (value_integer key : keys[i].integers) integers_[key];
+    }
+
+    for (std::size_t i = 0; i < rules.size(); ++i)
+    {
+        rule const* r = rules[i];
+        if (keyed[i])
+        {
+            for (value_unicode_string const& key : keys[i].strings) append_rule(strings_, key, r);
+            for (value_integer key : keys[i].integers) append_rule(integers_, key, r);
+        }
+        else
+        {
+            unkeyed_.push_back(r);
+            for (auto & kv : strings_) kv.second.push_back(r);
+            for (auto & kv : integers_) kv.second.push_back(r);
+        }
+    }
+    all_ = rules;
+    indexed_ = true;
+}
+
+rule_index::rule_ptrs const& rule_index::candidates(feature_impl const& feature) const
+{
+    using lookup_type = candidate_lookup<decltype(strings_), decltype(integers_)>;
+    rule_ptrs const* found = util::apply_visitor(lookup_type(strings_, integers_, all_),
+                                                 feature.get(attribute_).base());
+    return found ? *found : unkeyed_;
+}
+
+}
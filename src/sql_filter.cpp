@@ -0,0 +1,270 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/sql_filter.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/attribute_descriptor.hpp>
+#include <mapnik/unicode.hpp>
+
+// stl
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <locale>
+#include <set>
+#include <unordered_map>
+
+namespace mapnik { namespace sql_utils {
+
+namespace {
+
+struct sql_part
+{
+    sql_part()
+        : sql(),
+          valid(false),
+          exact(false) {}
+
+    sql_part(std::string const& _sql, bool _exact)
+        : sql(_sql),
+          valid(true),
+          exact(_exact) {}
+
+    std::string sql;
+    // false when nothing restricts the rows
+    bool valid;
+    // true when rows pass exactly when mapnik accepts them, which
+    // is what NOT needs of its operand
+    bool exact;
+};
+
+std::string quote_identifier(std::string const& name)
+{
+    std::string quoted("\"");
+    for (char c : name)
+    {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+std::string quote_string(value_unicode_string const& val)
+{
+    std::string utf8;
+    to_utf8(val, utf8);
+    std::string quoted("'");
+    for (char c : utf8)
+    {
+        if (c == '\'') quoted += '\'';
+        quoted += c;
+    }
+    quoted += '\'';
+    return quoted;
+}
+
+template <typename T>
+std::string number_literal(T val)
+{
+    std::ostringstream s;
+    s.imbue(std::locale::classic());
+    s << std::setprecision(17) << val;
+    return s.str();
+}
+
+bool is_numeric_column(unsigned type)
+{
+    return type == Integer || type == Float || type == Double;
+}
+
+class sql_translator : public util::static_visitor<sql_part>
+{
+public:
+    explicit sql_translator(std::unordered_map<std::string, unsigned> const& columns)
+        : columns_(columns) {}
+
+    template <typename T>
+    sql_part operator() (T const&) const
+    {
+        return sql_part();
+    }
+
+    sql_part operator() (value_bool val) const
+    {
+        return sql_part(val ? "1=1" : "1=0", true);
+    }
+
+    sql_part operator() (binary_node<tags::equal_to> const& x) const
+    {
+        return compare(x.left, x.right, "=", "=");
+    }
+
+    sql_part operator() (binary_node<tags::not_equal_to> const& x) const
+    {
+        return compare(x.left, x.right, "<>", "<>");
+    }
+
+    sql_part operator() (binary_node<tags::less> const& x) const
+    {
+        return compare(x.left, x.right, "<", ">");
+    }
+
+    sql_part operator() (binary_node<tags::less_equal> const& x) const
+    {
+        return compare(x.left, x.right, "<=", ">=");
+    }
+
+    sql_part operator() (binary_node<tags::greater> const& x) const
+    {
+        return compare(x.left, x.right, ">", "<");
+    }
+
+    sql_part operator() (binary_node<tags::greater_equal> const& x) const
+    {
+        return compare(x.left, x.right, ">=", "<=");
+    }
+
+    sql_part operator() (binary_node<tags::logical_and> const& x) const
+    {
+        sql_part left = util::apply_visitor(*this, x.left);
+        sql_part right = util::apply_visitor(*this, x.right);
+        if (left.valid && right.valid)
+        {
+            return sql_part("(" + left.sql + " AND " + right.sql + ")", left.exact && right.exact);
+        }
+        // dropping an operand of AND only lets more rows through
+        if (left.valid) return sql_part(left.sql, false);
+        if (right.valid) return sql_part(right.sql, false);
+        return sql_part();
+    }
+
+    sql_part operator() (binary_node<tags::logical_or> const& x) const
+    {
+        sql_part left = util::apply_visitor(*this, x.left);
+        if (!left.valid) return sql_part();
+        sql_part right = util::apply_visitor(*this, x.right);
+        if (!right.valid) return sql_part();
+        return sql_part("(" + left.sql + " OR " + right.sql + ")", left.exact && right.exact);
+    }
+
+    sql_part operator() (unary_node<tags::logical_not> const& x) const
+    {
+        sql_part operand = util::apply_visitor(*this, x.expr);
+        if (!operand.valid || !operand.exact) return sql_part();
+        return sql_part("(NOT " + operand.sql + ")", true);
+    }
+
+private:
+    sql_part compare(expr_node const& left, expr_node const& right,
+                     char const* op, char const* flipped_op) const
+    {
+        if (left.is<attribute>())
+        {
+            return compare_column(left.get<attribute>().name(), right, op);
+        }
+        if (right.is<attribute>())
+        {
+            return compare_column(right.get<attribute>().name(), left, flipped_op);
+        }
+        return sql_part();
+    }
+
+    sql_part compare_column(std::string const& name, expr_node const& literal, std::string const& op) const
+    {
+        auto itr = columns_.find(name);
+        if (itr == columns_.end()) return sql_part();
+
+        std::string value;
+        // SQL's = on strings can accept rows mapnik's equality rejects:
+        // case insensitive collations, SQLite's type conversions, blank
+        // padded char(n) columns. Ordered comparisons sort values mapnik
+        // never orders against numbers above all of them: NaN in
+        // PostgreSQL, TEXT stored in a numeric SQLite column. That's fine
+        // on its own, but not under NOT.
+        bool exact = op == "=" || op == "<>";
+        if (literal.is<value_integer>() && is_numeric_column(itr->second))
+        {
+            value = number_literal(literal.get<value_integer>());
+        }
+        else if (literal.is<value_double>() && is_numeric_column(itr->second))
+        {
+            // there's no portable SQL spelling of inf and nan
+            if (!std::isfinite(literal.get<value_double>())) return sql_part();
+            value = number_literal(literal.get<value_double>());
+        }
+        else if (literal.is<value_unicode_string>() && itr->second == String && op == "=")
+        {
+            value = quote_string(literal.get<value_unicode_string>());
+            exact = false;
+        }
+        else
+        {
+            return sql_part();
+        }
+
+        // spelled out so the result is never NULL: mapnik compares a
+        // null attribute unequal to everything and false otherwise
+        std::string column = quote_identifier(name);
+        if (op == "<>")
+        {
+            return sql_part("(" + column + " IS NULL OR " + column + " <> " + value + ")", exact);
+        }
+        return sql_part("(" + column + " IS NOT NULL AND " + column + " " + op + " " + value + ")", exact);
+    }
+
+    std::unordered_map<std::string, unsigned> const& columns_;
+};
+
+}
+
+boost::optional<std::string> filters_to_sql(std::vector<expression_ptr> const& filters,
+                                            layer_descriptor const& desc)
+{
+    boost::optional<std::string> result;
+    if (filters.empty()) return result;
+
+    std::unordered_map<std::string, unsigned> columns;
+    for (attribute_descriptor const& attr : desc.get_descriptors())
+    {
+        columns.emplace(attr.get_name(), attr.get_type());
+    }
+
+    sql_translator translator(columns);
+    std::set<std::string> seen;
+    std::string sql;
+    for (expression_ptr const& filter : filters)
+    {
+        if (!filter) return result;
+        sql_part part = util::apply_visitor(translator, *filter);
+        if (!part.valid || part.sql == "1=1") return result;
+        if (!seen.insert(part.sql).second) continue;
+        if (!sql.empty()) sql += " OR ";
+        sql += part.sql;
+    }
+    result = seen.size() > 1 ? "(" + sql + ")" : sql;
+    return result;
+}
+
+}}
@@ -25,6 +25,8 @@
 #include <mapnik/attribute.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/transform_processor.hpp>
+#include <mapnik/evaluate_global_attributes.hpp>
+#include <mapnik/color_factory.hpp>
 
 namespace mapnik {
 
@@ -41,6 +43,110 @@ void evaluate_transform(agg::trans_affine& tr,
 }
 // END FIXME
 
+namespace {
 
+// appends the result of `val` to `out` when it depends on neither the
+// feature nor render variables; returns false if it still has to be
+// evaluated
+struct fold_constant : util::static_visitor<bool>
+{
+    fold_constant(keys key, std::vector<symbolizer_base::value_type> & out)
+        : key_(key),
+          out_(out) {}
+
+    bool operator() (expression_ptr const& expr) const
+    {
+        if (!expr) return true;
+        auto result = pre_evaluate_expression<mapnik::value>(expr);
+        if (!std::get<1>(result)) return false;
+        mapnik::value const& v = std::get<0>(result);
+        // the same conversions load_map applies to constant expressions
+        switch (std::get<3>(get_meta(key_)))
+        {
+        case property_types::target_bool:
+            out_.emplace_back(v.to_bool());
+            return true;
+        case property_types::target_integer:
+            out_.emplace_back(v.to_int());
+            return true;
+        case property_types::target_double:
+            out_.emplace_back(v.to_double());
+            return true;
+        case property_types::target_color:
+            try
+            {
+                out_.emplace_back(parse_color(v.to_string()));
+                return true;
+            }
+            catch (...)
+            {
+                return false;
+            }
+        default:
+            return false;
+        }
+    }
+
+    bool operator() (path_expression_ptr const& path) const
+    {
+        if (!path) return true;
+        std::string str;
+        for (path_component const& part : *path)
+        {
+            if (!part.is<std::string>()) return false;
+            str += part.get<std::string>();
+        }
+        out_.emplace_back(std::move(str));
+        return true;
+    }
+
+    template <typename T>
+    bool operator() (T const&) const
+    {
+        return true;
+    }
+
+    keys key_;
+    std::vector<symbolizer_base::value_type> & out_;
+};
+
+struct compile_symbolizer : util::static_visitor<>
+{
+    template <typename Symbolizer>
+    void operator() (Symbolizer & sym) const
+    {
+        compile_properties(sym);
+    }
+};
+
+}
+
+void compile_properties(symbolizer_base & sym)
+{
+    auto props = std::make_shared<detail::compiled_properties>();
+    props->slots.fill(static_cast<std::uint8_t>(detail::compiled_properties::absent));
+    props->raw.reserve(sym.properties.size());
+    props->resolved.reserve(sym.properties.size());
+    for (auto const& prop : sym.properties)
+    {
+        std::size_t index = static_cast<std::size_t>(prop.first);
+        props->slots[index] = static_cast<std::uint8_t>(props->raw.size());
+        props->raw.push_back(prop.second);
+        if (!util::apply_visitor(fold_constant(prop.first, props->resolved), prop.second))
+        {
+            props->evaluate.set(index);
+        }
+        if (props->resolved.size() < props->raw.size())
+        {
+            props->resolved.push_back(prop.second);
+        }
+    }
+    sym.compiled = props;
+}
+
+void compile_properties(symbolizer & sym)
+{
+    util::apply_visitor(compile_symbolizer(), sym);
+}
 
 } // end of namespace mapnik
@@ -26,6 +26,7 @@
 #include <mapnik/expression_evaluator.hpp>
 #include <mapnik/text/placement_finder_impl.hpp>
 #include <mapnik/text/text_layout.hpp>
+#include <mapnik/text/text_layout_cache.hpp>
 #include <mapnik/text/text_properties.hpp>
 #include <mapnik/text/placements_list.hpp>
 #include <mapnik/text/vertex_cache.hpp>
@@ -67,6 +68,17 @@ bool placement_finder::next_position()
         layout->evaluate_properties(feature_, attr_);
         move_dx_ = layout->displacement().x;
         info_.properties.process(*layout, feature_, attr_);
+        // reuse the shaped glyphs of an identical label placed earlier in this render
+        text_layout_cache & cache = font_manager_.get_layout_cache();
+        std::string key = layout->cache_key();
+        if (text_layout_ptr cached = cache.find(key))
+        {
+            layout = cached;
+        }
+        else
+        {
+            cache.insert(key, layout);
+        }
         layouts_.clear(); // FIXME !!!!
         layouts_.add(layout);
         layouts_.layout();
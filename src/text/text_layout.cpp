@@ -49,6 +49,43 @@ static void rotated_box2d(box2d<double> & box, rotation const& rot, pixel_positi
     box.init(center.x - half_width, center.y - half_height, center.x + half_width, center.y + half_height);
 }
 
+template <typename T>
+static void append_key(std::string & key, T const& value)
+{
+    char const* bytes = reinterpret_cast<char const*>(&value);
+    key.append(bytes, sizeof(T));
+}
+
+static void append_key(std::string & key, std::string const& str)
+{
+    append_key(key, str.size());
+    key.append(str);
+}
+
+// Everything in the format that ends up in glyph metrics or in glyph_info::format.
+static void append_format_key(std::string & key, detail::evaluated_format_properties const& format)
+{
+    append_key(key, format.face_name);
+    append_key(key, static_cast<bool>(format.fontset));
+    if (format.fontset)
+    {
+        append_key(key, format.fontset->get_name());
+        for (std::string const& name : format.fontset->get_face_names())
+        {
+            append_key(key, name);
+        }
+    }
+    append_key(key, format.text_size);
+    append_key(key, format.character_spacing);
+    append_key(key, format.line_spacing);
+    append_key(key, format.text_opacity);
+    append_key(key, format.halo_opacity);
+    append_key(key, static_cast<int>(format.text_transform));
+    append_key(key, format.fill.rgba());
+    append_key(key, format.halo_fill.rgba());
+    append_key(key, format.halo_radius);
+}
+
 pixel_position pixel_position::rotate(rotation const& rot) const
 {
     return pixel_position(x * rot.cos - y * rot.sin, x * rot.sin + y * rot.cos);
@@ -68,6 +105,34 @@ text_layout::text_layout(face_manager_freetype & font_manager, double scale_fact
 void text_layout::add_text(mapnik::value_unicode_string const& str, evaluated_format_properties_ptr format)
 {
     itemizer_.add_text(str, format);
+    append_key(text_key_, str.length());
+    text_key_.append(reinterpret_cast<char const*>(str.getBuffer()), str.length() * sizeof(UChar));
+    append_format_key(text_key_, *format);
+}
+
+std::string text_layout::cache_key() const
+{
+    std::string key;
+    key.reserve(text_key_.size() + 128);
+    append_key(key, scale_factor_);
+    append_key(key, displacement_.x);
+    append_key(key, displacement_.y);
+    append_key(key, wrap_width_);
+    append_key(key, orientation_.sin);
+    append_key(key, orientation_.cos);
+    append_key(key, wrap_before_);
+    append_key(key, rotate_displacement_);
+    append_key(key, text_ratio_);
+    append_key(key, static_cast<int>(valign_));
+    append_key(key, static_cast<int>(halign_));
+    append_key(key, static_cast<int>(jalign_));
+    append_key(key, text_key_);
+    append_key(key, child_layout_list_.size());
+    for (text_layout_ptr const& child : child_layout_list_)
+    {
+        append_key(key, child->cache_key());
+    }
+    return key;
 }
 
 void text_layout::add_child(text_layout_ptr const& child_layout)
@@ -82,6 +147,8 @@ mapnik::value_unicode_string const& text_layout::text() const
 
 void text_layout::layout()
 {
+    if (laid_out_) return;
+    laid_out_ = true;
     unsigned num_lines = itemizer_.num_lines();
     for (unsigned i = 0; i < num_lines; ++i)
     {
@@ -224,6 +291,8 @@ void text_layout::clear()
     width_map_.clear();
     width_ = 0.0;
     height_ = 0.0;
+    laid_out_ = false;
+    text_key_.clear();
     child_layout_list_.clear();
 }
 
@@ -26,6 +26,8 @@
 
 // boost
 #include <memory>
+#include <vector>
+#include <algorithm>
 
 // iostreams
 #include <boost/iostreams/device/file.hpp>
@@ -128,6 +130,20 @@ private:
     int tile_height_;
     tiff_ptr tif_;
     bool premultiplied_alpha_;
+
+    // reduced resolution subfile (overview) stored in the same file
+    struct overview
+    {
+        uint16 dir;
+        unsigned factor;
+        int read_method;
+        std::size_t width;
+        std::size_t height;
+        int rows_per_strip;
+        int tile_width;
+        int tile_height;
+    };
+    std::vector<overview> overviews_;
 public:
     enum TiffType {
         generic=1,
@@ -142,6 +158,8 @@ public:
     inline bool has_alpha() const { return false; /*FIXME*/ }
     bool premultiplied_alpha() const;
     void read(unsigned x,unsigned y,image_data_32& image);
+    unsigned reduction(unsigned max_factor) const;
+    void read_reduced(unsigned x,unsigned y,unsigned factor,image_data_32& image);
 private:
     tiff_reader(const tiff_reader&);
     tiff_reader& operator=(const tiff_reader&);
@@ -149,6 +167,8 @@ private:
     void read_generic(unsigned x,unsigned y,image_data_32& image);
     void read_stripped(unsigned x,unsigned y,image_data_32& image);
     void read_tiled(unsigned x,unsigned y,image_data_32& image);
+    void init_overviews(TIFF* tif);
+    void swap_level(overview & ov);
     TIFF* open(std::istream & input);
     static void on_error(const char* , const char* fmt, va_list argptr);
 };
@@ -253,6 +273,7 @@ void tiff_reader<T>::init()
         {
             premultiplied_alpha_ = true;
         }
+        init_overviews(tif);
     }
     else
     {
@@ -260,6 +281,112 @@ void tiff_reader<T>::init()
     }
 }
 
+template <typename T>
+void tiff_reader<T>::init_overviews(TIFF* tif)
+{
+    // a broken overview only means it won't be used
+    TIFFSetErrorHandler(0);
+    while (TIFFReadDirectory(tif))
+    {
+        uint32 subfile_type = 0;
+        char msg[1024];
+        if (!TIFFGetField(tif, TIFFTAG_SUBFILETYPE, &subfile_type) ||
+            !(subfile_type & FILETYPE_REDUCEDIMAGE) ||
+            !TIFFRGBAImageOK(tif, msg))
+        {
+            continue;
+        }
+        uint32 width = 0;
+        uint32 height = 0;
+        TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+        if (width == 0 || height == 0) continue;
+        overview ov;
+        ov.dir = TIFFCurrentDirectory(tif);
+        ov.factor = static_cast<unsigned>((width_ + width / 2) / width);
+        ov.width = width;
+        ov.height = height;
+        ov.read_method = generic;
+        ov.rows_per_strip = 0;
+        ov.tile_width = 0;
+        ov.tile_height = 0;
+        // only overviews that are an exact integer reduction are usable
+        if (ov.factor < 2 ||
+            ov.width != (width_ + ov.factor - 1) / ov.factor ||
+            ov.height != (height_ + ov.factor - 1) / ov.factor)
+        {
+            continue;
+        }
+        if (TIFFIsTiled(tif))
+        {
+            TIFFGetField(tif, TIFFTAG_TILEWIDTH, &ov.tile_width);
+            TIFFGetField(tif, TIFFTAG_TILELENGTH, &ov.tile_height);
+            ov.read_method = tiled;
+        }
+        else if (TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &ov.rows_per_strip) != 0)
+        {
+            ov.read_method = stripped;
+        }
+        else
+        {
+            continue;
+        }
+        overviews_.push_back(ov);
+    }
+    TIFFSetDirectory(tif, 0);
+    TIFFSetErrorHandler(on_error);
+}
+
+template <typename T>
+void tiff_reader<T>::swap_level(overview & ov)
+{
+    std::swap(read_method_, ov.read_method);
+    std::swap(width_, ov.width);
+    std::swap(height_, ov.height);
+    std::swap(rows_per_strip_, ov.rows_per_strip);
+    std::swap(tile_width_, ov.tile_width);
+    std::swap(tile_height_, ov.tile_height);
+}
+
+template <typename T>
+unsigned tiff_reader<T>::reduction(unsigned max_factor) const
+{
+    unsigned factor = 1;
+    for (overview const& ov : overviews_)
+    {
+        if (ov.factor <= max_factor && ov.factor > factor) factor = ov.factor;
+    }
+    return factor;
+}
+
+template <typename T>
+void tiff_reader<T>::read_reduced(unsigned x, unsigned y, unsigned factor, image_data_32& image)
+{
+    auto itr = std::find_if(overviews_.begin(), overviews_.end(),
+                            [factor](overview const& ov) { return ov.factor == factor; });
+    TIFF* tif = open(stream_);
+    if (factor <= 1 || itr == overviews_.end() || !tif || !TIFFSetDirectory(tif, itr->dir))
+    {
+        image_reader::read_reduced(x, y, factor, image);
+        return;
+    }
+    // read from the overview directory as if it were the main image
+    overview level = *itr;
+    swap_level(level);
+    try
+    {
+        read(x, y, image);
+    }
+    catch (...)
+    {
+        swap_level(level);
+        TIFFSetDirectory(tif, 0);
+        throw;
+    }
+    swap_level(level);
+    TIFFSetDirectory(tif, 0);
+}
+
 template <typename T>
 tiff_reader<T>::~tiff_reader()
 {
@@ -29,10 +29,15 @@
 #include <mapnik/ctrans.hpp>
 #include <mapnik/raster.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/noncopyable.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/util/process_bands.hpp>
 
 // agg
 #include "agg_image_filters.h"
 #include "agg_trans_bilinear.h"
+#include "agg_trans_affine.h"
 #include "agg_span_interpolator_linear.h"
 #include "agg_span_image_filter_rgba.h"
 #include "agg_rendering_buffer.h"
@@ -45,24 +50,176 @@
 #include "agg_image_accessors.h"
 #include "agg_renderer_scanline.h"
 
+// stl
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+
 namespace mapnik {
 
-void reproject_and_scale_raster(raster & target, raster const& source,
-                                proj_transform const& prj_trans,
-                                double offset_x, double offset_y,
-                                unsigned mesh_size,
-                                scaling_method_e scaling_method)
+namespace {
+
+// Source mesh points transformed into target map coordinates, see build_mesh().
+struct warp_mesh
+{
+    warp_mesh(unsigned nx, unsigned ny)
+        : xs(nx, ny),
+          ys(nx, ny) {}
+
+    std::size_t bytes() const
+    {
+        return 2 * sizeof(double) * xs.width() * xs.height();
+    }
+
+    ImageData<double> xs;
+    ImageData<double> ys;
+};
+
+// A mesh cell in target pixels, with the affine transform taking target
+// pixels back to source pixels, see build_cells().
+struct warp_cell
+{
+    std::array<double, 8> polygon;
+    agg::trans_affine inverse;
+    // the target rows the cell touches
+    double y0;
+    double y1;
+};
+
+// The inverse coordinate lookup of one warp: every mesh cell, row by row.
+struct warp_cells
+{
+    std::size_t bytes() const
+    {
+        return sizeof(warp_cell) * cells.size();
+    }
+
+    std::vector<warp_cell> cells;
+};
+
+using warp_mesh_ptr = std::shared_ptr<warp_mesh const>;
+using warp_cells_ptr = std::shared_ptr<warp_cells const>;
+
+// Least recently used values up to a total size in bytes. Values larger
+// than the whole budget are not kept.
+template <typename T>
+class warp_lru : private mapnik::noncopyable
+{
+    using value_ptr = std::shared_ptr<T const>;
+    using entry = std::pair<std::string, value_ptr>;
+
+public:
+    explicit warp_lru(std::size_t max_bytes)
+        : max_bytes_(max_bytes),
+          bytes_(0),
+          entries_(),
+          index_() {}
+
+    value_ptr find(std::string const& key)
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr == index_.end()) return value_ptr();
+        entries_.splice(entries_.begin(), entries_, itr->second);
+        return itr->second->second;
+    }
+
+    void insert(std::string const& key, value_ptr const& value)
+    {
+        std::size_t bytes = value->bytes();
+        if (bytes > max_bytes_) return;
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr != index_.end())
+        {
+            // built by another thread meanwhile
+            bytes_ -= itr->second->second->bytes();
+            entries_.erase(itr->second);
+            index_.erase(itr);
+        }
+        while (bytes_ + bytes > max_bytes_)
+        {
+            bytes_ -= entries_.back().second->bytes();
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, value);
+        index_.emplace(key, entries_.begin());
+        bytes_ += bytes;
+    }
+
+private:
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+    // most recently used first
+    std::list<entry> entries_;
+    std::unordered_map<std::string, typename std::list<entry>::iterator> index_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+};
+
+// Meshes and cells of recently warped rasters. Tiled renders reproject the
+// same source extent and size with the same projections over and over, and
+// projecting the mesh points is the expensive part of setting up a warp.
+// The cells also depend on the target, so they are kept apart: a mesh can
+// serve many targets.
+class warp_cache : public singleton<warp_cache, CreateStatic>,
+                   private mapnik::noncopyable
+{
+    friend class CreateStatic<warp_cache>;
+
+    warp_cache()
+        : meshes(32 << 20),
+          cells(32 << 20) {}
+
+public:
+    warp_lru<warp_mesh> meshes;
+    warp_lru<warp_cells> cells;
+};
+
+template <typename T>
+void append_key(std::string & key, T const& value)
+{
+    key.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+std::string mesh_key(raster const& source, proj_transform const& prj_trans, unsigned mesh_size)
+{
+    std::string key;
+    append_key(key, source.ext_.minx());
+    append_key(key, source.ext_.miny());
+    append_key(key, source.ext_.maxx());
+    append_key(key, source.ext_.maxy());
+    append_key(key, source.data_.width());
+    append_key(key, source.data_.height());
+    append_key(key, mesh_size);
+    key += prj_trans.source().params();
+    key += '\n';
+    key += prj_trans.dest().params();
+    return key;
+}
+
+warp_mesh_ptr build_mesh(raster const& source, proj_transform const& prj_trans, unsigned mesh_size)
 {
     CoordTransform ts(source.data_.width(), source.data_.height(),
                       source.ext_);
-    CoordTransform tt(target.data_.width(), target.data_.height(),
-                      target.ext_, offset_x, offset_y);
 
     unsigned mesh_nx = std::ceil(source.data_.width()/double(mesh_size) + 1);
     unsigned mesh_ny = std::ceil(source.data_.height()/double(mesh_size) + 1);
 
-    ImageData<double> xs(mesh_nx, mesh_ny);
-    ImageData<double> ys(mesh_nx, mesh_ny);
+    std::shared_ptr<warp_mesh> mesh = std::make_shared<warp_mesh>(mesh_nx, mesh_ny);
+    ImageData<double> & xs = mesh->xs;
+    ImageData<double> & ys = mesh->ys;
 
     // Precalculate reprojected mesh
     for(unsigned j=0; j<mesh_ny; ++j)
@@ -75,33 +232,107 @@ void reproject_and_scale_raster(raster & target, raster const& source,
         }
     }
     prj_trans.backward(xs.getData(), ys.getData(), nullptr, mesh_nx*mesh_ny);
+    return mesh;
+}
+
+std::string cells_key(std::string const& mesh_key, raster const& target,
+                      double offset_x, double offset_y)
+{
+    std::string key(mesh_key);
+    key += '\n';
+    append_key(key, target.ext_.minx());
+    append_key(key, target.ext_.miny());
+    append_key(key, target.ext_.maxx());
+    append_key(key, target.ext_.maxy());
+    append_key(key, target.data_.width());
+    append_key(key, target.data_.height());
+    append_key(key, offset_x);
+    append_key(key, offset_y);
+    return key;
+}
+
+warp_cells_ptr build_cells(warp_mesh const& mesh, raster const& source, raster const& target,
+                           double offset_x, double offset_y, unsigned mesh_size)
+{
+    CoordTransform tt(target.data_.width(), target.data_.height(),
+                      target.ext_, offset_x, offset_y);
+    ImageData<double> const& xs = mesh.xs;
+    ImageData<double> const& ys = mesh.ys;
+    unsigned mesh_nx = xs.width();
+    unsigned mesh_ny = xs.height();
+
+    std::shared_ptr<warp_cells> cells = std::make_shared<warp_cells>();
+    cells->cells.reserve((mesh_nx - 1) * (mesh_ny - 1));
+    for(unsigned j=0; j<mesh_ny-1; ++j)
+    {
+        for (unsigned i=0; i<mesh_nx-1; ++i)
+        {
+            warp_cell cell;
+            std::array<double, 8> & polygon = cell.polygon;
+            polygon = {{xs(i,j), ys(i,j),
+                        xs(i+1,j), ys(i+1,j),
+                        xs(i+1,j+1), ys(i+1,j+1),
+                        xs(i,j+1), ys(i,j+1)}};
+            tt.forward(&polygon[0], &polygon[1]);
+            tt.forward(&polygon[2], &polygon[3]);
+            tt.forward(&polygon[4], &polygon[5]);
+            tt.forward(&polygon[6], &polygon[7]);
+            cell.y0 = std::floor(std::min(std::min(polygon[1], polygon[3]), std::min(polygon[5], polygon[7])));
+            cell.y1 = std::floor(std::max(std::max(polygon[1], polygon[3]), std::max(polygon[5], polygon[7])));
+
+            unsigned x0 = i * mesh_size;
+            unsigned y0 = j * mesh_size;
+            unsigned x1 = (i+1) * mesh_size;
+            unsigned y1 = (j+1) * mesh_size;
+            x1 = std::min(x1, source.data_.width());
+            y1 = std::min(y1, source.data_.height());
+            cell.inverse = agg::trans_affine(polygon.data(), x0, y0, x1, y1);
+            cells->cells.push_back(cell);
+        }
+    }
+    return cells;
+}
+
+}
+
+void reproject_and_scale_raster(raster & target, raster const& source,
+                                proj_transform const& prj_trans,
+                                double offset_x, double offset_y,
+                                unsigned mesh_size,
+                                scaling_method_e scaling_method,
+                                unsigned threads)
+{
+    std::string key = mesh_key(source, prj_trans, mesh_size);
+    std::string target_key = cells_key(key, target, offset_x, offset_y);
+    warp_cells_ptr cells = warp_cache::instance().cells.find(target_key);
+    if (!cells)
+    {
+        warp_mesh_ptr mesh = warp_cache::instance().meshes.find(key);
+        if (!mesh)
+        {
+            mesh = build_mesh(source, prj_trans, mesh_size);
+            warp_cache::instance().meshes.insert(key, mesh);
+        }
+        cells = build_cells(*mesh, source, target, offset_x, offset_y, mesh_size);
+        warp_cache::instance().cells.insert(target_key, cells);
+    }
 
     // Initialize AGG objects
     using pixfmt = agg::pixfmt_rgba32_pre;
     using color_type = pixfmt::color_type;
     using renderer_base = agg::renderer_base<pixfmt>;
 
-    agg::rasterizer_scanline_aa<> rasterizer;
-    agg::scanline_u8 scanline;
     agg::rendering_buffer buf((unsigned char*)target.data_.getData(),
                               target.data_.width(),
                               target.data_.height(),
                               target.data_.width()*4);
-    pixfmt pixf(buf);
-    renderer_base rb(pixf);
-    rasterizer.clip_box(0, 0, target.data_.width(), target.data_.height());
     agg::rendering_buffer buf_tile(
         (unsigned char*)source.data_.getData(),
         source.data_.width(),
         source.data_.height(),
         source.data_.width() * 4);
 
-    pixfmt pixf_tile(buf_tile);
-
     using img_accessor_type = agg::image_accessor_clone<pixfmt>;
-    img_accessor_type ia(pixf_tile);
-
-    agg::span_allocator<color_type> sa;
 
     // Initialize filter
     agg::image_filter_lut filter;
@@ -142,33 +373,31 @@ void reproject_and_scale_raster(raster & target, raster const& source,
         filter.calculate(agg::image_filter_blackman(source.get_filter_factor()), true); break;
     }
 
-    // Project mesh cells into target interpolating raster inside each one
-    for(unsigned j=0; j<mesh_ny-1; ++j)
+    // Interpolate the raster inside each cell. Bands of target rows are
+    // independent, each is clipped to its rows and has its own AGG state.
+    util::process_bands(target.data_.width(), target.data_.height(), [&](unsigned band_y0, unsigned band_y1)
     {
-        for (unsigned i=0; i<mesh_nx-1; ++i)
+        agg::rasterizer_scanline_aa<> rasterizer;
+        agg::scanline_u8 scanline;
+        pixfmt pixf(buf);
+        renderer_base rb(pixf);
+        rasterizer.clip_box(0, band_y0, target.data_.width(), band_y1);
+        pixfmt pixf_tile(buf_tile);
+        img_accessor_type ia(pixf_tile);
+        agg::span_allocator<color_type> sa;
+
+        for (warp_cell const& cell : cells->cells)
         {
-            double polygon[8] = {xs(i,j), ys(i,j),
-                                 xs(i+1,j), ys(i+1,j),
-                                 xs(i+1,j+1), ys(i+1,j+1),
-                                 xs(i,j+1), ys(i,j+1)};
-            tt.forward(polygon+0, polygon+1);
-            tt.forward(polygon+2, polygon+3);
-            tt.forward(polygon+4, polygon+5);
-            tt.forward(polygon+6, polygon+7);
+            if (cell.y1 < band_y0 || cell.y0 >= band_y1) continue;
 
+            std::array<double, 8> const& polygon = cell.polygon;
             rasterizer.reset();
             rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
             rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
             rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
             rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
 
-            unsigned x0 = i * mesh_size;
-            unsigned y0 = j * mesh_size;
-            unsigned x1 = (i+1) * mesh_size;
-            unsigned y1 = (j+1) * mesh_size;
-            x1 = std::min(x1, source.data_.width());
-            y1 = std::min(y1, source.data_.height());
-            agg::trans_affine tr(polygon, x0, y0, x1, y1);
+            agg::trans_affine tr(cell.inverse);
             if (tr.is_valid())
             {
                 using interpolator_type = agg::span_interpolator_linear<agg::trans_affine>;
@@ -191,8 +420,7 @@ void reproject_and_scale_raster(raster & target, raster const& source,
                                              sa, sg);
                 }
             }
-
         }
-    }
+    }, threads);
 }
 }// namespace mapnik
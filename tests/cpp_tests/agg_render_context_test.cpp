@@ -0,0 +1,167 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/agg_render_context.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/quad_tree.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/make_unique.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+mapnik::Map make_map(unsigned size)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"]="memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    for (int i = 0; i < 8; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx,i + 1));
+        auto poly = std::make_unique<mapnik::geometry_type>(mapnik::geometry_type::types::Polygon);
+        double x = -100 + i * 20;
+        poly->move_to(x, -100 + i * 10);
+        poly->line_to(x + 60, -100 + i * 10);
+        poly->line_to(x + 60, i * 10);
+        poly->line_to(x, i * 10);
+        poly->close_path();
+        feature->add_geometry(poly.release());
+        ds->push(feature);
+    }
+    mapnik::Map m(size, size);
+    mapnik::layer lyr("polygons");
+    lyr.set_datasource(ds);
+    lyr.add_style("fill");
+    lyr.add_style("multiply");
+    m.add_layer(lyr);
+    {
+        mapnik::feature_type_style style;
+        mapnik::rule r;
+        mapnik::polygon_symbolizer sym;
+        mapnik::put(sym, mapnik::keys::fill, mapnik::color(200, 100, 0));
+        r.append(std::move(sym));
+        style.add_rule(std::move(r));
+        m.insert_style("fill", style);
+    }
+    {
+        // composited in the style buffer
+        mapnik::feature_type_style style;
+        style.set_comp_op(mapnik::multiply);
+        mapnik::rule r;
+        mapnik::line_symbolizer sym;
+        mapnik::put(sym, mapnik::keys::stroke_width, 3.0);
+        r.append(std::move(sym));
+        style.add_rule(std::move(r));
+        m.insert_style("multiply", style);
+    }
+    m.zoom_to_box(mapnik::box2d<double>(-128,-128,128,128));
+    return m;
+}
+
+bool same_pixels(mapnik::image_32 const& a, mapnik::image_32 const& b)
+{
+    return a.width() == b.width() && a.height() == b.height() &&
+        std::memcmp(a.raw_data(), b.raw_data(), a.width() * a.height() * 4) == 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // a reset tree keeps its nodes but forgets their contents
+        mapnik::quad_tree<int> tree(mapnik::box2d<double>(0,0,100,100));
+        for (int i = 0; i < 10; ++i)
+        {
+            tree.insert(i, mapnik::box2d<double>(i * 10, i * 10, i * 10 + 1, i * 10 + 1));
+        }
+        std::size_t nodes = std::distance(tree.begin(), tree.end());
+        BOOST_TEST(nodes > 1);
+        tree.reset(mapnik::box2d<double>(0,0,50,50));
+        BOOST_TEST_EQ(std::distance(tree.begin(), tree.end()), 1);
+        BOOST_TEST(tree.extent() == mapnik::box2d<double>(0,0,50,50));
+        BOOST_TEST(tree.query_in_box(tree.extent()) == tree.query_end());
+        tree.insert(42, mapnik::box2d<double>(1,1,2,2));
+        std::vector<int> found;
+        for (auto itr = tree.query_in_box(tree.extent()); itr != tree.query_end(); ++itr)
+        {
+            found.push_back(*itr);
+        }
+        BOOST_TEST_EQ(found.size(), 1u);
+        if (!found.empty()) BOOST_TEST_EQ(found[0], 42);
+
+        // renders with a reused context match renders without one, also
+        // after the map grows past the kept style buffer
+        mapnik::agg_render_context_pool pool;
+        std::shared_ptr<mapnik::agg_render_context> context = pool.local();
+        BOOST_TEST(context == pool.local());
+        for (unsigned size : { 256u, 256u, 512u, 128u })
+        {
+            mapnik::Map m = make_map(size);
+            mapnik::image_32 expected(m.width(), m.height());
+            {
+                mapnik::agg_renderer<mapnik::image_32> ren(m, expected);
+                ren.apply();
+            }
+            mapnik::image_32 image(m.width(), m.height());
+            {
+                mapnik::agg_renderer<mapnik::image_32> ren(m, image, *context);
+                ren.apply();
+            }
+            BOOST_TEST(same_pixels(image, expected));
+        }
+
+        // one renderer at a time
+        {
+            mapnik::Map m = make_map(64);
+            mapnik::image_32 image(m.width(), m.height());
+            mapnik::agg_renderer<mapnik::image_32> ren(m, image, *context);
+            try
+            {
+                mapnik::agg_renderer<mapnik::image_32> other(m, image, *context);
+                BOOST_TEST(false);
+            }
+            catch (std::runtime_error const&) {}
+        }
+        // and free again once it is gone
+        {
+            mapnik::Map m = make_map(64);
+            mapnik::image_32 image(m.width(), m.height());
+            mapnik::agg_renderer<mapnik::image_32> ren(m, image, *context);
+            ren.apply();
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ agg render context: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
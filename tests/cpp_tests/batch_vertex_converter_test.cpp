@@ -0,0 +1,178 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <mapnik/ctrans.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/vertex_converters.hpp>
+#include <mapnik/batch_vertex_converter.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/wkt/wkt_factory.hpp>
+#include <mapnik/wkt/wkt_grammar_impl.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+
+// boost
+#include <boost/mpl/front.hpp>
+
+// agg
+#include "agg_trans_affine.h"
+
+// stl
+#include <stdexcept>
+
+namespace {
+
+struct vertex_recorder
+{
+    template <typename T>
+    void add_path(T & path)
+    {
+        mapnik::vertex2d vtx(mapnik::vertex2d::no_init);
+        path.rewind(0);
+        while ((vtx.cmd = path.vertex(&vtx.x, &vtx.y)) != mapnik::SEG_END)
+        {
+            vertices.push_back(vtx);
+        }
+    }
+    std::vector<mapnik::vertex2d> vertices;
+};
+
+template <template <typename, typename, typename, typename,
+                    typename, typename, typename, typename> class Converter,
+          typename ConvTypes, typename Symbolizer>
+std::vector<mapnik::vertex2d> convert(std::string const& wkt,
+                                      mapnik::box2d<double> const& clip_box,
+                                      std::string const& srs,
+                                      double tolerance)
+{
+    using namespace mapnik;
+    projection source(srs);
+    projection dest(MAPNIK_LONGLAT_PROJ);
+    proj_transform prj_trans(source, dest);
+    CoordTransform tr(256, 256, box2d<double>(-180, -90, 180, 90));
+    agg::trans_affine affine = agg::trans_affine_rotation(0.3) * agg::trans_affine_translation(4, -2);
+    Symbolizer sym;
+    put<value_double>(sym, keys::simplify_tolerance, tolerance);
+    context_ptr ctx = std::make_shared<context_type>();
+    feature_impl feature(ctx, 0);
+    attributes vars;
+    vertex_recorder recorder;
+    Converter<box2d<double>, vertex_recorder, Symbolizer, CoordTransform,
+              proj_transform, agg::trans_affine, ConvTypes, feature_impl>
+        converter(clip_box, recorder, sym, tr, prj_trans, affine, feature, vars, 1.0);
+    converter.template set<transform_tag>();
+    converter.template set<affine_transform_tag>();
+    if (tolerance > 0.0) converter.template set<simplify_tag>();
+    converter.template set<typename boost::mpl::front<ConvTypes>::type>();
+    geometry_container paths;
+    if (!from_wkt(wkt, paths))
+    {
+        throw std::runtime_error("Failed to parse WKT");
+    }
+    for (geometry_type & geom : paths)
+    {
+        converter.apply(geom);
+    }
+    return recorder.vertices;
+}
+
+bool same_vertices(std::vector<mapnik::vertex2d> const& a,
+                   std::vector<mapnik::vertex2d> const& b)
+{
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].cmd != b[i].cmd) return false;
+        // the coordinates of a close command carry no meaning
+        if (a[i].cmd == mapnik::SEG_CLOSE) continue;
+        if (std::fabs(a[i].x - b[i].x) > 1e-9 || std::fabs(a[i].y - b[i].y) > 1e-9) return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    using line_types = boost::mpl::vector<mapnik::clip_line_tag,
+                                          mapnik::transform_tag,
+                                          mapnik::affine_transform_tag,
+                                          mapnik::simplify_tag>;
+    using poly_types = boost::mpl::vector<mapnik::clip_poly_tag,
+                                          mapnik::transform_tag,
+                                          mapnik::affine_transform_tag,
+                                          mapnik::simplify_tag>;
+
+    std::vector<std::string> lines = {
+        "LineString(0 0,200 200)",
+        "LineString(-100 -50,-20 10,0 0,30 5,60 -40,120 30,170 80)",
+        "MultiLineString((10 10,20 20,30 10,40 20),(-200 0,200 1),(50 50,50.01 50.01,50.02 50,90 0))",
+        "LineString(-30 -30,30 -30,30 30,-30 30,-30 -30)",
+    };
+    std::vector<std::string> polygons = {
+        "Polygon((50 50,150 50,150 150,50 150,50 50))",
+        "Polygon((0 0,100 200,200 0,0 0))",
+        "Polygon((-60 -60,60 -60,60 60,-60 60,-60 -60),(-10 -10,10 -10,10 10,-10 10,-10 -10))",
+        "MultiPolygon(((0 0,10 0,10 10,0 10,0 0)),((-170 -80,-100 -80,-100 -20,-170 -20,-170 -80)),((-45 -45,45 -45,0 70,-45 -45)))",
+        "Polygon((-80 0,0 80,80 0,0 -80,-80 0))",
+    };
+    std::vector<mapnik::box2d<double> > boxes = {
+        mapnik::box2d<double>(-40, -40, 40, 40),
+        mapnik::box2d<double>(0, 0, 100, 100),
+        mapnik::box2d<double>(-180, -90, 180, 90),
+        mapnik::box2d<double>(200, 200, 300, 300),
+    };
+
+    for (auto const& box : boxes)
+    {
+        for (double tolerance : { 0.0, 1.0 })
+        {
+            for (auto const& wkt : lines)
+            {
+                auto pull = convert<mapnik::vertex_converter, line_types, mapnik::line_symbolizer>(wkt, box, mapnik::MAPNIK_LONGLAT_PROJ, tolerance);
+                auto batch = convert<mapnik::batch_vertex_converter, line_types, mapnik::line_symbolizer>(wkt, box, mapnik::MAPNIK_LONGLAT_PROJ, tolerance);
+                BOOST_TEST(same_vertices(pull, batch));
+            }
+            for (auto const& wkt : polygons)
+            {
+                auto pull = convert<mapnik::vertex_converter, poly_types, mapnik::polygon_symbolizer>(wkt, box, mapnik::MAPNIK_LONGLAT_PROJ, tolerance);
+                auto batch = convert<mapnik::batch_vertex_converter, poly_types, mapnik::polygon_symbolizer>(wkt, box, mapnik::MAPNIK_LONGLAT_PROJ, tolerance);
+                BOOST_TEST(same_vertices(pull, batch));
+            }
+        }
+    }
+
+    // reprojected input goes through the batch proj_transform stage
+    {
+        std::string wkt("LineString(-1000000 -1000000,0 0,2000000 500000,5000000 5000000)");
+        mapnik::box2d<double> box(-3000000, -3000000, 3000000, 3000000);
+        auto pull = convert<mapnik::vertex_converter, line_types, mapnik::line_symbolizer>(wkt, box, mapnik::MAPNIK_GMERC_PROJ, 0.0);
+        auto batch = convert<mapnik::batch_vertex_converter, line_types, mapnik::line_symbolizer>(wkt, box, mapnik::MAPNIK_GMERC_PROJ, 0.0);
+        BOOST_TEST(!pull.empty());
+        BOOST_TEST(same_vertices(pull, batch));
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ batch vertex converter: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
@@ -41,6 +41,8 @@ else:
             test_env_local = test_env.Clone()
             if 'csv_parse' in cpp_test:
                 source_files += glob.glob('../../plugins/input/csv/' + '*.cpp')
+            if 'gdal_block_cache' in cpp_test:
+                source_files += ['../../plugins/input/gdal/gdal_block_cache.cpp']
             test_program = test_env_local.Program(name, source=source_files)
             Depends(test_program, env.subst('../../src/%s' % env['MAPNIK_LIB_NAME']))
         # build locally if installing
@@ -0,0 +1,94 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/map.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/save_map.hpp>
+#include <mapnik/compiled_map.hpp>
+#include <mapnik/config_error.hpp>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        std::string xml =
+            "<Map srs='+init=epsg:4326' background-color='steelblue' buffer-size='16'>"
+            "<FontSet name='fonts'><Font face-name='DejaVu Sans Book'/></FontSet>"
+            "<Style name='style' filter-mode='first' opacity='0.5' image-filters='agg-stack-blur(2,3),gray'>"
+            "<Rule name='roads'>"
+            "<MaxScaleDenominator>100000</MaxScaleDenominator>"
+            "<Filter>([type] = 'road' and [lanes] &gt; 2) or not ([name].match('^A.*'))</Filter>"
+            "<LineSymbolizer stroke='#ff0000' stroke-width='[lanes] * 1.5' stroke-dasharray='4,2'"
+            " transform='translate(1,2) rotate(45)'/>"
+            "<TextSymbolizer fontset-name='fonts' size='12' placement='line'>"
+            "[name] + ' (' + [ref].replace('A','B') + ')'</TextSymbolizer>"
+            "</Rule>"
+            "<Rule><ElseFilter/><PointSymbolizer file='marker.png' opacity='sin([a])'/></Rule>"
+            "</Style>"
+            "<Layer name='layer' srs='+init=epsg:4326' maximum-extent='-10,-10,10,10'>"
+            "<StyleName>style</StyleName>"
+            "</Layer>"
+            "</Map>";
+
+        mapnik::Map xml_map(256,256);
+        mapnik::load_map_string(xml_map, xml);
+        std::string compiled = mapnik::save_compiled_map_to_string(xml_map);
+
+        mapnik::Map compiled_map(256,256);
+        mapnik::load_compiled_map_string(compiled_map, compiled);
+        BOOST_TEST_EQ(mapnik::save_map_to_string(xml_map), mapnik::save_map_to_string(compiled_map));
+
+        // truncated and foreign input is rejected
+        mapnik::Map m(256,256);
+        try
+        {
+            mapnik::load_compiled_map_string(m, compiled.substr(0, compiled.size() / 2));
+            BOOST_TEST(false);
+        }
+        catch (mapnik::config_error const&) {}
+        try
+        {
+            mapnik::load_compiled_map_string(m, xml);
+            BOOST_TEST(false);
+        }
+        catch (mapnik::config_error const&) {}
+
+        // a huge count anywhere in the input is never trusted for an allocation
+        for (std::size_t i = 0; i + 4 <= compiled.size(); ++i)
+        {
+            std::string corrupt(compiled);
+            corrupt.replace(i, 4, 4, '\xff');
+            try
+            {
+                mapnik::Map cm(256,256);
+                mapnik::load_compiled_map_string(cm, corrupt);
+            }
+            catch (std::bad_alloc const&) { BOOST_TEST(false); }
+            catch (std::length_error const&) { BOOST_TEST(false); }
+            catch (std::exception const&) {}
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ compiled map: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
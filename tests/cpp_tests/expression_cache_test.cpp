@@ -0,0 +1,62 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/expression_cache.hpp>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::expression_cache & cache = mapnik::expression_cache::instance();
+        cache.clear();
+
+        // identical strings share one tree, per grammar
+        mapnik::expression_ptr a = cache.expression("[highway] = 'residential'");
+        mapnik::expression_ptr b = cache.expression("[highway] = 'residential'");
+        BOOST_TEST(a && a == b);
+        BOOST_TEST(cache.expression("[highway] = 'primary'") != a);
+        mapnik::transform_list_ptr t = cache.transform("scale(2)");
+        BOOST_TEST(t && t == cache.transform("scale(2)"));
+        mapnik::path_expression_ptr p = cache.path("icons/[name].svg");
+        BOOST_TEST(p && p == cache.path("icons/[name].svg"));
+
+        // only weak references are kept: once the last user lets go, the
+        // string is parsed again into a new tree
+        std::weak_ptr<mapnik::expr_node> expired = a;
+        a.reset();
+        b.reset();
+        BOOST_TEST(expired.expired());
+        mapnik::expression_ptr c = cache.expression("[highway] = 'residential'");
+        BOOST_TEST(c && c->is<mapnik::binary_node<mapnik::tags::equal_to> >());
+        BOOST_TEST(c == cache.expression("[highway] = 'residential'"));
+
+        // parse errors are not cached
+        try
+        {
+            cache.expression("[highway] = ");
+            BOOST_TEST(false);
+        }
+        catch (std::exception const&) {}
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ expression cache: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,98 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "../../plugins/input/gdal/gdal_block_cache.hpp"
+
+namespace {
+
+gdal_block_key make_key(int block_x, int band = 1, int overview = -1, std::string const& dataset = "a.tif")
+{
+    gdal_block_key key = { dataset, band, overview, block_x, 0 };
+    return key;
+}
+
+gdal_block_ptr make_block(std::size_t bytes)
+{
+    return std::make_shared<std::vector<unsigned char> const>(bytes, 0);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        gdal_block_cache & cache = gdal_block_cache::instance();
+        cache.clear();
+        cache.reserve(300);
+        // the capacity never shrinks
+        cache.reserve(100);
+
+        for (int x = 0; x < 3; ++x)
+        {
+            cache.insert(make_key(x), make_block(100));
+        }
+        BOOST_TEST_EQ(cache.size(), 300u);
+
+        // keys differ by every field
+        BOOST_TEST(cache.find(make_key(0)));
+        BOOST_TEST(!cache.find(make_key(0, 2)));
+        BOOST_TEST(!cache.find(make_key(0, 1, 0)));
+        BOOST_TEST(!cache.find(make_key(0, 1, -1, "b.tif")));
+
+        // block 0 was just used, so block 1 is the least recently used
+        cache.insert(make_key(3), make_block(100));
+        BOOST_TEST_EQ(cache.size(), 300u);
+        BOOST_TEST(cache.find(make_key(0)));
+        BOOST_TEST(!cache.find(make_key(1)));
+        BOOST_TEST(cache.find(make_key(2)));
+        BOOST_TEST(cache.find(make_key(3)));
+
+        // a block that is already cached is not counted twice
+        cache.insert(make_key(3), make_block(100));
+        BOOST_TEST_EQ(cache.size(), 300u);
+
+        // blocks larger than the whole cache are not kept and evict nothing
+        cache.insert(make_key(4), make_block(301));
+        BOOST_TEST(!cache.find(make_key(4)));
+        BOOST_TEST_EQ(cache.size(), 300u);
+
+        // a larger block evicts as many old ones as it needs, oldest first
+        cache.insert(make_key(5), make_block(250));
+        BOOST_TEST_EQ(cache.size(), 250u);
+        BOOST_TEST(cache.find(make_key(5)));
+        BOOST_TEST(!cache.find(make_key(0)));
+        BOOST_TEST(!cache.find(make_key(2)));
+        BOOST_TEST(!cache.find(make_key(3)));
+
+        // evicted blocks stay valid for whoever still reads them
+        gdal_block_ptr held = cache.find(make_key(5));
+        cache.clear();
+        BOOST_TEST_EQ(cache.size(), 0u);
+        BOOST_TEST(!cache.find(make_key(5)));
+        BOOST_TEST_EQ(held->size(), 250u);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ gdal block cache: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,80 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#if defined(GRID_RENDERER)
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/value_types.hpp>
+#include <mapnik/unicode.hpp>
+
+mapnik::feature_ptr make_feature(mapnik::context_ptr const& ctx, mapnik::value_integer id, std::string const& name)
+{
+    mapnik::transcoder tr("utf-8");
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id));
+    feature->put("name", tr.transcode(name.c_str()));
+    return feature;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+#if defined(GRID_RENDERER)
+    try
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("name");
+        mapnik::grid grid(4, 2, "__id__", 1);
+        grid.add_property_name("name");
+        grid.add_feature(*make_feature(ctx, 1, "one"));
+        grid.add_feature(*make_feature(ctx, 2, "t\"wo"));
+        grid.setPixel(2, 0, 1);
+        grid.setPixel(3, 0, 1);
+        grid.setPixel(0, 1, 2);
+        grid.setPixel(1, 1, 1);
+
+        std::string json;
+        mapnik::encode_utf_grid(grid, json);
+        BOOST_TEST_EQ(json, std::string("{\"grid\":[\"  !!\",\"#!  \"],\"keys\":[\"\",\"1\",\"2\"],"
+                                        "\"data\":{\"1\":{\"name\":\"one\"},\"2\":{\"name\":\"t\\\"wo\"}}}"));
+
+        json.clear();
+        mapnik::encode_utf_grid(grid, json, 1, false, true);
+        BOOST_TEST_EQ(json, std::string("{\"grid\":[[0,2,1,2],[2,1,1,1,0,2]],\"keys\":[\"\",\"1\",\"2\"],\"data\":{}}"));
+
+        json.clear();
+        mapnik::encode_utf_grid(grid, json, 2, false);
+        BOOST_TEST_EQ(json, std::string("{\"grid\":[\" !\"],\"keys\":[\"\",\"1\"],\"data\":{}}"));
+
+        // codepoints skip '"', '\' and the UTF-16 surrogates
+        using keys_type = mapnik::utf_grid_keys<mapnik::grid>;
+        BOOST_TEST_EQ(keys_type::codepoint_of(0), 32u);
+        BOOST_TEST_EQ(keys_type::codepoint_of(2), 35u);
+        BOOST_TEST_EQ(keys_type::codepoint_of(59), 93u);
+        BOOST_TEST_EQ(keys_type::codepoint_of(0xd800 - 34), 0xe000u);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+#endif
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ UTFGrid encoding: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,99 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <mapnik/image_data.hpp>
+#include <mapnik/image_compositing.hpp>
+#include "agg_rendering_buffer.h"
+#include "agg_pixfmt_rgba.h"
+#include "agg_renderer_base.h"
+
+// reference result: the plain AGG comp_op path
+void agg_composite(mapnik::image_data_32 & dst, mapnik::image_data_32 & src,
+                   mapnik::composite_mode_e mode, float opacity, int dx, int dy)
+{
+    using blender_type = agg::comp_op_adaptor_rgba_pre<agg::rgba8, agg::order_rgba>;
+    using pixfmt_type = agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>;
+    agg::rendering_buffer dst_buffer(dst.getBytes(),dst.width(),dst.height(),dst.width() * 4);
+    agg::rendering_buffer src_buffer(src.getBytes(),src.width(),src.height(),src.width() * 4);
+    pixfmt_type pixf(dst_buffer);
+    pixf.comp_op(static_cast<agg::comp_op_e>(mode));
+    agg::pixfmt_rgba32 pixf_mask(src_buffer);
+    agg::renderer_base<pixfmt_type> ren(pixf);
+    ren.blend_from(pixf_mask,0,dx,dy,unsigned(255*opacity));
+}
+
+void fill_random(mapnik::image_data_32 & im, bool premultiplied)
+{
+    unsigned char * bytes = im.getBytes();
+    for (unsigned i = 0; i < im.width() * im.height(); ++i)
+    {
+        unsigned char * p = bytes + i * 4;
+        p[3] = (std::rand() % 4 == 0) ? 0 : std::rand() % 256;
+        for (int c = 0; c < 3; ++c)
+        {
+            p[c] = std::rand() % 256;
+            if (premultiplied) p[c] = p[c] * p[3] / 255;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // the modes with dedicated SIMD kernels must match AGG bit for bit,
+        // including odd widths (scalar tails), offsets and non-premultiplied input
+        mapnik::composite_mode_e modes[] = { mapnik::src_over, mapnik::dst_out, mapnik::multiply,
+                                             mapnik::screen, mapnik::overlay, mapnik::darken };
+        float opacities[] = { 1.0f, 0.77f, 0.5f, 0.0f };
+        std::srand(42);
+        for (int i = 0; i < 50; ++i)
+        {
+            unsigned width = 1 + std::rand() % 67;
+            unsigned height = 1 + std::rand() % 7;
+            bool premultiplied = (i % 2 == 0);
+            mapnik::image_data_32 dst(width, height);
+            mapnik::image_data_32 src(1 + std::rand() % 67, 1 + std::rand() % 7);
+            fill_random(dst, premultiplied);
+            fill_random(src, premultiplied);
+            for (mapnik::composite_mode_e mode : modes)
+            {
+                for (float opacity : opacities)
+                {
+                    int dx = std::rand() % 21 - 10;
+                    int dy = std::rand() % 5 - 2;
+                    mapnik::image_data_32 expected(width, height);
+                    mapnik::image_data_32 actual(width, height);
+                    std::memcpy(expected.getBytes(), dst.getBytes(), width * height * 4);
+                    std::memcpy(actual.getBytes(), dst.getBytes(), width * height * 4);
+                    agg_composite(expected, src, mode, opacity, dx, dy);
+                    mapnik::composite(actual, src, mode, opacity, dx, dy);
+                    BOOST_TEST(std::memcmp(expected.getBytes(), actual.getBytes(), width * height * 4) == 0);
+                }
+            }
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ image compositing: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,177 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <mapnik/graphics.hpp>
+#include <mapnik/image_filter.hpp>
+#include <mapnik/util/process_bands.hpp>
+#include <stdexcept>
+
+void fill_random(mapnik::image_32 & im)
+{
+    unsigned char * bytes = im.raw_data();
+    for (unsigned i = 0; i < im.width() * im.height(); ++i)
+    {
+        unsigned char * p = bytes + i * 4;
+        p[3] = (std::rand() % 4 == 0) ? 0 : std::rand() % 256;
+        for (int c = 0; c < 3; ++c)
+        {
+            p[c] = (std::rand() % 256) * p[3] / 255;
+        }
+    }
+}
+
+// reference result: the boost::gil per-pixel convolution
+template <typename Filter>
+void gil_filter(mapnik::image_32 & im, Filter const& filter)
+{
+    {
+        im.demultiply();
+        mapnik::filter::double_buffer<mapnik::image_32> tb(im);
+        mapnik::filter::apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
+    }
+    im.premultiply();
+}
+
+template <typename Filter>
+bool same_as_gil(unsigned width, unsigned height, Filter const& filter)
+{
+    mapnik::image_32 expected(width, height);
+    fill_random(expected);
+    mapnik::image_32 actual(expected);
+    gil_filter(expected, filter);
+    mapnik::filter::apply_filter(actual, filter);
+    return std::memcmp(expected.raw_data(), actual.raw_data(), width * height * 4) == 0;
+}
+
+// What agg_renderer does for a style with filters under a local comp-op:
+// filter only the painted box padded by the chain's spread. The result
+// must equal filtering the whole frame.
+bool region_matches_full_frame(std::vector<mapnik::filter::filter_type> const& filters)
+{
+    unsigned size = 96;
+    mapnik::image_32 full(size, size);
+    mapnik::image_32 painted(30, 20);
+    fill_random(painted);
+    int x0 = 40;
+    int y0 = 35;
+    for (unsigned y = 0; y < painted.height(); ++y)
+    {
+        std::memcpy(full.data().getRow(y0 + y) + x0, painted.data().getRow(y), painted.width() * 4);
+    }
+    int spread = 0;
+    mapnik::filter::filter_spread_visitor spread_visitor(spread);
+    for (mapnik::filter::filter_type const& filter_tag : filters)
+    {
+        mapnik::util::apply_visitor(spread_visitor, filter_tag);
+    }
+    int pad = spread + 1;
+    int rx0 = x0 - pad;
+    int ry0 = y0 - pad;
+    unsigned region_width = painted.width() + 2 * pad;
+    unsigned region_height = painted.height() + 2 * pad;
+    mapnik::image_32 region(region_width, region_height);
+    for (unsigned y = 0; y < region_height; ++y)
+    {
+        std::memcpy(region.data().getRow(y), full.data().getRow(ry0 + y) + rx0, region_width * 4);
+    }
+    mapnik::filter::filter_visitor<mapnik::image_32> full_visitor(full);
+    mapnik::filter::filter_visitor<mapnik::image_32> region_visitor(region);
+    for (mapnik::filter::filter_type const& filter_tag : filters)
+    {
+        mapnik::util::apply_visitor(full_visitor, filter_tag);
+        mapnik::util::apply_visitor(region_visitor, filter_tag);
+    }
+    for (int y = 0; y < static_cast<int>(size); ++y)
+    {
+        for (int x = 0; x < static_cast<int>(size); ++x)
+        {
+            bool inside = x >= rx0 && x < rx0 + static_cast<int>(region_width) &&
+                y >= ry0 && y < ry0 + static_cast<int>(region_height);
+            unsigned expected = full.data()(x, y);
+            unsigned actual = inside ? region.data()(x - rx0, y - ry0) : 0;
+            if (expected != actual) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // banded work stays serial unless the process wide cap is raised
+        BOOST_TEST_EQ(mapnik::util::max_band_threads(), 1u);
+        unsigned calls = 0;
+        mapnik::util::process_bands(1024, 1024, [&calls](unsigned, unsigned) { ++calls; });
+        BOOST_TEST_EQ(calls, 1u);
+        mapnik::util::set_max_band_threads(4);
+
+        // an exception thrown by another band reaches the caller
+        bool caught = false;
+        try
+        {
+            mapnik::util::process_bands(1024, 1024, [](unsigned y0, unsigned)
+            {
+                if (y0 > 0) throw std::runtime_error("band failed");
+            });
+        }
+        catch (std::runtime_error const&)
+        {
+            caught = true;
+        }
+        BOOST_TEST(caught);
+
+        std::srand(7);
+        // odd sizes exercise the edge columns; 700x500 is split into bands
+        unsigned sizes[][2] = { {2,2}, {3,5}, {17,9}, {64,33}, {700,500} };
+        for (auto const& size : sizes)
+        {
+            BOOST_TEST(same_as_gil(size[0], size[1], mapnik::filter::blur()));
+            BOOST_TEST(same_as_gil(size[0], size[1], mapnik::filter::emboss()));
+            BOOST_TEST(same_as_gil(size[0], size[1], mapnik::filter::sharpen()));
+            BOOST_TEST(same_as_gil(size[0], size[1], mapnik::filter::edge_detect()));
+            BOOST_TEST(same_as_gil(size[0], size[1], mapnik::filter::sobel()));
+
+            // banded stack blur must match a single pass over the whole image
+            mapnik::image_32 expected(size[0], size[1]);
+            fill_random(expected);
+            mapnik::image_32 actual(expected);
+            agg::rendering_buffer buf(expected.raw_data(), size[0], size[1], size[0] * 4);
+            agg::pixfmt_rgba32_pre pixf(buf);
+            agg::stack_blur_rgba32(pixf, 5, 3);
+            mapnik::filter::apply_filter(actual, mapnik::filter::agg_stack_blur(5, 3));
+            BOOST_TEST(std::memcmp(expected.raw_data(), actual.raw_data(), size[0] * size[1] * 4) == 0);
+        }
+
+        // chained filters spread further than any one of them
+        using namespace mapnik::filter;
+        BOOST_TEST(region_matches_full_frame({ agg_stack_blur(5, 5) }));
+        BOOST_TEST(region_matches_full_frame({ agg_stack_blur(5, 5), agg_stack_blur(5, 5) }));
+        BOOST_TEST(region_matches_full_frame({ blur(), blur(), blur() }));
+        BOOST_TEST(region_matches_full_frame({ agg_stack_blur(3, 1), sharpen(), emboss(), agg_stack_blur(1, 4) }));
+        BOOST_TEST(region_matches_full_frame({ edge_detect(), sobel(), blur() }));
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ image filters: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -93,6 +93,63 @@ int main(int argc, char** argv)
         }
 #endif
 
+#if defined(HAVE_PNG)
+        {
+            // reduced reads keep every factor-th pixel and honour the region
+            std::string png_file("./tests/data/images/12_654_1580.png");
+            std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(png_file,"png"));
+            unsigned width = reader->width();
+            unsigned height = reader->height();
+            mapnik::image_data_32 full(width, height);
+            reader->read(0, 0, full);
+            unsigned factor = reader->reduction(4);
+            BOOST_TEST_EQ( factor, 4u );
+            mapnik::image_data_32 reduced((width + 3) / 4, (height + 3) / 4);
+            reader->read_reduced(0, 0, factor, reduced);
+            mapnik::image_data_32 region(reduced.width() / 2, reduced.height() / 2);
+            reader->read_reduced(reduced.width() / 4, reduced.height() / 4, factor, region);
+            unsigned mismatches = 0;
+            for (unsigned y = 0; y < reduced.height(); ++y)
+            {
+                for (unsigned x = 0; x < reduced.width(); ++x)
+                {
+                    if (reduced.getRow(y)[x] != full.getRow(y * 4)[x * 4]) ++mismatches;
+                }
+            }
+            for (unsigned y = 0; y < region.height(); ++y)
+            {
+                for (unsigned x = 0; x < region.width(); ++x)
+                {
+                    if (region.getRow(y)[x] != reduced.getRow(y + reduced.height() / 4)[x + reduced.width() / 4]) ++mismatches;
+                }
+            }
+            BOOST_TEST_EQ( mismatches, 0u );
+        }
+#endif
+
+#if defined(HAVE_JPEG)
+        {
+            std::string jpeg_file("./tests/data/images/checker.jpg");
+            std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(jpeg_file,"jpeg"));
+            BOOST_TEST_EQ( reader->reduction(3), 2u );
+            BOOST_TEST_EQ( reader->reduction(100), 8u );
+            unsigned factor = reader->reduction(2);
+            mapnik::image_data_32 reduced((reader->width() + 1) / 2, (reader->height() + 1) / 2);
+            reader->read_reduced(0, 0, factor, reduced);
+            mapnik::image_data_32 region(reduced.width() / 2, reduced.height() / 2);
+            reader->read_reduced(3, 5, factor, region);
+            unsigned mismatches = 0;
+            for (unsigned y = 0; y < region.height(); ++y)
+            {
+                for (unsigned x = 0; x < region.width(); ++x)
+                {
+                    if (region.getRow(y)[x] != reduced.getRow(y + 5)[x + 3]) ++mismatches;
+                }
+            }
+            BOOST_TEST_EQ( mismatches, 0u );
+        }
+#endif
+
 #if defined(HAVE_WEBP)
         should_throw = "./tests/cpp_tests/data/blank.webp";
         BOOST_TEST( mapnik::util::exists( should_throw ) );
@@ -0,0 +1,67 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/box2d.hpp>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        using mapnik::box2d;
+        mapnik::value_unicode_string main_street("Main Street");
+        mapnik::value_unicode_string high_street("High Street");
+        mapnik::value_unicode_string empty;
+
+        mapnik::label_collision_detector4 detector(box2d<double>(0, 0, 1000, 1000));
+        detector.insert(box2d<double>(100, 100, 150, 110), main_street);
+
+        // overlapping boxes collide whatever their text
+        BOOST_TEST(!detector.has_placement(box2d<double>(140, 105, 190, 115), 0, high_street, 0));
+        // minimum distance applies to every label
+        BOOST_TEST(!detector.has_placement(box2d<double>(160, 100, 210, 110), 20, high_street, 0));
+        BOOST_TEST(detector.has_placement(box2d<double>(160, 100, 210, 110), 5, high_street, 0));
+
+        // repeat distance only to labels with the same text
+        BOOST_TEST(!detector.has_placement(box2d<double>(200, 100, 250, 110), 0, main_street, 100));
+        BOOST_TEST(detector.has_placement(box2d<double>(200, 100, 250, 110), 0, high_street, 100));
+        BOOST_TEST(detector.has_placement(box2d<double>(300, 100, 350, 110), 0, main_street, 100));
+        detector.insert(box2d<double>(300, 100, 350, 110), main_street);
+        BOOST_TEST(!detector.has_placement(box2d<double>(420, 100, 470, 110), 0, main_street, 100));
+        BOOST_TEST(detector.has_placement(box2d<double>(500, 100, 550, 110), 0, main_street, 100));
+
+        // labels without text repeat each other, including ones inserted
+        // without a text at all
+        detector.insert(box2d<double>(100, 500, 150, 510));
+        BOOST_TEST(!detector.has_placement(box2d<double>(200, 500, 250, 510), 0, empty, 100));
+        BOOST_TEST(detector.has_placement(box2d<double>(200, 500, 250, 510), 0, high_street, 100));
+        detector.insert(box2d<double>(100, 700, 150, 710), empty);
+        BOOST_TEST(!detector.has_placement(box2d<double>(100, 760, 150, 770), 0, empty, 100));
+
+        // clearing forgets the texts too
+        detector.clear();
+        BOOST_TEST(detector.has_placement(box2d<double>(200, 100, 250, 110), 0, main_street, 100));
+        BOOST_TEST(detector.begin() == detector.end());
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ label collision detector: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
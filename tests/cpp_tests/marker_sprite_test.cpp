@@ -0,0 +1,169 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mapnik/graphics.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/marker.hpp>
+#include <mapnik/marker_helpers.hpp>
+#include <mapnik/marker_sprite_cache.hpp>
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/svg/svg_converter.hpp>
+#include <mapnik/svg/svg_renderer_agg.hpp>
+#include <mapnik/svg/svg_path_adapter.hpp>
+#include "agg_ellipse.h"
+#include "agg_rasterizer_scanline_aa.h"
+#include "agg_pixfmt_rgba.h"
+
+namespace {
+
+using namespace mapnik::svg;
+using color_type = agg::rgba8;
+using order_type = agg::order_rgba;
+using blender_type = agg::comp_op_adaptor_rgba_pre<color_type, order_type>;
+using buf_type = agg::rendering_buffer;
+using pixfmt_comp_type = agg::pixfmt_custom_blend_rgba<blender_type, buf_type>;
+using renderer_base = agg::renderer_base<pixfmt_comp_type>;
+using renderer_type = agg::renderer_scanline_aa_solid<renderer_base>;
+using svg_attribute_type = agg::pod_bvector<path_attributes>;
+using svg_renderer_type = svg_renderer_agg<svg_path_adapter,
+                                           svg_attribute_type,
+                                           renderer_type,
+                                           pixfmt_comp_type>;
+using rasterizer = agg::rasterizer_scanline_aa<>;
+using context_type = std::tuple<buf_type &, rasterizer &, mapnik::image_32 &, mapnik::marker_sprite_cache &>;
+using dispatch_type = mapnik::vector_markers_rasterizer_dispatch<svg_renderer_type, mapnik::label_collision_detector4, context_type>;
+
+// a filled and stroked ellipse, like shape://ellipse
+mapnik::svg_path_ptr make_marker(agg::rgba8 const& fill)
+{
+    mapnik::svg_path_ptr marker = std::make_shared<mapnik::svg_storage_type>();
+    vertex_stl_adapter<svg_path_storage> stl_storage(marker->source());
+    svg_path_adapter svg_path(stl_storage);
+    svg_converter_type svg(svg_path, marker->attributes());
+    svg.push_attr();
+    svg.fill(fill);
+    svg.stroke(agg::rgba8(0, 0, 0, 255));
+    svg.stroke_width(1.5);
+    svg.begin_path();
+    agg::ellipse ellipse(0, 0, 7, 4);
+    svg.storage().concat_path(ellipse);
+    svg.end_path();
+    svg.pop_attr();
+    double lox, loy, hix, hiy;
+    svg.bounding_rect(&lox, &loy, &hix, &hiy);
+    marker->set_bounding_box(lox, loy, hix, hiy);
+    return marker;
+}
+
+// Draws markers snapped to pixels at a grid of fractional positions the way
+// the agg renderer does, one dispatcher per feature. Every other feature
+// uses `other`, with `attrs` in place of its own attributes when given.
+void render(mapnik::image_32 & im, mapnik::marker_sprite_cache & cache,
+            mapnik::svg_path_ptr const& marker, mapnik::svg_path_ptr const& other,
+            svg_attribute_type const* attrs)
+{
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::allow_overlap, true);
+    mapnik::put(sym, mapnik::keys::ignore_placement, true);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::attributes vars;
+    mapnik::label_collision_detector4 detector(mapnik::box2d<double>(0, 0, im.width(), im.height()));
+    buf_type buf(im.raw_data(), im.width(), im.height(), im.width() * 4);
+    rasterizer ras;
+    context_type renderer_context(buf, ras, im, cache);
+    agg::trans_affine tr = agg::trans_affine_scaling(1.5);
+    for (unsigned i = 0; i < 400; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i + 1));
+        mapnik::geometry_type point(mapnik::geometry_type::types::Point);
+        point.move_to(8.3 + (i % 20) * 12.37, 6.9 + (i / 20) * 11.61);
+        mapnik::svg_path_ptr const& mark = (i % 2) ? other : marker;
+        vertex_stl_adapter<svg_path_storage> stl_storage(mark->source());
+        svg_path_adapter svg_path(stl_storage);
+        svg_attribute_type const& marker_attrs = (i % 2 && attrs) ? *attrs : mark->attributes();
+        dispatch_type dispatch(svg_path, marker_attrs, mark, mark->bounding_box(), tr, sym,
+                               detector, 1.0, *feature, vars, true, renderer_context);
+        dispatch.add_path(point);
+    }
+}
+
+// largest difference of any channel
+int max_difference(mapnik::image_32 const& a, mapnik::image_32 const& b)
+{
+    unsigned char const* pa = a.raw_data();
+    unsigned char const* pb = b.raw_data();
+    int diff = 0;
+    for (unsigned i = 0; i < a.width() * a.height() * 4; ++i)
+    {
+        diff = std::max(diff, std::abs(pa[i] - pb[i]));
+    }
+    return diff;
+}
+
+bool compare(mapnik::svg_path_ptr const& marker, mapnik::svg_path_ptr const& other,
+             svg_attribute_type const* attrs)
+{
+    mapnik::image_32 vectors(256, 256);
+    vectors.set_background(mapnik::color(240, 230, 200));
+    mapnik::image_32 sprites(256, 256);
+    sprites.set_background(mapnik::color(240, 230, 200));
+    // no room for any sprite, so every placement is drawn as vectors
+    mapnik::marker_sprite_cache no_sprites(0);
+    std::size_t budget = 16 * 1024 * 1024;
+    mapnik::marker_sprite_cache cache(budget);
+    render(vectors, no_sprites, marker, other, attrs);
+    render(sprites, cache, marker, other, attrs);
+    // sprites were made and took some of the budget
+    BOOST_TEST(!cache.reserve(budget));
+    // compositing a premultiplied sprite rounds once more than drawing
+    // the fill and the stroke straight into the image
+    int diff = max_difference(vectors, sprites);
+    if (diff > 1) std::clog << "sprites differ from vectors by " << diff << "\n";
+    return diff <= 1;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::svg_path_ptr blue = make_marker(agg::rgba8(0, 0, 255, 255));
+        mapnik::svg_path_ptr red = make_marker(agg::rgba8(255, 0, 0, 200));
+        // snapped placements all share one sprite per marker
+        BOOST_TEST(compare(blue, blue, nullptr));
+        // two cached markers of the same shape get sprites of their own
+        BOOST_TEST(compare(blue, red, nullptr));
+        // overridden attributes are part of the key, not the marker alone
+        svg_attribute_type overridden;
+        overridden.push_back(blue->attributes()[0]);
+        overridden.last().fill_color = agg::rgba8(0, 160, 0, 255);
+        BOOST_TEST(compare(blue, blue, &overridden));
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ marker sprites: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,105 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/color.hpp>
+#include <mapnik/image_data.hpp>
+#include <mapnik/image_reader.hpp>
+#include <mapnik/unique_lock.hpp>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // 3x2 tiles of 16 pixels, each filled with its own index
+        mapnik::image_data_32 image(48, 32);
+        for (unsigned y = 0; y < 32; ++y)
+        {
+            for (unsigned x = 0; x < 48; ++x)
+            {
+                image(x, y) = (y / 16) * 3 + x / 16;
+            }
+        }
+        std::vector<mapnik::image_view<mapnik::image_data_32> > tiles = mapnik::slice_metatile(image, 3, 2, 16);
+        BOOST_TEST_EQ(tiles.size(), 6u);
+        for (std::size_t i = 0; i < tiles.size(); ++i)
+        {
+            BOOST_TEST_EQ(tiles[i].width(), 16u);
+            BOOST_TEST_EQ(tiles[i].height(), 16u);
+            BOOST_TEST_EQ(tiles[i].getRow(0)[0], i);
+            BOOST_TEST_EQ(tiles[i].getRow(15)[15], i);
+        }
+
+        try
+        {
+            mapnik::slice_metatile(image, 4, 2, 16);
+            BOOST_TEST(false);
+        }
+        catch (std::runtime_error const&) {}
+
+        mapnik::Map m(256, 256);
+        m.set_background(mapnik::color(255, 0, 0));
+        mapnik::metatile tile(mapnik::box2d<double>(-180, -90, 180, 90), 2, 1, 64);
+        BOOST_TEST_EQ(tile.threads, 1u);
+        // the same tiles whether encoded on the calling thread or on several
+        std::map<std::pair<unsigned, unsigned>, std::string> serial;
+        for (unsigned threads : { 1u, 2u, 0u })
+        {
+            tile.threads = threads;
+            std::map<std::pair<unsigned, unsigned>, std::string> encoded;
+            std::mutex encoded_mutex;
+            mapnik::render_metatile(m, tile, "png",
+                                    [&](unsigned column, unsigned row, std::string && data)
+                                    {
+                                        mapnik::scoped_lock lock(encoded_mutex);
+                                        encoded[std::make_pair(column, row)] = std::move(data);
+                                    });
+            BOOST_TEST_EQ(encoded.size(), 2u);
+            for (auto const& kv : encoded)
+            {
+                std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(kv.second.data(), kv.second.size()));
+                BOOST_TEST(reader.get() != nullptr);
+                if (reader.get())
+                {
+                    BOOST_TEST_EQ(reader->width(), 64u);
+                    BOOST_TEST_EQ(reader->height(), 64u);
+                }
+            }
+            if (threads == 1) serial = encoded;
+            else BOOST_TEST(encoded == serial);
+        }
+
+        // encoder errors reach the caller
+        try
+        {
+            mapnik::render_metatile(m, tile, "not-a-format",
+                                    [](unsigned, unsigned, std::string &&) {});
+            BOOST_TEST(false);
+        }
+        catch (std::exception const&) {}
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ metatile: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,104 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <mapnik/raster.hpp>
+#include <mapnik/raster_colorizer.hpp>
+#include <mapnik/util/process_bands.hpp>
+#include <mapnik/feature.hpp>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::raster_colorizer colorizer(mapnik::COLORIZER_LINEAR, mapnik::color(10,20,30,40));
+        colorizer.add_stop(mapnik::colorizer_stop(-100, mapnik::COLORIZER_INHERIT, mapnik::color(0,0,255)));
+        colorizer.add_stop(mapnik::colorizer_stop(0, mapnik::COLORIZER_DISCRETE, mapnik::color(0,255,0)));
+        colorizer.add_stop(mapnik::colorizer_stop(300, mapnik::COLORIZER_LINEAR, mapnik::color(255,255,0,128)));
+        colorizer.add_stop(mapnik::colorizer_stop(1000.5, mapnik::COLORIZER_EXACT, mapnik::color(255,0,0)));
+        colorizer.add_stop(mapnik::colorizer_stop(4000, mapnik::COLORIZER_LINEAR, mapnik::color(255,255,255)));
+
+        // large enough for the integer lookup table and row bands
+        mapnik::util::set_max_band_threads(4);
+        unsigned width = 1100;
+        unsigned height = 1000;
+        std::shared_ptr<mapnik::raster> raster = std::make_shared<mapnik::raster>(mapnik::box2d<double>(0,0,1,1), width, height, 1.0);
+        raster->set_nodata(-9999);
+        std::srand(42);
+        std::vector<float> values(width * height);
+        for (float & value : values)
+        {
+            switch (std::rand() % 5)
+            {
+            case 0: value = static_cast<float>(std::rand() % 70000 - 200); break;
+            case 1: value = (std::rand() % 500000) / 100.0f - 200.0f; break;
+            case 2: value = -9999.0f; break;
+            case 3: value = std::numeric_limits<float>::quiet_NaN(); break;
+            default: value = 1000.5f; break;
+            }
+        }
+        unsigned * data = raster->data_.getData();
+        std::copy(values.begin(), values.end(), reinterpret_cast<float *>(data));
+
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_impl feature(ctx, 1);
+        colorizer.colorize(raster, feature);
+
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            unsigned expected = (values[i] == -9999.0f) ? 0 : colorizer.get_color(values[i]);
+            if (data[i] != expected) ++mismatches;
+        }
+        BOOST_TEST_EQ(mismatches, 0u);
+
+        // single bands kept in their source type give the same colors
+        std::shared_ptr<mapnik::raster> gray8 = std::make_shared<mapnik::raster>(mapnik::box2d<double>(0,0,1,1), 300, 300, 1.0, mapnik::RASTER_GRAY8);
+        std::shared_ptr<mapnik::raster> gray16 = std::make_shared<mapnik::raster>(mapnik::box2d<double>(0,0,1,1), 300, 300, 1.0, mapnik::RASTER_GRAY16);
+        std::shared_ptr<mapnik::raster> float32 = std::make_shared<mapnik::raster>(mapnik::box2d<double>(0,0,1,1), 300, 300, 1.0, mapnik::RASTER_FLOAT32);
+        gray16->set_nodata(300);
+        for (unsigned i = 0; i < 300 * 300; ++i)
+        {
+            gray8->band_8().getData()[i] = static_cast<unsigned char>(i % 256);
+            gray16->band_16().getData()[i] = static_cast<std::uint16_t>((i * 7) % 65536);
+            float32->band_32f().getData()[i] = values[i];
+        }
+        colorizer.colorize(gray8, feature);
+        colorizer.colorize(gray16, feature);
+        colorizer.colorize(float32, feature);
+        BOOST_TEST_EQ(gray8->data_.width(), 300u);
+        BOOST_TEST_EQ(gray16->data_.height(), 300u);
+        mismatches = 0;
+        for (unsigned i = 0; i < 300 * 300; ++i)
+        {
+            float value16 = static_cast<float>((i * 7) % 65536);
+            if (gray8->data_.getData()[i] != colorizer.get_color(static_cast<float>(i % 256))) ++mismatches;
+            if (gray16->data_.getData()[i] != (value16 == 300 ? 0 : colorizer.get_color(value16))) ++mismatches;
+            if (float32->data_.getData()[i] != colorizer.get_color(values[i])) ++mismatches;
+        }
+        BOOST_TEST_EQ(mismatches, 0u);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ raster colorizer: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
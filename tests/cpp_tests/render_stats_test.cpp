@@ -0,0 +1,139 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/render_stats.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/make_unique.hpp>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // ten lines, of which [kind] = 1 matches three
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("kind");
+        mapnik::parameters params;
+        params["type"]="memory";
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        for (int i = 0; i < 10; ++i)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx,i + 1));
+            feature->put("kind", mapnik::value_integer(i % 3 == 0 && i > 0 ? 1 : 0));
+            auto line = std::make_unique<mapnik::geometry_type>(mapnik::geometry_type::types::LineString);
+            line->move_to(-100, i * 10 - 50);
+            line->line_to(100, i * 10 - 50);
+            feature->add_geometry(line.release());
+            ds->push(feature);
+        }
+
+        mapnik::Map m(256,256);
+        mapnik::layer lyr("lines");
+        lyr.set_datasource(ds);
+        lyr.add_style("matching");
+        lyr.add_style("composited");
+        m.add_layer(lyr);
+        {
+            mapnik::feature_type_style style;
+            mapnik::rule r;
+            r.set_filter(mapnik::parse_expression("[kind] = 1"));
+            r.append(mapnik::line_symbolizer());
+            style.add_rule(std::move(r));
+            m.insert_style("matching", style);
+        }
+        {
+            // compositing makes the agg renderer allocate a style buffer
+            mapnik::feature_type_style style;
+            style.set_comp_op(mapnik::multiply);
+            mapnik::rule r;
+            r.append(mapnik::line_symbolizer());
+            r.append(mapnik::polygon_symbolizer());
+            style.add_rule(std::move(r));
+            m.insert_style("composited", style);
+        }
+        m.zoom_to_box(mapnik::box2d<double>(-128,-128,128,128));
+
+        mapnik::render_stats stats;
+        mapnik::image_32 buf(m.width(),m.height());
+        mapnik::agg_renderer<mapnik::image_32> ren(m,buf);
+        ren.set_stats(&stats);
+        ren.apply();
+
+        BOOST_TEST_EQ(stats.layers.size(), 1u);
+        if (stats.layers.size() == 1)
+        {
+            mapnik::layer_stats const& layer = stats.layers[0];
+            BOOST_TEST_EQ(layer.name, std::string("lines"));
+            // one featureset per style
+            BOOST_TEST_EQ(layer.features_fetched, 20u);
+            BOOST_TEST_EQ(layer.styles.size(), 2u);
+            if (layer.styles.size() == 2)
+            {
+                mapnik::style_stats const& matching = layer.styles[0];
+                BOOST_TEST_EQ(matching.name, std::string("matching"));
+                BOOST_TEST_EQ(matching.features_fetched, 10u);
+                BOOST_TEST_EQ(matching.features_matched, 3u);
+                BOOST_TEST_EQ(matching.symbolizers.size(), 1u);
+                BOOST_TEST_EQ(matching.symbolizers.count("LineSymbolizer"), 1u);
+                if (matching.symbolizers.count("LineSymbolizer"))
+                {
+                    BOOST_TEST_EQ(matching.symbolizers.at("LineSymbolizer").count, 3u);
+                }
+                BOOST_TEST_EQ(matching.bytes_allocated, 0u);
+
+                mapnik::style_stats const& composited = layer.styles[1];
+                BOOST_TEST_EQ(composited.features_matched, 10u);
+                BOOST_TEST_EQ(composited.symbolizers.size(), 2u);
+                BOOST_TEST_EQ(composited.bytes_allocated, 256u * 256u * 4u);
+                BOOST_TEST_EQ(composited.labels_attempted, 0u);
+            }
+        }
+        BOOST_TEST(stats.render_ms >= 0.0);
+
+        std::string json = stats.to_json();
+        BOOST_TEST(json.find("\"layers\":[{\"name\":\"lines\"") != std::string::npos);
+        BOOST_TEST(json.find("\"LineSymbolizer\":{\"count\":3,") != std::string::npos);
+        BOOST_TEST(json.find("\"bytes_allocated\":262144,") != std::string::npos);
+
+        // rendering without stats leaves them alone
+        ren.set_stats(nullptr);
+        ren.apply();
+        BOOST_TEST_EQ(stats.layers.size(), 1u);
+
+        stats.clear();
+        BOOST_TEST_EQ(stats.to_json(), std::string("{\"render_ms\":0.000,\"encode_ms\":0.000,\"features_fetched\":0,"
+                                                   "\"labels_attempted\":0,\"labels_placed\":0,\"bytes_allocated\":0,\"layers\":[]}"));
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ render stats: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,127 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/rule.hpp>
+#include <mapnik/rule_index.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/value.hpp>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+mapnik::rule make_rule(std::string const& filter)
+{
+    mapnik::rule r;
+    r.set_filter(mapnik::parse_expression(filter));
+    return r;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        std::vector<mapnik::rule> rules;
+        rules.push_back(make_rule("[highway] = 'motorway'"));
+        rules.push_back(make_rule("[highway] = 'primary' or [highway] = 'secondary'"));
+        rules.push_back(make_rule("[tunnel] = 'yes'"));
+        rules.push_back(make_rule("[highway] = 'primary' and [bridge] = 'yes'"));
+        rules.push_back(make_rule("'residential' = [highway]"));
+        rules.push_back(make_rule("[highway] = 3"));
+        mapnik::rule_index::rule_ptrs ptrs;
+        for (mapnik::rule const& r : rules) ptrs.push_back(&r);
+
+        mapnik::rule_index index;
+        index.build(ptrs);
+        BOOST_TEST(index.indexed());
+        BOOST_TEST_EQ(index.attribute_name(), std::string("highway"));
+
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("highway");
+        mapnik::transcoder tr("utf-8");
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+
+        // keyed rules for the value plus the unkeyed [tunnel] rule, in order
+        feature->put("highway", tr.transcode("primary"));
+        mapnik::rule_index::rule_ptrs const& primary = index.candidates(*feature);
+        BOOST_TEST_EQ(primary.size(), 3u);
+        if (primary.size() == 3)
+        {
+            BOOST_TEST(primary[0] == &rules[1]);
+            BOOST_TEST(primary[1] == &rules[2]);
+            BOOST_TEST(primary[2] == &rules[3]);
+        }
+
+        feature->put("highway", tr.transcode("footway"));
+        BOOST_TEST_EQ(index.candidates(*feature).size(), 1u);
+
+        // numbers compare across integer and double
+        feature->put("highway", mapnik::value_double(3.0));
+        BOOST_TEST_EQ(index.candidates(*feature).size(), 2u);
+        // from 2^53 on doubles match several integers, so every rule is a candidate
+        feature->put("highway", mapnik::value_double(9223372036854775808.0));
+        BOOST_TEST_EQ(index.candidates(*feature).size(), rules.size());
+        feature->put("highway", mapnik::value_double(-9007199254740992.0));
+        BOOST_TEST_EQ(index.candidates(*feature).size(), rules.size());
+        feature->put("highway", mapnik::value_double(std::numeric_limits<double>::quiet_NaN()));
+        BOOST_TEST_EQ(index.candidates(*feature).size(), 1u);
+        // fractions match no integer key
+        feature->put("highway", mapnik::value_double(3.5));
+        BOOST_TEST_EQ(index.candidates(*feature).size(), 1u);
+
+        {
+            // 2^53 + 1 converts to the double 2^53, which the filter then equals
+            std::vector<mapnik::rule> big;
+            big.push_back(make_rule("[id] = 9007199254740993"));
+            big.push_back(make_rule("[id] = 1"));
+            big.push_back(make_rule("[id] = 2"));
+            big.push_back(make_rule("[id] = 3"));
+            mapnik::rule_index::rule_ptrs big_ptrs;
+            for (mapnik::rule const& r : big) big_ptrs.push_back(&r);
+            mapnik::rule_index big_index;
+            big_index.build(big_ptrs);
+            BOOST_TEST(big_index.indexed());
+            mapnik::context_ptr id_ctx = std::make_shared<mapnik::context_type>();
+            id_ctx->push("id");
+            mapnik::feature_ptr id_feature(mapnik::feature_factory::create(id_ctx, 1));
+            id_feature->put("id", mapnik::value_double(9007199254740992.0));
+            mapnik::rule_index::rule_ptrs const& found = big_index.candidates(*id_feature);
+            BOOST_TEST(std::find(found.begin(), found.end(), &big[0]) != found.end());
+            mapnik::value_type matched = mapnik::util::apply_visitor(
+                mapnik::evaluate<mapnik::feature_impl, mapnik::value_type, mapnik::attributes>(*id_feature, mapnik::attributes()),
+                *big[0].get_filter());
+            BOOST_TEST(matched.to_bool());
+        }
+
+        // too few keyed rules are left to the linear scan
+        ptrs.resize(3);
+        index.build(ptrs);
+        BOOST_TEST(!index.indexed());
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ rule index: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
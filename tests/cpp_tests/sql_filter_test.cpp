@@ -0,0 +1,114 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/sql_filter.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/attribute_descriptor.hpp>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace {
+
+boost::optional<std::string> to_sql(std::vector<std::string> const& filters)
+{
+    mapnik::layer_descriptor desc("test", "utf-8");
+    desc.add_descriptor(mapnik::attribute_descriptor("name", mapnik::String));
+    desc.add_descriptor(mapnik::attribute_descriptor("pop", mapnik::Integer));
+    desc.add_descriptor(mapnik::attribute_descriptor("area", mapnik::Double));
+    std::vector<mapnik::expression_ptr> exprs;
+    for (std::string const& filter : filters)
+    {
+        exprs.push_back(mapnik::parse_expression(filter));
+    }
+    return mapnik::sql_utils::filters_to_sql(exprs, desc);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        boost::optional<std::string> sql = to_sql({ "[name] = 'O''Hare'" });
+        BOOST_TEST(sql);
+        if (sql) BOOST_TEST_EQ(*sql, std::string("(\"name\" IS NOT NULL AND \"name\" = 'O''Hare')"));
+
+        // literal on the left flips the operator, rules are OR'ed
+        sql = to_sql({ "1000 < [pop]", "[area] <> 2.5" });
+        BOOST_TEST(sql);
+        if (sql) BOOST_TEST_EQ(*sql, std::string("((\"pop\" IS NOT NULL AND \"pop\" > 1000) OR "
+                                                  "(\"area\" IS NULL OR \"area\" <> 2.5))"));
+
+        // untranslatable parts of an and are dropped
+        sql = to_sql({ "[pop] >= 10 and [name].match('^A')" });
+        BOOST_TEST(sql);
+        if (sql) BOOST_TEST_EQ(*sql, std::string("(\"pop\" IS NOT NULL AND \"pop\" >= 10)"));
+
+        // ... which makes them unusable under not
+        BOOST_TEST(!to_sql({ "not ([pop] >= 10 and [name].match('^A'))" }));
+        // a rule nothing can be derived for needs every row
+        BOOST_TEST(!to_sql({ "[pop] > 10", "[name].match('^A')" }));
+        BOOST_TEST(!to_sql({ "[pop] > 10 or [missing] = 1" }));
+        // type mismatches and string ordering are left to mapnik
+        BOOST_TEST(!to_sql({ "[name] = 1" }));
+        BOOST_TEST(!to_sql({ "[pop] = '1'" }));
+        BOOST_TEST(!to_sql({ "[name] > 'm'" }));
+        // SQL may find more strings equal than mapnik, so no NOT around them
+        BOOST_TEST(!to_sql({ "not ([name] = 'Main')" }));
+        BOOST_TEST(!to_sql({ "not ([pop] > 10 and [name] = 'Main')" }));
+        sql = to_sql({ "not ([pop] = 10)" });
+        BOOST_TEST(sql);
+        if (sql) BOOST_TEST_EQ(*sql, std::string("(NOT (\"pop\" IS NOT NULL AND \"pop\" = 10))"));
+        sql = to_sql({ "not ([area] <> 2.5)" });
+        BOOST_TEST(sql);
+        // SQL sorts NaN and text in numeric columns above every number,
+        // where mapnik finds them neither greater nor less
+        BOOST_TEST(!to_sql({ "not ([area] > 2.5)" }));
+        BOOST_TEST(!to_sql({ "not ([pop] < 10)" }));
+        BOOST_TEST(!to_sql({ "not (10 <= [pop])" }));
+        BOOST_TEST(!to_sql({ "not ([pop] >= 10 or [pop] = 3)" }));
+        // which is fine outside of NOT
+        sql = to_sql({ "[area] > 2.5 and not ([pop] = 3)" });
+        BOOST_TEST(sql);
+        if (sql) BOOST_TEST_EQ(*sql, std::string("((\"area\" IS NOT NULL AND \"area\" > 2.5) AND "
+                                                  "(NOT (\"pop\" IS NOT NULL AND \"pop\" = 3)))"));
+        // inf and nan have no SQL literal
+        {
+            mapnik::layer_descriptor desc("test", "utf-8");
+            desc.add_descriptor(mapnik::attribute_descriptor("area", mapnik::Double));
+            for (double val : { std::numeric_limits<double>::infinity(),
+                                std::numeric_limits<double>::quiet_NaN() })
+            {
+                std::vector<mapnik::expression_ptr> exprs;
+                exprs.push_back(std::make_shared<mapnik::expr_node>(
+                    mapnik::binary_node<mapnik::tags::less>(mapnik::attribute("area"), val)));
+                BOOST_TEST(!mapnik::sql_utils::filters_to_sql(exprs, desc));
+            }
+        }
+        BOOST_TEST(!to_sql({ "true" }));
+        BOOST_TEST(!to_sql({}));
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ sql filter: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -2,6 +2,10 @@
 #include <boost/detail/lightweight_test.hpp>
 #include <iostream>
 #include <mapnik/symbolizer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/parse_path.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
 #include <vector>
 #include <algorithm>
 
@@ -30,6 +34,43 @@ int main(int argc, char** argv)
         BOOST_TEST(true);
     }
 
+    try {
+        line_symbolizer sym;
+        put(sym, keys::stroke_width, parse_expression("[width] * 2"));
+        put(sym, keys::stroke_opacity, parse_expression("0.25 + 0.25"));
+        put(sym, keys::file, parse_path("icons/dot.svg"));
+        put(sym, keys::stroke_linecap, ROUND_CAP);
+        compile_properties(sym);
+        BOOST_TEST(sym.compiled != nullptr);
+        if (sym.compiled)
+        {
+            // only the feature dependent width is left to evaluate
+            BOOST_TEST(sym.compiled->evaluate.test(static_cast<std::size_t>(keys::stroke_width)));
+            BOOST_TEST_EQ(sym.compiled->evaluate.count(), 1u);
+        }
+
+        context_ptr ctx = std::make_shared<context_type>();
+        ctx->push("width");
+        feature_ptr feature(feature_factory::create(ctx, 1));
+        feature->put("width", value_integer(3));
+        attributes vars;
+        BOOST_TEST_EQ(get<value_double>(sym, keys::stroke_width, *feature, vars), 6.0);
+        BOOST_TEST_EQ(get<value_double>(sym, keys::stroke_opacity, *feature, vars), 0.5);
+        BOOST_TEST_EQ(get<std::string>(sym, keys::file, *feature, vars), std::string("icons/dot.svg"));
+        BOOST_TEST_EQ(get<line_cap_enum>(sym, keys::stroke_linecap, *feature, vars), ROUND_CAP);
+        BOOST_TEST_EQ(get<value_double>(sym, keys::offset, *feature, vars, 1.5), 1.5);
+        // raw lookups still see the stored expression
+        BOOST_TEST(get<expression_ptr>(sym, keys::stroke_opacity) != nullptr);
+
+        // changing a property drops the compiled form
+        put(sym, keys::stroke_opacity, 0.75);
+        BOOST_TEST(sym.compiled == nullptr);
+        BOOST_TEST_EQ(get<value_double>(sym, keys::stroke_opacity, *feature, vars), 0.75);
+    } catch (std::exception const& ex) {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
     if (!::boost::detail::test_errors()) {
         if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
         else std::clog << "C++ exceptions: \x1b[1;32m✓ \x1b[0m\n";
@@ -0,0 +1,147 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/color.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/text/placement_finder.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/text/placements_list.hpp>
+#include <mapnik/text/glyph_info.hpp>
+#include <mapnik/text/text_layout_cache.hpp>
+#include <vector>
+#include <string>
+#include <tuple>
+#include <algorithm>
+
+#include "utils.hpp"
+
+namespace {
+
+mapnik::text_placements_ptr make_placements(double text_size)
+{
+    mapnik::text_placements_ptr placements = std::make_shared<mapnik::text_placements_dummy>();
+    placements->defaults.format_defaults.face_name = "DejaVu Sans Book";
+    placements->defaults.format_defaults.text_size = text_size;
+    placements->defaults.format_defaults.fill = mapnik::color(0,0,0);
+    placements->defaults.layout_defaults.wrap_width = 40.0;
+    placements->defaults.set_old_style_expression(mapnik::parse_expression("[name]"));
+    return placements;
+}
+
+struct label
+{
+    std::string name;
+    mapnik::text_placements_ptr placements;
+    double scale_factor;
+    mapnik::pixel_position pos;
+};
+
+// glyph index, character and position of every placed glyph
+using glyph_summary = std::tuple<unsigned, unsigned, double, double, double, double>;
+
+// Places the label as a text symbolizer would. Returns the glyphs that were
+// placed and the address of the first one, which lives in the layout.
+std::vector<glyph_summary> place(mapnik::face_manager_freetype & font_manager,
+                                 label const& l,
+                                 mapnik::glyph_info const** first_glyph)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx,1));
+    mapnik::transcoder tr("utf-8");
+    feature->put("name", tr.transcode(l.name.c_str()));
+    mapnik::attributes vars;
+    mapnik::box2d<double> extent(0, 0, 512, 512);
+    mapnik::label_collision_detector4 detector(extent);
+    mapnik::text_placement_info_ptr info = l.placements->get_placement_info(l.scale_factor);
+    mapnik::placement_finder finder(*feature, vars, detector, extent, *info, font_manager, l.scale_factor);
+    std::vector<glyph_summary> glyphs;
+    *first_glyph = nullptr;
+    while (finder.next_position())
+    {
+        if (finder.find_point_placement(l.pos)) break;
+    }
+    for (mapnik::glyph_positions_ptr const& positions : finder.placements())
+    {
+        for (mapnik::glyph_position const& glyph : *positions)
+        {
+            if (!*first_glyph) *first_glyph = glyph.glyph;
+            glyphs.emplace_back(glyph.glyph->glyph_index, glyph.glyph->char_index,
+                                glyph.pos.x, glyph.pos.y, glyph.rot.sin, glyph.rot.cos);
+        }
+    }
+    return glyphs;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        BOOST_TEST(set_working_dir(args));
+        BOOST_TEST(mapnik::freetype_engine::register_font("fonts/dejavu-fonts-ttf-2.33/ttf/DejaVuSans.ttf"));
+
+        mapnik::text_placements_ptr small = make_placements(10.0);
+        mapnik::text_placements_ptr large = make_placements(12.0);
+        // segments of one road, then labels differing by text, format and scale factor
+        std::vector<label> labels = {
+            { "Main Street", small, 1.0, { 100, 100 } },
+            { "Main Street", small, 1.0, { 300, 250 } },
+            { "Main Street", small, 1.0, { 120.5, 400.25 } },
+            { "Side Road", small, 1.0, { 100, 100 } },
+            { "Main Street", large, 1.0, { 100, 100 } },
+            { "Main Street", small, 2.0, { 100, 100 } }
+        };
+
+        mapnik::freetype_engine engine;
+        mapnik::face_manager_freetype cached_manager(engine);
+        mapnik::text_layout_cache & cache = cached_manager.get_layout_cache();
+        std::vector<mapnik::glyph_info const*> first_glyphs;
+        for (label const& l : labels)
+        {
+            mapnik::glyph_info const* first_glyph;
+            std::vector<glyph_summary> cached = place(cached_manager, l, &first_glyph);
+            BOOST_TEST(!cached.empty());
+            first_glyphs.push_back(first_glyph);
+            // a manager of its own starts with an empty cache
+            mapnik::face_manager_freetype uncached_manager(engine);
+            mapnik::glyph_info const* uncached_glyph;
+            BOOST_TEST(place(uncached_manager, l, &uncached_glyph) == cached);
+            BOOST_TEST_EQ(uncached_manager.get_layout_cache().size(), 1u);
+        }
+
+        // the same text and properties share one layout
+        BOOST_TEST(first_glyphs[1] == first_glyphs[0]);
+        BOOST_TEST(first_glyphs[2] == first_glyphs[0]);
+        // different text, format or scale factor miss
+        BOOST_TEST(first_glyphs[3] != first_glyphs[0]);
+        BOOST_TEST(first_glyphs[4] != first_glyphs[0]);
+        BOOST_TEST(first_glyphs[5] != first_glyphs[0]);
+        BOOST_TEST_EQ(cache.size(), 4u);
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ text layout cache: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,81 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/warp.hpp>
+#include <mapnik/util/process_bands.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/image_scaling.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool same_pixels(mapnik::image_data_32 const& a, mapnik::image_data_32 const& b)
+{
+    return a.width() == b.width() && a.height() == b.height() &&
+        std::memcmp(a.getData(), b.getData(), a.width() * a.height() * 4) == 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        mapnik::projection source_srs("+init=epsg:4326");
+        mapnik::projection target_srs("+init=epsg:3857");
+        mapnik::proj_transform prj_trans(target_srs, source_srs);
+
+        std::srand(11);
+        mapnik::raster source(mapnik::box2d<double>(-20, -10, 20, 10), 400, 200, 1.0, true);
+        for (unsigned y = 0; y < source.data_.height(); ++y)
+        {
+            for (unsigned x = 0; x < source.data_.width(); ++x)
+            {
+                unsigned a = 128 + std::rand() % 128;
+                unsigned c = std::rand() % (a + 1);
+                source.data_(x, y) = (a << 24) | (c << 16) | ((a - c) << 8) | (c / 2);
+            }
+        }
+
+        // large enough for several bands; the same with one thread, many
+        // threads and from the cache
+        mapnik::util::set_max_band_threads(0);
+        mapnik::box2d<double> target_extent(-2000000, -1000000, 2000000, 1000000);
+        for (mapnik::scaling_method_e method : { mapnik::SCALING_NEAR, mapnik::SCALING_BILINEAR,
+                                                 mapnik::SCALING_LANCZOS })
+        {
+            mapnik::raster expected(target_extent, 1024, 512, 1.0, true);
+            mapnik::reproject_and_scale_raster(expected, source, prj_trans, 0.0, 0.0, 16, method, 1);
+            for (unsigned threads : { 2u, 4u, 0u })
+            {
+                mapnik::raster actual(target_extent, 1024, 512, 1.0, true);
+                mapnik::reproject_and_scale_raster(actual, source, prj_trans, 0.0, 0.0, 16, method, threads);
+                BOOST_TEST(same_pixels(expected.data_, actual.data_));
+            }
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ warp: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
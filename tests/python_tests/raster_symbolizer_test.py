@@ -194,6 +194,43 @@ def test_raster_warping_does_not_overclip_source():
         mapnik.render(_map, im)
         assert im.view(0,200,1,1).tostring()=='\xff\xff\x00\xff'
 
+def render_gdal(filepath, block_cache, zoom, band=None):
+    lyr = mapnik.Layer('raster')
+    if band:
+        lyr.datasource = mapnik.Gdal(file=filepath, band=band, block_cache=block_cache)
+    else:
+        lyr.datasource = mapnik.Gdal(file=filepath, block_cache=block_cache)
+    sym = mapnik.RasterSymbolizer()
+    if band:
+        sym.colorizer = mapnik.RasterColorizer(mapnik.COLORIZER_LINEAR, mapnik.Color('transparent'))
+        sym.colorizer.add_stop(0, mapnik.Color('black'))
+        sym.colorizer.add_stop(100, mapnik.Color('white'))
+    rule = mapnik.Rule()
+    rule.symbols.append(sym)
+    style = mapnik.Style()
+    style.rules.append(rule)
+    _map = mapnik.Map(256,256)
+    _map.append_style('foo', style)
+    lyr.styles.append('foo')
+    _map.layers.append(lyr)
+    _map.zoom_all()
+    _map.zoom(zoom)
+    im = mapnik.Image(_map.width,_map.height)
+    mapnik.render(_map, im)
+    return im.tostring()
+
+def test_gdal_block_cache_reads_same_pixels():
+    if 'gdal' in mapnik.DatasourceCache.plugin_names():
+        # a tiled float raster through a colorizer and a striped rgb one;
+        # zoomed in, whole, and decimated
+        for filepath, band in [('../data/raster/dataraster.tif', 1),
+                               ('../data/raster/river.tiff', None)]:
+            for zoom in [0.3, 1.0, 4.0]:
+                expected = render_gdal(filepath, False, zoom, band)
+                # twice: decoding the blocks, then from the cache
+                eq_(render_gdal(filepath, True, zoom, band), expected)
+                eq_(render_gdal(filepath, True, zoom, band), expected)
+
 if __name__ == "__main__":
     setup()
     exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
@@ -416,6 +416,39 @@ if 'sqlite' in mapnik.DatasourceCache.plugin_names():
         eq_(feature,None)
         mapnik.logger.set_severity(default_logging_severity)
 
+    def test_initdb_runs_once():
+        # initdb writes to an attached file database: queries must neither
+        # run it again nor lose the temp table it creates
+        import sqlite3, tempfile
+        handle, counter = tempfile.mkstemp(suffix='.sqlite')
+        os.close(handle)
+        try:
+            db = sqlite3.connect(counter)
+            db.execute('create table runs (n INTEGER)')
+            db.commit()
+            db.close()
+            ds = mapnik.SQLite(file='../data/sqlite/qgis_spatiallite.sqlite',
+                table='initdb_point',
+                geometry_field='geometry',
+                key_field='pkuid',
+                use_spatial_index=False,
+                attachdb='counter@%s' % counter,
+                initdb='''
+                    insert into counter.runs values (1);
+                    create temp table initdb_point as select * from point;
+                    '''
+            )
+            fs = ds.featureset()
+            feature = fs.next()
+            eq_(feature['pkuid'],1)
+            fs = ds.featureset()
+            fs.next()
+            db = sqlite3.connect(counter)
+            eq_(db.execute('select count(*) from runs').fetchone()[0],1)
+            db.close()
+        finally:
+            os.remove(counter)
+
 if __name__ == "__main__":
     setup()
     exit(run_all(eval(x) for x in dir() if x.startswith("test_")))